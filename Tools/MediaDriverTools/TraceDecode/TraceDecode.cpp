@@ -0,0 +1,178 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     TraceDecode.cpp
+//! \brief    Prints the binary trace events written by the media driver when
+//!           MOS_TRACE_FILE is set, one event per line sorted by time.
+//!
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// Layout of the trace file, must match MOS_TRACE_FILE_HEADER and
+// MOS_TRACE_RECORD in media_driver/linux/common/os/mos_utilities_specific.h
+#define TRACE_FILE_MAGIC            "IMTEBIN"
+#define TRACE_FILE_VERSION          1
+#define TRACE_RECORD_DATA_SIZE      44
+
+struct TraceFileHeader
+{
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    recordSize;
+    uint64_t    startTime;
+};
+
+struct TraceRecord
+{
+    uint64_t    time;
+    uint32_t    threadId;
+    uint16_t    id;
+    uint8_t     type;
+    uint8_t     reserved;
+    uint16_t    size1;
+    uint16_t    size2;
+    uint8_t     data[TRACE_RECORD_DATA_SIZE];
+};
+
+// MEDIA_EVENT of media_driver/agnostic/common/os/mos_os_trace_event.h
+static const char *EVENT_NAMES[] =
+{
+    "UNDEFINED_EVENT",
+    "EVENT_RESOURCE_ALLOCATE",
+    "EVENT_RESOURCE_FREE",
+    "EVENT_RESOURCE_REGISTER",
+    "EVENT_RESOURCE_PATCH",
+    "EVENT_PPED_HUC",
+    "EVENT_PPED_FW",
+    "EVENT_PPED_AUDIO",
+    "EVENT_BLT_ENC",
+    "EVENT_BLT_DEC",
+    "EVENT_PPED_HW_CAPS",
+    "EVENT_MOS_MESSAGE",
+    "EVENT_CODEC_NV12ToP010",
+    "EVENT_CODEC_CENC",
+    "EVENT_CODEC_DECODE_DDI",
+    "EVENT_CODEC_DECODE",
+    "EVENT_CODEC_ENCODE_DDI",
+    "EVENT_ENCODER_CREATE",
+    "EVENT_ENCODER_DESTROY",
+    "EVENT_CODECHAL_CREATE",
+    "EVENT_CODECHAL_EXECUTE",
+    "EVENT_CODECHAL_DESTROY",
+    "EVENT_MHW_PROLOG",
+    "EVENT_MHW_EPILOG",
+    "EVENT_KEYEXCHANGE_WV",
+};
+
+// MEDIA_EVENT_TYPE
+static const char *EVENT_TYPES[] = { "INFO", "START", "END" };
+
+static void PrintData(const uint8_t *data, uint32_t size, uint32_t stored)
+{
+    for (uint32_t i = 0; i < stored; i++)
+    {
+        printf("%02X", data[i]);
+    }
+    if (stored < size)
+    {
+        printf("...(%u bytes)", size);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0 ||
+        header.version != TRACE_FILE_VERSION ||
+        header.recordSize != sizeof(TraceRecord))
+    {
+        fprintf(stderr, "%s is not a media driver trace file of version %d\n", argv[1], TRACE_FILE_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    // Records are flushed per thread, sort them back in time order
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1)
+    {
+        records.push_back(record);
+    }
+    fclose(file);
+
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) { return a.time < b.time; });
+
+    printf("%-14s %-8s %-28s %-6s %s\n", "Time(us)", "Thread", "Event", "Type", "Data");
+    for (const TraceRecord &r : records)
+    {
+        double time = (r.time >= header.startTime) ? (r.time - header.startTime) / 1000.0 : 0.0;
+
+        printf("%-14.3f %-8u ", time, r.threadId);
+        if (r.id < sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]))
+        {
+            printf("%-28s ", EVENT_NAMES[r.id]);
+        }
+        else
+        {
+            printf("%-28u ", r.id);
+        }
+        if (r.type < sizeof(EVENT_TYPES) / sizeof(EVENT_TYPES[0]))
+        {
+            printf("%-6s ", EVENT_TYPES[r.type]);
+        }
+        else
+        {
+            printf("%-6u ", r.type);
+        }
+
+        uint32_t stored1 = std::min<uint32_t>(r.size1, TRACE_RECORD_DATA_SIZE);
+        uint32_t stored2 = std::min<uint32_t>(r.size2, TRACE_RECORD_DATA_SIZE - stored1);
+        PrintData(r.data, r.size1, stored1);
+        if (r.size2)
+        {
+            printf(" ");
+            PrintData(r.data + stored1, r.size2, stored2);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
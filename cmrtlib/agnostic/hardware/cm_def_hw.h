@@ -335,7 +335,9 @@ struct CM_DEVICE_CREATE_BUFFER_ALIAS_PARAM
 #endif
 
 #if MDF_PROFILER_ENABLED
-#define INSERT_PROFILER_RECORD()     CmTimer Time(__FUNCTION__ )
+#define INSERT_PROFILER_RECORD()                                                    \
+    static const uint32_t cmProfilerApiId = CmTimer::RegisterApi(__FUNCTION__);     \
+    CmTimer Time(__FUNCTION__, cmProfilerApiId)
 #else
 #define INSERT_PROFILER_RECORD()
 #endif
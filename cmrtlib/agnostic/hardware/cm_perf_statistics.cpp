@@ -22,21 +22,73 @@
 #include "cm_perf_statistics.h"
 #include "cm_mem.h"
 #include "cm_sdk_provider.h"
+#include <algorithm>
+#include <new>
 
 #if MDF_PROFILER_ENABLED
 
-CmPerfStatistics::CmPerfStatistics()
+// Record ring of the calling thread, there is a single CmPerfStatistics per process
+static thread_local ApiCallRecordBuffer *s_threadRecordBuffer = nullptr;
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Map a duration to a log-linear histogram bucket, exact below 4
+//|             ticks, then 4 buckets per power of 2
+//*-----------------------------------------------------------------------------
+static uint32_t GetHistogramBucket(uint64_t ticks)
 {
+    if (ticks < (1ULL << CM_PERF_HISTOGRAM_SUB_BITS))
+    {
+        return (uint32_t)ticks;
+    }
 
-    m_apiCallRecordCount  = 0;
-    m_apiCallFile         = nullptr;
+    uint32_t msb = 63 - __builtin_clzll(ticks);
+    uint32_t sub = (uint32_t)(ticks >> (msb - CM_PERF_HISTOGRAM_SUB_BITS)) & ((1 << CM_PERF_HISTOGRAM_SUB_BITS) - 1);
+    return ((msb - CM_PERF_HISTOGRAM_SUB_BITS + 1) << CM_PERF_HISTOGRAM_SUB_BITS) + sub;
+}
 
-    m_perfStatisticFile   = nullptr;
-    m_perfStatisticCount = 0;
+//*-----------------------------------------------------------------------------
+//| Purpose:    Largest duration falling into a histogram bucket
+//*-----------------------------------------------------------------------------
+static uint64_t GetHistogramBucketUpperBound(uint32_t bucket)
+{
+    if (bucket < (1 << CM_PERF_HISTOGRAM_SUB_BITS))
+    {
+        return bucket;
+    }
+
+    uint32_t msb   = (bucket >> CM_PERF_HISTOGRAM_SUB_BITS) + CM_PERF_HISTOGRAM_SUB_BITS - 1;
+    uint32_t sub   = bucket & ((1 << CM_PERF_HISTOGRAM_SUB_BITS) - 1);
+    uint32_t shift = msb - CM_PERF_HISTOGRAM_SUB_BITS;
+    uint64_t lower = ((uint64_t)((1 << CM_PERF_HISTOGRAM_SUB_BITS) + sub)) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+CmPerfStatistics::CmPerfStatistics()
+{
+    LARGE_INTEGER freq;
+
+    m_apiCount.store(0);
 
     m_profilerOn      = false;
     m_profilerLevel    = CM_RT_PERF_LOG_LEVEL_DEFAULT;
 
+    // Query the frequency once instead of in every timer
+    QueryPerformanceFrequency(&freq);
+    m_frequency = freq.QuadPart;
+
+    for (uint32_t i = 0; i < CM_PERF_MAX_API_NUM; i++)
+    {
+        ApiPerfStatistic *statistic = &m_perfStatisticRecords[i];
+        statistic->functionName = nullptr;
+        statistic->callTimes.store(0);
+        statistic->totalTicks.store(0);
+        statistic->maxTicks.store(0);
+        for (uint32_t j = 0; j < CM_PERF_HISTOGRAM_BUCKETS; j++)
+        {
+            statistic->histogram[j].store(0);
+        }
+    }
+
     GetProfilerLevel(); // get profiler level from env variable "CM_RT_PERF_LOG"
 
     if(m_profilerLevel >= CM_RT_PERF_LOG_LEVEL_ETW)
@@ -51,134 +103,255 @@ CmPerfStatistics::~CmPerfStatistics()
     DumpApiCallRecords();
 
     DumpPerfStatisticRecords();
+
+    CLock locker(m_criticalSection);
+
+    m_profilerOn = false;
+    for (size_t i = 0; i < m_threadRecordBuffers.size(); i++)
+    {
+        CmSafeRelease(m_threadRecordBuffers[i]);
+    }
+    m_threadRecordBuffers.clear();
 }
 
 void CmPerfStatistics::GetProfilerLevel()
-{   // Enabled Profiler in Debug Mode
+{   // Enabled Profiler in Debug Mode, records level unless "CM_RT_PERF_LOG" says otherwise
+    char *level = nullptr;
+
     m_profilerLevel = CM_RT_PERF_LOG_LEVEL_RECORDS;
     m_profilerOn   = true;
+
+    CM_GETENV(level, "CM_RT_PERF_LOG");
+    if (level != nullptr)
+    {
+        int value = atoi(level);
+        if (value >= CM_RT_PERF_LOG_LEVEL_DEFAULT && value <= CM_RT_PERF_LOG_LEVEL_RECORDS)
+        {
+            m_profilerLevel = (PerfLogLevel)value;
+        }
+        CM_GETENV_FREE(level);
+    }
     return;
 }
 
-//! Insert API Call Records Into m_apiCallRecords Array and Update Perf Statistic Array accordingly
-void CmPerfStatistics::InsertApiCallRecord(char *functionName, float time, LARGE_INTEGER start, LARGE_INTEGER end)
+//! Intern an API name, called once per call site
+uint32_t CmPerfStatistics::RegisterApi(const char *functionName)
 {
-    CLock locker(m_criticalSectionOnApiCallRecords);
+    CLock locker(m_criticalSection);
+    uint32_t apiCount = m_apiCount.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < apiCount; i++)
+    {
+        if (!strcmp(m_perfStatisticRecords[i].functionName, functionName))
+        {
+            return i;
+        }
+    }
 
-    ApiCallRecord *records = new ApiCallRecord ;
+    if (apiCount >= CM_PERF_MAX_API_NUM)
+    {
+        return CM_PERF_INVALID_API_ID;
+    }
 
-    records->startTime = start;
-    records->endTime   = end;
-    records->duration   = time;
+    // Lock-free readers check the id against the count, publish the name first
+    m_perfStatisticRecords[apiCount].functionName = functionName;
+    m_apiCount.store(apiCount + 1, std::memory_order_release);
+    return apiCount;
+}
 
-    CM_STRCPY(records->functionName, MSG_STRING_SIZE, functionName);
+ApiCallRecordBuffer *CmPerfStatistics::GetThreadRecordBuffer()
+{
+    if (s_threadRecordBuffer == nullptr)
+    {
+        CLock locker(m_criticalSection);
 
-    m_apiCallRecords.push_back(records);
-    m_apiCallRecordCount++;
+        ApiCallRecordBuffer *buffer = new (std::nothrow) ApiCallRecordBuffer;
+        if (buffer == nullptr)
+        {
+            return nullptr;
+        }
+        buffer->threadId = (uint32_t)m_threadRecordBuffers.size() + 1;
+        buffer->recordCount.store(0);
 
-    InsertPerfStatistic(records);
+        m_threadRecordBuffers.push_back(buffer);
+        s_threadRecordBuffer = buffer;
+    }
 
+    return s_threadRecordBuffer;
 }
 
-//Update Perf Statistic Array
-void CmPerfStatistics::InsertPerfStatistic(ApiCallRecord *record)
+//! Update the API statistics and append the call to the ring of the calling thread
+void CmPerfStatistics::InsertApiCallRecord(uint32_t apiId, LARGE_INTEGER start, LARGE_INTEGER end)
 {
-    uint32_t index = 0;
-
-    for( index = 0 ; index < m_perfStatisticCount ; index ++)
+    if (!m_profilerOn || apiId >= m_apiCount.load(std::memory_order_acquire))
     {
-        ApiPerfStatistic *perfStatisticRecords = m_perfStatisticRecords[index];
-        if(perfStatisticRecords != nullptr)
-        {
-            if(!strcmp(record->functionName, perfStatisticRecords->functionName))
-            { // existing
-               perfStatisticRecords->callTimes ++ ;
-               perfStatisticRecords->time += record->duration;
+        return;
+    }
 
-               //Update statistic records
-               m_perfStatisticRecords[index] = perfStatisticRecords;
+    ApiPerfStatistic *statistic = &m_perfStatisticRecords[apiId];
+    uint64_t ticks = (end.QuadPart > start.QuadPart) ? (uint64_t)(end.QuadPart - start.QuadPart) : 0;
 
-               break;
-            }
-        }
-    }
+    statistic->callTimes.fetch_add(1, std::memory_order_relaxed);
+    statistic->totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+    statistic->histogram[GetHistogramBucket(ticks)].fetch_add(1, std::memory_order_relaxed);
 
-    if(index == m_perfStatisticCount)
-    { // record does not exist, create new entry
-        ApiPerfStatistic *perfStatisticRecords = new ApiPerfStatistic;
-        CM_STRCPY(perfStatisticRecords->functionName, MSG_STRING_SIZE, record->functionName);
+    uint64_t maxTicks = statistic->maxTicks.load(std::memory_order_relaxed);
+    while (ticks > maxTicks &&
+           !statistic->maxTicks.compare_exchange_weak(maxTicks, ticks, std::memory_order_relaxed))
+    {
+    }
 
-        perfStatisticRecords->callTimes = 1;
-        perfStatisticRecords->time       = record->duration;
+    if (m_profilerLevel < CM_RT_PERF_LOG_LEVEL_RECORDS)
+    {
+        return;
+    }
 
-        m_perfStatisticRecords.push_back(perfStatisticRecords);
-        m_perfStatisticCount ++;
+    ApiCallRecordBuffer *buffer = GetThreadRecordBuffer();
+    if (buffer == nullptr)
+    {
+        return;
     }
 
-    return ;
+    // Only the owning thread writes its ring, the oldest records are overwritten
+    uint64_t count = buffer->recordCount.load(std::memory_order_relaxed);
+    ApiCallRecord *record = &buffer->records[count % CM_PERF_RECORDS_PER_THREAD];
+    record->apiId     = apiId;
+    record->startTime = start.QuadPart;
+    record->endTime   = end.QuadPart;
+    buffer->recordCount.store(count + 1, std::memory_order_release);
 }
 
-//Dump APICall Records and Release m_apiCallRecords Array
+//Dump APICall Records of all threads, sorted by start time
 void CmPerfStatistics::DumpApiCallRecords()
 {
-    if(!m_profilerOn)
+    FILE *apiCallFile = nullptr;
+    FILE *traceFile   = nullptr;
+    std::vector<std::pair<const ApiCallRecord*, uint32_t>> records; // record and thread id
+
+    if(!m_profilerOn || m_profilerLevel < CM_RT_PERF_LOG_LEVEL_RECORDS)
     {
         return ;
     }
 
-    CM_FOPEN(m_apiCallFile, "CmPerfLog.csv", "wb");
-    if(! m_apiCallFile )
+    {
+        CLock locker(m_criticalSection);
+        for (size_t i = 0; i < m_threadRecordBuffers.size(); i++)
+        {
+            ApiCallRecordBuffer *buffer = m_threadRecordBuffers[i];
+            uint64_t count = buffer->recordCount.load(std::memory_order_acquire);
+            uint64_t first = (count > CM_PERF_RECORDS_PER_THREAD) ? count - CM_PERF_RECORDS_PER_THREAD : 0;
+            for (uint64_t j = first; j < count; j++)
+            {
+                records.push_back(std::make_pair(&buffer->records[j % CM_PERF_RECORDS_PER_THREAD], buffer->threadId));
+            }
+        }
+    }
+
+    std::sort(records.begin(), records.end(),
+              [](const std::pair<const ApiCallRecord*, uint32_t> &a,
+                 const std::pair<const ApiCallRecord*, uint32_t> &b)
+              { return a.first->startTime < b.first->startTime; });
+
+    CM_FOPEN(apiCallFile, "CmPerfLog.csv", "wb");
+    if(! apiCallFile )
     {
         fprintf(stdout, "Fail to create file CmPerfLog.csv \n ");
         return ;
     }
-    fprintf(m_apiCallFile,  "%-40s %s \t %s \t %s \n", "FunctionName", "StartTime", "EndTime", "Duration");
+    fprintf(apiCallFile,  "%-40s %s \t %s \t %s \t %s \n", "FunctionName", "Thread", "StartTime", "EndTime", "Duration");
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const ApiCallRecord *record = records[i].first;
+
+        fprintf(apiCallFile,  "%-40s  %u \t %lld \t %lld \t %fms \n",
+           m_perfStatisticRecords[record->apiId].functionName, records[i].second,
+           (long long)record->startTime, (long long)record->endTime,
+           TicksToMs(record->endTime - record->startTime));
+    }
 
-    for(uint32_t i=0 ; i< m_apiCallRecordCount ; i++)
+    fclose(apiCallFile);
+
+    // Same records as a Chrome trace, times in us
+    CM_FOPEN(traceFile, "CmPerfTrace.json", "wb");
+    if(! traceFile )
     {
-        ApiCallRecord *records = m_apiCallRecords[i];
+        fprintf(stdout, "Fail to create file CmPerfTrace.json \n ");
+        return ;
+    }
+    fprintf(traceFile, "{\"traceEvents\":[\n");
 
-        fprintf(m_apiCallFile,  "%-40s  %lld \t %lld \t %fms \n", records->functionName,
-           records->startTime.QuadPart, records->endTime.QuadPart, records->duration);
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const ApiCallRecord *record = records[i].first;
 
-        CmSafeRelease(records);
+        fprintf(traceFile, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+           m_perfStatisticRecords[record->apiId].functionName, records[i].second,
+           TicksToMs(record->startTime) * 1000.0, TicksToMs(record->endTime - record->startTime) * 1000.0,
+           (i + 1 < records.size()) ? "," : "");
     }
 
-    m_apiCallRecords.clear();
+    fprintf(traceFile, "]}\n");
+    fclose(traceFile);
+}
+
+//Smallest duration at or above the given percentage of the calls, bucket precision
+uint64_t CmPerfStatistics::GetHistogramPercentile(ApiPerfStatistic *statistic, uint64_t callTimes, uint32_t percent)
+{
+    uint64_t target = (callTimes * percent + 99) / 100;
+    uint64_t count  = 0;
 
-    fclose(m_apiCallFile);
+    for (uint32_t i = 0; i < CM_PERF_HISTOGRAM_BUCKETS; i++)
+    {
+        count += statistic->histogram[i].load(std::memory_order_relaxed);
+        if (count >= target)
+        {
+            return GetHistogramBucketUpperBound(i);
+        }
+    }
 
+    return statistic->maxTicks.load(std::memory_order_relaxed);
 }
 
-//Dump Perf Statistic Records and Release m_perfStatisticRecords Array
+//Dump Perf Statistic Records
 void CmPerfStatistics::DumpPerfStatisticRecords()
 {
+    FILE *perfStatisticFile = nullptr;
+
     if(!m_profilerOn)
     {
         return ;
     }
 
-    CM_FOPEN(m_perfStatisticFile, "CmPerfStatistics.txt","wb");
-    if(!m_perfStatisticFile )
+    CM_FOPEN(perfStatisticFile, "CmPerfStatistics.txt","wb");
+    if(!perfStatisticFile )
     {
         fprintf(stdout, "Fail to create file CmPerfStatistics.txt \n ");
         return ;
     }
-    fprintf(m_perfStatisticFile,  "%-40s %s \t %s \n", "FunctionName", "Total Time(ms)", "Called Times");
+    fprintf(perfStatisticFile,  "%-40s %s \t %s \t %s \t %s \t %s \t %s \n", "FunctionName", "Total Time(ms)",
+        "Called Times", "Avg(ms)", "P50(ms)", "P99(ms)", "Max(ms)");
 
-    for(uint32_t i=0 ; i< m_perfStatisticCount; i++)
+    uint32_t apiCount = m_apiCount.load(std::memory_order_acquire);
+    for(uint32_t i=0 ; i< apiCount; i++)
     {
-        ApiPerfStatistic *perfStatisticRecords = m_perfStatisticRecords[i];
+        ApiPerfStatistic *statistic = &m_perfStatisticRecords[i];
+        uint64_t callTimes  = statistic->callTimes.load(std::memory_order_relaxed);
+        uint64_t totalTicks = statistic->totalTicks.load(std::memory_order_relaxed);
 
-        fprintf(m_perfStatisticFile,  "%-40s %fms \t %d \n", perfStatisticRecords->functionName,
-           perfStatisticRecords->time, perfStatisticRecords->callTimes);
+        if (callTimes == 0)
+        {
+            continue;
+        }
 
-        CmSafeRelease(perfStatisticRecords);
+        fprintf(perfStatisticFile,  "%-40s %fms \t %llu \t %fms \t %fms \t %fms \t %fms \n", statistic->functionName,
+           TicksToMs(totalTicks), (unsigned long long)callTimes, TicksToMs(totalTicks) / callTimes,
+           TicksToMs(GetHistogramPercentile(statistic, callTimes, 50)),
+           TicksToMs(GetHistogramPercentile(statistic, callTimes, 99)),
+           TicksToMs(statistic->maxTicks.load(std::memory_order_relaxed)));
     }
 
-    m_perfStatisticRecords.clear();
-
-    fclose(m_perfStatisticFile);
+    fclose(perfStatisticFile);
 
 }
 
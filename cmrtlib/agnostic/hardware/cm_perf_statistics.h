@@ -23,29 +23,42 @@
 #define CMRTLIB_AGNOSTIC_HARDWARE_CM_PERF_STATISTICS_H_
 
 #include <vector>
+#include <atomic>
 #include <cstdio>
 #include "cm_def_hw.h"
 #include "cm_include.h"
 
 #if MDF_PROFILER_ENABLED
 
-#define MAX_RECORD_NUM  256
 #define MSG_STRING_SIZE 256
-#define INIT_ARRAY_ZIE  256
+
+#define CM_PERF_MAX_API_NUM             256     // distinct API names that can be profiled
+#define CM_PERF_RECORDS_PER_THREAD      4096    // per-thread ring size, the oldest records are overwritten
+#define CM_PERF_HISTOGRAM_SUB_BITS      2       // 4 buckets per power of 2, about 20% latency precision
+#define CM_PERF_HISTOGRAM_BUCKETS       (64 << CM_PERF_HISTOGRAM_SUB_BITS)
+#define CM_PERF_INVALID_API_ID          0xFFFFFFFF
 
 struct ApiPerfStatistic
 {
-    char  functionName[MSG_STRING_SIZE];       // function name
-    float time;                                 // accumulative api duration
-    uint32_t callTimes;                           // called times
+    const char            *functionName;      // function name, interned by RegisterApi
+    std::atomic<uint64_t>  callTimes;          // called times
+    std::atomic<uint64_t>  totalTicks;         // accumulative api duration
+    std::atomic<uint64_t>  maxTicks;           // longest api duration
+    std::atomic<uint64_t>  histogram[CM_PERF_HISTOGRAM_BUCKETS];   // log-linear latency histogram
 };
 
 struct ApiCallRecord
 {
-    char  functionName[MSG_STRING_SIZE];       // function name
-    LARGE_INTEGER  startTime;                  // start time
-    LARGE_INTEGER  endTime;                    // end time
-    float          duration;                    // duration
+    uint32_t       apiId;                      // interned function name
+    int64_t        startTime;                  // start time in ticks
+    int64_t        endTime;                    // end time in ticks
+};
+
+struct ApiCallRecordBuffer
+{
+    uint32_t               threadId;           // sequential id of the recording thread
+    std::atomic<uint64_t>  recordCount;        // records ever written, the ring position is recordCount % size
+    ApiCallRecord          records[CM_PERF_RECORDS_PER_THREAD];
 };
 
 enum PerfLogLevel
@@ -62,39 +75,50 @@ public:
     ~CmPerfStatistics();
 
     //!
-    //! \brief    Insert API call record 
-    //! \details  Insert API call record which contains function name, start time, end and duration.
+    //! \brief    Intern an API name
+    //! \details  Called once per call site, the returned id is used by every
+    //!           record of the call site instead of its name.
     //! \param    [in] functionName
-    //!           pointer to function name's string
-    //! \param    [in] time
-    //!           function's duration
+    //!           pointer to function name's string, must stay valid
+    //! \return   id of the API, CM_PERF_INVALID_API_ID if there are too many
+    //!
+    uint32_t RegisterApi(const char *functionName);
+
+    //!
+    //! \brief    Insert API call record 
+    //! \details  Update the API statistics with atomics and, at the records
+    //!           level, append the call to the ring buffer of the calling
+    //!           thread. No lock is taken.
+    //! \param    [in] apiId
+    //!           id returned by RegisterApi
     //! \param    [in] start
     //!           function's start time
     //! \param    [in] end
     //!           function's end time
     //!
-    void InsertApiCallRecord(char *functionName, float time, LARGE_INTEGER start, LARGE_INTEGER end);
-
-    //!
-    //! \brief    Insert API call record into performace statistic record
-    //! \details  Insert API call record into performace statistic record.
-    //! \param    [in] pRecords
-    //!           pointer to API call record
-    //!
-    void InsertPerfStatistic(ApiCallRecord *records);
+    void InsertApiCallRecord(uint32_t apiId, LARGE_INTEGER start, LARGE_INTEGER end);
 
 private:
 
     //!
     //! \brief    Check the profiler level
-    //! \details  So far, this function turns the profiler on.
+    //! \details  The level comes from env variable "CM_RT_PERF_LOG", the
+    //!           records level is used if it is not set.
     //!
     void GetProfilerLevel();
 
+    //!
+    //! \brief    Get the record ring buffer of the calling thread
+    //! \details  The buffer is created at the first call of each thread and
+    //!           kept until the statistics are destroyed.
+    //!
+    ApiCallRecordBuffer *GetThreadRecordBuffer();
+
     //!
     //! \brief    Dump API call records into file
     //! \details  Dump API call records into file, 
-    //!           "CmPerfLog.csv" under app's location.
+    //!           "CmPerfLog.csv" under app's location, and as a Chrome trace,
+    //!           "CmPerfTrace.json", which chrome://tracing can open.
     //!
     void DumpApiCallRecords();
 
@@ -105,17 +129,17 @@ private:
     //!
     void DumpPerfStatisticRecords();
 
-    CSync           m_criticalSectionOnApiCallRecords;
-    uint32_t        m_apiCallRecordCount;
-    FILE           *m_apiCallFile;
+    uint64_t GetHistogramPercentile(ApiPerfStatistic *statistic, uint64_t callTimes, uint32_t percent);
+
+    double TicksToMs(uint64_t ticks) { return (double)ticks * 1000.0 / (double)m_frequency; }
 
-    CSync           m_criticalSectionOnPerfStatisticRecords;
-    FILE           *m_perfStatisticFile;
-    uint32_t        m_perfStatisticCount;
+    CSync           m_criticalSection;          // only for API registration and new threads
+    std::atomic<uint32_t> m_apiCount;           // published with release after the name is set
+    ApiPerfStatistic m_perfStatisticRecords[CM_PERF_MAX_API_NUM]; // perf statistic information, indexed by API id
 
-    std::vector<ApiCallRecord*>      m_apiCallRecords;  // array to store api call records
-    std::vector<ApiPerfStatistic*>   m_perfStatisticRecords; // array to store perf statistic information
+    std::vector<ApiCallRecordBuffer*> m_threadRecordBuffers;     // record rings of all threads
 
+    int64_t      m_frequency;    // ticks per second
     PerfLogLevel m_profilerLevel; // profiler level
     bool m_profilerOn;   // profiler on or off
 
@@ -32,28 +32,31 @@
 class CmTimer
 {
 public:
-    CmTimer(const char *functionName);
+    CmTimer(const char *functionName, uint32_t apiId);
 
     ~CmTimer();
 
+    //!
+    //! \brief    Intern the name of a profiled function
+    //! \details  INSERT_PROFILER_RECORD calls it once per call site and keeps
+    //!           the id in a function-local static.
+    //!
+    static uint32_t RegisterApi(const char *functionName);
+
 private:
     void Start();
 
     void Stop();
 
-    float GetTimeinMs();
-
     void InsertEventStartFlag();
 
     void InsertEventEndFlag();
 
-    uint64_t m_cycles;
-
     LARGE_INTEGER m_start;
 
     LARGE_INTEGER m_end;
 
-    LARGE_INTEGER m_freq;
+    uint32_t m_apiId;
 
     char *m_funcName;
 };
@@ -35,7 +35,9 @@ enum CM_EVENT_PROFILING_INFO
     CM_EVENT_PROFILING_KERNELCOUNT,
     CM_EVENT_PROFILING_KERNELNAMES,
     CM_EVENT_PROFILING_THREADSPACE,
-    CM_EVENT_PROFILING_CALLBACK
+    CM_EVENT_PROFILING_CALLBACK,
+    CM_EVENT_PROFILING_QUEUEDEPTH,
+    CM_EVENT_PROFILING_FLUSHSTALL
 };
 
 enum CM_STATUS
@@ -156,14 +158,18 @@ public:
     //!
     //! \brief      This function can be used to get more profiling 
     //!             information for vTune.
-    //! \details    It can provided 9 profiling values, for profiling 
+    //! \details    It can provided 11 profiling values, for profiling 
     //!             information,including
     //!             CM_EVENT_PROFILING_HWSTART,CM_EVENT_PROFILING_HWEND,
     //!             CM_EVENT_PROFILING_SUBMIT,CM_EVENT_PROFILING_COMPLETE,
     //!             CM_EVENT_PROFILING_ENQUEUE,CM_EVENT_PROFILING_KERNELCOUNT,
     //!             CM_EVENT_PROFILING_KERNELNAMES,
     //!             CM_EVENT_PROFILING_THREADSPACE, 
-    //!             CM_EVENT_PROFILING_CALLBACK.
+    //!             CM_EVENT_PROFILING_CALLBACK,
+    //!             CM_EVENT_PROFILING_QUEUEDEPTH (uint32_t, tasks still
+    //!             running on GPU when the task was flushed),
+    //!             CM_EVENT_PROFILING_FLUSHSTALL (uint64_t, time in ns the
+    //!             flush waited for GPU to free a task slot).
     //! \param      [in] infoType
     //!             One value of CM_EVENT_PROFILING_INFO, specify which 
     //!             information to get.
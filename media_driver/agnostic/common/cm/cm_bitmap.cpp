@@ -0,0 +1,222 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      cm_bitmap.cpp
+//! \brief     Contains Class CmBitmap definitions
+//!
+
+#include "cm_bitmap.h"
+#include "cm_mem.h"
+
+#define CM_BITMAP_WORD_SHIFT    6
+#define CM_BITMAP_WORD_MASK     63
+#define CM_BITMAP_BIT(i)        (1ULL << ((i) & CM_BITMAP_WORD_MASK))
+
+namespace CMRT_UMD
+{
+//*-----------------------------------------------------------------------------
+//| Purpose:    Constructor of CmBitmap
+//| Returns:    None.
+//*-----------------------------------------------------------------------------
+CmBitmap::CmBitmap():
+    m_levelCount(0),
+    m_size(0)
+{
+    CmSafeMemSet(m_levels, 0, sizeof(m_levels));
+    CmSafeMemSet(m_wordCount, 0, sizeof(m_wordCount));
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Destructor of CmBitmap
+//| Returns:    None.
+//*-----------------------------------------------------------------------------
+CmBitmap::~CmBitmap()
+{
+    Destroy();
+}
+
+void CmBitmap::Destroy()
+{
+    for (uint32_t level = 0; level < CM_BITMAP_MAX_LEVELS; level++)
+    {
+        MosSafeDeleteArray(m_levels[level]);
+        m_wordCount[level] = 0;
+    }
+    m_levelCount = 0;
+    m_size = 0;
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Allocate the bitmap with all bits cleared
+//| Arguments :
+//|               size        [in]       number of bits
+//|
+//| Returns:    Result of the operation.
+//*-----------------------------------------------------------------------------
+int32_t CmBitmap::Initialize(uint32_t size)
+{
+    uint32_t bitCount = size;
+
+    Destroy();
+
+    if (size == 0)
+    {
+        CM_ASSERTMESSAGE("Error: Invalid bitmap size.");
+        return CM_INVALID_ARG_VALUE;
+    }
+
+    // Add levels until one word summarizes the whole level below
+    do
+    {
+        if (m_levelCount >= CM_BITMAP_MAX_LEVELS)
+        {
+            Destroy();
+            CM_ASSERTMESSAGE("Error: Invalid bitmap size.");
+            return CM_INVALID_ARG_VALUE;
+        }
+
+        uint32_t wordCount = (bitCount + CM_BITMAP_WORD_MASK) >> CM_BITMAP_WORD_SHIFT;
+        m_levels[m_levelCount] = MOS_NewArray(uint64_t, wordCount);
+        if (m_levels[m_levelCount] == nullptr)
+        {
+            Destroy();
+            CM_ASSERTMESSAGE("Error: Out of system memory.");
+            return CM_OUT_OF_HOST_MEMORY;
+        }
+        CmSafeMemSet(m_levels[m_levelCount], 0, wordCount * sizeof(uint64_t));
+        m_wordCount[m_levelCount] = wordCount;
+        m_levelCount++;
+
+        bitCount = wordCount;
+    } while (bitCount > 1);
+
+    m_size = size;
+
+    return CM_SUCCESS;
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Set a bit, and mark its word as non-empty in the upper levels
+//*-----------------------------------------------------------------------------
+void CmBitmap::Set(uint32_t index)
+{
+    if (index >= m_size)
+    {
+        return;
+    }
+
+    for (uint32_t level = 0; level < m_levelCount; level++)
+    {
+        uint64_t &word = m_levels[level][index >> CM_BITMAP_WORD_SHIFT];
+        bool wasEmpty  = (word == 0);
+
+        word |= CM_BITMAP_BIT(index);
+        if (!wasEmpty)
+        {
+            break;
+        }
+        index >>= CM_BITMAP_WORD_SHIFT;
+    }
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Clear a bit, and mark its word as empty in the upper levels
+//|             once it has no bit left
+//*-----------------------------------------------------------------------------
+void CmBitmap::Clear(uint32_t index)
+{
+    if (index >= m_size)
+    {
+        return;
+    }
+
+    for (uint32_t level = 0; level < m_levelCount; level++)
+    {
+        uint64_t &word = m_levels[level][index >> CM_BITMAP_WORD_SHIFT];
+
+        word &= ~CM_BITMAP_BIT(index);
+        if (word != 0)
+        {
+            break;
+        }
+        index >>= CM_BITMAP_WORD_SHIFT;
+    }
+}
+
+bool CmBitmap::Test(uint32_t index)
+{
+    if (index >= m_size)
+    {
+        return false;
+    }
+
+    return (m_levels[0][index >> CM_BITMAP_WORD_SHIFT] & CM_BITMAP_BIT(index)) != 0;
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Find the first set bit at or after start
+//| Arguments :
+//|               start       [in]       index to start the search from
+//|
+//| Returns:    Index of the bit, CM_BITMAP_INVALID_INDEX if none is set.
+//*-----------------------------------------------------------------------------
+uint32_t CmBitmap::FindFirstSet(uint32_t start)
+{
+    uint32_t level = 0;
+    uint32_t index = start;
+
+    if (start >= m_size)
+    {
+        return CM_BITMAP_INVALID_INDEX;
+    }
+
+    // Go up until a word has a set bit at or after the position
+    while (true)
+    {
+        uint32_t wordIndex = index >> CM_BITMAP_WORD_SHIFT;
+        uint64_t word      = m_levels[level][wordIndex] & (~0ULL << (index & CM_BITMAP_WORD_MASK));
+
+        if (word != 0)
+        {
+            index = (wordIndex << CM_BITMAP_WORD_SHIFT) + __builtin_ctzll(word);
+            break;
+        }
+
+        // The rest of this word is empty, continue from the next word one level up
+        level++;
+        index = wordIndex + 1;
+        if (level >= m_levelCount || index >= m_wordCount[level - 1])
+        {
+            return CM_BITMAP_INVALID_INDEX;
+        }
+    }
+
+    // Go down through the first non-empty word of each level
+    while (level > 0)
+    {
+        level--;
+        index = (index << CM_BITMAP_WORD_SHIFT) + __builtin_ctzll(m_levels[level][index]);
+    }
+
+    return index;
+}
+} //namespace
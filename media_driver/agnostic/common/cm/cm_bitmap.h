@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      cm_bitmap.h
+//! \brief     Contains Class CmBitmap definitions
+//!
+
+#ifndef MEDIADRIVER_AGNOSTIC_COMMON_CM_CMBITMAP_H_
+#define MEDIADRIVER_AGNOSTIC_COMMON_CM_CMBITMAP_H_
+
+#include "cm_def.h"
+
+#define CM_BITMAP_MAX_LEVELS        4           // 64^4 bits, far above any CM pool size
+#define CM_BITMAP_INVALID_INDEX     0xFFFFFFFF
+
+namespace CMRT_UMD
+{
+//!
+//! \brief  Hierarchical bitmap with find-first-set
+//! \details Each bit of an upper level tells whether the 64-bit word under it
+//!          in the lower level has any bit set, so set, clear and search take
+//!          a fixed number of word operations whatever the bitmap size is.
+//!          Not thread safe, the owner serializes the calls.
+//!
+class CmBitmap
+{
+public:
+    CmBitmap();
+    ~CmBitmap();
+
+    int32_t Initialize(uint32_t size);
+
+    void Set(uint32_t index);
+    void Clear(uint32_t index);
+    bool Test(uint32_t index);
+
+    //!
+    //! \brief  Find the first set bit at or after start
+    //! \return Index of the bit, CM_BITMAP_INVALID_INDEX if there is none
+    //!
+    uint32_t FindFirstSet(uint32_t start);
+
+protected:
+    void Destroy();
+
+    uint64_t *m_levels[CM_BITMAP_MAX_LEVELS];
+    uint32_t m_wordCount[CM_BITMAP_MAX_LEVELS];
+    uint32_t m_levelCount;
+    uint32_t m_size;
+
+private:
+    CmBitmap(const CmBitmap& other);
+    CmBitmap& operator= (const CmBitmap& other);
+};
+} //namespace
+
+#endif  // #ifndef MEDIADRIVER_AGNOSTIC_COMMON_CM_CMBITMAP_H_
@@ -91,6 +91,8 @@ CmEventRT::CmEventRT(uint32_t index, CmQueueRT *queue, CmTaskInternal *task, int
     m_status( CM_STATUS_QUEUED ),
     m_time( 0 ),
     m_ticks(0),
+    m_queueDepth(0),
+    m_flushStallTime(0),
     m_device( device ),
     m_queue (queue),
     m_refCount(0),
@@ -467,6 +469,17 @@ int32_t CmEventRT::SetEnqueueTime( LARGE_INTEGER time )
     return CM_SUCCESS;
 }
 
+//*-----------------------------------------------------------------------------
+//| Purpose:    Record the GPU queue depth and throttling stall seen by the flush
+//| Returns:    Result of the operation.
+//*-----------------------------------------------------------------------------
+int32_t CmEventRT::SetFlushInfo( uint32_t queueDepth, uint64_t stallTimeNs )
+{
+    m_queueDepth     = queueDepth;
+    m_flushStallTime = stallTimeNs;
+    return CM_SUCCESS;
+}
+
 int32_t CmEventRT::SetCompleteTime( LARGE_INTEGER time )
 {
     m_completeTime = time;
@@ -791,6 +804,16 @@ CM_RT_API  int32_t CmEventRT::GetProfilingInfo(CM_EVENT_PROFILING_INFO infoType,
             }
             break;
 
+        case CM_EVENT_PROFILING_QUEUEDEPTH:
+             CM_CHK_LESS_THAN(paramSize, sizeof(uint32_t), CM_INVALID_PARAM_SIZE);
+             *(uint32_t *)value = m_queueDepth;
+             break;
+
+        case CM_EVENT_PROFILING_FLUSHSTALL:
+             CM_CHK_LESS_THAN(paramSize, sizeof(uint64_t), CM_INVALID_PARAM_SIZE);
+             *(uint64_t *)value = m_flushStallTime;
+             break;
+
         default:
             hr = CM_FAILURE;
     }
@@ -118,6 +118,12 @@ public:
 
     int32_t GetQueue(CmQueueRT *&queue);
 
+    int32_t SetFlushInfo(uint32_t queueDepth, uint64_t stallTimeNs);
+
+    void *ReferenceBatch();
+
+    static int32_t WaitForBatch(void *batch, uint32_t timeOutMs);
+
 protected:
     CmEventRT(uint32_t index,
               CmQueueRT *queue,
@@ -149,6 +155,8 @@ protected:
     LARGE_INTEGER m_completeTime;        // The task complete time in CPU
     LARGE_INTEGER m_enqueueTime;         // The time when the task is pushed into enqueued
                                          //  queue
+    uint32_t m_queueDepth;               // Tasks still running on GPU when the task is flushed
+    uint64_t m_flushStallTime;           // Time in ns the flush waited for a free task slot
 
     char **m_kernelNames;
     uint32_t *m_threadSpace;
@@ -132,6 +132,8 @@ CmProgramRT::CmProgramRT( CmDeviceRT* device, uint32_t programId ):
     m_kernelInfo( CM_INIT_KERNEL_PER_PROGRAM ),
     m_isJitterEnabled(false),
     m_isHwDebugEnabled(false),
+    m_jitCacheEnabled(false),
+    m_jitCacheHash(0),
     m_refCount(0),
     m_programIndex(programId),
     m_fJITCompile(nullptr),
@@ -376,6 +378,17 @@ int32_t CmProgramRT::Initialize( void* cisaCode, const uint32_t cisaCodeSize, co
                 return CM_OUT_OF_HOST_MEMORY;
             }
         }
+
+        // Binaries jitted earlier with the same CISA and flags are reused from
+        // the JIT cache. HW debugging needs the debug info of a real jitting.
+        if (!m_isHwDebugEnabled
+#if USE_EXTENSION_CODE
+            && !m_device->CheckGTPinEnabled()
+#endif
+            )
+        {
+            InitJitCache(cisaCode, cisaCodeSize, platform, jitMajor, jitMinor, numJitFlags, jitFlags);
+        }
     }
 
     if (useVisaApi)
@@ -597,22 +610,40 @@ int32_t CmProgramRT::Initialize( void* cisaCode, const uint32_t cisaCodeSize, co
             }
             CmSafeMemSet( jitProfInfo, 0, CM_JIT_PROF_INFO_SIZE );
 
-            result = m_fJITCompile( kernInfo->kernelName, (uint8_t*)cisaCode, cisaCodeSize,
-                                    jitBinary, jitBinarySize, platform, m_cisaMajorVersion, m_cisaMinorVersion, numJitFlags, jitFlags, errorMsg, jitProfInfo );
-
-            //if error code returned or error message not nullptr
-            if(result != CM_SUCCESS)// || errorMsg[0])
+            if (m_jitCacheEnabled &&
+                LoadJitBinary(kernInfo->kernelName, jitBinary, jitBinarySize, jitProfInfo) == CM_SUCCESS)
             {
-                CM_NORMALMESSAGE("%s.", errorMsg);
-                free(errorMsg);
-                CmSafeDelete(kernInfo);
-                hr = CM_JIT_COMPILE_FAILURE;
-                goto finish;
+                kernInfo->jitBinaryFromCache = true;
+            }
+            else
+            {
+                result = m_fJITCompile( kernInfo->kernelName, (uint8_t*)cisaCode, cisaCodeSize,
+                                        jitBinary, jitBinarySize, platform, m_cisaMajorVersion, m_cisaMinorVersion, numJitFlags, jitFlags, errorMsg, jitProfInfo );
+
+                //if error code returned or error message not nullptr
+                if(result != CM_SUCCESS)// || errorMsg[0])
+                {
+                    CM_NORMALMESSAGE("%s.", errorMsg);
+                    free(errorMsg);
+                    CmSafeDelete(kernInfo);
+                    hr = CM_JIT_COMPILE_FAILURE;
+                    goto finish;
+                }
+
+                if (m_jitCacheEnabled)
+                {
+                    StoreJitBinary(kernInfo->kernelName, jitBinary, jitBinarySize, jitProfInfo);
+                }
             }
 
             // if spill code exists and scrach space disabled, return error to user
             if( jitProfInfo->isSpill &&  m_device->IsScratchSpaceDisabled())
             {
+                if (kernInfo->jitBinaryFromCache)
+                    FreeJitBinary(jitBinary, jitBinarySize);
+                else
+                    m_fFreeBlock(jitBinary);
+                free(jitProfInfo);
                 CmSafeDelete(kernInfo);
                 free(errorMsg);
                 return CM_INVALID_KERNEL_SPILL_CODE;
@@ -840,7 +871,12 @@ uint32_t CmProgramRT::ReleaseKernelInfo(uint32_t index)
                 if(m_isJitterEnabled)
                 {
                     if(kernelInfo && kernelInfo->jitBinaryCode)
-                        m_fFreeBlock(kernelInfo->jitBinaryCode);
+                    {
+                        if(kernelInfo->jitBinaryFromCache)
+                            FreeJitBinary(kernelInfo->jitBinaryCode, kernelInfo->jitBinarySize);
+                        else
+                            m_fFreeBlock(kernelInfo->jitBinaryCode);
+                    }
                     if(kernelInfo && kernelInfo->jitInfo)
                         free(kernelInfo->jitInfo);
                 }
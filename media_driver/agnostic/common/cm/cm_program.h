@@ -100,6 +100,7 @@ struct CM_KERNEL_INFO
     bool blNoBarrier;       //Indicate if the barrier is used in kernel: true means no barrier used, false means barrier is used.
 
     FINALIZER_INFO *jitInfo;
+    bool jitBinaryFromCache;    // jitBinaryCode is mapped from the JIT cache, not allocated by the jitter
 
     uint32_t variableCount;
     gen_var_info_t *variables;
@@ -206,6 +207,15 @@ protected:
 #if USE_EXTENSION_CODE
     int InitForGTPin(const char *jitFlags[CM_RT_JITTER_MAX_NUM_FLAGS], int &numJitFlags);
 #endif
+
+    // Persistent cache of jitted binaries, OS specific. Without one, or if it
+    // is not enabled, InitJitCache leaves m_jitCacheEnabled false.
+    void InitJitCache(const void *cisaCode, uint32_t cisaCodeSize, const char *platform,
+                      uint32_t jitMajor, uint32_t jitMinor, int numJitFlags, const char **jitFlags);
+    int32_t LoadJitBinary(const char *kernelName, void* &binary, uint32_t &binarySize, FINALIZER_INFO *jitInfo);
+    void StoreJitBinary(const char *kernelName, const void *binary, uint32_t binarySize, const FINALIZER_INFO *jitInfo);
+    void FreeJitBinary(void *binary, uint32_t binarySize);
+
     CmDeviceRT* m_device;
 
     uint32_t m_programCodeSize;
@@ -221,6 +231,9 @@ protected:
     bool m_isJitterEnabled;
     bool m_isHwDebugEnabled;
 
+    bool m_jitCacheEnabled;
+    uint64_t m_jitCacheHash;    // key of the program in the JIT cache
+
     uint32_t m_refCount;
 
     uint32_t m_programIndex;
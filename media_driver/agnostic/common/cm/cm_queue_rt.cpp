@@ -117,7 +117,7 @@ CmQueueRT::CmQueueRT(CmDeviceRT *device,
     m_copyKernelParamArrayCount(0),
     m_queueOption(queueCreateOption)
 {
-
+    CmSafeMemSet(m_copyKernelFreeList, 0, sizeof(m_copyKernelFreeList));
 }
 
 //*-----------------------------------------------------------------------------
@@ -148,7 +148,7 @@ CmQueueRT::~CmQueueRT()
     }
     m_eventArray.Delete();
 
-    // Do not destroy the kernel in m_copyKernelParamArray.
+    // Do not destroy the kernel, task and thread space in m_copyKernelParamArray.
     // They have been destoyed in ~CmDevice() before destroying Queue
     for( uint32_t i = 0; i < m_copyKernelParamArrayCount; i ++ )
     {
@@ -1281,7 +1281,7 @@ int32_t CmQueueRT::EnqueueCopyInternal_1Plane(CmSurface2DRT* surface,
         threadHeight = ( uint32_t )ceil( ( double )sliceCopyHeightRow/BLOCK_HEIGHT/INNER_LOOP );
         threadNum = threadWidth * threadHeight;
         CMCHK_HR(kernel->SetThreadCount( threadNum ));
-        CMCHK_HR(m_device->CreateThreadSpace( threadWidth, threadHeight, threadSpace ));
+        CMCHK_HR(GetGPUCopyTask(gpuCopyKernelParam, threadWidth, threadHeight, option, threadSpace, gpuCopyTask));
 
         if( direction == CM_FASTCOPY_CPU2GPU)
         {
@@ -1326,22 +1326,13 @@ int32_t CmQueueRT::EnqueueCopyInternal_1Plane(CmSurface2DRT* surface,
         }
 
         CMCHK_HR(m_device->CreateQueue( cmQueue ));
-        CMCHK_HR(m_device->CreateTask(gpuCopyTask));
-        CMCHK_HR(gpuCopyTask->AddKernel( kernel ));
-        if (option & CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST)
-        {
-            // disable turbo
-            CM_TASK_CONFIG taskConfig;
-            CmSafeMemSet(&taskConfig, 0, sizeof(CM_TASK_CONFIG));
-            taskConfig.turboBoostFlag = CM_TURBO_BOOST_DISABLE;
-            gpuCopyTask->SetProperty(taskConfig);
-        }
         CMCHK_HR(cmQueue->Enqueue( gpuCopyTask, internalEvent, threadSpace ));
 
-        if( gpuCopyKernelParam )
-        {
-            GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-        }
+        // the task and thread space stay cached with the kernel
+        ReleaseGPUCopyKernel(gpuCopyKernelParam);
+        gpuCopyKernelParam = nullptr;
+        gpuCopyTask        = nullptr;
+        threadSpace        = nullptr;
 
         //update for next slice
         linearAddress += sliceCopyBufferUPSize - addedShiftLeftOffset;
@@ -1372,8 +1363,6 @@ int32_t CmQueueRT::EnqueueCopyInternal_1Plane(CmSurface2DRT* surface,
             }
         }
 
-        CMCHK_HR(m_device->DestroyTask(gpuCopyTask));
-        CMCHK_HR(m_device->DestroyThreadSpace(threadSpace));
         CMCHK_HR(m_device->DestroyBufferUP(cmbufferUP));
     }
 
@@ -1387,9 +1376,7 @@ finish:
             hr = CM_GPUCOPY_OUT_OF_RESOURCE;
         }
 
-        if(kernel && gpuCopyKernelParam)        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-        if(threadSpace)                                m_device->DestroyThreadSpace(threadSpace);
-        if(gpuCopyTask)                       m_device->DestroyTask(gpuCopyTask);
+        if(kernel && gpuCopyKernelParam)        ReleaseGPUCopyKernel(gpuCopyKernelParam);
         if(cmbufferUP)                        m_device->DestroyBufferUP(cmbufferUP);
         if(internalEvent)                     cmQueue->DestroyEvent(internalEvent);
 
@@ -1551,7 +1538,7 @@ int32_t CmQueueRT::EnqueueCopyInternal_2Planes(CmSurface2DRT* surface,
     threadHeight = (uint32_t)ceil((double)copyHeightRow / BLOCK_HEIGHT / INNER_LOOP);
     threadNum = threadWidth * threadHeight;
     CMCHK_HR(kernel->SetThreadCount(threadNum));
-    CMCHK_HR(m_device->CreateThreadSpace(threadWidth, threadHeight, threadSpace));
+    CMCHK_HR(GetGPUCopyTask(gpuCopyKernelParam, threadWidth, threadHeight, option, threadSpace, gpuCopyTask));
 
     widthDword = (uint32_t)ceil((double)widthByte / 4);
     strideInDwords = (uint32_t)ceil((double)strideInBytes / 4);
@@ -1594,22 +1581,11 @@ int32_t CmQueueRT::EnqueueCopyInternal_2Planes(CmSurface2DRT* surface,
     }
 
     CMCHK_HR(m_device->CreateQueue(cmQueue));
-    CMCHK_HR(m_device->CreateTask(gpuCopyTask));
-    CMCHK_HR(gpuCopyTask->AddKernel(kernel));
-    if (option & CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST)
-    {
-        // disable turbo
-        CM_TASK_CONFIG taskConfig;
-        CmSafeMemSet(&taskConfig, 0, sizeof(CM_TASK_CONFIG));
-        taskConfig.turboBoostFlag = CM_TURBO_BOOST_DISABLE;
-        gpuCopyTask->SetProperty(taskConfig);
-    }
     CMCHK_HR(cmQueue->Enqueue(gpuCopyTask, internalEvent, threadSpace));
 
-    if (gpuCopyKernelParam)
-    {
-        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-    }
+    // the task and thread space stay cached with the kernel
+    ReleaseGPUCopyKernel(gpuCopyKernelParam);
+    gpuCopyKernelParam = nullptr;
 
     if ((option & CM_FASTCOPY_OPTION_BLOCKING) && (internalEvent))
     {
@@ -1626,8 +1602,6 @@ int32_t CmQueueRT::EnqueueCopyInternal_2Planes(CmSurface2DRT* surface,
         event = internalEvent;
     }
 
-    CMCHK_HR(m_device->DestroyTask(gpuCopyTask));
-    CMCHK_HR(m_device->DestroyThreadSpace(threadSpace));
     CMCHK_HR(m_device->DestroyBufferUP(cmbufferUPY));
     CMCHK_HR(m_device->DestroyBufferUP(cmbufferUPUV));
 
@@ -1641,9 +1615,7 @@ finish:
             hr = CM_GPUCOPY_OUT_OF_RESOURCE;
         }
 
-        if (kernel && gpuCopyKernelParam)        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-        if (threadSpace)                                m_device->DestroyThreadSpace(threadSpace);
-        if (gpuCopyTask)                       m_device->DestroyTask(gpuCopyTask);
+        if (kernel && gpuCopyKernelParam)        ReleaseGPUCopyKernel(gpuCopyKernelParam);
         if (cmbufferUPY)                      m_device->DestroyBufferUP(cmbufferUPY);
         if (cmbufferUPUV)                     m_device->DestroyBufferUP(cmbufferUPUV);
         if (internalEvent)                     cmQueue->DestroyEvent(internalEvent);
@@ -1769,23 +1741,15 @@ CM_RT_API int32_t CmQueueRT::EnqueueCopyGPUToGPU( CmSurface2D* outputSurface, Cm
     CMCHK_HR(kernel->SetKernelArg(1, sizeof(SurfaceIndex), surfaceOutputIndex));
     CMCHK_HR(kernel->SetKernelArg(2, sizeof(uint32_t), &threadHeight));
 
-    CMCHK_HR(m_device->CreateThreadSpace(threadWidth, threadHeight, threadSpace));
-
-    CMCHK_HR(m_device->CreateTask(task));
-    CMCHK_NULL(task);
-    CMCHK_HR(task->AddKernel(kernel));
-
-    if (option & CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST)
-    {
-        // disable turbo
-        CM_TASK_CONFIG taskConfig;
-        CmSafeMemSet(&taskConfig, 0, sizeof(CM_TASK_CONFIG));
-        taskConfig.turboBoostFlag = CM_TURBO_BOOST_DISABLE;
-        task->SetProperty(taskConfig);
-    }
+    CMCHK_HR(GetGPUCopyTask(gpuCopyKernelParam, threadWidth, threadHeight, option, threadSpace, task));
 
     CMCHK_HR(m_device->CreateQueue(cmQueue));
     CMCHK_HR(cmQueue->Enqueue(task, event, threadSpace));
+
+    // the task and thread space stay cached with the kernel
+    ReleaseGPUCopyKernel(gpuCopyKernelParam);
+    gpuCopyKernelParam = nullptr;
+
     if ((option & CM_FASTCOPY_OPTION_BLOCKING) && (event))
     {
         CMCHK_HR(event->WaitForTaskFinished());
@@ -1793,9 +1757,7 @@ CM_RT_API int32_t CmQueueRT::EnqueueCopyGPUToGPU( CmSurface2D* outputSurface, Cm
 
 finish:
 
-    if (kernel && gpuCopyKernelParam)        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-    if (threadSpace)                                m_device->DestroyThreadSpace(threadSpace);
-    if (task)                              m_device->DestroyTask(task);
+    if (kernel && gpuCopyKernelParam)        ReleaseGPUCopyKernel(gpuCopyKernelParam);
 
     return hr;
 }
@@ -1940,24 +1902,15 @@ CM_RT_API int32_t CmQueueRT::EnqueueCopyCPUToCPU( unsigned char* dstSysMem, unsi
     CMCHK_HR(kernel->SetKernelArg( 5, sizeof( int ), &dstLeftShiftOffset ));
     CMCHK_HR(kernel->SetKernelArg( 6, sizeof( int ), &size ));
 
-    CMCHK_HR(m_device->CreateThreadSpace(threadWidth, threadHeight, threadSpace));
-
-    CMCHK_HR(m_device->CreateTask(task));
-    CMCHK_NULL(task);
-    CMCHK_HR(task->AddKernel (kernel));
-
-    if (option & CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST)
-    {
-        // disable turbo
-        CM_TASK_CONFIG taskConfig;
-        CmSafeMemSet(&taskConfig, 0, sizeof(CM_TASK_CONFIG));
-        taskConfig.turboBoostFlag = CM_TURBO_BOOST_DISABLE;
-        task->SetProperty(taskConfig);
-    }
+    CMCHK_HR(GetGPUCopyTask(gpuCopyKernelParam, threadWidth, threadHeight, option, threadSpace, task));
 
     CMCHK_HR(m_device->CreateQueue( cmQueue));
     CMCHK_HR(cmQueue->Enqueue(task, event, threadSpace));
 
+    // the task and thread space stay cached with the kernel
+    ReleaseGPUCopyKernel(gpuCopyKernelParam);
+    gpuCopyKernelParam = nullptr;
+
     if ((option & CM_FASTCOPY_OPTION_BLOCKING) && (event))
     {
         CMCHK_HR(event->WaitForTaskFinished());
@@ -1971,16 +1924,9 @@ CM_RT_API int32_t CmQueueRT::EnqueueCopyCPUToCPU( unsigned char* dstSysMem, unsi
                   (void *)(inputLinearAddress+gpuMemcopySize),
                           cpuMemcopySize); //SSE copy used in CMRT.
 
-    CMCHK_HR(m_device->DestroyThreadSpace(threadSpace));
-    CMCHK_HR(m_device->DestroyTask(task));
     CMCHK_HR(m_device->DestroyBufferUP(surfaceOutput));   // ref_cnf to guarantee task finish before BufferUP being really destroy.
     CMCHK_HR(m_device->DestroyBufferUP(surfaceInput));
 
-    if( gpuCopyKernelParam )
-    {
-        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-    }
-
 finish:
     if(hr != CM_SUCCESS)
     {   //Failed
@@ -1994,9 +1940,7 @@ finish:
         }
         if(surfaceInput)                      m_device->DestroyBufferUP(surfaceInput);
         if(surfaceOutput)                     m_device->DestroyBufferUP(surfaceOutput);
-        if(kernel && gpuCopyKernelParam)        GPUCOPY_KERNEL_UNLOCK(gpuCopyKernelParam);
-        if(threadSpace)                                m_device->DestroyThreadSpace(threadSpace);
-        if(task)                              m_device->DestroyTask(task);
+        if(kernel && gpuCopyKernelParam)        ReleaseGPUCopyKernel(gpuCopyKernelParam);
     }
 
     return hr;
@@ -2133,6 +2077,40 @@ finish:
     return hr;
 }
 
+//*-----------------------------------------------------------------------------
+//| Purpose:    Sleep until the oldest flushed task completes on GPU, so that
+//|             throttling does not spin on the status of the flushed queue
+//| Returns:    Result of the operation.
+//*-----------------------------------------------------------------------------
+int32_t CmQueueRT::WaitForOldestFlushedTask()
+{
+    int32_t          hr    = CM_SUCCESS;
+    CmTaskInternal  *task  = nullptr;
+    CmEventRT       *event = nullptr;
+    void            *batch = nullptr;
+
+    // Only reference the batch under the lock, the task may complete and be
+    // destroyed by other threads while this one sleeps
+    m_criticalSectionFlushedTask.Acquire();
+    task = (CmTaskInternal*)m_flushedTasks.Top();
+    if( task != nullptr )
+    {
+        task->GetTaskEvent(event);
+    }
+    if( event != nullptr )
+    {
+        batch = event->ReferenceBatch();
+    }
+    m_criticalSectionFlushedTask.Release();
+
+    if( batch != nullptr )
+    {
+        hr = CmEventRT::WaitForBatch(batch, CM_MAX_TIMEOUT_MS);
+    }
+
+    return hr;
+}
+
 //*-----------------------------------------------------------------------------
 //! This is a blocking call. It will NOT return untill
 //! all tasks in GPU and all tasks in queue finishes execution.
@@ -2201,6 +2179,7 @@ int32_t CmQueueRT::CleanQueue( )
 
     while( !m_flushedTasks.IsEmpty() && status != CM_EXCEED_MAX_TIMEOUT )
     {
+        WaitForOldestFlushedTask();
         QueryFlushedTasks();
 
         LARGE_INTEGER current;
@@ -2804,14 +2783,28 @@ int32_t CmQueueRT::FlushTaskWithoutSync( bool flushBlocked )
     while( !m_enqueuedTasks.IsEmpty() )
     {
         uint32_t flushedTaskCount = m_flushedTasks.GetCount();
+        uint64_t stallTimeNs = 0;
         if ( flushBlocked )
         {
-            while( flushedTaskCount >= m_halMaxValues->maxTasks )
+            if( flushedTaskCount >= m_halMaxValues->maxTasks )
             {
-                // If the task count in flushed queue is no less than hw restrictiion,
-                // query the staus of flushed task queue. Remove any finished tasks from the queue
-                QueryFlushedTasks();
-                flushedTaskCount = m_flushedTasks.GetCount();
+                LARGE_INTEGER freq, stallStart, stallEnd;
+                MOS_QueryPerformanceFrequency((uint64_t*)&freq.QuadPart);
+                MOS_QueryPerformanceCounter((uint64_t*)&stallStart.QuadPart);
+                while( flushedTaskCount >= m_halMaxValues->maxTasks )
+                {
+                    // If the task count in flushed queue is no less than hw restrictiion,
+                    // sleep until the oldest flushed task completes on GPU, then
+                    // remove any finished tasks from the queue
+                    WaitForOldestFlushedTask();
+                    QueryFlushedTasks();
+                    flushedTaskCount = m_flushedTasks.GetCount();
+                }
+                MOS_QueryPerformanceCounter((uint64_t*)&stallEnd.QuadPart);
+                if( freq.QuadPart > 0 )
+                {
+                    stallTimeNs = (uint64_t)((double)(stallEnd.QuadPart - stallStart.QuadPart) * 1000000000.0 / freq.QuadPart);
+                }
             }
         }
         else
@@ -2866,6 +2859,12 @@ int32_t CmQueueRT::FlushTaskWithoutSync( bool flushBlocked )
 
         if(hr == CM_SUCCESS)
         {
+            CmEventRT *event = nullptr;
+            task->GetTaskEvent(event);
+            if( event != nullptr )
+            {
+                event->SetFlushInfo(flushedTaskCount, stallTimeNs);
+            }
             m_flushedTasks.Push( task );
             task->VtuneSetFlushTime(); // Record Flush Time
         }
@@ -3085,11 +3084,7 @@ int32_t CmQueueRT::CreateGPUCopyKernel(uint32_t widthInByte,
     //Search existing kernel
     CMCHK_HR(SearchGPUCopyKernel(widthInByte, height, format, copyDirection, gpuCopyKernelParam));
 
-    if(gpuCopyKernelParam != nullptr)
-    { // reuse
-        GPUCOPY_KERNEL_LOCK(gpuCopyKernelParam);
-    }
-    else
+    if(gpuCopyKernelParam == nullptr)
     {
         gpuCopyKernelParam   = new (std::nothrow) CM_GPUCOPY_KERNEL ;
         CMCHK_NULL(gpuCopyKernelParam);
@@ -3113,7 +3108,7 @@ finish:
 
 //*---------------------------------------------------------------------------------------------------------
 //| Name:       SearchGPUCopyKernel()
-//| Purpose:    Search if the required kernel exists
+//| Purpose:    Search if the required kernel exists, and lock it if found
 //| Arguments:
 //|             widthInByte      [in]  surface's width in bytes
 //|             height           [in]  surface's height
@@ -3131,23 +3126,24 @@ int32_t CmQueueRT::SearchGPUCopyKernel(uint32_t widthInByte,
                                        CM_GPUCOPY_KERNEL* &kernelParam)
 {
     int32_t     hr = CM_SUCCESS;
-    CM_GPUCOPY_KERNEL *gpucopyKernel = nullptr;
     CM_GPUCOPY_KERNEL_ID kernelTypeID = GPU_COPY_KERNEL_UNKNOWN;
 
     kernelParam = nullptr;
     CMCHK_HR(GetGPUCopyKrnID(widthInByte, height, format, copyDirection, kernelTypeID));
+    CM_CHK_LESS((uint32_t)kernelTypeID, CM_GPUCOPY_KERNEL_ID_COUNT, "Invalid GPU copy kernel ID", CM_INVALID_GPUCOPY_KERNEL);
 
-    for(uint32_t index =0 ;  index< m_copyKernelParamArrayCount; index++)
     {
-        gpucopyKernel = (CM_GPUCOPY_KERNEL*)m_copyKernelParamArray.GetElement(index);
-        if(gpucopyKernel != nullptr)
+        // critical section protection
+        CLock locker(m_criticalSectionGPUCopyKrn);
+
+        // The unlocked kernels of each kernelID are kept on their own list,
+        // so the lookup does not walk the kernels of other shapes
+        kernelParam = m_copyKernelFreeList[kernelTypeID];
+        if(kernelParam != nullptr)
         {
-            if(!gpucopyKernel->locked &&
-               gpucopyKernel->kernelID == kernelTypeID)
-            {
-                kernelParam = gpucopyKernel;
-                break;
-            }
+            m_copyKernelFreeList[kernelTypeID] = kernelParam->nextFree;
+            kernelParam->nextFree = nullptr;
+            GPUCOPY_KERNEL_LOCK(kernelParam);
         }
     }
 
@@ -3155,6 +3151,97 @@ finish:
     return hr;
 }
 
+//*---------------------------------------------------------------------------------------------------------
+//| Name:       ReleaseGPUCopyKernel()
+//| Purpose:    Unlock the kernel and put it back for reuse
+//| Arguments:
+//|             kernelParam      [in]  kernel param
+//|
+//*---------------------------------------------------------------------------------------------------------
+void CmQueueRT::ReleaseGPUCopyKernel(CM_GPUCOPY_KERNEL *kernelParam)
+{
+    // critical section protection
+    CLock locker(m_criticalSectionGPUCopyKrn);
+
+    if(kernelParam == nullptr || !kernelParam->locked ||
+       (uint32_t)kernelParam->kernelID >= CM_GPUCOPY_KERNEL_ID_COUNT)
+    {
+        return;
+    }
+
+    GPUCOPY_KERNEL_UNLOCK(kernelParam);
+    kernelParam->nextFree = m_copyKernelFreeList[kernelParam->kernelID];
+    m_copyKernelFreeList[kernelParam->kernelID] = kernelParam;
+}
+
+//*---------------------------------------------------------------------------------------------------------
+//| Name:       GetGPUCopyTask()
+//| Purpose:    Get the task and thread space cached in a locked kernel param. They are created on the
+//|             first use, and the thread space is re-created only when the size changes.
+//| Arguments:
+//|             kernelParam      [in]  locked kernel param
+//|             threadWidth      [in]  thread space width
+//|             threadHeight     [in]  thread space height
+//|             option           [in]  copy option, turbo boost is disabled for CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST
+//|             threadSpace      [out] thread space
+//|             task             [out] task holding the kernel
+//|
+//| Returns:    Result of the operation.
+//|
+//*---------------------------------------------------------------------------------------------------------
+int32_t CmQueueRT::GetGPUCopyTask(CM_GPUCOPY_KERNEL *kernelParam,
+                                  uint32_t threadWidth,
+                                  uint32_t threadHeight,
+                                  uint32_t option,
+                                  CmThreadSpace* &threadSpace,
+                                  CmTask* &task)
+{
+    int32_t         hr = CM_SUCCESS;
+    CM_TASK_CONFIG  taskConfig;
+
+    threadSpace = nullptr;
+    task        = nullptr;
+    CMCHK_NULL_RETURN(kernelParam, CM_INVALID_GPUCOPY_KERNEL);
+
+    if(kernelParam->threadSpace != nullptr &&
+       (kernelParam->threadWidth != threadWidth || kernelParam->threadHeight != threadHeight))
+    {
+        CMCHK_HR(m_device->DestroyThreadSpace(kernelParam->threadSpace));
+        kernelParam->threadSpace = nullptr;
+    }
+    if(kernelParam->threadSpace == nullptr)
+    {
+        CMCHK_HR(m_device->CreateThreadSpace(threadWidth, threadHeight, kernelParam->threadSpace));
+        kernelParam->threadWidth  = threadWidth;
+        kernelParam->threadHeight = threadHeight;
+    }
+
+    if(kernelParam->task == nullptr)
+    {
+        CmTask *newTask = nullptr;
+        CMCHK_HR(m_device->CreateTask(newTask));
+        hr = newTask->AddKernel(kernelParam->kernel);
+        if(hr != CM_SUCCESS)
+        {
+            m_device->DestroyTask(newTask);
+            goto finish;
+        }
+        kernelParam->task = newTask;
+    }
+
+    // The task is shared by all copies with this kernel, so reset the turbo setting every time
+    CmSafeMemSet(&taskConfig, 0, sizeof(CM_TASK_CONFIG));
+    taskConfig.turboBoostFlag = (option & CM_FASTCOPY_OPTION_DISABLE_TURBO_BOOST) ?
+                                CM_TURBO_BOOST_DISABLE : CM_TURBO_BOOST_DEFAULT;
+    CMCHK_HR(kernelParam->task->SetProperty(taskConfig));
+
+    threadSpace = kernelParam->threadSpace;
+    task        = kernelParam->task;
+
+finish:
+    return hr;
+}
+
 //*---------------------------------------------------------------------------------------------------------
 //| Name:       AddGPUCopyKernel()
 //| Purpose:    Add new kernel into m_copyKernelParamArray
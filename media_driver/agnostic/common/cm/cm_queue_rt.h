@@ -56,11 +56,18 @@ class CmVebox;
 class CmSurface2D;
 class CmSurface2DRT;
 
+#define CM_GPUCOPY_KERNEL_ID_COUNT (GPU_COPY_KERNEL_CPU2CPU_ID + 1)
+
 struct CM_GPUCOPY_KERNEL
 {
     CmKernel *kernel;
     CM_GPUCOPY_KERNEL_ID kernelID;
     bool locked;
+    CmTask *task;                   // Task holding kernel, reused by every copy with it
+    CmThreadSpace *threadSpace;     // Thread space of the last copy, reused for the same size
+    uint32_t threadWidth;
+    uint32_t threadHeight;
+    CM_GPUCOPY_KERNEL *nextFree;    // Next unlocked kernel with the same kernelID
 };
 
 class ThreadSafeQueue
@@ -269,6 +276,8 @@ protected:
 
     int32_t QueryFlushedTasks();
 
+    int32_t WaitForOldestFlushedTask();
+
     //New sub functions for different task flush
     int32_t FlushGeneralTask(CmTaskInternal *task);
 
@@ -311,6 +320,15 @@ protected:
                                 CM_GPUCOPY_DIRECTION copyDirection,
                                 CM_GPUCOPY_KERNEL* &kernelParam);
 
+    int32_t GetGPUCopyTask(CM_GPUCOPY_KERNEL *kernelParam,
+                           uint32_t threadWidth,
+                           uint32_t threadHeight,
+                           uint32_t option,
+                           CmThreadSpace* &threadSpace,
+                           CmTask* &task);
+
+    void ReleaseGPUCopyKernel(CM_GPUCOPY_KERNEL *kernelParam);
+
     CmDeviceRT *m_device;
     ThreadSafeQueue m_enqueuedTasks;
     ThreadSafeQueue m_flushedTasks;
@@ -325,8 +343,9 @@ protected:
 
     CmDynamicArray m_copyKernelParamArray;
     uint32_t m_copyKernelParamArrayCount;
+    CM_GPUCOPY_KERNEL *m_copyKernelFreeList[CM_GPUCOPY_KERNEL_ID_COUNT];  // Unlocked kernels by kernelID
 
-    CSync m_criticalSectionGPUCopyKrn;
+    CSync m_criticalSectionGPUCopyKrn;  // Protect m_copyKernelParamArray and m_copyKernelFreeList
 
     CM_HAL_MAX_VALUES *m_halMaxValues;
     CM_QUEUE_CREATE_OPTION m_queueOption;
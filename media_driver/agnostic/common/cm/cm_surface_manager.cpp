@@ -56,6 +56,7 @@ int32_t CmSurfaceManager::UpdateStateForDelayedDestroy(SURFACE_DESTROY_KIND dest
 
         case APP_DESTROY:
             m_surfaceReleased[index] = true;
+            m_releasedSurfaceIndexes.Set(index);
             if (m_surfaceStates[index])
             {
                 return CM_SURFACE_IN_USE;
@@ -73,7 +74,8 @@ int32_t CmSurfaceManager::UpdateStateForDelayedDestroy(SURFACE_DESTROY_KIND dest
 int32_t CmSurfaceManager::UpdateStateForRealDestroy(uint32_t index, CM_ENUM_CLASS_TYPE surfaceType)
 {
     m_surfaceReleased[index] = false;
-    m_surfaceArray[index] = nullptr;
+    m_releasedSurfaceIndexes.Clear(index);
+    SetSurfaceArrayElement(index, nullptr);
 
     m_surfaceSizes[index] = 0;
 
@@ -421,10 +423,42 @@ int32_t CmSurfaceManager::Initialize( CM_HAL_MAX_VALUES halMaxValues, CM_HAL_MAX
     CmSafeMemSet( m_surfaceStates, 0, m_surfaceArraySize * sizeof( int32_t ) );
     CmSafeMemSet( m_surfaceReleased, 0, m_surfaceArraySize * sizeof( bool ) );
     CmSafeMemSet( m_surfaceSizes, 0, m_surfaceArraySize * sizeof( int32_t ) );
+
+    if (m_freeSurfaceIndexes.Initialize(m_surfaceArraySize) != CM_SUCCESS ||
+        m_releasedSurfaceIndexes.Initialize(m_surfaceArraySize) != CM_SUCCESS)
+    {
+        CM_ASSERTMESSAGE("Error: Out of system memory.");
+        return CM_OUT_OF_HOST_MEMORY;
+    }
+    for (uint32_t index = ValidSurfaceIndexStart(); index < m_surfaceArraySize; index++)
+    {
+        m_freeSurfaceIndexes.Set(index);
+    }
+
     return CM_SUCCESS;
 }
 
+//*-----------------------------------------------------------------------------
+//| Purpose:    Set an element of the surface array, and keep the free index
+//|             bitmap in sync with it
+//| Returns:    None
+//*-----------------------------------------------------------------------------
+void CmSurfaceManager::SetSurfaceArrayElement(uint32_t index, CmSurface *surface)
+{
+    m_surfaceArray[index] = surface;
+    if (surface)
+    {
+        m_freeSurfaceIndexes.Clear(index);
+    }
+    else
+    {
+        m_freeSurfaceIndexes.Set(index);
+    }
+}
+
 // Sysmem based surface allocation will always use new surface entry.
+// Only the surfaces released by API can be destroyed here, so just walk the
+// released surface bitmap instead of the whole pool.
 int32_t CmSurfaceManager::DestroySurfaceInPool(uint32_t &freeSurfaceCount, SURFACE_DESTROY_KIND destroyKind)
 {
     CmSurface*   surface = nullptr;
@@ -434,16 +468,16 @@ int32_t CmSurfaceManager::DestroySurfaceInPool(uint32_t &freeSurfaceCount, SURFA
     CmSurface3DRT*   surf3D  = nullptr;
     CmStateBuffer* surfStateBuffer = nullptr;
     int32_t status = CM_FAILURE;
-    uint32_t index = ValidSurfaceIndexStart();
+    uint32_t index = m_releasedSurfaceIndexes.FindFirstSet(ValidSurfaceIndexStart());
 
     freeSurfaceCount = 0;
 
-    while(index <= m_maxSurfaceIndexAllocated )
+    while(index != CM_BITMAP_INVALID_INDEX)
     {
         surface  = m_surfaceArray[index];
         if (!surface)
         {
-            index ++;
+            index = m_releasedSurfaceIndexes.FindFirstSet(index + 1);
             continue;
         }
 
@@ -506,7 +540,7 @@ int32_t CmSurfaceManager::DestroySurfaceInPool(uint32_t &freeSurfaceCount, SURFA
         {
             freeSurfaceCount++;
         }
-        index ++;
+        index = m_releasedSurfaceIndexes.FindFirstSet(index + 1);
     }
 
     return CM_SUCCESS;
@@ -544,14 +578,9 @@ int32_t CmSurfaceManager::TouchSurfaceInPoolForDestroy()
 
 int32_t CmSurfaceManager::GetFreeSurfaceIndexFromPool(uint32_t &freeIndex)
 {
-    uint32_t index = ValidSurfaceIndexStart();
-
-    while( ( index < m_surfaceArraySize ) && m_surfaceArray[ index ] )
-    {
-        index ++;
-    }
+    uint32_t index = m_freeSurfaceIndexes.FindFirstSet(ValidSurfaceIndexStart());
 
-    if( index >= m_surfaceArraySize )
+    if( index == CM_BITMAP_INVALID_INDEX )
     {
         CM_ASSERTMESSAGE("Error: Invalid surface index.");
         return CM_FAILURE;
@@ -721,6 +750,7 @@ int32_t CmSurfaceManager::AllocateSurfaceIndex(uint32_t width, uint32_t height,
 
     freeIndex = index;
     m_surfaceReleased[index] = false;
+    m_releasedSurfaceIndexes.Clear(index);
     m_maxSurfaceIndexAllocated = Max(index, m_maxSurfaceIndexAllocated);
 
     return CM_SUCCESS;
@@ -781,7 +811,7 @@ int32_t CmSurfaceManager::CreateBuffer(uint32_t size, CM_BUFFER_TYPE type, bool
         return result;
     }
 
-    m_surfaceArray[ index ] = buffer;
+    SetSurfaceArrayElement(index, buffer);
     UpdateProfileFor1DSurface(index, size);
 
     return CM_SUCCESS;
@@ -902,7 +932,7 @@ int32_t CmSurfaceManager::CreateSurface2DUP(uint32_t width, uint32_t height, CM_
         return result;
     }
 
-    m_surfaceArray[ index ] = surface;
+    SetSurfaceArrayElement(index, surface);
     m_2DUPSurfaceCount ++;
     uint32_t sizeperpixel = 1;
 
@@ -1041,7 +1071,7 @@ int32_t CmSurfaceManager::CreateSurface2D(uint32_t width, uint32_t height, uint3
         return result;
     }
 
-    m_surfaceArray[ index ] = surface;
+    SetSurfaceArrayElement(index, surface);
 
     result = UpdateProfileFor2DSurface(index, width, height, format);
     if (result != CM_SUCCESS)
@@ -1192,7 +1222,7 @@ int32_t CmSurfaceManager::CreateSampler8x8Surface(CmSurface2DRT* currentSurface,
 
     if(cmSurfaceSampler8x8)
     {
-        m_surfaceArray[ index ] = cmSurfaceSampler8x8;
+        SetSurfaceArrayElement(index, cmSurfaceSampler8x8);
         cmSurfaceSampler8x8->GetIndex( sampler8x8SurfaceIndex );
         return CM_SUCCESS;
     }
@@ -1383,7 +1413,7 @@ int32_t CmSurfaceManager::CreateVmeSurface( CmSurface2DRT* currentSurface,
         return result;
     }
 
-    m_surfaceArray[ index ] = cmSurfaceVme;
+    SetSurfaceArrayElement(index, cmSurfaceVme);
     cmSurfaceVme->GetIndex( vmeSurfaceIndex );
 
     return CM_SUCCESS;
@@ -1914,7 +1944,7 @@ int32_t CmSurfaceManager::CreateSurface3D(uint32_t width, uint32_t height, uint3
         return result;
     }
 
-    m_surfaceArray[ index ] = surface3d;
+    SetSurfaceArrayElement(index, surface3d);
 
     result = UpdateProfileFor3DSurface(index, width, height, depth, format);
     if (result != CM_SUCCESS)
@@ -2056,7 +2086,7 @@ int32_t CmSurfaceManager::CreateSamplerSurface(CmSurface2DRT* currentSurface2d,
         return result;
     }
 
-    m_surfaceArray[ index ] = cmSurfaceSampler;
+    SetSurfaceArrayElement(index, cmSurfaceSampler);
     cmSurfaceSampler->GetSurfaceIndex( samplerSurfaceIndex );
 
     return CM_SUCCESS;
@@ -2087,7 +2117,7 @@ int32_t CmSurfaceManager::CreateSamplerSurface(CmSurface2DUPRT* currentSurface2d
         return result;
     }
 
-    m_surfaceArray[ index ] = cmSurfaceSampler;
+    SetSurfaceArrayElement(index, cmSurfaceSampler);
     cmSurfaceSampler->GetSurfaceIndex( samplerSurfaceIndex );
 
     return CM_SUCCESS;
@@ -2115,7 +2145,7 @@ int32_t CmSurfaceManager::CreateSamplerSurface(CmSurface3DRT* currentSurface3d,
         return result;
     }
 
-    m_surfaceArray[ index ] = cmSurfaceSampler;
+    SetSurfaceArrayElement(index, cmSurfaceSampler);
     cmSurfaceSampler->GetSurfaceIndex( samplerSurfaceIndex );
 
     return CM_SUCCESS;
@@ -2349,7 +2379,7 @@ int32_t CmSurfaceManager::CreateStateBuffer( CM_STATE_BUFFER_TYPE stateBufferTyp
         return result;
     }
 
-    m_surfaceArray[ index ] = buffer;
+    SetSurfaceArrayElement(index, buffer);
     UpdateProfileFor1DSurface( index, size);
 
     switch ( stateBufferType )
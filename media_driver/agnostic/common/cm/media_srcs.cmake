@@ -20,6 +20,7 @@
 
 set(TMP_SOURCES_
     ${CMAKE_CURRENT_LIST_DIR}/cm_array.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/cm_bitmap.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_buffer_rt.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_state_buffer.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_def.cpp
@@ -58,6 +59,7 @@ set(TMP_SOURCES_
 
 set(TMP_HEADERS_
     ${CMAKE_CURRENT_LIST_DIR}/cm_array.h
+    ${CMAKE_CURRENT_LIST_DIR}/cm_bitmap.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_buffer.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_buffer_rt.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_common.h
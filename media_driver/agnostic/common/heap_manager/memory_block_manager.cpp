@@ -25,6 +25,8 @@
 //!
 
 #include "memory_block_manager.h"
+#include <algorithm>
+#include <queue>
 
 MemoryBlockManager::~MemoryBlockManager()
 {
@@ -286,11 +288,11 @@ MOS_STATUS MemoryBlockManager::UnregisterHeap(uint32_t heapId)
             m_totalSizeOfHeaps -= (*iterator)->m_heap->GetSize();
 
             // free blocks may be removed right away
-            auto block = m_sortedBlockList[MemoryBlockInternal::State::free];
+            auto block = GetFreeListHead(m_freeListClasses);
             MemoryBlockInternal *next = nullptr;
             while (block != nullptr)
             {
-                next = block->m_stateNext;
+                next = GetNextFreeBlock(block);
                 auto heap = block->GetHeap();
                 if (heap != nullptr)
                 {
@@ -369,7 +371,7 @@ MOS_STATUS MemoryBlockManager::IsSpaceAvailable(
         HEAP_ASSERTMESSAGE("No space is being requested");
         return MOS_STATUS_INVALID_PARAMETER;
     }
-    if (m_sortedBlockList[MemoryBlockInternal::State::free] == nullptr)
+    if (m_sortedBlockListNumEntries[MemoryBlockInternal::State::free] == 0)
     {
         bool blocksUpdated = false;
         HEAP_CHK_STATUS(RefreshBlockStates(blocksUpdated));
@@ -379,53 +381,57 @@ MOS_STATUS MemoryBlockManager::IsSpaceAvailable(
         }
     }
 
-    auto block = m_sortedBlockList[MemoryBlockInternal::State::free];
- 
+    // Blocks in a free list are not sorted, visit each size class largest
+    // block first so that the free blocks are walked in decreasing size
+    std::vector<MemoryBlockInternal *> classBlocks;
+    uint32_t classIdx = 0;
+    uint32_t classEnd = m_freeListClasses;
+    auto nextFreeBlock = [&]() -> MemoryBlockInternal * {
+        if (classIdx == classBlocks.size() && classEnd > 0)
+        {
+            auto head = GetFreeListHead(classEnd);
+            classEnd = head ? GetFreeListIndex(head->GetSize()) : 0;
+            classBlocks.clear();
+            classIdx = 0;
+            for (auto curr = head; curr != nullptr; curr = curr->m_stateNext)
+            {
+                classBlocks.push_back(curr);
+            }
+            std::sort(classBlocks.begin(), classBlocks.end(),
+                [](MemoryBlockInternal *a, MemoryBlockInternal *b) { return a->GetSize() > b->GetSize(); });
+        }
+        return classIdx < classBlocks.size() ? classBlocks[classIdx++] : nullptr;
+    };
+
+    // Replay AllocateSpace, which splits each request off the largest free
+    // block left, so that no space is reported for requests it can place.
+    // Free blocks are only pulled in as far as they may be the largest one.
+    std::priority_queue<uint32_t> freeSizes;
+    auto block = nextFreeBlock();
+
     for (auto requestIterator = m_sortedSizes.begin();
         requestIterator != m_sortedSizes.end();
         ++requestIterator)
     {
-        if (block == nullptr)
+        while (block != nullptr && (freeSizes.empty() || block->GetSize() > freeSizes.top()))
         {
-            // There is no free space available, add up all requested sizes
-            spaceNeeded += (*requestIterator).m_blockSize;
+            freeSizes.push(block->GetSize());
+            block = nextFreeBlock();
         }
-        else
+
+        if (freeSizes.empty() || (*requestIterator).m_blockSize > freeSizes.top())
         {
-            // Determine whether or not there is space available
-            if ((*requestIterator).m_blockSize > block->GetSize())
-            {
-                // The requested size is larger than the largest free block size
-                spaceNeeded += (*requestIterator).m_blockSize;
-                continue;
-            }
-            else
-            {
-                // determine if there is enough space in the heaps
-                auto freeBlockSize = block->GetSize();
-                while (requestIterator != m_sortedSizes.end())
-                {
-                    if ((*requestIterator).m_blockSize < freeBlockSize)
-                    {
-                        // if the aligned size fits within the current free block, consider it used
-                        freeBlockSize -= (*requestIterator).m_blockSize;
-                        ++requestIterator;
-                    }
-                    else
-                    {
-                        // if the aligned size does not fit within the curret free block, continue for loop
-                        break;
-                    }
-                }
-                if (requestIterator == m_sortedSizes.end())
-                {
-                    break;
-                }
-            }
+            // The requested size is larger than the largest free block left
+            spaceNeeded += (*requestIterator).m_blockSize;
+            continue;
         }
-        if (block != nullptr)
+
+        // consider the request split off the largest free block
+        uint32_t remainder = freeSizes.top() - (*requestIterator).m_blockSize;
+        freeSizes.pop();
+        if (remainder != 0)
         {
-            block = block->m_stateNext;
+            freeSizes.push(remainder);
         }
     }
 
@@ -444,7 +450,7 @@ MOS_STATUS MemoryBlockManager::AllocateSpace(
         return MOS_STATUS_INVALID_PARAMETER;
     }
 
-    if (m_sortedBlockList[MemoryBlockInternal::State::free] == nullptr)
+    if (m_sortedBlockListNumEntries[MemoryBlockInternal::State::free] == 0)
     {
         HEAP_ASSERTMESSAGE("No free blocks available");
         return MOS_STATUS_INVALID_PARAMETER;
@@ -459,9 +465,10 @@ MOS_STATUS MemoryBlockManager::AllocateSpace(
         requestIterator != m_sortedSizes.end();
         ++requestIterator)
     {
+        // Take the largest free block, as IsSpaceAvailable expects
         bool allocated = false;
-        auto block = m_sortedBlockList[MemoryBlockInternal::State::free];
-        while (block != nullptr)
+        auto block = GetLargestFreeBlock();
+        if (block != nullptr)
         {
             if (block->GetSize() >= (*requestIterator).m_blockSize)
             {
@@ -482,9 +489,7 @@ MOS_STATUS MemoryBlockManager::AllocateSpace(
                     heap,
                     heap->m_keepLocked ? heap->m_lockedHeap : nullptr));
                 allocated = true;
-                break;
             }
-            block = block->m_stateNext;
         }
 
         if (!allocated)
@@ -565,42 +570,15 @@ MOS_STATUS MemoryBlockManager::AddBlockToSortedList(
     {
         case MemoryBlockInternal::State::free:
         {
-            bool inserted = false;
-            MemoryBlockInternal *prev = nullptr;
-            while (curr != nullptr)
-            {
-                if (curr->GetSize() <= block->GetSize())
-                {
-                    if (prev)
-                    {
-                        prev->m_stateNext = block;
-                    }
-                    else
-                    {
-                        m_sortedBlockList[state] = block;
-                    }
-                    curr->m_statePrev = block;
-                    block->m_statePrev = prev;
-                    block->m_stateNext = curr;
-                    inserted = true;
-                    break;
-                }
-                prev = curr;
-                curr = curr->m_stateNext;
-            }
-            if (!inserted)
+            uint32_t idx = GetFreeListIndex(block->GetSize());
+            curr = m_freeLists[idx];
+            block->m_stateNext = curr;
+            if (curr)
             {
-                if (prev == nullptr)
-                {
-                    block->m_stateNext = m_sortedBlockList[state];
-                    m_sortedBlockList[state] = block;
-                }
-                else
-                {
-                    block->m_statePrev = prev;
-                    prev->m_stateNext = block;
-                }
+                curr->m_statePrev = block;
             }
+            m_freeLists[idx] = block;
+            m_freeListBitmap[idx / 32] |= (1u << (idx % 32));
             block->m_stateListType = state;
             m_sortedBlockListNumEntries[state]++;
             m_sortedBlockListSizes[state] += block->GetSize();
@@ -656,6 +634,16 @@ MOS_STATUS MemoryBlockManager::RemoveBlockFromSortedList(
             {
                 block->m_statePrev->m_stateNext = block->m_stateNext;
             }
+            else if (state == MemoryBlockInternal::State::free)
+            {
+                // the block heads its size class list, clear the list bit once it empties
+                uint32_t idx = GetFreeListIndex(block->GetSize());
+                m_freeLists[idx] = block->m_stateNext;
+                if (m_freeLists[idx] == nullptr)
+                {
+                    m_freeListBitmap[idx / 32] &= ~(1u << (idx % 32));
+                }
+            }
             else
             {
                 // special case for beginning of list
@@ -707,6 +695,78 @@ MemoryBlockInternal *MemoryBlockManager::GetBlockFromPool()
     return block;
 }
 
+uint32_t MemoryBlockManager::GetFreeListIndex(uint32_t size)
+{
+    uint32_t firstLevel = 0;
+    for (uint32_t remaining = size >> 1; remaining != 0; remaining >>= 1)
+    {
+        firstLevel++;
+    }
+
+    if (firstLevel < m_freeListSubClassesShift)
+    {
+        // small sizes each get their own list
+        return size;
+    }
+
+    uint32_t secondLevel = (size >> (firstLevel - m_freeListSubClassesShift)) & (m_freeListSubClasses - 1);
+    return (firstLevel - m_freeListSubClassesShift + 1) * m_freeListSubClasses + secondLevel;
+}
+
+MemoryBlockInternal *MemoryBlockManager::GetFreeListHead(uint32_t end)
+{
+    while (end > 0)
+    {
+        uint32_t word = (end - 1) / 32;
+        uint32_t lastBit = (end - 1) % 32;
+        uint32_t bits = m_freeListBitmap[word];
+        if (lastBit < 31)
+        {
+            bits &= (1u << (lastBit + 1)) - 1;
+        }
+
+        if (bits != 0)
+        {
+            uint32_t highestBit = 0;
+            for (bits >>= 1; bits != 0; bits >>= 1)
+            {
+                highestBit++;
+            }
+            return m_freeLists[word * 32 + highestBit];
+        }
+        end = word * 32;
+    }
+
+    return nullptr;
+}
+
+MemoryBlockInternal *MemoryBlockManager::GetLargestFreeBlock()
+{
+    auto largest = GetFreeListHead(m_freeListClasses);
+    if (largest == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (auto curr = largest->m_stateNext; curr != nullptr; curr = curr->m_stateNext)
+    {
+        if (curr->GetSize() > largest->GetSize())
+        {
+            largest = curr;
+        }
+    }
+    return largest;
+}
+
+MemoryBlockInternal *MemoryBlockManager::GetNextFreeBlock(MemoryBlockInternal *block)
+{
+    if (block->m_stateNext)
+    {
+        return block->m_stateNext;
+    }
+    return GetFreeListHead(GetFreeListIndex(block->GetSize()));
+}
+
 MOS_STATUS MemoryBlockManager::RemoveHeapFromSortedBlockList(uint32_t heapId)
 {
     for (auto state = 0; state < MemoryBlockInternal::State::stateCount; ++state)
@@ -716,12 +776,13 @@ MOS_STATUS MemoryBlockManager::RemoveHeapFromSortedBlockList(uint32_t heapId)
             continue;
         }
 
-        auto curr = m_sortedBlockList[state];
+        bool isFree = (state == MemoryBlockInternal::State::free);
+        auto curr = isFree ? GetFreeListHead(m_freeListClasses) : m_sortedBlockList[state];
         Heap *heap = nullptr;
         MemoryBlockInternal *nextBlock = nullptr;
         while (curr != nullptr)
         {
-            nextBlock = curr->m_stateNext;
+            nextBlock = isFree ? GetNextFreeBlock(curr) : curr->m_stateNext;
             heap = curr->GetHeap();
             HEAP_CHK_NULL(heap);
             if (heap->GetId() == heapId)
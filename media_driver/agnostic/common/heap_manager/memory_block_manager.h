@@ -298,6 +298,44 @@ private:
         MemoryBlockInternal *block,
         MemoryBlockInternal::State state);
 
+    //!
+    //! \brief  Gets the index of the segregated free list which holds blocks of \a size
+    //! \details Free blocks are binned by the position of their highest set bit, and each
+    //!          power of two is split into m_freeListSubClasses linear size classes, so the
+    //!          sizes of blocks in one list differ by less than 1/m_freeListSubClasses.
+    //! \param  [in] size
+    //!         Size of the free block
+    //! \return uint32_t
+    //!         Index in \see m_freeLists, lists of larger blocks have higher indices
+    //!
+    static uint32_t GetFreeListIndex(uint32_t size);
+
+    //!
+    //! \brief  Gets the first block of the non-empty free list with the highest index below \a end
+    //! \param  [in] end
+    //!         Free lists at or above this index are skipped, use m_freeListClasses to get the
+    //!         list of the largest free blocks
+    //! \return MemoryBlockInternal*
+    //!         First block of the list, nullptr if all lists below \a end are empty
+    //!
+    MemoryBlockInternal *GetFreeListHead(uint32_t end);
+
+    //!
+    //! \brief  Gets the largest free block, the largest one of the highest non-empty free list
+    //! \return MemoryBlockInternal*
+    //!         Largest free block, nullptr if there is none
+    //!
+    MemoryBlockInternal *GetLargestFreeBlock();
+
+    //!
+    //! \brief  Walks the free blocks from the largest size class to the smallest
+    //! \param  [in] block
+    //!         Free block currently in a free list
+    //! \return MemoryBlockInternal*
+    //!         Next free block, nullptr if \a block is the last one
+    //!
+    MemoryBlockInternal *GetNextFreeBlock(MemoryBlockInternal *block);
+
     //!
     //! \brief  Gets a pool type block from the sorted block pool, if pool is empty allocates a new one
     //!         \see m_sortedBlockList[MemoryBlockInternal::State::pool]
@@ -369,6 +407,12 @@ private:
     static const uint16_t m_heapAlignment = MOS_PAGE_SIZE;
     //! \brief Number of submissions before a refresh, currently fixed
     static const uint16_t m_numSubmissionsForRefresh = 128;
+    //! \brief Log2 of the number of size classes each power of two is split into \see GetFreeListIndex
+    static const uint32_t m_freeListSubClassesShift = 3;
+    //! \brief Number of size classes each power of two is split into
+    static const uint32_t m_freeListSubClasses = 1 << m_freeListSubClassesShift;
+    //! \brief Number of segregated free lists needed to cover all 32 bit sizes
+    static const uint32_t m_freeListClasses = (32 - m_freeListSubClassesShift + 1) * m_freeListSubClasses;
 
     //! \brief Total size of all managed heaps.
     uint32_t m_totalSizeOfHeaps = 0;
@@ -377,8 +421,14 @@ private:
     //! \brief List of block pools per heap for heaps in deletion process
     std::list<std::shared_ptr<HeapWithAdjacencyBlockList>> m_deletedHeaps;
     //! \brief Pools of memory blocks sorted by their states based on the state indicated
-    //!        by the latest TrackerId. The free pool is sorted in ascending order.
+    //!        by the latest TrackerId. Free blocks are kept in \see m_freeLists instead.
     MemoryBlockInternal *m_sortedBlockList[MemoryBlockInternal::State::stateCount] = {nullptr};
+    //! \brief Segregated lists of free blocks indexed by size class, \see GetFreeListIndex.
+    //!        Blocks are added and removed in constant time. A list is not sorted, so finding
+    //!        its largest block takes a scan of that one list.
+    MemoryBlockInternal *m_freeLists[m_freeListClasses] = {nullptr};
+    //! \brief One bit per free list, set while the list is not empty
+    uint32_t m_freeListBitmap[(m_freeListClasses + 31) / 32] = {0};
     //! \brief Number of entries in each sorted block list.
     uint32_t m_sortedBlockListNumEntries[MemoryBlockInternal::State::stateCount] = {0};
     //! \brief Sizes of each block pool.
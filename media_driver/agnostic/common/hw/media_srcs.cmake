@@ -67,6 +67,7 @@ set(TMP_4_SOURCES_
 
 set(TMP_4_HEADERS_
     ${CMAKE_CURRENT_LIST_DIR}/mhw_block_manager.h
+    ${CMAKE_CURRENT_LIST_DIR}/mhw_cmd_template.h
     ${CMAKE_CURRENT_LIST_DIR}/mhw_memory_pool.h
     ${CMAKE_CURRENT_LIST_DIR}/mhw_mi.h
     ${CMAKE_CURRENT_LIST_DIR}/mhw_mi_generic.h
@@ -0,0 +1,400 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     mhw_cmd_template.h
+//! \brief    Recorded command templates with a patch table
+//! \details  Records the commands built for a configuration once, together
+//!           with the resources they reference, and replays them for later
+//!           frames by copying the bytes and adding the resources again
+//!
+
+#ifndef __MHW_CMD_TEMPLATE_H__
+#define __MHW_CMD_TEMPLATE_H__
+
+#include "mhw_utilities.h"
+
+#define MHW_CMD_TEMPLATE_MAX_SIZE       256     //!< Largest recorded command sequence in bytes
+#define MHW_CMD_TEMPLATE_MAX_PATCHES    16      //!< Resources referenced by one template
+#define MHW_CMD_TEMPLATE_MAX_SLOTS      16      //!< Resources a caller can bind to a template
+#define MHW_CMD_TEMPLATE_ENTRIES        2       //!< Configurations kept by one template
+#define MHW_CMD_TEMPLATE_SLOT_NULL      0xFF    //!< Alias value of an unbound slot
+
+//!
+//! \brief  Resources bound to a command template for one frame
+//! \details A slot is a resource the recorded commands may reference. The
+//!          resource offsets are recorded relative to dwBaseOffset, so a heap
+//!          whose instance changes every frame only changes the base offset.
+//!
+typedef struct _MHW_CMD_TEMPLATE_SLOTS
+{
+    PMOS_RESOURCE   presResource[MHW_CMD_TEMPLATE_MAX_SLOTS];
+    uint32_t        dwBaseOffset[MHW_CMD_TEMPLATE_MAX_SLOTS];
+    uint32_t        dwCount;
+} MHW_CMD_TEMPLATE_SLOTS, *PMHW_CMD_TEMPLATE_SLOTS;
+
+//!
+//! \brief  Recorded command template with a patch table
+//! \details The commands are recorded into the template once per configuration
+//!          while the interface's pfnAddResourceToCmd points to RecordResource.
+//!          Instead of adding the resource, the hook stores a patch: the slot
+//!          of the resource, its offset from the slot base and the location in
+//!          the commands. Replay copies the recorded bytes into the primary
+//!          command buffer and adds every patch with the real pfnAddResourceToCmd
+//!          and the resources bound for this frame, so the patch list and
+//!          the allocation list are the same as for built commands.
+//!          The recorded functions must not have side effects other than the
+//!          commands, must add every resource through pfnAddResourceToCmd, and
+//!          must not change an address dword after adding the resource, except
+//!          for its bits below dwLsbNum.
+//!          TKey holds every other input the commands are built from and is
+//!          compared with memcmp, so callers zero a key before filling it.
+//!          Entries are replaced in turn. Not thread safe, the template belongs
+//!          to an interface used by one context.
+//! \param  TKey
+//!         Configuration the commands are built from, without the resources
+//!
+template <class TKey>
+class MhwCmdTemplate
+{
+public:
+    typedef MOS_STATUS (*AddResourceToCmd)(
+        PMOS_INTERFACE          pOsInterface,
+        PMOS_COMMAND_BUFFER     pCmdBuffer,
+        PMHW_RESOURCE_PARAMS    pParams);
+
+    MhwCmdTemplate()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        MOS_ZeroMemory(m_entries, sizeof(m_entries));
+        MOS_ZeroMemory(&m_recordBuffer, sizeof(m_recordBuffer));
+        m_nextEntry = 0;
+    }
+
+    //!
+    //! \brief    Add the commands recorded for a configuration to the command buffer
+    //! \param    [in] osInterface
+    //!           OS interface
+    //! \param    [in] addResourceToCmd
+    //!           Function adding the resources, the one used to build the commands
+    //! \param    [in] cmdBuffer
+    //!           Command buffer to add the commands to
+    //! \param    [in] key
+    //!           Configuration of the commands
+    //! \param    [in] slots
+    //!           Resources for this frame
+    //! \param    [out] hit
+    //!           True if a template was found and added
+    //! \return   MOS_STATUS
+    //!           MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    MOS_STATUS Replay(
+        PMOS_INTERFACE                  osInterface,
+        AddResourceToCmd                addResourceToCmd,
+        PMOS_COMMAND_BUFFER             cmdBuffer,
+        const TKey                      &key,
+        const MHW_CMD_TEMPLATE_SLOTS    &slots,
+        bool                            &hit)
+    {
+        uint8_t  alias[MHW_CMD_TEMPLATE_MAX_SLOTS];
+        Entry    *entry = nullptr;
+
+        hit = false;
+
+        MHW_CHK_NULL_RETURN(addResourceToCmd);
+        MHW_CHK_NULL_RETURN(cmdBuffer);
+        MHW_CHK_NULL_RETURN(cmdBuffer->pCmdPtr);
+
+        GetAlias(slots, alias);
+
+        for (uint32_t i = 0; i < MHW_CMD_TEMPLATE_ENTRIES; i++)
+        {
+            if (m_entries[i].size != 0                                      &&
+                m_entries[i].slotCount == slots.dwCount                     &&
+                memcmp(m_entries[i].alias, alias, sizeof(alias)) == 0       &&
+                memcmp(&m_entries[i].key, &key, sizeof(TKey)) == 0)
+            {
+                entry = &m_entries[i];
+                break;
+            }
+        }
+
+        if (entry == nullptr)
+        {
+            return MOS_STATUS_SUCCESS;
+        }
+
+        if (cmdBuffer->iRemaining < (int32_t)entry->size)
+        {
+            MHW_ASSERTMESSAGE("Unable to add command template (no space).");
+            return MOS_STATUS_UNKNOWN;
+        }
+
+        MHW_CHK_STATUS_RETURN(MOS_SecureMemcpy(cmdBuffer->pCmdPtr, entry->size, entry->data, entry->size));
+
+        // The resources are added before the commands are committed, so the
+        // offset of the command buffer is the start of the template.
+        for (uint32_t i = 0; i < entry->patchCount; i++)
+        {
+            const Patch         &patch  = entry->patches[i];
+            uint32_t            *cmd    = cmdBuffer->pCmdPtr + patch.params.dwLocationInCmd;
+            uint32_t            mask    = (0xFFFFFFFF << patch.params.dwLsbNum);
+            MHW_RESOURCE_PARAMS params  = patch.params;
+
+            params.presResource = slots.presResource[patch.slot];
+            params.dwOffset     = slots.dwBaseOffset[patch.slot] + patch.offset;
+            params.pdwCmd       = cmd;
+
+            cmd[0] = patch.cmdValue;
+            if (params.dwUpperBoundLocationOffsetFromCmd > 0)
+            {
+                cmd[params.dwUpperBoundLocationOffsetFromCmd] = patch.upperBoundValue;
+            }
+
+            MHW_CHK_STATUS_RETURN(addResourceToCmd(osInterface, cmdBuffer, &params));
+
+            // Bits below the address were set by the caller after the resource
+            cmd[0] = (entry->data[patch.params.dwLocationInCmd] & ~mask) | (cmd[0] & mask);
+            if (patch.params.dwUpperBoundLocationOffsetFromCmd > 0)
+            {
+                uint32_t location = patch.params.dwLocationInCmd + patch.params.dwUpperBoundLocationOffsetFromCmd;
+                cmd[patch.params.dwUpperBoundLocationOffsetFromCmd] =
+                    (entry->data[location] & ~mask) | (cmd[patch.params.dwUpperBoundLocationOffsetFromCmd] & mask);
+            }
+        }
+
+        MHW_CHK_STATUS_RETURN(Mos_CommitCommand(cmdBuffer, entry->size));
+
+        hit = true;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    //!
+    //! \brief    Start recording the commands of a configuration
+    //! \details  The caller builds the commands into the returned command buffer
+    //!           with pfnAddResourceToCmd set to RecordResource, then calls EndRecord.
+    //! \param    [in] key
+    //!           Configuration of the commands
+    //! \param    [in] slots
+    //!           Resources the commands may reference
+    //! \return   PMOS_COMMAND_BUFFER
+    //!           Command buffer recording into the template
+    //!
+    PMOS_COMMAND_BUFFER BeginRecord(
+        const TKey                      &key,
+        const MHW_CMD_TEMPLATE_SLOTS    &slots)
+    {
+        Entry &entry = m_entries[m_nextEntry];
+
+        MOS_ZeroMemory(&entry, sizeof(entry));
+        MOS_SecureMemcpy(&entry.key, sizeof(TKey), &key, sizeof(TKey));
+        entry.slotCount = slots.dwCount;
+        GetAlias(slots, entry.alias);
+
+        MOS_ZeroMemory(&m_recordBuffer, sizeof(m_recordBuffer));
+        m_recordBuffer.pCmdBase   = entry.data;
+        m_recordBuffer.pCmdPtr    = entry.data;
+        m_recordBuffer.iRemaining = sizeof(entry.data);
+        m_recordBuffer.owner      = this;
+        m_recordSlots             = slots;
+
+        return &m_recordBuffer;
+    }
+
+    //!
+    //! \brief    Finish recording
+    //! \param    [in] status
+    //!           Result of building the commands into the template
+    //! \return   bool
+    //!           True if the template was recorded, false if the commands
+    //!           could not be recorded and have to be built
+    //!
+    bool EndRecord(MOS_STATUS status)
+    {
+        Entry &entry = m_entries[m_nextEntry];
+
+        // Mos_AddCommand leaves iRemaining negative when a command did not fit
+        if (status != MOS_STATUS_SUCCESS ||
+            m_recordBuffer.iRemaining < 0 ||
+            m_recordBuffer.iOffset == 0)
+        {
+            entry.size = 0;
+            return false;
+        }
+
+        for (uint32_t i = 0; i < entry.patchCount; i++)
+        {
+            uint32_t location = entry.patches[i].params.dwLocationInCmd +
+                entry.patches[i].params.dwUpperBoundLocationOffsetFromCmd + 1;
+            if (location * sizeof(uint32_t) >= (uint32_t)m_recordBuffer.iOffset)
+            {
+                MHW_ASSERTMESSAGE("Resource outside of the recorded commands.");
+                entry.size = 0;
+                return false;
+            }
+        }
+
+        entry.size  = m_recordBuffer.iOffset;
+        m_nextEntry = (m_nextEntry + 1) % MHW_CMD_TEMPLATE_ENTRIES;
+        return true;
+    }
+
+    //!
+    //! \brief    pfnAddResourceToCmd used while recording
+    //! \details  Stores the resource in the patch table of the template the
+    //!           command buffer records into. Resources in indirect state and
+    //!           resources not bound to a slot fail the recording.
+    //! \param    [in] pOsInterface
+    //!           OS interface
+    //! \param    [in] pCmdBuffer
+    //!           Command buffer returned by BeginRecord
+    //! \param    [in] pParams
+    //!           Parameters of the resource
+    //! \return   MOS_STATUS
+    //!           MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    static MOS_STATUS RecordResource(
+        PMOS_INTERFACE          pOsInterface,
+        PMOS_COMMAND_BUFFER     pCmdBuffer,
+        PMHW_RESOURCE_PARAMS    pParams)
+    {
+        MOS_UNUSED(pOsInterface);
+
+        MHW_CHK_NULL_RETURN(pCmdBuffer);
+        MHW_CHK_NULL_RETURN(pParams);
+        MHW_CHK_NULL_RETURN(pParams->presResource);
+        MHW_CHK_NULL_RETURN(pParams->pdwCmd);
+
+        RecordBuffer *recordBuffer = static_cast<RecordBuffer *>(pCmdBuffer);
+        MHW_CHK_NULL_RETURN(recordBuffer->owner);
+
+        return recordBuffer->owner->AddPatch(pParams);
+    }
+
+private:
+    struct Patch
+    {
+        MHW_RESOURCE_PARAMS params;             //!< dwLocationInCmd relative to the template start
+        uint32_t            slot;
+        uint32_t            offset;             //!< Resource offset relative to the slot base
+        uint32_t            cmdValue;           //!< Address dword when the resource was added
+        uint32_t            upperBoundValue;    //!< Upper bound dword when the resource was added
+    };
+
+    struct Entry
+    {
+        TKey        key;
+        uint8_t     alias[MHW_CMD_TEMPLATE_MAX_SLOTS];
+        uint32_t    slotCount;
+        uint32_t    size;                       //!< Zero if the entry is free
+        uint32_t    patchCount;
+        Patch       patches[MHW_CMD_TEMPLATE_MAX_PATCHES];
+        uint32_t    data[MHW_CMD_TEMPLATE_MAX_SIZE / sizeof(uint32_t)];
+    };
+
+    struct RecordBuffer : public MOS_COMMAND_BUFFER
+    {
+        MhwCmdTemplate  *owner;
+    };
+
+    //!
+    //! \brief    Describe which slots are unbound or share a resource
+    //! \details  Each slot maps to the first slot with the same resource, so a
+    //!           template only replays for frames where the resources alias the
+    //!           same way as when it was recorded.
+    //!
+    static void GetAlias(
+        const MHW_CMD_TEMPLATE_SLOTS    &slots,
+        uint8_t                         *alias)
+    {
+        for (uint32_t i = 0; i < MHW_CMD_TEMPLATE_MAX_SLOTS; i++)
+        {
+            alias[i] = MHW_CMD_TEMPLATE_SLOT_NULL;
+            if (i >= slots.dwCount || slots.presResource[i] == nullptr)
+            {
+                continue;
+            }
+
+            for (uint32_t j = 0; j <= i; j++)
+            {
+                if (slots.presResource[j] == slots.presResource[i])
+                {
+                    alias[i] = (uint8_t)j;
+                    break;
+                }
+            }
+        }
+    }
+
+    MOS_STATUS AddPatch(PMHW_RESOURCE_PARAMS pParams)
+    {
+        Entry       &entry  = m_entries[m_nextEntry];
+        uint32_t    slot    = 0;
+
+        if (pParams->dwOffsetInSSH > 0)
+        {
+            MHW_NORMALMESSAGE("Resources in indirect state are not recorded.");
+            return MOS_STATUS_UNIMPLEMENTED;
+        }
+
+        if (entry.patchCount >= MHW_CMD_TEMPLATE_MAX_PATCHES)
+        {
+            MHW_NORMALMESSAGE("Too many resources in the command template.");
+            return MOS_STATUS_UNIMPLEMENTED;
+        }
+
+        while (slot < m_recordSlots.dwCount && m_recordSlots.presResource[slot] != pParams->presResource)
+        {
+            slot++;
+        }
+
+        if (slot >= m_recordSlots.dwCount)
+        {
+            MHW_NORMALMESSAGE("Resource not bound to the command template.");
+            return MOS_STATUS_UNIMPLEMENTED;
+        }
+
+        Patch &patch = entry.patches[entry.patchCount++];
+
+        patch.params                 = *pParams;
+        patch.params.presResource    = nullptr;
+        patch.params.pdwCmd          = nullptr;
+        patch.params.dwLocationInCmd += m_recordBuffer.iOffset / sizeof(uint32_t);
+        patch.slot                   = slot;
+        patch.offset                 = pParams->dwOffset - m_recordSlots.dwBaseOffset[slot];
+        patch.cmdValue               = *pParams->pdwCmd;
+        patch.upperBoundValue        = (pParams->dwUpperBoundLocationOffsetFromCmd > 0) ?
+            pParams->pdwCmd[pParams->dwUpperBoundLocationOffsetFromCmd] : 0;
+
+        return MOS_STATUS_SUCCESS;
+    }
+
+    Entry                   m_entries[MHW_CMD_TEMPLATE_ENTRIES];
+    uint32_t                m_nextEntry = 0;
+    RecordBuffer            m_recordBuffer;
+    MHW_CMD_TEMPLATE_SLOTS  m_recordSlots;
+};
+
+#endif // __MHW_CMD_TEMPLATE_H__
@@ -744,4 +744,66 @@ static __inline MOS_STATUS Mhw_AddCommandCmdOrBB(
     }
 }
 
+//*-----------------------------------------------------------------------------
+//| Purpose:    Function to construct a command in place in command buffer or
+//|             batch buffer, added by Mhw_CommitCommandCmdOrBB
+//| Return:     MOS_STATUS_SUCCESS if call succeeds
+//*-----------------------------------------------------------------------------
+template <class TCmd>
+MOS_STATUS Mhw_EmplaceCommandCmdOrBB(
+    void       *pCmdBuffer,     // [in] Pointer to Command Buffer
+    void       *pBatchBuffer,   // [in] Pointer to Batch Buffer
+    TCmd       *&pCmd)          // [out] Command constructed in the buffer
+{
+    PMHW_BATCH_BUFFER pBatch = (PMHW_BATCH_BUFFER)pBatchBuffer;
+
+    if (pCmdBuffer)
+    {
+        return Mos_EmplaceCommand((PMOS_COMMAND_BUFFER)pCmdBuffer, pCmd);
+    }
+
+    pCmd = nullptr;
+
+    if (pBatch == nullptr || pBatch->pData == nullptr)
+    {
+        return MOS_STATUS_NULL_POINTER;
+    }
+
+    if (pBatch->iRemaining < (int32_t)MOS_ALIGN_CEIL(sizeof(TCmd), sizeof(uint32_t)))
+    {
+        MHW_ASSERTMESSAGE("Unable to add command (no space).");
+        return MOS_STATUS_UNKNOWN;
+    }
+
+    pCmd = new (pBatch->pData + pBatch->iCurrent) TCmd;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Function to add the command constructed by
+//|             Mhw_EmplaceCommandCmdOrBB
+//| Return:     MOS_STATUS_SUCCESS if call succeeds
+//*-----------------------------------------------------------------------------
+static __inline MOS_STATUS Mhw_CommitCommandCmdOrBB(
+    void       *pCmdBuffer,     // [in] Pointer to Command Buffer
+    void       *pBatchBuffer,   // [in] Pointer to Batch Buffer
+    uint32_t   dwCmdSize)       // [in] Size of command in bytes
+{
+    PMHW_BATCH_BUFFER pBatch = (PMHW_BATCH_BUFFER)pBatchBuffer;
+    uint32_t          dwCmdSizeDwAligned;
+
+    if (pCmdBuffer)
+    {
+        return Mos_CommitCommand((PMOS_COMMAND_BUFFER)pCmdBuffer, dwCmdSize);
+    }
+
+    dwCmdSizeDwAligned = MOS_ALIGN_CEIL(dwCmdSize, sizeof(uint32_t));
+
+    pBatch->iCurrent   += dwCmdSizeDwAligned;
+    pBatch->iRemaining -= dwCmdSizeDwAligned;
+
+    return MOS_STATUS_SUCCESS;
+}
+
 #endif // __MHW_UTILITIES_H__
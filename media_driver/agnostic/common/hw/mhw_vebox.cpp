@@ -353,6 +353,170 @@ MOS_STATUS MhwVeboxInterface::DestroyHeap()
         m_veboxHeap = nullptr;
     }
 
+    // The recorded offsets are relative to the heap layout
+    m_veboxStateTemplate.Reset();
+    m_veboxDiIecpTemplate.Reset();
+
+finish:
+    return eStatus;
+}
+
+MOS_STATUS MhwVeboxInterface::AddVeboxStateAndSurfacesFromTemplate(
+    PMOS_COMMAND_BUFFER                     pCmdBuffer,
+    PMHW_VEBOX_STATE_CMD_PARAMS             pVeboxStateCmdParams,
+    PMHW_VEBOX_SURFACE_STATE_CMD_PARAMS     pVeboxSurfaceStateCmdParams)
+{
+    MHW_VEBOX_STATE_TEMPLATE_KEY    Key;
+    MHW_CMD_TEMPLATE_SLOTS          Slots;
+    PMOS_COMMAND_BUFFER             pRecordBuffer;
+    MOS_STATUS                      (*pfnAddResource)(PMOS_INTERFACE, PMOS_COMMAND_BUFFER, PMHW_RESOURCE_PARAMS);
+    bool                            bRecorded = false;
+    bool                            bReplayed = false;
+    MOS_STATUS                      eStatus   = MOS_STATUS_SUCCESS;
+
+    MHW_FUNCTION_ENTER;
+    MHW_CHK_NULL(pCmdBuffer);
+    MHW_CHK_NULL(pVeboxStateCmdParams);
+    MHW_CHK_NULL(pVeboxSurfaceStateCmdParams);
+
+    // Without the heap VEBOX_STATE allocates the dummy IECP resource, so it is
+    // always built
+    if (pVeboxStateCmdParams->bNoUseVeboxHeap || m_veboxHeap == nullptr)
+    {
+        MHW_CHK_STATUS(AddVeboxState(pCmdBuffer, pVeboxStateCmdParams, false));
+        MHW_CHK_STATUS(AddVeboxSurfaces(pCmdBuffer, pVeboxSurfaceStateCmdParams));
+        goto finish;
+    }
+
+    MOS_ZeroMemory(&Key, sizeof(Key));
+    MOS_SecureMemcpy(&Key.VeboxStateCmdParams, sizeof(Key.VeboxStateCmdParams),
+        pVeboxStateCmdParams, sizeof(*pVeboxStateCmdParams));
+    MOS_SecureMemcpy(&Key.VeboxSurfaceStateCmdParams, sizeof(Key.VeboxSurfaceStateCmdParams),
+        pVeboxSurfaceStateCmdParams, sizeof(*pVeboxSurfaceStateCmdParams));
+    Key.VeboxStateCmdParams.pLaceLookUpTables                       = nullptr;
+    Key.VeboxStateCmdParams.pVeboxParamSurf                         = nullptr;
+    Key.VeboxStateCmdParams.pVebox3DLookUpTables                    = nullptr;
+    MOS_ZeroMemory(&Key.VeboxStateCmdParams.DummyIecpResource, sizeof(MOS_RESOURCE));
+    Key.VeboxSurfaceStateCmdParams.SurfInput.pOsResource            = nullptr;
+    Key.VeboxSurfaceStateCmdParams.SurfOutput.pOsResource           = nullptr;
+    Key.VeboxSurfaceStateCmdParams.SurfSTMM.pOsResource             = nullptr;
+    Key.VeboxSurfaceStateCmdParams.SurfDNOutput.pOsResource         = nullptr;
+    Key.VeboxSurfaceStateCmdParams.SurfSkinScoreOutput.pOsResource  = nullptr;
+
+    // The heap instance changes every frame, its offset is the slot base
+    MOS_ZeroMemory(&Slots, sizeof(Slots));
+    Slots.presResource[0] = pVeboxStateCmdParams->bUseVeboxHeapKernelResource ?
+        &m_veboxHeap->KernelResource : &m_veboxHeap->DriverResource;
+    Slots.dwBaseOffset[0] = m_veboxHeap->uiInstanceSize * m_veboxHeap->uiCurState;
+    Slots.presResource[1] = pVeboxStateCmdParams->pVeboxParamSurf;
+    Slots.presResource[2] = pVeboxStateCmdParams->pLaceLookUpTables;
+    Slots.presResource[3] = pVeboxStateCmdParams->pVebox3DLookUpTables;
+    Slots.dwCount         = 4;
+
+    MHW_CHK_STATUS(m_veboxStateTemplate.Replay(m_osInterface, pfnAddResourceToCmd, pCmdBuffer, Key, Slots, bReplayed));
+    if (bReplayed)
+    {
+        goto finish;
+    }
+
+    pRecordBuffer       = m_veboxStateTemplate.BeginRecord(Key, Slots);
+    pfnAddResource      = pfnAddResourceToCmd;
+    pfnAddResourceToCmd = MhwCmdTemplate<MHW_VEBOX_STATE_TEMPLATE_KEY>::RecordResource;
+    eStatus             = AddVeboxState(pRecordBuffer, pVeboxStateCmdParams, false);
+    if (eStatus == MOS_STATUS_SUCCESS)
+    {
+        eStatus = AddVeboxSurfaces(pRecordBuffer, pVeboxSurfaceStateCmdParams);
+    }
+    pfnAddResourceToCmd = pfnAddResource;
+
+    bRecorded = m_veboxStateTemplate.EndRecord(eStatus);
+    eStatus   = MOS_STATUS_SUCCESS;
+    if (bRecorded)
+    {
+        MHW_CHK_STATUS(m_veboxStateTemplate.Replay(m_osInterface, pfnAddResourceToCmd, pCmdBuffer, Key, Slots, bReplayed));
+    }
+
+    // Not recordable, build the commands
+    if (!bReplayed)
+    {
+        MHW_CHK_STATUS(AddVeboxState(pCmdBuffer, pVeboxStateCmdParams, false));
+        MHW_CHK_STATUS(AddVeboxSurfaces(pCmdBuffer, pVeboxSurfaceStateCmdParams));
+    }
+
+finish:
+    return eStatus;
+}
+
+MOS_STATUS MhwVeboxInterface::AddVeboxDiIecpFromTemplate(
+    PMOS_COMMAND_BUFFER                     pCmdBuffer,
+    PMHW_VEBOX_DI_IECP_CMD_PARAMS           pVeboxDiIecpCmdParams)
+{
+    MHW_VEBOX_DI_IECP_TEMPLATE_KEY  Key;
+    MHW_CMD_TEMPLATE_SLOTS          Slots;
+    PMOS_COMMAND_BUFFER             pRecordBuffer;
+    MOS_STATUS                      (*pfnAddResource)(PMOS_INTERFACE, PMOS_COMMAND_BUFFER, PMHW_RESOURCE_PARAMS);
+    bool                            bRecorded = false;
+    bool                            bReplayed = false;
+    MOS_STATUS                      eStatus   = MOS_STATUS_SUCCESS;
+
+    MHW_FUNCTION_ENTER;
+    MHW_CHK_NULL(pCmdBuffer);
+    MHW_CHK_NULL(pVeboxDiIecpCmdParams);
+
+    MOS_ZeroMemory(&Slots, sizeof(Slots));
+    Slots.presResource[0]  = pVeboxDiIecpCmdParams->pOsResCurrInput;
+    Slots.presResource[1]  = pVeboxDiIecpCmdParams->pOsResPrevInput;
+    Slots.presResource[2]  = pVeboxDiIecpCmdParams->pOsResStmmInput;
+    Slots.presResource[3]  = pVeboxDiIecpCmdParams->pOsResStmmOutput;
+    Slots.presResource[4]  = pVeboxDiIecpCmdParams->pOsResDenoisedCurrOutput;
+    Slots.presResource[5]  = pVeboxDiIecpCmdParams->pOsResCurrOutput;
+    Slots.presResource[6]  = pVeboxDiIecpCmdParams->pOsResPrevOutput;
+    Slots.presResource[7]  = pVeboxDiIecpCmdParams->pOsResStatisticsOutput;
+    Slots.presResource[8]  = pVeboxDiIecpCmdParams->pOsResAlphaOrVignette;
+    Slots.presResource[9]  = pVeboxDiIecpCmdParams->pOsResLaceOrAceOrRgbHistogram;
+    Slots.presResource[10] = pVeboxDiIecpCmdParams->pOsResSkinScoreSurface;
+    Slots.dwCount          = 11;
+
+    MOS_ZeroMemory(&Key, sizeof(Key));
+    MOS_SecureMemcpy(&Key.VeboxDiIecpCmdParams, sizeof(Key.VeboxDiIecpCmdParams),
+        pVeboxDiIecpCmdParams, sizeof(*pVeboxDiIecpCmdParams));
+    Key.VeboxDiIecpCmdParams.pOsResCurrInput                = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResPrevInput                = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResStmmInput                = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResStmmOutput               = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResDenoisedCurrOutput       = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResCurrOutput               = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResPrevOutput               = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResStatisticsOutput         = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResAlphaOrVignette          = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResLaceOrAceOrRgbHistogram  = nullptr;
+    Key.VeboxDiIecpCmdParams.pOsResSkinScoreSurface         = nullptr;
+
+    MHW_CHK_STATUS(m_veboxDiIecpTemplate.Replay(m_osInterface, pfnAddResourceToCmd, pCmdBuffer, Key, Slots, bReplayed));
+    if (bReplayed)
+    {
+        goto finish;
+    }
+
+    pRecordBuffer       = m_veboxDiIecpTemplate.BeginRecord(Key, Slots);
+    pfnAddResource      = pfnAddResourceToCmd;
+    pfnAddResourceToCmd = MhwCmdTemplate<MHW_VEBOX_DI_IECP_TEMPLATE_KEY>::RecordResource;
+    eStatus             = AddVeboxDiIecp(pRecordBuffer, pVeboxDiIecpCmdParams);
+    pfnAddResourceToCmd = pfnAddResource;
+
+    bRecorded = m_veboxDiIecpTemplate.EndRecord(eStatus);
+    eStatus   = MOS_STATUS_SUCCESS;
+    if (bRecorded)
+    {
+        MHW_CHK_STATUS(m_veboxDiIecpTemplate.Replay(m_osInterface, pfnAddResourceToCmd, pCmdBuffer, Key, Slots, bReplayed));
+    }
+
+    // Not recordable, build the commands
+    if (!bReplayed)
+    {
+        MHW_CHK_STATUS(AddVeboxDiIecp(pCmdBuffer, pVeboxDiIecpCmdParams));
+    }
+
 finish:
     return eStatus;
 }
@@ -31,6 +31,7 @@
 #include "mos_os.h"
 #include "mhw_utilities.h"
 #include "mhw_cp.h"
+#include "mhw_cmd_template.h"
 
 #include <math.h>
 
@@ -779,6 +780,25 @@ typedef struct
 } MHW_VEBOX_SETTINGS, *PMHW_VEBOX_SETTINGS;
 typedef const MHW_VEBOX_SETTINGS CMHW_VEBOX_SETTINGS, *PCMHW_VEBOX_SETTINGS;
 
+//!
+//! \brief  Configuration of the recorded VEBOX_STATE and VEBOX_SURFACE_STATE commands
+//! \details The command parameters with their resources cleared
+//!
+typedef struct _MHW_VEBOX_STATE_TEMPLATE_KEY
+{
+    MHW_VEBOX_STATE_CMD_PARAMS          VeboxStateCmdParams;
+    MHW_VEBOX_SURFACE_STATE_CMD_PARAMS  VeboxSurfaceStateCmdParams;
+} MHW_VEBOX_STATE_TEMPLATE_KEY, *PMHW_VEBOX_STATE_TEMPLATE_KEY;
+
+//!
+//! \brief  Configuration of the recorded VEB_DI_IECP command
+//! \details The command parameters with their resources cleared
+//!
+typedef struct _MHW_VEBOX_DI_IECP_TEMPLATE_KEY
+{
+    MHW_VEBOX_DI_IECP_CMD_PARAMS        VeboxDiIecpCmdParams;
+} MHW_VEBOX_DI_IECP_TEMPLATE_KEY, *PMHW_VEBOX_DI_IECP_TEMPLATE_KEY;
+
 //!
 //! \brief  MHW VEBOX GPUNODE Structure
 //!
@@ -856,6 +876,39 @@ public:
         PMOS_COMMAND_BUFFER                     pCmdBuffer,
         PMHW_VEBOX_DI_IECP_CMD_PARAMS           pVeboxDiIecpCmdParams) = 0;
 
+    //!
+    //! \brief    Add Vebox State and Vebox Surface State commands from a template
+    //! \details  The commands are recorded with their resources the first time
+    //!           a configuration is seen and replayed for the next frames with
+    //!           the resources of the frame. Configurations that cannot be
+    //!           recorded are built with AddVeboxState and AddVeboxSurfaces.
+    //! \param    [in] pCmdBuffer
+    //!           Pointer to Command Buffer
+    //! \param    [in] pVeboxStateCmdParams
+    //!           Pointer to Vebox State Params
+    //! \param    [in] pVeboxSurfaceStateCmdParams
+    //!           Pointer to surface state params
+    //! \return   MOS_STATUS
+    //!
+    MOS_STATUS AddVeboxStateAndSurfacesFromTemplate(
+        PMOS_COMMAND_BUFFER                     pCmdBuffer,
+        PMHW_VEBOX_STATE_CMD_PARAMS             pVeboxStateCmdParams,
+        PMHW_VEBOX_SURFACE_STATE_CMD_PARAMS     pVeboxSurfaceStateCmdParams);
+
+    //!
+    //! \brief    Send Vebox Di Iecp from a template
+    //! \details  Same as AddVeboxDiIecp, replaying the command recorded for
+    //!           the configuration with the resources of the frame
+    //! \param    [in] pCmdBuffer
+    //!           Pointer to Command Buffer
+    //! \param    [in] pVeboxDiIecpCmdParams
+    //!           Pointer to DI IECP Params
+    //! \return   MOS_STATUS
+    //!
+    MOS_STATUS AddVeboxDiIecpFromTemplate(
+        PMOS_COMMAND_BUFFER                     pCmdBuffer,
+        PMHW_VEBOX_DI_IECP_CMD_PARAMS           pVeboxDiIecpCmdParams);
+
     //!
     //! \brief      Add VEBOX DNDI States
     //! \details    Add vebox dndi states
@@ -1099,6 +1152,12 @@ private:
     //! \brief    Vebox heap instance in use
     int                    m_veboxHeapInUse = 0;
 
+    //! \brief    Recorded VEBOX_STATE and VEBOX_SURFACE_STATE commands
+    MhwCmdTemplate<MHW_VEBOX_STATE_TEMPLATE_KEY>    m_veboxStateTemplate;
+
+    //! \brief    Recorded VEB_DI_IECP commands
+    MhwCmdTemplate<MHW_VEBOX_DI_IECP_TEMPLATE_KEY>  m_veboxDiIecpTemplate;
+
  public:
     PMOS_INTERFACE         m_osInterface   = nullptr;
     PMHW_VEBOX_HEAP        m_veboxHeap     = nullptr;
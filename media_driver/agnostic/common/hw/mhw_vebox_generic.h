@@ -108,7 +108,7 @@ public:
             &cmd1,
             false,
             pVeboxSurfaceStateCmdParams->bDIEnable);
-        Mos_AddCommand(pCmdBuffer, &cmd1, cmd1.byteSize);
+        MHW_CHK_STATUS(Mos_AddCommand(pCmdBuffer, &cmd1, cmd1.byteSize));
 
         // Setup Surface State for Output surface
         if (bOutputValid)
@@ -127,7 +127,7 @@ public:
                 cmd2.DW3.SurfaceFormat = cmd1.DW3.SurfaceFormat;
             }
 
-            Mos_AddCommand(pCmdBuffer, &cmd2, cmd2.byteSize);
+            MHW_CHK_STATUS(Mos_AddCommand(pCmdBuffer, &cmd2, cmd2.byteSize));
         }
 
     finish:
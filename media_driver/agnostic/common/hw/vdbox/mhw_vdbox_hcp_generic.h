@@ -343,12 +343,13 @@ protected:
 
         MHW_FUNCTION_ENTER;
 
-        typename THcpCmds::HCP_BSD_OBJECT_CMD   cmd;
+        typename THcpCmds::HCP_BSD_OBJECT_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mos_EmplaceCommand(cmdBuffer, cmd));
 
-        cmd.DW1.IndirectBsdDataLength = params->dwBsdDataLength;
-        cmd.DW2.IndirectDataStartAddress = params->dwBsdDataStartOffset;
+        cmd->DW1.IndirectBsdDataLength = params->dwBsdDataLength;
+        cmd->DW2.IndirectDataStartAddress = params->dwBsdDataStartOffset;
 
-        MHW_MI_CHK_STATUS(Mos_AddCommand(cmdBuffer, &cmd, sizeof(cmd)));
+        MHW_MI_CHK_STATUS(Mos_CommitCommand(cmdBuffer, sizeof(*cmd)));
 
         return eStatus;
     }
@@ -469,12 +470,18 @@ protected:
 
         MHW_MI_CHK_NULL(params);
 
+        if (cmdBuffer == nullptr && batchBuffer == nullptr)
+        {
+            MHW_ASSERTMESSAGE("There was no valid buffer to add the HW command to.");
+        }
+
         MHW_ASSERT(params->CurrPic.FrameIdx != 0x7F);
 
-        typename THcpCmds::HCP_REF_IDX_STATE_CMD cmd;
+        typename THcpCmds::HCP_REF_IDX_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mhw_EmplaceCommandCmdOrBB(cmdBuffer, batchBuffer, cmd));
 
-        cmd.DW1.Refpiclistnum = params->ucList;
-        cmd.DW1.NumRefIdxLRefpiclistnumActiveMinus1 = params->ucNumRefForList - 1;
+        cmd->DW1.Refpiclistnum = params->ucList;
+        cmd->DW1.NumRefIdxLRefpiclistnumActiveMinus1 = params->ucNumRefForList - 1;
 
         for (uint8_t i = 0; i < params->ucNumRefForList; i++)
         {
@@ -483,35 +490,30 @@ protected:
             {
                 MHW_ASSERT(*(params->pRefIdxMapping + refFrameIDx) >= 0);
 
-                cmd.Entries[i].DW0.ListEntryLxReferencePictureFrameIdRefaddr07 = *(params->pRefIdxMapping + refFrameIDx);
+                cmd->Entries[i].DW0.ListEntryLxReferencePictureFrameIdRefaddr07 = *(params->pRefIdxMapping + refFrameIDx);
                 int32_t pocDiff = params->poc_curr_pic - params->poc_list[refFrameIDx];
-                cmd.Entries[i].DW0.ReferencePictureTbValue = CodecHal_Clip3(-128, 127, pocDiff);
+                cmd->Entries[i].DW0.ReferencePictureTbValue = CodecHal_Clip3(-128, 127, pocDiff);
                 CODEC_REF_LIST** refList = (CODEC_REF_LIST**)params->hevcRefList;
-                cmd.Entries[i].DW0.Longtermreference = CodecHal_PictureIsLongTermRef(refList[params->CurrPic.FrameIdx]->RefList[refFrameIDx]);
-                cmd.Entries[i].DW0.FieldPicFlag = (params->RefFieldPicFlag >> refFrameIDx) & 0x01;
-                cmd.Entries[i].DW0.BottomFieldFlag = ((params->RefBottomFieldFlag >> refFrameIDx) & 0x01) ? 0 : 1;
+                cmd->Entries[i].DW0.Longtermreference = CodecHal_PictureIsLongTermRef(refList[params->CurrPic.FrameIdx]->RefList[refFrameIDx]);
+                cmd->Entries[i].DW0.FieldPicFlag = (params->RefFieldPicFlag >> refFrameIDx) & 0x01;
+                cmd->Entries[i].DW0.BottomFieldFlag = ((params->RefBottomFieldFlag >> refFrameIDx) & 0x01) ? 0 : 1;
             }
             else
             {
-                cmd.Entries[i].DW0.ListEntryLxReferencePictureFrameIdRefaddr07 = 0;
-                cmd.Entries[i].DW0.ReferencePictureTbValue = 0;
-                cmd.Entries[i].DW0.Longtermreference = false;
-                cmd.Entries[i].DW0.FieldPicFlag = 0;
-                cmd.Entries[i].DW0.BottomFieldFlag = 0;
+                cmd->Entries[i].DW0.ListEntryLxReferencePictureFrameIdRefaddr07 = 0;
+                cmd->Entries[i].DW0.ReferencePictureTbValue = 0;
+                cmd->Entries[i].DW0.Longtermreference = false;
+                cmd->Entries[i].DW0.FieldPicFlag = 0;
+                cmd->Entries[i].DW0.BottomFieldFlag = 0;
             }
         }
 
         for (uint8_t i = (uint8_t)params->ucNumRefForList; i < 16; i++)
         {
-            cmd.Entries[i].DW0.Value = 0x00;
+            cmd->Entries[i].DW0.Value = 0x00;
         }
 
-        if (cmdBuffer == nullptr && batchBuffer == nullptr)
-        {
-            MHW_ASSERTMESSAGE("There was no valid buffer to add the HW command to.");
-        }
-
-        MHW_MI_CHK_STATUS(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, &cmd, cmd.byteSize));
+        MHW_MI_CHK_STATUS(Mhw_CommitCommandCmdOrBB(cmdBuffer, batchBuffer, cmd->byteSize));
 
         return eStatus;
     }
@@ -527,35 +529,36 @@ protected:
 
         MHW_MI_CHK_NULL(params);
 
-        typename THcpCmds::HCP_WEIGHTOFFSET_STATE_CMD       cmd;
+        if (cmdBuffer == nullptr && batchBuffer == nullptr)
+        {
+            MHW_ASSERTMESSAGE("There was no valid buffer to add the HW command to.");
+        }
+
+        typename THcpCmds::HCP_WEIGHTOFFSET_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mhw_EmplaceCommandCmdOrBB(cmdBuffer, batchBuffer, cmd));
         uint8_t i = 0;
 
-        cmd.DW1.Refpiclistnum = i = params->ucList;
+        cmd->DW1.Refpiclistnum = i = params->ucList;
 
         // Luma
         for (uint8_t refIdx = 0; refIdx < CODEC_MAX_NUM_REF_FRAME_HEVC; refIdx++)
         {
-            cmd.Lumaoffsets[refIdx].DW0.DeltaLumaWeightLxI = params->LumaWeights[i][refIdx];
-            cmd.Lumaoffsets[refIdx].DW0.LumaOffsetLxI = params->LumaOffsets[i][refIdx];
+            cmd->Lumaoffsets[refIdx].DW0.DeltaLumaWeightLxI = params->LumaWeights[i][refIdx];
+            cmd->Lumaoffsets[refIdx].DW0.LumaOffsetLxI = params->LumaOffsets[i][refIdx];
         }
 
         // Chroma
         for (uint8_t refIdx = 0; refIdx < CODEC_MAX_NUM_REF_FRAME_HEVC; refIdx++)
         {
-            cmd.Chromaoffsets[refIdx].DW0.DeltaChromaWeightLxI0 = params->ChromaWeights[i][refIdx][0];
-            cmd.Chromaoffsets[refIdx].DW0.ChromaoffsetlxI0 = params->ChromaOffsets[i][refIdx][0];
-            cmd.Chromaoffsets[refIdx].DW0.DeltaChromaWeightLxI1 = params->ChromaWeights[i][refIdx][1];
-            cmd.Chromaoffsets[refIdx].DW0.ChromaoffsetlxI1 = params->ChromaOffsets[i][refIdx][1];
+            cmd->Chromaoffsets[refIdx].DW0.DeltaChromaWeightLxI0 = params->ChromaWeights[i][refIdx][0];
+            cmd->Chromaoffsets[refIdx].DW0.ChromaoffsetlxI0 = params->ChromaOffsets[i][refIdx][0];
+            cmd->Chromaoffsets[refIdx].DW0.DeltaChromaWeightLxI1 = params->ChromaWeights[i][refIdx][1];
+            cmd->Chromaoffsets[refIdx].DW0.ChromaoffsetlxI1 = params->ChromaOffsets[i][refIdx][1];
         }
 
         //cmd.DW2[15] and cmd.DW18[15] not be used
 
-        if (cmdBuffer == nullptr && batchBuffer == nullptr)
-        {
-            MHW_ASSERTMESSAGE("There was no valid buffer to add the HW command to.");
-        }
-
-        MHW_MI_CHK_STATUS(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, &cmd, cmd.byteSize));
+        MHW_MI_CHK_STATUS(Mhw_CommitCommandCmdOrBB(cmdBuffer, batchBuffer, cmd->byteSize));
 
         return eStatus;
     }
@@ -570,7 +573,8 @@ protected:
 
         MHW_MI_CHK_NULL(hevcSliceState);
 
-        typename THcpCmds::HCP_SLICE_STATE_CMD cmd;
+        typename THcpCmds::HCP_SLICE_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mos_EmplaceCommand(cmdBuffer, cmd));
 
         auto hevcSliceParams = hevcSliceState->pHevcSliceParams;
         auto hevcPicParams = hevcSliceState->pHevcPicParams;
@@ -585,44 +589,44 @@ protected:
         // If first slice doesn't starts from (0,0), that means this is error bitstream.
         if (hevcSliceState->dwSliceIndex == 0)
         {
-            cmd.DW1.SlicestartctbxOrSliceStartLcuXEncoder = 0;
-            cmd.DW1.SlicestartctbyOrSliceStartLcuYEncoder = 0;
+            cmd->DW1.SlicestartctbxOrSliceStartLcuXEncoder = 0;
+            cmd->DW1.SlicestartctbyOrSliceStartLcuYEncoder = 0;
         }
         else
         {
-            cmd.DW1.SlicestartctbxOrSliceStartLcuXEncoder = hevcSliceParams->slice_segment_address % widthInCtb;
-            cmd.DW1.SlicestartctbyOrSliceStartLcuYEncoder = hevcSliceParams->slice_segment_address / widthInCtb;
+            cmd->DW1.SlicestartctbxOrSliceStartLcuXEncoder = hevcSliceParams->slice_segment_address % widthInCtb;
+            cmd->DW1.SlicestartctbyOrSliceStartLcuYEncoder = hevcSliceParams->slice_segment_address / widthInCtb;
         }
 
         if (hevcSliceState->bLastSlice)
         {
-            cmd.DW2.NextslicestartctbxOrNextSliceStartLcuXEncoder = 0;
-            cmd.DW2.NextslicestartctbyOrNextSliceStartLcuYEncoder = 0;
+            cmd->DW2.NextslicestartctbxOrNextSliceStartLcuXEncoder = 0;
+            cmd->DW2.NextslicestartctbyOrNextSliceStartLcuYEncoder = 0;
         }
         else
         {
-            cmd.DW2.NextslicestartctbxOrNextSliceStartLcuXEncoder = (hevcSliceParams + 1)->slice_segment_address % widthInCtb;
-            cmd.DW2.NextslicestartctbyOrNextSliceStartLcuYEncoder = (hevcSliceParams + 1)->slice_segment_address / widthInCtb;
+            cmd->DW2.NextslicestartctbxOrNextSliceStartLcuXEncoder = (hevcSliceParams + 1)->slice_segment_address % widthInCtb;
+            cmd->DW2.NextslicestartctbyOrNextSliceStartLcuYEncoder = (hevcSliceParams + 1)->slice_segment_address / widthInCtb;
         }
 
-        cmd.DW3.SliceType = hevcSliceParams->LongSliceFlags.fields.slice_type;
-        cmd.DW3.Lastsliceofpic = hevcSliceState->bLastSlice;
-        cmd.DW3.DependentSliceFlag = hevcSliceParams->LongSliceFlags.fields.dependent_slice_segment_flag;
-        cmd.DW3.SliceTemporalMvpEnableFlag = hevcSliceParams->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag;
-        cmd.DW3.SliceCbQpOffset = hevcSliceParams->slice_cb_qp_offset;
-        cmd.DW3.SliceCrQpOffset = hevcSliceParams->slice_cr_qp_offset;
+        cmd->DW3.SliceType = hevcSliceParams->LongSliceFlags.fields.slice_type;
+        cmd->DW3.Lastsliceofpic = hevcSliceState->bLastSlice;
+        cmd->DW3.DependentSliceFlag = hevcSliceParams->LongSliceFlags.fields.dependent_slice_segment_flag;
+        cmd->DW3.SliceTemporalMvpEnableFlag = hevcSliceParams->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag;
+        cmd->DW3.SliceCbQpOffset = hevcSliceParams->slice_cb_qp_offset;
+        cmd->DW3.SliceCrQpOffset = hevcSliceParams->slice_cr_qp_offset;
 
-        cmd.DW4.SliceHeaderDisableDeblockingFilterFlag = hevcSliceParams->LongSliceFlags.fields.slice_deblocking_filter_disabled_flag;
-        cmd.DW4.SliceTcOffsetDiv2OrFinalTcOffsetDiv2Encoder = hevcSliceParams->slice_tc_offset_div2;
-        cmd.DW4.SliceBetaOffsetDiv2OrFinalBetaOffsetDiv2Encoder = hevcSliceParams->slice_beta_offset_div2;
-        cmd.DW4.SliceLoopFilterAcrossSlicesEnabledFlag = hevcSliceParams->LongSliceFlags.fields.slice_loop_filter_across_slices_enabled_flag;
-        cmd.DW4.SliceSaoChromaFlag = hevcSliceParams->LongSliceFlags.fields.slice_sao_chroma_flag;
-        cmd.DW4.SliceSaoLumaFlag = hevcSliceParams->LongSliceFlags.fields.slice_sao_luma_flag;
-        cmd.DW4.MvdL1ZeroFlag = hevcSliceParams->LongSliceFlags.fields.mvd_l1_zero_flag;
+        cmd->DW4.SliceHeaderDisableDeblockingFilterFlag = hevcSliceParams->LongSliceFlags.fields.slice_deblocking_filter_disabled_flag;
+        cmd->DW4.SliceTcOffsetDiv2OrFinalTcOffsetDiv2Encoder = hevcSliceParams->slice_tc_offset_div2;
+        cmd->DW4.SliceBetaOffsetDiv2OrFinalBetaOffsetDiv2Encoder = hevcSliceParams->slice_beta_offset_div2;
+        cmd->DW4.SliceLoopFilterAcrossSlicesEnabledFlag = hevcSliceParams->LongSliceFlags.fields.slice_loop_filter_across_slices_enabled_flag;
+        cmd->DW4.SliceSaoChromaFlag = hevcSliceParams->LongSliceFlags.fields.slice_sao_chroma_flag;
+        cmd->DW4.SliceSaoLumaFlag = hevcSliceParams->LongSliceFlags.fields.slice_sao_luma_flag;
+        cmd->DW4.MvdL1ZeroFlag = hevcSliceParams->LongSliceFlags.fields.mvd_l1_zero_flag;
 
         uint8_t isLowDelay = 1;
 
-        if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_I_SLICE)
+        if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_I_SLICE)
         {
             isLowDelay = 0;
         }
@@ -638,7 +642,7 @@ protected:
                 }
             }
 
-            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_B_SLICE)
+            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_B_SLICE)
             {
                 for (uint8_t i = 0; i < hevcSliceParams->num_ref_idx_l1_active_minus1 + 1; i++)
                 {
@@ -652,13 +656,13 @@ protected:
             }
         }
 
-        cmd.DW4.Islowdelay = isLowDelay & 0x1;
+        cmd->DW4.Islowdelay = isLowDelay & 0x1;
 
-        cmd.DW4.CollocatedFromL0Flag = hevcSliceParams->LongSliceFlags.fields.collocated_from_l0_flag;
-        cmd.DW4.Chromalog2Weightdenom = hevcSliceParams->luma_log2_weight_denom + hevcSliceParams->delta_chroma_log2_weight_denom;
-        cmd.DW4.LumaLog2WeightDenom = hevcSliceParams->luma_log2_weight_denom;
-        cmd.DW4.CabacInitFlag = hevcSliceParams->LongSliceFlags.fields.cabac_init_flag;
-        cmd.DW4.Maxmergeidx = 5 - hevcSliceParams->five_minus_max_num_merge_cand - 1;
+        cmd->DW4.CollocatedFromL0Flag = hevcSliceParams->LongSliceFlags.fields.collocated_from_l0_flag;
+        cmd->DW4.Chromalog2Weightdenom = hevcSliceParams->luma_log2_weight_denom + hevcSliceParams->delta_chroma_log2_weight_denom;
+        cmd->DW4.LumaLog2WeightDenom = hevcSliceParams->luma_log2_weight_denom;
+        cmd->DW4.CabacInitFlag = hevcSliceParams->LongSliceFlags.fields.cabac_init_flag;
+        cmd->DW4.Maxmergeidx = 5 - hevcSliceParams->five_minus_max_num_merge_cand - 1;
 
         uint8_t collocatedRefIndex, collocatedFrameIdx, collocatedFromL0Flag;
 
@@ -668,28 +672,28 @@ protected:
             collocatedRefIndex = hevcSliceParams->collocated_ref_idx;
             collocatedFrameIdx = 0;
             collocatedFromL0Flag = hevcSliceParams->LongSliceFlags.fields.collocated_from_l0_flag;
-            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_P_SLICE)
+            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_P_SLICE)
             {
                 collocatedFrameIdx = hevcSliceParams->RefPicList[0][collocatedRefIndex].FrameIdx;
             }
-            else if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_B_SLICE)
+            else if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_B_SLICE)
             {
                 collocatedFrameIdx = hevcSliceParams->RefPicList[!collocatedFromL0Flag][collocatedRefIndex].FrameIdx;
             }
 
-            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_I_SLICE)
+            if (hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_I_SLICE)
             {
-                cmd.DW4.Collocatedrefidx = 0;
+                cmd->DW4.Collocatedrefidx = 0;
             }
             else
             {
                 MHW_ASSERT(*(hevcSliceState->pRefIdxMapping + collocatedFrameIdx) >= 0);
-                cmd.DW4.Collocatedrefidx = *(hevcSliceState->pRefIdxMapping + collocatedFrameIdx);
+                cmd->DW4.Collocatedrefidx = *(hevcSliceState->pRefIdxMapping + collocatedFrameIdx);
             }
         }
         else
         {
-            cmd.DW4.Collocatedrefidx = 0;
+            cmd->DW4.Collocatedrefidx = 0;
         }
 
         static uint8_t  ucFirstInterSliceCollocatedFrameIdx;
@@ -706,25 +710,25 @@ protected:
         }
 
         if ((!bFinishFirstInterSlice) &&
-            (hevcSliceParams->LongSliceFlags.fields.slice_type != cmd.SLICE_TYPE_I_SLICE) &&
+            (hevcSliceParams->LongSliceFlags.fields.slice_type != cmd->SLICE_TYPE_I_SLICE) &&
             (hevcSliceParams->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag == 1))
         {
-            ucFirstInterSliceCollocatedFrameIdx = cmd.DW4.Collocatedrefidx;
-            ucFirstInterSliceCollocatedFromL0Flag = cmd.DW4.CollocatedFromL0Flag;
+            ucFirstInterSliceCollocatedFrameIdx = cmd->DW4.Collocatedrefidx;
+            ucFirstInterSliceCollocatedFromL0Flag = cmd->DW4.CollocatedFromL0Flag;
             bFinishFirstInterSlice = true;
         }
 
         if (bFinishFirstInterSlice &&
-            ((hevcSliceParams->LongSliceFlags.fields.slice_type == cmd.SLICE_TYPE_I_SLICE) ||
+            ((hevcSliceParams->LongSliceFlags.fields.slice_type == cmd->SLICE_TYPE_I_SLICE) ||
                 (hevcSliceParams->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag == 0)))
         {
-            cmd.DW4.Collocatedrefidx = ucFirstInterSliceCollocatedFrameIdx;
-            cmd.DW4.CollocatedFromL0Flag = ucFirstInterSliceCollocatedFromL0Flag;
+            cmd->DW4.Collocatedrefidx = ucFirstInterSliceCollocatedFrameIdx;
+            cmd->DW4.CollocatedFromL0Flag = ucFirstInterSliceCollocatedFromL0Flag;
         }
 
-        cmd.DW5.Sliceheaderlength = hevcSliceParams->ByteOffsetToSliceData;
+        cmd->DW5.Sliceheaderlength = hevcSliceParams->ByteOffsetToSliceData;
 
-        MHW_MI_CHK_STATUS(Mos_AddCommand(cmdBuffer, &cmd, cmd.byteSize));
+        MHW_MI_CHK_STATUS(Mos_CommitCommand(cmdBuffer, cmd->byteSize));
 
         return eStatus;
     }
@@ -394,12 +394,13 @@ protected:
             return MOS_STATUS_INVALID_PARAMETER;
         }
 
-        typename TMfxCmds::MFX_AVC_REF_IDX_STATE_CMD cmd;
+        typename TMfxCmds::MFX_AVC_REF_IDX_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mhw_EmplaceCommandCmdOrBB(cmdBuffer, batchBuffer, cmd));
 
         CODEC_REF_LIST** avcRefList = (CODEC_REF_LIST**)params->avcRefList;
-        AvcRefListWrite *cmdAvcRefListWrite = (AvcRefListWrite *)&(cmd.ReferenceListEntry);
+        AvcRefListWrite *cmdAvcRefListWrite = (AvcRefListWrite *)&(cmd->ReferenceListEntry);
 
-        cmd.DW1.RefpiclistSelect = params->uiList;
+        cmd->DW1.RefpiclistSelect = params->uiList;
 
         uint8_t picIDOneOnOneMapping = 0;
         for (uint32_t i = 0; i < params->uiNumRefForList; i++)
@@ -441,7 +442,7 @@ protected:
             cmdAvcRefListWrite->UC[i].value = 0x80;
         }
 
-        MHW_MI_CHK_STATUS(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, &cmd, sizeof(cmd)));
+        MHW_MI_CHK_STATUS(Mhw_CommitCommandCmdOrBB(cmdBuffer, batchBuffer, sizeof(*cmd)));
 
         return MOS_STATUS_SUCCESS;
     }
@@ -463,22 +464,23 @@ protected:
             return MOS_STATUS_INVALID_PARAMETER;
         }
 
-        typename TMfxCmds::MFX_AVC_WEIGHTOFFSET_STATE_CMD cmd;
+        typename TMfxCmds::MFX_AVC_WEIGHTOFFSET_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mhw_EmplaceCommandCmdOrBB(cmdBuffer, batchBuffer, cmd));
 
-        cmd.DW1.WeightAndOffsetSelect = params->uiList;
+        cmd->DW1.WeightAndOffsetSelect = params->uiList;
 
         //The correct explicit calculation (like in Cantiga)
         for (auto i = 0; i < CODEC_MAX_NUM_REF_FIELD; i++)
         {
-            cmd.Weightoffset[3 * i] = params->Weights[params->uiList][i][0][0] & 0xFFFF; // Y weight
-            cmd.Weightoffset[3 * i] |= (params->Weights[params->uiList][i][0][1] & 0xFFFF) << 16; // Y offset
-            cmd.Weightoffset[3 * i + 1] = params->Weights[params->uiList][i][1][0] & 0xFFFF; // Cb weight
-            cmd.Weightoffset[3 * i + 1] |= (params->Weights[params->uiList][i][1][1] & 0xFFFF) << 16; // Cb offset
-            cmd.Weightoffset[3 * i + 2] = params->Weights[params->uiList][i][2][0] & 0xFFFF; // Cr weight
-            cmd.Weightoffset[3 * i + 2] |= (params->Weights[params->uiList][i][2][1] & 0xFFFF) << 16; // Cr offset
+            cmd->Weightoffset[3 * i] = params->Weights[params->uiList][i][0][0] & 0xFFFF; // Y weight
+            cmd->Weightoffset[3 * i] |= (params->Weights[params->uiList][i][0][1] & 0xFFFF) << 16; // Y offset
+            cmd->Weightoffset[3 * i + 1] = params->Weights[params->uiList][i][1][0] & 0xFFFF; // Cb weight
+            cmd->Weightoffset[3 * i + 1] |= (params->Weights[params->uiList][i][1][1] & 0xFFFF) << 16; // Cb offset
+            cmd->Weightoffset[3 * i + 2] = params->Weights[params->uiList][i][2][0] & 0xFFFF; // Cr weight
+            cmd->Weightoffset[3 * i + 2] |= (params->Weights[params->uiList][i][2][1] & 0xFFFF) << 16; // Cr offset
         }
 
-        MHW_MI_CHK_STATUS(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, &cmd, sizeof(cmd)));
+        MHW_MI_CHK_STATUS(Mhw_CommitCommandCmdOrBB(cmdBuffer, batchBuffer, sizeof(*cmd)));
 
         return eStatus;
     }
@@ -572,72 +574,73 @@ protected:
             frameFieldHeightInMb);
 
         auto sliceParams = avcSliceState->pAvcSliceParams;
-        typename TMfxCmds::MFX_AVC_SLICE_STATE_CMD cmd;
+        typename TMfxCmds::MFX_AVC_SLICE_STATE_CMD *cmd = nullptr;
+        MHW_MI_CHK_STATUS(Mhw_EmplaceCommandCmdOrBB(cmdBuffer, batchBuffer, cmd));
 
         // Set MFX_AVC_SLICE_STATE_CMD
-        cmd.DW1.SliceType = m_AvcBsdSliceType[sliceParams->slice_type];
-        cmd.DW2.Log2WeightDenomChroma = sliceParams->chroma_log2_weight_denom;
-        cmd.DW2.Log2WeightDenomLuma = sliceParams->luma_log2_weight_denom;
-        cmd.DW3.WeightedPredictionIndicator = 0;
-        cmd.DW3.DisableDeblockingFilterIndicator = avcSliceState->ucDisableDeblockingFilterIdc;
-        cmd.DW3.CabacInitIdc10 = sliceParams->cabac_init_idc;
-        cmd.DW3.SliceQuantizationParameter = 26 + picParams->pic_init_qp_minus26 + sliceParams->slice_qp_delta;
-        cmd.DW3.SliceBetaOffsetDiv2 = avcSliceState->ucSliceBetaOffsetDiv2;
-        cmd.DW3.SliceAlphaC0OffsetDiv2 = avcSliceState->ucSliceAlphaC0OffsetDiv2;
+        cmd->DW1.SliceType = m_AvcBsdSliceType[sliceParams->slice_type];
+        cmd->DW2.Log2WeightDenomChroma = sliceParams->chroma_log2_weight_denom;
+        cmd->DW2.Log2WeightDenomLuma = sliceParams->luma_log2_weight_denom;
+        cmd->DW3.WeightedPredictionIndicator = 0;
+        cmd->DW3.DisableDeblockingFilterIndicator = avcSliceState->ucDisableDeblockingFilterIdc;
+        cmd->DW3.CabacInitIdc10 = sliceParams->cabac_init_idc;
+        cmd->DW3.SliceQuantizationParameter = 26 + picParams->pic_init_qp_minus26 + sliceParams->slice_qp_delta;
+        cmd->DW3.SliceBetaOffsetDiv2 = avcSliceState->ucSliceBetaOffsetDiv2;
+        cmd->DW3.SliceAlphaC0OffsetDiv2 = avcSliceState->ucSliceAlphaC0OffsetDiv2;
 
         auto widthInMb = picParams->pic_width_in_mbs_minus1 + 1;
         if (avcSliceState->bPhantomSlice)
         {
-            cmd.DW4.SliceStartMbNum = widthInMb * frameFieldHeightInMb;
-            cmd.DW4.SliceVerticalPosition = frameFieldHeightInMb;
-            cmd.DW4.SliceHorizontalPosition = widthInMb;
+            cmd->DW4.SliceStartMbNum = widthInMb * frameFieldHeightInMb;
+            cmd->DW4.SliceVerticalPosition = frameFieldHeightInMb;
+            cmd->DW4.SliceHorizontalPosition = widthInMb;
         }
         else
         {
-            cmd.DW4.SliceStartMbNum = sliceParams->first_mb_in_slice * mbaffMultiplier;
-            cmd.DW4.SliceVerticalPosition = (sliceParams->first_mb_in_slice / widthInMb) * mbaffMultiplier;
-            cmd.DW4.SliceHorizontalPosition = sliceParams->first_mb_in_slice % widthInMb;
+            cmd->DW4.SliceStartMbNum = sliceParams->first_mb_in_slice * mbaffMultiplier;
+            cmd->DW4.SliceVerticalPosition = (sliceParams->first_mb_in_slice / widthInMb) * mbaffMultiplier;
+            cmd->DW4.SliceHorizontalPosition = sliceParams->first_mb_in_slice % widthInMb;
         }
 
         if (avcSliceState->bLastSlice)
         {
-            cmd.DW5.NextSliceVerticalPosition = frameFieldHeightInMb;
-            cmd.DW5.NextSliceHorizontalPosition = 0;
+            cmd->DW5.NextSliceVerticalPosition = frameFieldHeightInMb;
+            cmd->DW5.NextSliceHorizontalPosition = 0;
         }
         else
         {
-            cmd.DW5.NextSliceVerticalPosition = (sliceParams->first_mb_in_next_slice / widthInMb) * mbaffMultiplier;
-            cmd.DW5.NextSliceHorizontalPosition = sliceParams->first_mb_in_next_slice % widthInMb;
+            cmd->DW5.NextSliceVerticalPosition = (sliceParams->first_mb_in_next_slice / widthInMb) * mbaffMultiplier;
+            cmd->DW5.NextSliceHorizontalPosition = sliceParams->first_mb_in_next_slice % widthInMb;
         }
 
-        cmd.DW6.IsLastSlice = avcSliceState->bLastSlice;
+        cmd->DW6.IsLastSlice = avcSliceState->bLastSlice;
 
-        cmd.DW9.Roundintra = 5;
-        cmd.DW9.Roundintraenable = 1;
-        cmd.DW9.Roundinter = 2;
+        cmd->DW9.Roundintra = 5;
+        cmd->DW9.Roundintraenable = 1;
+        cmd->DW9.Roundinter = 2;
 
         if (IsAvcPSlice(sliceParams->slice_type))
         {
-            cmd.DW2.NumberOfReferencePicturesInInterPredictionList0 = sliceParams->num_ref_idx_l0_active_minus1 + 1;
-            cmd.DW3.WeightedPredictionIndicator = picParams->pic_fields.weighted_pred_flag;
+            cmd->DW2.NumberOfReferencePicturesInInterPredictionList0 = sliceParams->num_ref_idx_l0_active_minus1 + 1;
+            cmd->DW3.WeightedPredictionIndicator = picParams->pic_fields.weighted_pred_flag;
         }
         else if (IsAvcBSlice(sliceParams->slice_type))
         {
-            cmd.DW2.NumberOfReferencePicturesInInterPredictionList1 = sliceParams->num_ref_idx_l1_active_minus1 + 1;
-            cmd.DW2.NumberOfReferencePicturesInInterPredictionList0 = sliceParams->num_ref_idx_l0_active_minus1 + 1;
-            cmd.DW3.WeightedPredictionIndicator = picParams->pic_fields.weighted_bipred_idc;
-            cmd.DW3.DirectPredictionType = sliceParams->direct_spatial_mv_pred_flag;
+            cmd->DW2.NumberOfReferencePicturesInInterPredictionList1 = sliceParams->num_ref_idx_l1_active_minus1 + 1;
+            cmd->DW2.NumberOfReferencePicturesInInterPredictionList0 = sliceParams->num_ref_idx_l0_active_minus1 + 1;
+            cmd->DW3.WeightedPredictionIndicator = picParams->pic_fields.weighted_bipred_idc;
+            cmd->DW3.DirectPredictionType = sliceParams->direct_spatial_mv_pred_flag;
 
             // Set MFX_AVC_WEIGHTOFFSET_STATE_CMD_G6
             if (picParams->pic_fields.weighted_bipred_idc != 1)
             {
                 // luma/chroma_log2_weight_denoms need to be set to default value in the case of implicit mode
-                cmd.DW2.Log2WeightDenomChroma = m_log2WeightDenomDefault;
-                cmd.DW2.Log2WeightDenomLuma = m_log2WeightDenomDefault;
+                cmd->DW2.Log2WeightDenomChroma = m_log2WeightDenomDefault;
+                cmd->DW2.Log2WeightDenomLuma = m_log2WeightDenomDefault;
             }
         }
 
-        MHW_MI_CHK_STATUS(Mhw_AddCommandCmdOrBB(cmdBuffer, batchBuffer, &cmd, sizeof(cmd)));
+        MHW_MI_CHK_STATUS(Mhw_CommitCommandCmdOrBB(cmdBuffer, batchBuffer, sizeof(*cmd)));
 
         return eStatus;
     }
@@ -24,7 +24,6 @@
 //! \brief   Container class for the basic command buffer manager
 //!
 #include "mos_cmdbufmgr.h"
-#include <algorithm>
 
 CmdBufMgr::CmdBufMgr()
 {
@@ -48,38 +47,27 @@ CmdBufMgr* CmdBufMgr::GetObject()
 
 MOS_STATUS CmdBufMgr::Initialize(OsContext *osContext, uint32_t cmdBufSize)
 {
-    MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
-
     MOS_OS_FUNCTION_ENTER;
     MOS_OS_CHK_NULL_RETURN(osContext);
 
     if (!m_initialized)
     {
-        m_osContext          = osContext;
-        m_inUsePoolMutex     = MOS_CreateMutex();
-        m_availablePoolMutex = MOS_CreateMutex();
+        m_osContext = osContext;
+        m_poolMutex = MOS_CreateMutex();
 
         for (int i = 0; i < m_initBufNum; i++)
         {
-            auto cmdBuf = CommandBuffer::CreateCmdBuf();
+            auto cmdBuf = AllocateCmdBuf(cmdBufSize);
             if (cmdBuf == nullptr)
-            {
-                MOS_OS_ASSERTMESSAGE("input nullptr returned by CommandBuffer::CreateCmdBuf.");
-                return MOS_STATUS_INVALID_HANDLE;
-            }
-
-            eStatus = cmdBuf->Allocate(m_osContext, cmdBufSize);
-            if (eStatus != MOS_STATUS_SUCCESS)
             {
                 MOS_OS_ASSERTMESSAGE("Allocate CmdBuf#%d failed", i);
                 return MOS_STATUS_INVALID_HANDLE;
             }
 
-            MOS_LockMutex(m_availablePoolMutex);
-            m_availableCmdBufPool.push_back(cmdBuf);
-            MOS_UnlockMutex(m_availablePoolMutex);
-
+            MOS_LockMutex(m_poolMutex);
+            AddToAvailablePool(cmdBuf);
             m_cmdBufTotalNum++;
+            MOS_UnlockMutex(m_poolMutex);
         }
 
         m_initialized = true;
@@ -92,24 +80,26 @@ void CmdBufMgr::CleanUp()
 {
     MOS_OS_FUNCTION_ENTER;
 
-    CommandBuffer* cmdBuf = nullptr;
-    for (auto& cmdBuf : m_availableCmdBufPool)
+    MOS_LockMutex(m_poolMutex);
+
+    for (auto& sizeClass : m_availableCmdBufPool)
     {
-        if (cmdBuf != nullptr)
+        for (auto& cmdBuf : sizeClass.second)
         {
-            cmdBuf->Free();
-            MOS_Delete(cmdBuf);
-        }
-        else
-        {
-            MOS_OS_ASSERTMESSAGE("Unexpected, found null command buffer!");
+            if (cmdBuf != nullptr)
+            {
+                cmdBuf->Free();
+                MOS_Delete(cmdBuf);
+            }
+            else
+            {
+                MOS_OS_ASSERTMESSAGE("Unexpected, found null command buffer!");
+            }
         }
     }
 
     // clear available command buffer pool
-    MOS_LockMutex(m_availablePoolMutex);
     m_availableCmdBufPool.clear();
-    MOS_UnlockMutex(m_availablePoolMutex);
 
     if (!m_inUseCmdBufPool.empty())
     {
@@ -125,14 +115,14 @@ void CmdBufMgr::CleanUp()
     }
 
     // clear in-use command buffer pool
-    MOS_LockMutex(m_inUsePoolMutex);
     m_inUseCmdBufPool.clear();
-    MOS_UnlockMutex(m_inUsePoolMutex);
+
+    MOS_UnlockMutex(m_poolMutex);
 
     m_cmdBufTotalNum = 0;
     m_initialized    = false;
-    MOS_DestroyMutex(m_inUsePoolMutex);
-    MOS_DestroyMutex(m_availablePoolMutex);
+    MOS_DestroyMutex(m_poolMutex);
+    m_poolMutex = nullptr;
 }
 
 CommandBuffer *CmdBufMgr::PickupOneCmdBuf(uint32_t size)
@@ -145,102 +135,78 @@ CommandBuffer *CmdBufMgr::PickupOneCmdBuf(uint32_t size)
         return nullptr;
     }
 
-    // lock for both in-use and available command buffer pool before pick up
-    MOS_LockMutex(m_inUsePoolMutex);
-    MOS_LockMutex(m_availablePoolMutex);
-
-    CommandBuffer* cmdBuf = nullptr;
-    CommandBuffer* retbuf  = nullptr;
-    MOS_STATUS     eStatus = MOS_STATUS_SUCCESS;
+    MOS_LockMutex(m_poolMutex);
 
-    if (!m_availableCmdBufPool.empty())
+    // take the smallest available buf which is large enough
+    auto sizeClass = m_availableCmdBufPool.lower_bound(size);
+    if (sizeClass != m_availableCmdBufPool.end())
     {
-        cmdBuf = *(m_availableCmdBufPool.begin());
-
-        // find available buf
-        if (size <= cmdBuf->GetCmdBufSize())
+        CommandBuffer *cmdBuf = sizeClass->second.back();
+        sizeClass->second.pop_back();
+        if (sizeClass->second.empty())
         {
-            m_inUseCmdBufPool.push_back(cmdBuf);
+            m_availableCmdBufPool.erase(sizeClass);
+        }
+        AddToInUsePool(cmdBuf);
 
-            m_availableCmdBufPool.erase(m_availableCmdBufPool.begin());
+        MOS_UnlockMutex(m_poolMutex);
+        MOS_OS_VERBOSEMESSAGE("successfully get available buf from pool");
+        return cmdBuf;
+    }
 
-            MOS_OS_VERBOSEMESSAGE("successfully get available buf from pool");
-        }
-        // available buf  is not large enough, need reallocate
-        else
+    // available bufs are not large enough, only need one reallocated;
+    // no available buf in the pool, will allocate in batch
+    uint32_t allocNum = 1;
+    if (m_availableCmdBufPool.empty())
+    {
+        MOS_OS_VERBOSEMESSAGE("No more cmd buf in the pool");
+        if (m_cmdBufTotalNum >= m_maxPoolSize)
         {
-            MOS_OS_VERBOSEMESSAGE("find available buf, but is not large enough");
-
-            cmdBuf = CommandBuffer::CreateCmdBuf();
-            if (cmdBuf == nullptr)
-            {
-                MOS_OS_ASSERTMESSAGE("input nullptr returned by CommandBuffer::CreateCmdBuf.");
-            }
-            else
-            {
-                eStatus = cmdBuf->Allocate(m_osContext, size);
-                if (eStatus != MOS_STATUS_SUCCESS)
-                {
-                    MOS_OS_ASSERTMESSAGE("Allocate CmdBuf failed");
-                }
-
-                // directly push into inuse pool
-                m_inUseCmdBufPool.push_back(cmdBuf);
-                m_cmdBufTotalNum++;
-            }
+            MOS_UnlockMutex(m_poolMutex);
+            MOS_OS_ASSERTMESSAGE("No availabe cmd buf in pool and the total buf num hit the ceiling, may need wait for a while.");
+            return nullptr;
         }
-
-        retbuf = cmdBuf;
+        allocNum = m_bufIncStepSize;
+        MOS_OS_VERBOSEMESSAGE("Increase the cmd buf pool size by %d", m_bufIncStepSize);
     }
-    // no available buf in the pool, will allocate in batch
     else
     {
-        MOS_OS_VERBOSEMESSAGE("No more cmd buf in the pool");
+        MOS_OS_VERBOSEMESSAGE("find available buf, but is not large enough");
+    }
 
-        if (m_cmdBufTotalNum < m_maxPoolSize)
+    MOS_UnlockMutex(m_poolMutex);
+
+    // allocate without holding the pool lock so other contexts can keep picking up and releasing
+    CommandBuffer *retbuf = nullptr;
+    CommandBuffer *newBufs[m_bufIncStepSize] = {};
+    uint32_t       newBufNum = 0;
+    for (uint32_t i = 0; i < allocNum; i++)
+    {
+        auto cmdBuf = AllocateCmdBuf(size);
+        if (cmdBuf == nullptr)
         {
-            MOS_OS_VERBOSEMESSAGE("Increase the cmd buf pool size by %d", m_bufIncStepSize);
-            for (int i = 0; i < m_bufIncStepSize; i++)
-            {
-                cmdBuf = CommandBuffer::CreateCmdBuf();
-                if (cmdBuf == nullptr)
-                {
-                    MOS_OS_ASSERTMESSAGE("input nullptr returned by CommandBuffer::CreateCmdBuf.");
-                    continue;
-                }
-
-                eStatus = cmdBuf->Allocate(m_osContext, size);
-                if (eStatus != MOS_STATUS_SUCCESS)
-                {
-                    MOS_OS_ASSERTMESSAGE("Allocate CmdBuf#%d failed", i);
-                    continue;
-                }
-
-                if (i == 0)
-                {
-                    // directly push into inuse pool
-                    m_inUseCmdBufPool.push_back(cmdBuf);
-                    retbuf = cmdBuf;
-                }
-                else
-                {
-                    m_availableCmdBufPool.insert(m_availableCmdBufPool.begin(), cmdBuf);
-                }
-                m_cmdBufTotalNum++;
-            }
-            // sort by decent order
-            std::sort(m_availableCmdBufPool.begin(), m_availableCmdBufPool.end(), &CmdBufMgr::GreaterSizeSort);
+            MOS_OS_ASSERTMESSAGE("Allocate CmdBuf#%d failed", i);
+            continue;
+        }
+        newBufs[newBufNum++] = cmdBuf;
+    }
+
+    MOS_LockMutex(m_poolMutex);
+    for (uint32_t i = 0; i < newBufNum; i++)
+    {
+        if (i == 0)
+        {
+            // directly push into inuse pool
+            AddToInUsePool(newBufs[i]);
+            retbuf = newBufs[i];
         }
         else
         {
-            MOS_OS_ASSERTMESSAGE("No availabe cmd buf in pool and the total buf num hit the ceiling, may need wait for a while.");
-            retbuf = nullptr;
+            AddToAvailablePool(newBufs[i]);
         }
+        m_cmdBufTotalNum++;
     }
-
-    // unlock after got return buffer
-    MOS_UnlockMutex(m_inUsePoolMutex);
-    MOS_UnlockMutex(m_availablePoolMutex);
+    MOS_UnlockMutex(m_poolMutex);
 
     return retbuf;
 }
@@ -259,38 +225,69 @@ MOS_STATUS CmdBufMgr::ReleaseCmdBuf(CommandBuffer *cmdBuf)
 
     MOS_OS_CHK_NULL_RETURN(cmdBuf);
 
-    // lock for both in-use and available command buffer pool before release
-    MOS_LockMutex(m_inUsePoolMutex);
-    MOS_LockMutex(m_availablePoolMutex);
-
-    bool           found = false;
-    for (auto iter = m_inUseCmdBufPool.begin(); iter != m_inUseCmdBufPool.end(); iter++)
-    {
-        if (cmdBuf == *iter)
-        {
-            found = true;
-            m_inUseCmdBufPool.erase(iter);
-            break;
-        }
-    }
+    MOS_LockMutex(m_poolMutex);
 
-    if (!found)
+    if (!RemoveFromInUsePool(cmdBuf))
     {
         MOS_OS_ASSERTMESSAGE("Cannot find the specified cmdbuf in inusepool, sth must be wrong!");
         eStatus = MOS_STATUS_UNKNOWN;
     }
 
-    m_availableCmdBufPool.push_back(cmdBuf);
-    // sort by decent order
-    std::sort(m_availableCmdBufPool.begin(), m_availableCmdBufPool.end(), &CmdBufMgr::GreaterSizeSort);
+    AddToAvailablePool(cmdBuf);
 
-    // unlock after release buffer
-    MOS_UnlockMutex(m_inUsePoolMutex);
-    MOS_UnlockMutex(m_availablePoolMutex);
+    MOS_UnlockMutex(m_poolMutex);
 
     return eStatus;
 }
 
+CommandBuffer *CmdBufMgr::AllocateCmdBuf(uint32_t size)
+{
+    auto cmdBuf = CommandBuffer::CreateCmdBuf();
+    if (cmdBuf == nullptr)
+    {
+        MOS_OS_ASSERTMESSAGE("input nullptr returned by CommandBuffer::CreateCmdBuf.");
+        return nullptr;
+    }
+
+    if (cmdBuf->Allocate(m_osContext, size) != MOS_STATUS_SUCCESS)
+    {
+        MOS_Delete(cmdBuf);
+        return nullptr;
+    }
+
+    return cmdBuf;
+}
+
+void CmdBufMgr::AddToAvailablePool(CommandBuffer *cmdBuf)
+{
+    // the size may differ from the picked up one if the buffer was resized while in use
+    m_availableCmdBufPool[cmdBuf->GetCmdBufSize()].push_back(cmdBuf);
+}
+
+void CmdBufMgr::AddToInUsePool(CommandBuffer *cmdBuf)
+{
+    cmdBuf->m_inUsePoolIndex = (uint32_t)m_inUseCmdBufPool.size();
+    m_inUseCmdBufPool.push_back(cmdBuf);
+}
+
+bool CmdBufMgr::RemoveFromInUsePool(CommandBuffer *cmdBuf)
+{
+    uint32_t index = cmdBuf->m_inUsePoolIndex;
+    if (index >= m_inUseCmdBufPool.size() || m_inUseCmdBufPool[index] != cmdBuf)
+    {
+        return false;
+    }
+
+    // move the last in-use buf into the vacated slot
+    CommandBuffer *last       = m_inUseCmdBufPool.back();
+    m_inUseCmdBufPool[index]  = last;
+    last->m_inUsePoolIndex    = index;
+    m_inUseCmdBufPool.pop_back();
+    cmdBuf->m_inUsePoolIndex  = CommandBuffer::m_invalidPoolIndex;
+
+    return true;
+}
+
 MOS_STATUS CmdBufMgr::ResizeOneCmdBuf(CommandBuffer *cmdBufToResize, uint32_t newSize)
 {
     MOS_OS_FUNCTION_ENTER;
@@ -27,6 +27,8 @@
 #ifndef __COMMAND_BUFFER_MANAGER_H__
 #define __COMMAND_BUFFER_MANAGER_H__
 
+#include <map>
+#include <vector>
 #include "mos_os.h"
 #include "mos_commandbuffer.h"
 #include "mos_gpucontextmgr.h"
@@ -78,7 +80,8 @@ public:
     //! \details  This function will pick up one proper command buffer from 
     //!           available pool, internal logic in below 3 conditions:
     //!           1: if available pool has command buffer and its size bigger than
-    //!              required, directly put it into in use pool and return;
+    //!              required, directly put the smallest such one into in use pool
+    //!              and return;
     //!           2: if available pool has command buffer but size smaller than
     //!              required, only create one command buffer as reqired and put
     //!              it to in  use pool directly;
@@ -120,19 +123,38 @@ public:
 
 private:
     //!
-    //! \brief    Self define compare method as std:sort input 
-    //! \detail   Command buffer size will be compared 
-    //! \param    [in] a
-    //!           Input command buffer to be compared
-    //! \param    [in] b
-    //!           Input command buffer to be compared
+    //! \brief    Create one command buffer and allocate its resource
+    //! \param    [in] size
+    //!           Required command buffer size
+    //! \return   CommandBuffer*
+    //!           New command buffer if success, otherwise nullptr
+    //!
+    CommandBuffer *AllocateCmdBuf(uint32_t size);
+
+    //!
+    //! \brief    Push command buffer onto the available stack of its size,
+    //!           called with m_poolMutex held
+    //! \param    [in] cmdBuf
+    //!           Command buffer to be added
+    //!
+    void AddToAvailablePool(CommandBuffer *cmdBuf);
+
+    //!
+    //! \brief    Add command buffer to in-use pool, called with m_poolMutex held
+    //! \param    [in] cmdBuf
+    //!           Command buffer to be added
+    //!
+    void AddToInUsePool(CommandBuffer *cmdBuf);
+
+    //!
+    //! \brief    Remove command buffer from in-use pool in constant time through
+    //!           its in-use pool index, called with m_poolMutex held
+    //! \param    [in] cmdBuf
+    //!           Command buffer to be removed
     //! \return   bool
-    //!           true if a size bigger than b, otherwise false
+    //!           true if the buffer was in use, otherwise false
     //!
-    static bool GreaterSizeSort(CommandBuffer *a, CommandBuffer *b)
-    {
-        return (a->GetCmdBufSize() > b->GetCmdBufSize());
-    }
+    bool RemoveFromInUsePool(CommandBuffer *cmdBuf);
 
     //! \brief   Max comamnd buffer number for per manager, including all
     //!          command buffer in availble pool and in-use pool
@@ -147,17 +169,17 @@ private:
     //! \brief   Initial command buffer number
     constexpr static uint32_t m_initBufNum = 32;
 
-    //! \brief   Sorted List of available command buffer pool
-    std::vector<CommandBuffer *> m_availableCmdBufPool;
-
-    //! \brief   Mutex for available command buffer pool
-    PMOS_MUTEX m_availablePoolMutex;
+    //! \brief   Available command buffers keyed by size, each size keeps a stack
+    //!          so pick up and release never need to sort or search
+    std::map<uint32_t, std::vector<CommandBuffer *>> m_availableCmdBufPool;
 
-    //! \brief   List of in used command buffer pool
+    //! \brief   List of in used command buffer pool, indexed by
+    //!          CommandBuffer::m_inUsePoolIndex
     std::vector<CommandBuffer *> m_inUseCmdBufPool;
 
-    //! \brief   Mutex for in-use command buffer pool
-    PMOS_MUTEX m_inUsePoolMutex;
+    //! \brief   Mutex for available and in-use command buffer pool, never held
+    //!          while command buffers are allocated
+    PMOS_MUTEX m_poolMutex = nullptr;
 
     //! \brief   Flag to indicate cmd buf mgr initialized or not
     bool m_initialized = false;
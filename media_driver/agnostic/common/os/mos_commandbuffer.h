@@ -35,6 +35,8 @@
 //!
 class CommandBuffer
 {
+    friend class CmdBufMgr;
+
 public:
     //!
     //! \brief  Constructor
@@ -146,5 +148,12 @@ protected:
 
     //! \brief    Command buffer size
     uint32_t          m_size             = 0;
+
+private:
+    //! \brief    Invalid in-use pool index
+    static const uint32_t m_invalidPoolIndex = 0xffffffff;
+
+    //! \brief    Position in the command buffer manager's in-use pool
+    uint32_t          m_inUsePoolIndex   = m_invalidPoolIndex;
 };
 #endif // __MOS_COMMANDBUFFER_H__
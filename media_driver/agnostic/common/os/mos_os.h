@@ -1008,4 +1008,64 @@ MEMORY_OBJECT_CONTROL_STATE Mos_CachePolicyGetMemoryObject(
 }
 #endif
 
+#ifdef __cplusplus
+#include <new>
+
+//! \brief    Construct a command in place at the end of command buffer
+//! \details  Checks the space left and constructs the command directly in the
+//!           command buffer, so it needs no copy. The command is not added
+//!           until Mos_CommitCommand, so the offset of command buffer still
+//!           points to its first dword while resources are patched into it.
+//! \param    PMOS_COMMAND_BUFFER pCmdBuffer
+//!           [in/out] Pointer to Command Buffer
+//! \param    TCmd *&pCmd
+//!           [out] Command constructed in the command buffer
+//! \return   MOS_STATUS
+//!           Return MOS_STATUS_SUCCESS if successful, otherwise failed
+//!
+template <class TCmd>
+MOS_STATUS Mos_EmplaceCommand(
+    PMOS_COMMAND_BUFFER pCmdBuffer,
+    TCmd                *&pCmd)
+{
+    pCmd = nullptr;
+
+    if (pCmdBuffer == nullptr || pCmdBuffer->pCmdPtr == nullptr)
+    {
+        return MOS_STATUS_NULL_POINTER;
+    }
+
+    if (pCmdBuffer->iRemaining < (int32_t)MOS_ALIGN_CEIL(sizeof(TCmd), sizeof(uint32_t)))
+    {
+        MOS_OS_ASSERTMESSAGE("Unable to add command (no space).");
+        return MOS_STATUS_UNKNOWN;
+    }
+
+    pCmd = new (pCmdBuffer->pCmdPtr) TCmd;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+//! \brief    Add the command constructed by Mos_EmplaceCommand to command buffer
+//! \param    PMOS_COMMAND_BUFFER pCmdBuffer
+//!           [in/out] Pointer to Command Buffer
+//! \param    uint32_t dwCmdSize
+//!           [in] Size of command in bytes
+//! \return   MOS_STATUS
+//!           Return MOS_STATUS_SUCCESS if successful, otherwise failed
+//!
+static __inline MOS_STATUS Mos_CommitCommand(
+    PMOS_COMMAND_BUFFER pCmdBuffer,
+    uint32_t            dwCmdSize)
+{
+    uint32_t dwCmdSizeDwAligned = MOS_ALIGN_CEIL(dwCmdSize, sizeof(uint32_t));
+
+    pCmdBuffer->iOffset    += dwCmdSizeDwAligned;
+    pCmdBuffer->iRemaining -= dwCmdSizeDwAligned;
+    pCmdBuffer->pCmdPtr    += (dwCmdSizeDwAligned / sizeof(uint32_t));
+
+    return MOS_STATUS_SUCCESS;
+}
+#endif
+
 #endif  // __MOS_OS_H__
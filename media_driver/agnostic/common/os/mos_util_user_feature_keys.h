@@ -42,6 +42,35 @@
 //!
 #define __MEDIA_USER_FEATURE_VALUE_MEMNINJA_COUNTER                     "MemNinja Counter"
 
+//!
+//! \brief      User feature keys for the buffer object reuse cache
+//! \details    BO Cache Limit bounds the cached bytes in MB (0 = unlimited). The hit, miss and
+//!             eviction counts of the cache are reported when the driver is terminated.
+//!
+#define __MEDIA_USER_FEATURE_VALUE_BO_CACHE_LIMIT                       "BO Cache Limit"
+#define __MEDIA_USER_FEATURE_VALUE_BO_CACHE_HITS                        "BO Cache Hits"
+#define __MEDIA_USER_FEATURE_VALUE_BO_CACHE_MISSES                      "BO Cache Misses"
+#define __MEDIA_USER_FEATURE_VALUE_BO_CACHE_EVICTIONS                   "BO Cache Evictions"
+
+//!
+//! \brief      User feature key to chain the command buffers of a GPU context
+//! \details    Queued command buffers are submitted together when the chain is full, another
+//!             engine is targeted, or the CPU waits on or maps a buffer they reference.
+//!
+#define __MEDIA_USER_FEATURE_VALUE_ENABLE_DEFERRED_SUBMISSION           "Enable Deferred Submission"
+
+//!
+//! \brief      User feature keys reporting validation list reuse across execbuffers
+//!
+#define __MEDIA_USER_FEATURE_VALUE_EXEC_COUNT                           "Exec Count"
+#define __MEDIA_USER_FEATURE_VALUE_EXEC_UNCHANGED_LISTS                 "Exec Unchanged Validation Lists"
+#define __MEDIA_USER_FEATURE_VALUE_EXEC_REUSED_BOS                      "Exec Reused BOs"
+
+//!
+//! \brief      User feature key to pin every buffer object at a driver chosen address
+//!
+#define __MEDIA_USER_FEATURE_VALUE_ENABLE_SOFTPIN                       "Enable Softpin"
+
 //!
 //! \brief      User feature key to override the number of Slices/Sub-slices/EUs to suhutdown
 //! \details    Same setting will apply to all command buffer submissions
@@ -42,6 +42,7 @@ int32_t MosMemAllocCounterGfx;
 int32_t MosMemAllocCounterNoUserFeature;
 int32_t MosMemAllocCounterNoUserFeatureGfx;
 uint8_t MosUltFlag;
+uint8_t MosUltDeferredSubmission;  //!< Deferred submission forced on by the ULT
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,6 +53,11 @@ extern "C" {
         MosUltFlag = ultFlag;
     }
 
+    MOS_FUNC_EXPORT void MOS_SetUltDeferredSubmission(uint8_t enable)
+    {
+        MosUltDeferredSubmission = enable;
+    }
+
     MOS_FUNC_EXPORT int32_t MOS_GetMemNinjaCounter()
     {
         return MosMemAllocCounterNoUserFeature;
@@ -228,6 +234,15 @@ static MOS_USER_FEATURE_VALUE MOSUserFeatureDescFields[__MOS_USER_FEATURE_KEY_MA
      MOS_USER_FEATURE_VALUE_TYPE_UINT32,
      "0",
      "Performance Profiler Memory Information Register"),
+    MOS_DECLARE_UF_KEY_DBGONLY(__MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_STREAM_INTERVAL,
+     "Perf Profiler Stream Interval",
+     __MEDIA_USER_FEATURE_SUBKEY_PERFORMANCE,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "General",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT32,
+     "0",
+     "Interval in ms of the per engine statistics of Performance Profiler. 0: only dump the buffer at exit."),
     MOS_DECLARE_UF_KEY_DBGONLY(__MEDIA_USER_FEATURE_VALUE_DISABLE_KMD_WATCHDOG_ID,
      "Disable KMD Watchdog",
      __MEDIA_USER_FEATURE_SUBKEY_PERFORMANCE,
@@ -858,6 +873,87 @@ static MOS_USER_FEATURE_VALUE MOSUserFeatureDescFields[__MOS_USER_FEATURE_KEY_MA
      MOS_USER_FEATURE_VALUE_TYPE_INT32,
      "0",
      "Reports out the internal allocation counter value. If this value is not 0, the test has a memory leak."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_BO_CACHE_LIMIT_ID,
+     __MEDIA_USER_FEATURE_VALUE_BO_CACHE_LIMIT,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "MOS",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT32,
+     "0",
+     "Limits the buffer object reuse cache to this many MB, evicting the least recently released buffers. 0 means unlimited."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_BO_CACHE_HITS_ID,
+     __MEDIA_USER_FEATURE_VALUE_BO_CACHE_HITS,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of buffer object allocations served from the reuse cache."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_BO_CACHE_MISSES_ID,
+     __MEDIA_USER_FEATURE_VALUE_BO_CACHE_MISSES,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of buffer object allocations that needed a new GEM object."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_BO_CACHE_EVICTIONS_ID,
+     __MEDIA_USER_FEATURE_VALUE_BO_CACHE_EVICTIONS,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of cached buffer objects freed to stay under BO Cache Limit."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_ENABLE_DEFERRED_SUBMISSION_ID,
+     __MEDIA_USER_FEATURE_VALUE_ENABLE_DEFERRED_SUBMISSION,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "MOS",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_INT32,
+     "0",
+     "If enabled, consecutive command buffers of a GPU context are chained and submitted with one execbuffer, gen8 and later."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_EXEC_COUNT_ID,
+     __MEDIA_USER_FEATURE_VALUE_EXEC_COUNT,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of execbuffers submitted on a GPU context."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_EXEC_UNCHANGED_LISTS_ID,
+     __MEDIA_USER_FEATURE_VALUE_EXEC_UNCHANGED_LISTS,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of execbuffers whose validation list matched the previous one on their GPU context."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_EXEC_REUSED_BOS_ID,
+     __MEDIA_USER_FEATURE_VALUE_EXEC_REUSED_BOS,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "Report",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_UINT64,
+     "0",
+     "Reports the number of validation list entries that skipped the per-context offset update."),
+    MOS_DECLARE_UF_KEY(__MEDIA_USER_FEATURE_VALUE_ENABLE_SOFTPIN_ID,
+     __MEDIA_USER_FEATURE_VALUE_ENABLE_SOFTPIN,
+     __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
+     __MEDIA_USER_FEATURE_SUBKEY_REPORT,
+     "MOS",
+     MOS_USER_FEATURE_TYPE_USER,
+     MOS_USER_FEATURE_VALUE_TYPE_INT32,
+     "0",
+     "If enabled and the kernel supports it, every buffer object is pinned at a driver chosen address and batches are submitted without relocations."),
     MOS_DECLARE_UF_KEY_DBGONLY(__MEDIA_USER_FEATURE_VALUE_ENCODE_ENABLE_CMD_INIT_HUC_ID,
         "VDEnc CmdInitializer Huc Enable",
         __MEDIA_USER_FEATURE_SUBKEY_INTERNAL,
@@ -5230,6 +5326,11 @@ finish:
     {
         MOS_UserFeatureCloseKey(UFKey);      // Closes the key if not nullptr
     }
+    // Write back the values written so far, even if a later one failed
+    if (MOS_UserFeatureFlush() != MOS_STATUS_SUCCESS && eStatus == MOS_STATUS_SUCCESS)
+    {
+        eStatus = MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED;
+    }
     return eStatus;
 }
 
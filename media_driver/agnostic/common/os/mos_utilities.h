@@ -88,6 +88,7 @@
 extern int32_t MosMemAllocCounter;
 extern int32_t MosMemAllocCounterGfx;
 extern uint8_t MosUltFlag;
+extern uint8_t MosUltDeferredSubmission;
 
 //! Helper Macros for MEMNINJA debug messages
 #define MOS_MEMNINJA_ALLOC_MESSAGE(ptr, size, functionName, filename, line)                                 \
@@ -134,6 +135,7 @@ typedef enum _MOS_USER_FEATURE_VALUE_ID
     __MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_REGISTER_6,
     __MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_REGISTER_7,
     __MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_REGISTER_8,
+    __MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_STREAM_INTERVAL,
     __MEDIA_USER_FEATURE_VALUE_DISABLE_KMD_WATCHDOG_ID,
     __MEDIA_USER_FEATURE_VALUE_SINGLE_TASK_PHASE_ENABLE_ID,
     __MEDIA_USER_FEATURE_VALUE_MFE_MBENC_ENABLE_ID,
@@ -208,6 +210,15 @@ typedef enum _MOS_USER_FEATURE_VALUE_ID
     __MEDIA_USER_FEATURE_VALUE_VP9_ENCODE_ADAPTIVE_REPAK_ENABLE_ID,
     __MEDIA_USER_FEATURE_VALUE_VP9_ENCODE_ADAPTIVE_REPAK_IN_USE_ID,
     __MEDIA_USER_FEATURE_VALUE_MEMNINJA_COUNTER_ID,
+    __MEDIA_USER_FEATURE_VALUE_BO_CACHE_LIMIT_ID,
+    __MEDIA_USER_FEATURE_VALUE_BO_CACHE_HITS_ID,
+    __MEDIA_USER_FEATURE_VALUE_BO_CACHE_MISSES_ID,
+    __MEDIA_USER_FEATURE_VALUE_BO_CACHE_EVICTIONS_ID,
+    __MEDIA_USER_FEATURE_VALUE_ENABLE_DEFERRED_SUBMISSION_ID,
+    __MEDIA_USER_FEATURE_VALUE_EXEC_COUNT_ID,
+    __MEDIA_USER_FEATURE_VALUE_EXEC_UNCHANGED_LISTS_ID,
+    __MEDIA_USER_FEATURE_VALUE_EXEC_REUSED_BOS_ID,
+    __MEDIA_USER_FEATURE_VALUE_ENABLE_SOFTPIN_ID,
     __MEDIA_USER_FEATURE_VALUE_ENCODE_ENABLE_CMD_INIT_HUC_ID,
     __MEDIA_USER_FEATURE_VALUE_HEVC_ENCODE_ENABLE_ID,
     __MEDIA_USER_FEATURE_VALUE_HEVC_ENCODE_SECURE_INPUT_ID,
@@ -2002,6 +2013,19 @@ MOS_STATUS MOS_UserFeatureSetValueEx(
     uint8_t              *lpData,
     uint32_t             cbData);
 
+//!
+//! \brief    Writes back the values set since the last flush
+//! \details  Values set with MOS_UserFeatureSetValueEx may be kept by the OS
+//!           layer and written to the backing store together, this makes them
+//!           visible to other processes. Called at the end of
+//!           MOS_UserFeature_WriteValues
+//! \return   MOS_STATUS
+//!           If the function succeeds, the return value is MOS_STATUS_SUCCESS.
+//!           If the function fails, the return value is a error code defined
+//!           in mos_utilities.h.
+//!
+MOS_STATUS MOS_UserFeatureFlush();
+
 //!
 //! \brief    Notifies the caller about changes to the attributes or contents
 //!           of a specified user feature key
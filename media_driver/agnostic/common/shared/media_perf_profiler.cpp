@@ -68,6 +68,16 @@ struct NodeHeader
 
 #define BASE_OF_NODE(perfDataIndex) (sizeof(NodeHeader) + (sizeof(PerfEntry) * perfDataIndex))
 
+// The address of timestamp must be 8 bytes aligned.
+#define TIMESTAMP_OF_NODE(perfDataIndex, member) \
+    MOS_ALIGN_CEIL(BASE_OF_NODE(perfDataIndex) + OFFSET_OF(PerfEntry, member), 8)
+
+#define PERF_STREAM_POLL_MS     10
+#define PERF_STATS_STRING_SIZE  4096
+#define PERF_NODE_SKIPPED       0xFFFFFFFF  // the submission is not profiled, its ring slot was still in use
+
+static const char *perfGpuNodeName[PERF_GPU_NODE_COUNT] = { "RCS", "VCS", "BCS", "VECS", "VCS2" };
+
 #define CHK_STATUS_RETURN(_stmt)                   \
 {                                                  \
     MOS_STATUS stmtStatus = (MOS_STATUS)(_stmt);   \
@@ -111,6 +121,11 @@ MediaPerfProfiler::MediaPerfProfiler()
     m_initialized   = false;
 
     m_profilerEnabled = 0;
+
+    MOS_ZeroMemory(m_engineStats, sizeof(m_engineStats));
+    MOS_ZeroMemory(m_pendingStats, sizeof(m_pendingStats));
+    MOS_ZeroMemory(m_windowBegin, sizeof(m_windowBegin));
+    MOS_ZeroMemory(m_windowEnd, sizeof(m_windowEnd));
     
     MOS_USER_FEATURE_VALUE_DATA     userFeatureData;
     // Check whether profiler is enabled
@@ -126,7 +141,8 @@ MediaPerfProfiler::MediaPerfProfiler()
         return;
     }
 
-    m_mutex = MOS_CreateMutex();
+    m_mutex     = MOS_CreateMutex();
+    m_statMutex = MOS_CreateMutex();
 }
 
 MediaPerfProfiler::~MediaPerfProfiler()
@@ -136,6 +152,12 @@ MediaPerfProfiler::~MediaPerfProfiler()
         MOS_DestroyMutex(m_mutex);
         m_mutex = nullptr;
     }
+
+    if (m_statMutex != nullptr)
+    {
+        MOS_DestroyMutex(m_statMutex);
+        m_statMutex = nullptr;
+    }
 }
 
 MediaPerfProfiler* MediaPerfProfiler::Instance()
@@ -170,7 +192,17 @@ void MediaPerfProfiler::Destroy(MediaPerfProfiler* profiler, void* context, MOS_
     {
         if (profiler->m_initialized == true)
         {
+            profiler->StopStream();
+
             profiler->SavePerfData(osInterface);
+
+            if (profiler->m_perfStoreData != nullptr)
+            {
+                osInterface->pfnUnlockResource(
+                    osInterface,
+                    &profiler->m_perfStoreBuffer);
+                profiler->m_perfStoreData = nullptr;
+            }
     
             osInterface->pfnFreeResource(
                 osInterface,
@@ -258,6 +290,22 @@ MOS_STATUS MediaPerfProfiler::Initialize(void* context, MOS_INTERFACE *osInterfa
         m_registers[regIndex] = userFeatureData.u32Data;
     }
 
+    // Read the interval of per engine statistics
+    MOS_ZeroMemory(&userFeatureData, sizeof(userFeatureData));
+    MOS_UserFeature_ReadValue_ID(
+        nullptr,
+        __MEDIA_USER_FEATURE_VALUE_PERF_PROFILER_STREAM_INTERVAL,
+        &userFeatureData);
+    m_streamInterval = userFeatureData.u32Data;
+
+    // The nodes are used as a ring, so a long session never writes out of the buffer
+    if (m_bufferSize < BASE_OF_NODE(1))
+    {
+        MOS_UnlockMutex(m_mutex);
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+    m_perfDataCount = (m_bufferSize - sizeof(NodeHeader)) / sizeof(PerfEntry);
+
     MOS_ZeroMemory(&m_perfStoreBuffer, sizeof(MOS_RESOURCE));
     
     // Allocate the buffer which store the performance data
@@ -285,6 +333,9 @@ MOS_STATUS MediaPerfProfiler::Initialize(void* context, MOS_INTERFACE *osInterfa
     MOS_LOCK_PARAMS lockFlags;
     MOS_ZeroMemory(&lockFlags, sizeof(MOS_LOCK_PARAMS));
     lockFlags.WriteOnly   = 1;
+    // The stream thread reads the timestamps through this mapping while the
+    // GPU writes them, a cached mapping would not see them on non-LLC parts
+    lockFlags.Uncached    = (m_streamInterval != 0 && m_statMutex != nullptr);
 
     NodeHeader* header = (NodeHeader*)osInterface->pfnLockResource(
             osInterface,
@@ -307,9 +358,34 @@ MOS_STATUS MediaPerfProfiler::Initialize(void* context, MOS_INTERFACE *osInterfa
         header->perfMode    = UMD_PERF_MODE_TIMING_ONLY;
     }
 
-    osInterface->pfnUnlockResource(
-            osInterface,
-            &m_perfStoreBuffer);
+    // Keep the buffer mapped for the stream thread, which reads the nodes
+    // as soon as the GPU writes their end timestamp
+    if (m_streamInterval != 0 && m_statMutex != nullptr)
+    {
+        m_perfStoreData = (uint8_t *)header;
+        m_readIndex     = m_perfDataIndex;
+        m_droppedCount  = 0;
+        m_skippedCount  = 0;
+        MOS_ZeroMemory(m_engineStats, sizeof(m_engineStats));
+        MOS_ZeroMemory(m_pendingStats, sizeof(m_pendingStats));
+        MOS_ZeroMemory(m_windowBegin, sizeof(m_windowBegin));
+        MOS_ZeroMemory(m_windowEnd, sizeof(m_windowEnd));
+
+        m_streamRunning = true;
+        m_streamThread  = MOS_CreateThread((void *)StreamThread, this);
+        if (m_streamThread == 0)
+        {
+            m_streamRunning = false;
+            m_perfStoreData = nullptr;
+        }
+    }
+
+    if (m_perfStoreData == nullptr)
+    {
+        osInterface->pfnUnlockResource(
+                osInterface,
+                &m_perfStoreBuffer);
+    }
 
     m_initialized = true;
 
@@ -410,8 +486,27 @@ MOS_STATUS MediaPerfProfiler::AddPerfCollectStartCmd(void* context,
 
     MOS_LockMutex(m_mutex);
 
-    perfDataIndex = m_perfDataIndex;
-    m_perfDataIndex++;
+    perfDataIndex = m_perfDataIndex % m_perfDataCount;
+
+    if (m_perfStoreData != nullptr)
+    {
+        // The node of the previous lap is not read yet and the GPU has not
+        // completed it, reusing the slot would mix the two submissions
+        if (m_perfDataIndex - __atomic_load_n(&m_readIndex, __ATOMIC_ACQUIRE) >= m_perfDataCount &&
+            __atomic_load_n((uint64_t *)(m_perfStoreData + TIMESTAMP_OF_NODE(perfDataIndex, endTimeClockValue)), __ATOMIC_ACQUIRE) == 0)
+        {
+            __atomic_add_fetch(&m_skippedCount, 1, __ATOMIC_RELAXED);
+            MOS_UnlockMutex(m_mutex);
+            m_contextIndexMap[context] = PERF_NODE_SKIPPED;
+            return status;
+        }
+
+        // The stream thread takes a node as completed once its end timestamp is
+        // not 0, so clear the timestamps left by the previous lap of the ring
+        *(uint64_t *)(m_perfStoreData + TIMESTAMP_OF_NODE(perfDataIndex, beginTimeClockValue)) = 0;
+        *(uint64_t *)(m_perfStoreData + TIMESTAMP_OF_NODE(perfDataIndex, endTimeClockValue))   = 0;
+    }
+    __atomic_store_n(&m_perfDataIndex, m_perfDataIndex + 1, __ATOMIC_RELEASE);
 
     MOS_UnlockMutex(m_mutex);
 
@@ -457,9 +552,7 @@ MOS_STATUS MediaPerfProfiler::AddPerfCollectStartCmd(void* context,
         }
     }
 
-    // The address of timestamp must be 8 bytes aligned.
-    uint32_t offset = BASE_OF_NODE(perfDataIndex) + OFFSET_OF(PerfEntry, beginTimeClockValue);
-    offset = MOS_ALIGN_CEIL(offset, 8);
+    uint32_t offset = TIMESTAMP_OF_NODE(perfDataIndex, beginTimeClockValue);
 
     if (rcsEngineUsed)
     {
@@ -503,6 +596,10 @@ MOS_STATUS MediaPerfProfiler::AddPerfCollectEndCmd(void* context,
     rcsEngineUsed = MOS_RCS_ENGINE_USED(gpuContext);
 
     perfDataIndex = m_contextIndexMap[context];
+    if (perfDataIndex == PERF_NODE_SKIPPED)
+    {
+        return status;
+    }
 
     int8_t regIndex = 0;
     for (regIndex = 0; regIndex < 8; regIndex++)
@@ -517,9 +614,7 @@ MOS_STATUS MediaPerfProfiler::AddPerfCollectEndCmd(void* context,
         }
     }
 
-    // The address of timestamp must be 8 bytes aligned.
-    uint32_t offset = BASE_OF_NODE(perfDataIndex) + OFFSET_OF(PerfEntry, endTimeClockValue);
-    offset = MOS_ALIGN_CEIL(offset, 8);
+    uint32_t offset = TIMESTAMP_OF_NODE(perfDataIndex, endTimeClockValue);
 
     if (rcsEngineUsed)
     {
@@ -544,8 +639,14 @@ MOS_STATUS MediaPerfProfiler::SavePerfData(MOS_INTERFACE *osInterface)
     MOS_STATUS status = MOS_STATUS_SUCCESS;
 
     CHK_NULL_RETURN(osInterface);
-    
-    if (m_perfDataIndex > 0)
+
+    uint32_t perfDataCount = MOS_MIN(m_perfDataIndex, m_perfDataCount);
+
+    if (perfDataCount > 0 && m_perfStoreData != nullptr)
+    {
+        MOS_WriteFileFromPtr(m_outputFileName, m_perfStoreData, BASE_OF_NODE(perfDataCount));
+    }
+    else if (perfDataCount > 0)
     {
         MOS_LOCK_PARAMS     LockFlagsNoOverWrite;
         MOS_ZeroMemory(&LockFlagsNoOverWrite, sizeof(MOS_LOCK_PARAMS));
@@ -560,7 +661,7 @@ MOS_STATUS MediaPerfProfiler::SavePerfData(MOS_INTERFACE *osInterface)
 
         CHK_NULL_RETURN(pData);
 
-        MOS_WriteFileFromPtr(m_outputFileName, pData, BASE_OF_NODE(m_perfDataIndex));
+        MOS_WriteFileFromPtr(m_outputFileName, pData, BASE_OF_NODE(perfDataCount));
 
         osInterface->pfnUnlockResource(
             osInterface,
@@ -570,6 +671,197 @@ MOS_STATUS MediaPerfProfiler::SavePerfData(MOS_INTERFACE *osInterface)
     return status;
 }
 
+MOS_STATUS MediaPerfProfiler::GetEngineStatistics(PerfGPUNode node, PerfEngineStatistics *stats)
+{
+    CHK_NULL_RETURN(stats);
+
+    if (node >= PERF_GPU_NODE_COUNT)
+    {
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+
+    if (m_statMutex == nullptr)
+    {
+        MOS_ZeroMemory(stats, sizeof(*stats));
+        return MOS_STATUS_SUCCESS;
+    }
+
+    MOS_LockMutex(m_statMutex);
+    *stats = m_engineStats[node];
+    MOS_UnlockMutex(m_statMutex);
+
+    return MOS_STATUS_SUCCESS;
+}
+
+void *MediaPerfProfiler::StreamThread(void *data)
+{
+    MediaPerfProfiler *profiler = (MediaPerfProfiler *)data;
+    uint32_t           elapsed  = 0;
+
+    while (__atomic_load_n(&profiler->m_streamRunning, __ATOMIC_ACQUIRE))
+    {
+        MOS_Sleep(PERF_STREAM_POLL_MS);
+
+        // Read often enough for the GPU never to catch up with the reader
+        profiler->ReadCompletedEntries();
+
+        elapsed += PERF_STREAM_POLL_MS;
+        if (elapsed >= profiler->m_streamInterval)
+        {
+            profiler->PublishStatistics();
+            elapsed = 0;
+        }
+    }
+
+    profiler->ReadCompletedEntries();
+    profiler->PublishStatistics();
+
+    return nullptr;
+}
+
+void MediaPerfProfiler::StopStream()
+{
+    if (m_streamThread == 0)
+    {
+        return;
+    }
+
+    __atomic_store_n(&m_streamRunning, false, __ATOMIC_RELEASE);
+    MOS_WaitThread(m_streamThread);
+    m_streamThread = 0;
+}
+
+void MediaPerfProfiler::ReadCompletedEntries()
+{
+    uint32_t writeIndex = __atomic_load_n(&m_perfDataIndex, __ATOMIC_ACQUIRE);
+    uint32_t readIndex  = m_readIndex;
+
+    // Nodes more than one lap behind were overwritten before being read
+    if (writeIndex - readIndex > m_perfDataCount)
+    {
+        m_droppedCount += writeIndex - readIndex - m_perfDataCount;
+        readIndex       = writeIndex - m_perfDataCount;
+    }
+
+    for (; readIndex != writeIndex; __atomic_store_n(&m_readIndex, ++readIndex, __ATOMIC_RELEASE))
+    {
+        uint32_t nodeIndex = readIndex % m_perfDataCount;
+        uint64_t begin     = __atomic_load_n(
+            (uint64_t *)(m_perfStoreData + TIMESTAMP_OF_NODE(nodeIndex, beginTimeClockValue)), __ATOMIC_RELAXED);
+        uint64_t end       = __atomic_load_n(
+            (uint64_t *)(m_perfStoreData + TIMESTAMP_OF_NODE(nodeIndex, endTimeClockValue)), __ATOMIC_ACQUIRE);
+
+        if (end == 0)
+        {
+            // Nodes are completed in order on one GPU node but not across nodes,
+            // give up on a node whose end command was never submitted
+            if (writeIndex - readIndex < m_perfDataCount / 2)
+            {
+                break;
+            }
+            m_droppedCount++;
+            continue;
+        }
+
+        uint32_t engineTag = *(uint32_t *)(m_perfStoreData + BASE_OF_NODE(nodeIndex) + OFFSET_OF(PerfEntry, engineTag));
+
+        if (engineTag >= PERF_GPU_NODE_COUNT || begin == 0 || end < begin)
+        {
+            m_droppedCount++;
+            continue;
+        }
+
+        uint64_t              ticks  = end - begin;
+        uint32_t              bucket = (ticks == 0) ? 0 : (64 - __builtin_clzll(ticks));
+        PerfEngineStatistics &stats  = m_pendingStats[engineTag];
+
+        stats.frameCount++;
+        stats.busyTicks       += ticks;
+        stats.windowBusyTicks += ticks;
+        stats.maxTicks         = MOS_MAX(stats.maxTicks, ticks);
+        stats.latencyHistogram[MOS_MIN(bucket, PERF_LATENCY_BUCKET_COUNT - 1)]++;
+
+        if (m_windowBegin[engineTag] == 0 || begin < m_windowBegin[engineTag])
+        {
+            m_windowBegin[engineTag] = begin;
+        }
+        m_windowEnd[engineTag] = MOS_MAX(m_windowEnd[engineTag], end);
+    }
+    __atomic_store_n(&m_readIndex, readIndex, __ATOMIC_RELEASE);
+}
+
+void MediaPerfProfiler::PublishStatistics()
+{
+    uint32_t node = 0;
+
+    for (node = 0; node < PERF_GPU_NODE_COUNT; node++)
+    {
+        m_pendingStats[node].windowSpanTicks = m_windowEnd[node] - m_windowBegin[node];
+    }
+
+    MOS_LockMutex(m_statMutex);
+    MOS_SecureMemcpy(m_engineStats, sizeof(m_engineStats), m_pendingStats, sizeof(m_pendingStats));
+    MOS_UnlockMutex(m_statMutex);
+
+    // Snapshot file next to the output file, rewritten every interval
+    char     fileName[MOS_MAX_PATH_LENGTH + 1];
+    char     text[PERF_STATS_STRING_SIZE];
+    uint32_t length = 0;
+    int32_t  ret    = 0;
+
+    MOS_SecureStringPrint(fileName, sizeof(fileName), sizeof(fileName), "%s.stats", m_outputFileName);
+
+    ret = MOS_SecureStringPrint(text, sizeof(text), sizeof(text),
+        "dropped %llu\nskipped %llu\nnode frames busy_ticks max_ticks window_busy_ticks window_span_ticks\n",
+        (unsigned long long)m_droppedCount,
+        (unsigned long long)__atomic_load_n(&m_skippedCount, __ATOMIC_RELAXED));
+    length  = (ret > 0) ? MOS_MIN(length + ret, sizeof(text) - 1) : length;
+
+    for (node = 0; node < PERF_GPU_NODE_COUNT; node++)
+    {
+        PerfEngineStatistics &stats = m_pendingStats[node];
+
+        ret = MOS_SecureStringPrint(text + length, sizeof(text) - length, sizeof(text) - length,
+            "%s %llu %llu %llu %llu %llu\n",
+            perfGpuNodeName[node],
+            (unsigned long long)stats.frameCount,
+            (unsigned long long)stats.busyTicks,
+            (unsigned long long)stats.maxTicks,
+            (unsigned long long)stats.windowBusyTicks,
+            (unsigned long long)stats.windowSpanTicks);
+        length  = (ret > 0) ? MOS_MIN(length + ret, sizeof(text) - 1) : length;
+    }
+
+    // One line per node with the entries below 2^bucket ticks
+    for (node = 0; node < PERF_GPU_NODE_COUNT; node++)
+    {
+        ret = MOS_SecureStringPrint(text + length, sizeof(text) - length, sizeof(text) - length,
+            "%s_histogram", perfGpuNodeName[node]);
+        length  = (ret > 0) ? MOS_MIN(length + ret, sizeof(text) - 1) : length;
+
+        for (uint32_t bucket = 0; bucket < PERF_LATENCY_BUCKET_COUNT; bucket++)
+        {
+            ret = MOS_SecureStringPrint(text + length, sizeof(text) - length, sizeof(text) - length,
+                " %llu", (unsigned long long)m_pendingStats[node].latencyHistogram[bucket]);
+            length  = (ret > 0) ? MOS_MIN(length + ret, sizeof(text) - 1) : length;
+        }
+
+        ret = MOS_SecureStringPrint(text + length, sizeof(text) - length, sizeof(text) - length, "\n");
+        length  = (ret > 0) ? MOS_MIN(length + ret, sizeof(text) - 1) : length;
+    }
+
+    MOS_WriteFileFromPtr(fileName, text, length);
+
+    // Start the next interval
+    for (node = 0; node < PERF_GPU_NODE_COUNT; node++)
+    {
+        m_pendingStats[node].windowBusyTicks = 0;
+        m_pendingStats[node].windowSpanTicks = 0;
+        m_windowBegin[node]                  = 0;
+        m_windowEnd[node]                    = 0;
+    }
+}
+
 PerfGPUNode MediaPerfProfiler::GpuContextToGpuNode(MOS_GPU_CONTEXT context)
 {
     PerfGPUNode node = PERF_GPU_NODE_UNKNOW;
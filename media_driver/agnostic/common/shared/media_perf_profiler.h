@@ -45,6 +45,23 @@ typedef enum _PerfGPUNode
     PERF_GPU_NODE_UNKNOW = 0xFF
 }PerfGPUNode;
 
+#define PERF_GPU_NODE_COUNT         5
+#define PERF_LATENCY_BUCKET_COUNT   32
+
+//!
+//! \brief  Statistics of the perf entries completed on one GPU node, in GPU
+//!         timestamp ticks
+//!
+struct PerfEngineStatistics
+{
+    uint64_t    frameCount;                                 //!< Number of completed entries
+    uint64_t    busyTicks;                                  //!< Sum of end - begin of all entries
+    uint64_t    maxTicks;                                   //!< Longest entry
+    uint64_t    windowBusyTicks;                            //!< Sum of end - begin in the last interval
+    uint64_t    windowSpanTicks;                            //!< First begin to last end in the last interval
+    uint64_t    latencyHistogram[PERF_LATENCY_BUCKET_COUNT];//!< Entries by log2 of end - begin
+};
+
 class MediaPerfProfiler
 {
 public:
@@ -122,6 +139,22 @@ public:
         MhwMiInterface *miInterface,
         MOS_COMMAND_BUFFER *cmdBuffer);
 
+    //!
+    //! \brief    Get the statistics of a GPU node
+    //! \details  Only available when the profiler streams its data, i.e. when
+    //!           "Perf Profiler Stream Interval" is not 0. The window values
+    //!           cover the last interval.
+    //!
+    //! \param    [in] node
+    //!           GPU node
+    //! \param    [out] stats
+    //!           Statistics of the node
+    //!
+    //! \return   MOS_STATUS
+    //!           MOS_STATUS_SUCCESS if success, else fail reason
+    //!
+    MOS_STATUS GetEngineStatistics(PerfGPUNode node, PerfEngineStatistics *stats);
+
 private:
     //!
     //! \brief    Constructor
@@ -239,13 +272,45 @@ private:
     //!
     bool IsPerfModeWidthMemInfo(uint32_t *regs);
 
+    //!
+    //! \brief    Thread reading the completed entries of the ring
+    //!
+    //! \param    [in] data
+    //!           Pointer of profiler
+    //!
+    //! \return   void*
+    //!
+    static void *StreamThread(void *data);
+
+    //!
+    //! \brief    Stop the stream thread after it reads the last entries
+    //!
+    //! \return   void
+    //!
+    void StopStream();
+
+    //!
+    //! \brief    Accumulate the entries completed by the GPU since last call
+    //!
+    //! \return   void
+    //!
+    void ReadCompletedEntries();
+
+    //!
+    //! \brief    Close the current interval and write the statistics file
+    //!
+    //! \return   void
+    //!
+    void PublishStatistics();
+
 protected:
     MOS_RESOURCE               m_perfStoreBuffer;       //!< Buffer for perf data collection
     Map                        m_contextIndexMap;       //!< Map between CodecHal/VPHal and PerfDataContext
     PMOS_MUTEX                 m_mutex = nullptr;       //!< Mutex for protecting data of profiler when refereced multi times
 
     int32_t                    m_profilerEnabled = 0;   //!< UMD Perf Profiler enable or not
-    uint32_t                   m_perfDataIndex = 0;     //!< The index of performance data node in buffer
+    uint32_t                   m_perfDataIndex = 0;     //!< The number of performance data nodes written, the ring index is modulo m_perfDataCount
+    uint32_t                   m_perfDataCount = 0;     //!< The number of performance data nodes in buffer
     uint32_t                   m_ref = 0;               //!< The number of refereces
     uint32_t                   m_bufferSize = 10000000; //!< The size of perf data buffer
     uint32_t                   m_timerReg = 0;          //!< registers of Timer
@@ -253,6 +318,20 @@ protected:
 
     bool                       m_initialized = false;   //!< Indicate whether profiler was initialized
     char                       m_outputFileName[MOS_MAX_PATH_LENGTH + 1];  //!< Name of output file
+
+    uint32_t                   m_streamInterval = 0;    //!< Interval of statistics in ms, 0 if not streaming
+    uint8_t                    *m_perfStoreData = nullptr;  //!< Buffer mapping kept while streaming
+    MOS_THREADHANDLE           m_streamThread = 0;      //!< Thread reading the completed entries
+    bool                       m_streamRunning = false; //!< Cleared to stop the stream thread
+    uint32_t                   m_readIndex = 0;         //!< The next performance data node to read
+    uint64_t                   m_droppedCount = 0;      //!< Nodes overwritten or never completed before being read
+    uint64_t                   m_skippedCount = 0;      //!< Submissions not profiled because their ring slot was still in use
+    PMOS_MUTEX                 m_statMutex = nullptr;   //!< Mutex for protecting the statistics
+
+    PerfEngineStatistics       m_engineStats[PERF_GPU_NODE_COUNT];   //!< Published statistics
+    PerfEngineStatistics       m_pendingStats[PERF_GPU_NODE_COUNT];  //!< Statistics of the current interval
+    uint64_t                   m_windowBegin[PERF_GPU_NODE_COUNT];   //!< First begin timestamp in the current interval
+    uint64_t                   m_windowEnd[PERF_GPU_NODE_COUNT];     //!< Last end timestamp in the current interval
 };
 
 #endif // __MEDIA_PERF_PROFILER_H__
@@ -1865,18 +1865,12 @@ MOS_STATUS VPHAL_VEBOX_STATE::VeboxRenderVeboxCmd(
         &CmdBuffer));
 
     //---------------------------------
-    // Send CMD: Vebox_State
+    // Send CMD: Vebox_State and Vebox_Surface_State, replayed from the
+    // commands recorded for the first frame of the same configuration
     //---------------------------------
-    VPHAL_RENDER_CHK_STATUS(pVeboxInterface->AddVeboxState(
+    VPHAL_RENDER_CHK_STATUS(pVeboxInterface->AddVeboxStateAndSurfacesFromTemplate(
         &CmdBuffer,
         &VeboxStateCmdParams,
-        0));
-
-    //---------------------------------
-    // Send CMD: Vebox_Surface_State
-    //---------------------------------
-    VPHAL_RENDER_CHK_STATUS(pVeboxInterface->AddVeboxSurfaces(
-        &CmdBuffer,
         &MhwVeboxSurfaceStateCmdParams));
 
     //---------------------------------
@@ -1892,7 +1886,7 @@ MOS_STATUS VPHAL_VEBOX_STATE::VeboxRenderVeboxCmd(
     //---------------------------------
     // Send CMD: Vebox_DI_IECP
     //---------------------------------
-    VPHAL_RENDER_CHK_STATUS(pVeboxInterface->AddVeboxDiIecp(
+    VPHAL_RENDER_CHK_STATUS(pVeboxInterface->AddVeboxDiIecpFromTemplate(
         &CmdBuffer,
         &VeboxDiIecpCmdParams));
 
@@ -458,7 +458,7 @@ MOS_STATUS MhwVeboxInterfaceG8::AddVeboxSurfaces(
         &cmd1,
         false,
         pVeboxSurfaceStateCmdParams->bDIEnable);
-    Mos_AddCommand(pCmdBuffer, &cmd1, cmd1.byteSize);
+    MHW_CHK_STATUS_RETURN(Mos_AddCommand(pCmdBuffer, &cmd1, cmd1.byteSize));
 
     // Setup Surface State for Output surface
     SetVeboxSurfaces(
@@ -468,7 +468,7 @@ MOS_STATUS MhwVeboxInterfaceG8::AddVeboxSurfaces(
         &cmd2,
         true,
         pVeboxSurfaceStateCmdParams->bDIEnable);
-    Mos_AddCommand(pCmdBuffer, &cmd2, cmd2.byteSize);
+    MHW_CHK_STATUS_RETURN(Mos_AddCommand(pCmdBuffer, &cmd2, cmd2.byteSize));
 
     return MOS_STATUS_SUCCESS;
 }
@@ -47,10 +47,11 @@ CM_RT_API int32_t CmEventRT::WaitForTaskFinished(uint32_t timeOutMs)
     if( m_status == CM_STATUS_FINISHED )
         goto finish;
 
-    //Make sure task flushed
+    //Make sure task flushed, blocking until the flushed queue has room
+    //instead of retrying a non-blocking flush
     while ( m_status == CM_STATUS_QUEUED )
     {
-        m_queue->FlushTaskWithoutSync();  //Flush none if 1st task NOT finished yet
+        m_queue->FlushTaskWithoutSync(true);
     }
 
     CM_ASSERT(m_osData != nullptr);
@@ -81,6 +82,47 @@ finish:
     return result;
 }
 
+//*-----------------------------------------------------------------------------
+//! Reference the batch of a flushed task, so that it can be waited on with
+//! WaitForBatch after the lock protecting the event is released. The event
+//! drops its own reference once the task is finished.
+//! OUTPUT:
+//!     The batch, or nullptr if the task is not flushed or already finished.
+//*-----------------------------------------------------------------------------
+void *CmEventRT::ReferenceBatch()
+{
+    if( m_osData == nullptr || m_status == CM_STATUS_FINISHED )
+    {
+        return nullptr;
+    }
+
+    mos_bo_reference((MOS_LINUX_BO*)m_osData);
+    return m_osData;
+}
+
+//*-----------------------------------------------------------------------------
+//! Sleep until a batch referenced by ReferenceBatch completes on GPU, then
+//! release it. Unlike WaitForTaskFinished, it does not flush the queue.
+//! INPUT:
+//!     Batch returned by ReferenceBatch
+//!     Timeout in Milliseconds
+//! OUTPUT:
+//!     CM_SUCCESS:  if the batch completed.
+//!     CM_EXCEED_MAX_TIMEOUT:  if timeout in synchoinization system call.
+//*-----------------------------------------------------------------------------
+int32_t CmEventRT::WaitForBatch(void *batch, uint32_t timeOutMs)
+{
+    int32_t result = CM_SUCCESS;
+
+    if( mos_gem_bo_wait((MOS_LINUX_BO*)batch, 1000000LL*timeOutMs) )
+    {
+        result = CM_EXCEED_MAX_TIMEOUT;
+    }
+    mos_bo_unreference((MOS_LINUX_BO*)batch);
+
+    return result;
+}
+
 //*-----------------------------------------------------------------------------
 //! Unreference the bo in linux.
 //! INPUT:
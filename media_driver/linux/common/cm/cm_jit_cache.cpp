@@ -0,0 +1,508 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      cm_jit_cache.cpp
+//! \brief     Class CmJitCache definitions
+//!
+
+#include "cm_jit_cache.h"
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <elf.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cm_mem.h"
+
+#define CM_JIT_CACHE_MAGIC          0x434d4a43  // "CMJC"
+#define CM_JIT_CACHE_VERSION        1
+#define CM_JIT_CACHE_FILE_SUFFIX    ".bin"
+
+#define FNV_OFFSET_BASIS_64         0xcbf29ce484222325ULL
+#define FNV_PRIME_64                0x100000001b3ULL
+
+// Entry layout: header, jitter info, Gen binary
+struct CM_JIT_CACHE_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t programHash;
+    uint64_t checksum;          // of the jitter info and the binary
+    uint32_t binarySize;
+    uint32_t infoSize;
+    char     kernelName[CM_MAX_KERNEL_NAME_SIZE_IN_BYTE];
+};
+
+#define CM_JIT_CACHE_DATA_OFFSET    (sizeof(CM_JIT_CACHE_HEADER) + sizeof(FINALIZER_INFO))
+
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME_64;
+    }
+    return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char *str)
+{
+    // the terminator keeps "ab","c" and "a","bc" apart
+    return str ? HashBytes(hash, str, strlen(str) + 1) : HashBytes(hash, "", 1);
+}
+
+struct CM_JIT_BUILD_ID_SEARCH
+{
+    const void *base;       // load address of the jitter library
+    uint64_t   hash;
+    bool       found;
+};
+
+//! Hash the GNU build id note of the object loaded at search->base
+static int HashBuildIdNote(struct dl_phdr_info *info, size_t size, void *data)
+{
+    CM_JIT_BUILD_ID_SEARCH *search = (CM_JIT_BUILD_ID_SEARCH *)data;
+
+    if ((const void *)info->dlpi_addr != search->base)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < info->dlpi_phnum; i++)
+    {
+        if (info->dlpi_phdr[i].p_type != PT_NOTE)
+        {
+            continue;
+        }
+
+        const uint8_t *note = (const uint8_t *)(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+        const uint8_t *end  = note + info->dlpi_phdr[i].p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end)
+        {
+            const ElfW(Nhdr) *header = (const ElfW(Nhdr) *)note;
+            const uint8_t    *name   = note + sizeof(ElfW(Nhdr));
+            const uint8_t    *desc   = name + MOS_ALIGN_CEIL(header->n_namesz, 4);
+
+            if (desc + header->n_descsz > end)
+            {
+                break;
+            }
+            if (header->n_type == NT_GNU_BUILD_ID && header->n_namesz == 4 &&
+                memcmp(name, "GNU", 4) == 0)
+            {
+                search->hash  = HashBytes(search->hash, desc, header->n_descsz);
+                search->found = true;
+                return 1;
+            }
+            note = desc + MOS_ALIGN_CEIL(header->n_descsz, 4);
+        }
+    }
+
+    return 1;
+}
+
+//! Hash the build of the jitter library containing jitterEntry: its GNU build
+//! id, or the size, time and inode of the file if it has none
+static uint64_t HashJitterBuild(uint64_t hash, const void *jitterEntry)
+{
+    Dl_info dlInfo;
+
+    if (jitterEntry == nullptr || dladdr(jitterEntry, &dlInfo) == 0)
+    {
+        return hash;
+    }
+
+    CM_JIT_BUILD_ID_SEARCH search = {dlInfo.dli_fbase, hash, false};
+    dl_iterate_phdr(HashBuildIdNote, &search);
+    if (search.found)
+    {
+        return search.hash;
+    }
+
+    struct stat fileStat;
+    if (dlInfo.dli_fname && stat(dlInfo.dli_fname, &fileStat) == 0)
+    {
+        uint64_t fileId[4] = {(uint64_t)fileStat.st_size,
+                              (uint64_t)fileStat.st_mtim.tv_sec,
+                              (uint64_t)fileStat.st_mtim.tv_nsec,
+                              (uint64_t)fileStat.st_ino};
+        hash = HashBytes(hash, fileId, sizeof(fileId));
+    }
+    return hash;
+}
+
+//! Create a directory and its parents, like mkdir -p
+static bool MakeDirectory(const char *dir)
+{
+    char path[CM_JIT_CACHE_MAX_PATH];
+    size_t length = strnlen(dir, CM_JIT_CACHE_MAX_PATH);
+
+    if (length == 0 || length >= CM_JIT_CACHE_MAX_PATH)
+    {
+        return false;
+    }
+    CmSafeMemCopy(path, dir, length + 1);
+
+    for (size_t i = 1; i <= length; i++)
+    {
+        if (path[i] == '/' || path[i] == '\0')
+        {
+            char saved = path[i];
+            path[i] = '\0';
+            if (mkdir(path, 0755) != 0 && errno != EEXIST)
+            {
+                return false;
+            }
+            path[i] = saved;
+        }
+    }
+
+    return access(dir, R_OK | W_OK | X_OK) == 0;
+}
+
+static bool WriteAll(int fd, const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size  -= written;
+    }
+    return true;
+}
+
+CmJitCache* CmJitCache::GetInstance()
+{
+    static CmJitCache jitCache;
+    return &jitCache;
+}
+
+CmJitCache::CmJitCache():
+    m_enabled(false),
+    m_maxSize(CM_JIT_CACHE_DEFAULT_MAX_SIZE),
+    m_size(0)
+{
+    CmSafeMemSet(m_dir, 0, sizeof(m_dir));
+
+    // Opt-in, a shared cache is written only if asked for
+    const char *enable = getenv(CM_JIT_CACHE_ENABLE_ENV);
+    const char *dir    = getenv(CM_JIT_CACHE_DIR_ENV);
+    if ((enable == nullptr || atoi(enable) == 0) && (dir == nullptr || dir[0] == '\0'))
+    {
+        return;
+    }
+
+    const char *maxSize = getenv(CM_JIT_CACHE_MAX_SIZE_ENV);
+    if (maxSize && atoi(maxSize) > 0)
+    {
+        m_maxSize = (uint64_t)atoi(maxSize) * 1024 * 1024;
+    }
+
+    int length = 0;
+    if (dir && dir[0])
+    {
+        length = snprintf(m_dir, sizeof(m_dir), "%s", dir);
+    }
+    else if ((dir = getenv("XDG_CACHE_HOME")) && dir[0])
+    {
+        length = snprintf(m_dir, sizeof(m_dir), "%s/intel-media/cm_jit", dir);
+    }
+    else if ((dir = getenv("HOME")) && dir[0])
+    {
+        length = snprintf(m_dir, sizeof(m_dir), "%s/.cache/intel-media/cm_jit", dir);
+    }
+
+    if (length <= 0 || length >= (int)sizeof(m_dir))
+    {
+        return;
+    }
+
+    m_enabled = MakeDirectory(m_dir);
+    if (m_enabled)
+    {
+        m_size = Evict();
+    }
+}
+
+uint64_t CmJitCache::HashProgram(const void *cisaCode,
+                                 uint32_t cisaCodeSize,
+                                 const char *platform,
+                                 uint32_t jitMajor,
+                                 uint32_t jitMinor,
+                                 const void *jitterEntry,
+                                 int numJitFlags,
+                                 const char **jitFlags)
+{
+    uint64_t hash = FNV_OFFSET_BASIS_64;
+    uint32_t versions[3] = {CM_JIT_CACHE_VERSION, jitMajor, jitMinor};
+
+    // The version does not change with every jitter build
+    hash = HashBytes(hash, versions, sizeof(versions));
+    hash = HashJitterBuild(hash, jitterEntry);
+    hash = HashString(hash, platform);
+    for (int i = 0; i < numJitFlags; i++)
+    {
+        hash = HashString(hash, jitFlags[i]);
+    }
+    hash = HashBytes(hash, &cisaCodeSize, sizeof(cisaCodeSize));
+    hash = HashBytes(hash, cisaCode, cisaCodeSize);
+
+    return hash;
+}
+
+void CmJitCache::GetEntryPath(uint64_t key, char *path, size_t size)
+{
+    snprintf(path, size, "%s/%016llx%s", m_dir, (unsigned long long)key, CM_JIT_CACHE_FILE_SUFFIX);
+}
+
+int32_t CmJitCache::Load(uint64_t programHash,
+                         const char *kernelName,
+                         void* &binary,
+                         uint32_t &binarySize,
+                         FINALIZER_INFO *jitInfo)
+{
+    char        path[CM_JIT_CACHE_MAX_PATH];
+    struct stat fileStat;
+    uint8_t     *data = nullptr;
+    uint64_t    key = HashString(HashBytes(FNV_OFFSET_BASIS_64, &programHash, sizeof(programHash)), kernelName);
+
+    binary     = nullptr;
+    binarySize = 0;
+
+    if (!m_enabled || jitInfo == nullptr)
+    {
+        return CM_FAILURE;
+    }
+
+    GetEntryPath(key, path, sizeof(path));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return CM_FAILURE;
+    }
+
+    if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < CM_JIT_CACHE_DATA_OFFSET)
+    {
+        close(fd);
+        return CM_FAILURE;
+    }
+
+    data = (uint8_t *)mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return CM_FAILURE;
+    }
+
+    const CM_JIT_CACHE_HEADER *header = (const CM_JIT_CACHE_HEADER *)data;
+    if (header->magic != CM_JIT_CACHE_MAGIC ||
+        header->version != CM_JIT_CACHE_VERSION ||
+        header->programHash != programHash ||
+        header->infoSize != sizeof(FINALIZER_INFO) ||
+        (size_t)fileStat.st_size != CM_JIT_CACHE_DATA_OFFSET + header->binarySize ||
+        strncmp(header->kernelName, kernelName, CM_MAX_KERNEL_NAME_SIZE_IN_BYTE) != 0 ||
+        header->checksum != HashBytes(FNV_OFFSET_BASIS_64, data + sizeof(CM_JIT_CACHE_HEADER),
+                                      sizeof(FINALIZER_INFO) + header->binarySize))
+    {
+        munmap(data, fileStat.st_size);
+        close(fd);
+        return CM_FAILURE;
+    }
+
+    // Refresh the modification time, which orders the entries for eviction
+    futimens(fd, nullptr);
+    close(fd);
+
+    CmSafeMemCopy(jitInfo, data + sizeof(CM_JIT_CACHE_HEADER), sizeof(FINALIZER_INFO));
+    binary     = data + CM_JIT_CACHE_DATA_OFFSET;
+    binarySize = header->binarySize;
+
+    return CM_SUCCESS;
+}
+
+void CmJitCache::Store(uint64_t programHash,
+                       const char *kernelName,
+                       const void *binary,
+                       uint32_t binarySize,
+                       const FINALIZER_INFO *jitInfo)
+{
+    static uint32_t     tempIndex = 0;
+    char                path[CM_JIT_CACHE_MAX_PATH];
+    char                tempPath[CM_JIT_CACHE_MAX_PATH];
+    CM_JIT_CACHE_HEADER header;
+    FINALIZER_INFO      info;
+    uint64_t            key = HashString(HashBytes(FNV_OFFSET_BASIS_64, &programHash, sizeof(programHash)), kernelName);
+
+    if (!m_enabled || binary == nullptr || binarySize == 0 || jitInfo == nullptr ||
+        binarySize > m_maxSize)
+    {
+        return;
+    }
+
+    // Pointers in the jitter info are not valid in another process
+    CmSafeMemCopy(&info, jitInfo, sizeof(FINALIZER_INFO));
+    info.genDebugInfo     = nullptr;
+    info.genDebugInfoSize = 0;
+    info.bbInfo           = nullptr;
+    info.bbNum            = 0;
+
+    CmSafeMemSet(&header, 0, sizeof(header));
+    header.magic       = CM_JIT_CACHE_MAGIC;
+    header.version     = CM_JIT_CACHE_VERSION;
+    header.programHash = programHash;
+    header.binarySize  = binarySize;
+    header.infoSize    = sizeof(FINALIZER_INFO);
+    header.checksum    = HashBytes(HashBytes(FNV_OFFSET_BASIS_64, &info, sizeof(info)), binary, binarySize);
+    snprintf(header.kernelName, sizeof(header.kernelName), "%s", kernelName);
+
+    // Write to a name private to this process and thread, then rename it in
+    // place so readers only ever see complete entries
+    GetEntryPath(key, path, sizeof(path));
+    snprintf(tempPath, sizeof(tempPath), "%s.%d.%u.tmp", path, (int)getpid(),
+             __atomic_fetch_add(&tempIndex, 1, __ATOMIC_RELAXED));
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    bool written = WriteAll(fd, &header, sizeof(header)) &&
+                   WriteAll(fd, &info, sizeof(info)) &&
+                   WriteAll(fd, binary, binarySize);
+    if (close(fd) != 0 || !written || rename(tempPath, path) != 0)
+    {
+        unlink(tempPath);
+        return;
+    }
+
+    // Rescan only once the entries stored since the last scan may exceed the limit
+    uint64_t entrySize = CM_JIT_CACHE_DATA_OFFSET + binarySize;
+    if (__atomic_add_fetch(&m_size, entrySize, __ATOMIC_RELAXED) > m_maxSize)
+    {
+        m_evictLock.Acquire();
+        if (__atomic_load_n(&m_size, __ATOMIC_RELAXED) > m_maxSize)
+        {
+            __atomic_store_n(&m_size, Evict(), __ATOMIC_RELAXED);
+        }
+        m_evictLock.Release();
+    }
+}
+
+void CmJitCache::FreeBinary(void *binary, uint32_t binarySize)
+{
+    if (binary)
+    {
+        uint8_t *data = (uint8_t *)binary - CM_JIT_CACHE_DATA_OFFSET;
+        munmap(data, CM_JIT_CACHE_DATA_OFFSET + binarySize);
+    }
+}
+
+//*-----------------------------------------------------------------------------
+//| Purpose:    Scan the cache directory and, if it exceeds the size limit,
+//|             remove the least recently used entries until it is back under
+//|             3/4 of the limit
+//| Returns:    Size of the entries left
+//*-----------------------------------------------------------------------------
+uint64_t CmJitCache::Evict()
+{
+    struct CacheEntry
+    {
+        std::string path;
+        uint64_t    time;       // modification time in ns
+        uint64_t    size;
+    };
+    std::vector<CacheEntry> entries;
+    uint64_t                totalSize = 0;
+    size_t                  suffixLength = strlen(CM_JIT_CACHE_FILE_SUFFIX);
+
+    DIR *dir = opendir(m_dir);
+    if (dir == nullptr)
+    {
+        return 0;
+    }
+
+    struct dirent *dirEntry = nullptr;
+    while ((dirEntry = readdir(dir)) != nullptr)
+    {
+        size_t      length = strlen(dirEntry->d_name);
+        struct stat fileStat;
+
+        if (length <= suffixLength ||
+            strcmp(dirEntry->d_name + length - suffixLength, CM_JIT_CACHE_FILE_SUFFIX) != 0)
+        {
+            continue;
+        }
+
+        CacheEntry entry;
+        entry.path = std::string(m_dir) + "/" + dirEntry->d_name;
+        if (stat(entry.path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+        {
+            continue;
+        }
+        entry.time = (uint64_t)fileStat.st_mtim.tv_sec * 1000000000ULL + fileStat.st_mtim.tv_nsec;
+        entry.size = fileStat.st_size;
+        totalSize += entry.size;
+        entries.push_back(entry);
+    }
+    closedir(dir);
+
+    if (totalSize <= m_maxSize)
+    {
+        return totalSize;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const CacheEntry &a, const CacheEntry &b) { return a.time < b.time; });
+
+    // Mapped entries stay valid for the processes using them after unlink
+    for (auto iter = entries.begin(); iter != entries.end() && totalSize > m_maxSize / 4 * 3; iter++)
+    {
+        if (unlink(iter->path.c_str()) == 0)
+        {
+            totalSize -= iter->size;
+        }
+    }
+
+    return totalSize;
+}
@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      cm_jit_cache.h
+//! \brief     Contains Class CmJitCache definitions
+//!
+
+#ifndef MEDIADRIVER_LINUX_COMMON_CM_CMJITCACHE_H_
+#define MEDIADRIVER_LINUX_COMMON_CM_CMJITCACHE_H_
+
+#include "cm_common.h"
+#include "cm_jitter_info.h"
+#include "cm_csync.h"
+
+// Environment variables controlling the cache. It is off unless one of the
+// first two is set. CM_JIT_CACHE_ENABLE=1 puts it in
+// $XDG_CACHE_HOME/intel-media/cm_jit, or $HOME/.cache/intel-media/cm_jit,
+// CM_JIT_CACHE_DIR puts it in the given directory.
+#define CM_JIT_CACHE_ENABLE_ENV     "CM_JIT_CACHE_ENABLE"
+#define CM_JIT_CACHE_DIR_ENV        "CM_JIT_CACHE_DIR"
+#define CM_JIT_CACHE_MAX_SIZE_ENV   "CM_JIT_CACHE_MAX_SIZE"     // in MB
+
+#define CM_JIT_CACHE_DEFAULT_MAX_SIZE   (64 * 1024 * 1024)
+#define CM_JIT_CACHE_MAX_PATH           256
+
+//!
+//! \brief  Persistent cache of the Gen binaries created by the jitter
+//! \details Each kernel is stored in its own file, named by a hash of the
+//!          CISA, the jitter flags (including platform and stepping), the
+//!          jitter version and build id and the kernel name. A hit maps the
+//!          file and the kernel uses the binary in place. Files are written
+//!          to a temporary name and renamed, so concurrent processes never
+//!          see a partial entry. The directory is scanned once per process,
+//!          then again only when the entries stored since make the cache
+//!          exceed its size limit, and the least recently used files are
+//!          removed.
+//!
+class CmJitCache
+{
+public:
+    static CmJitCache* GetInstance();
+
+    bool IsEnabled() { return m_enabled; }
+
+    //!
+    //! \brief  Hash the inputs of the jitting of a program
+    //! \param  [in] jitterEntry
+    //!         Function of the jitter library, whose build id goes in the hash
+    //!
+    uint64_t HashProgram(const void *cisaCode,
+                         uint32_t cisaCodeSize,
+                         const char *platform,
+                         uint32_t jitMajor,
+                         uint32_t jitMinor,
+                         const void *jitterEntry,
+                         int numJitFlags,
+                         const char **jitFlags);
+
+    //!
+    //! \brief  Look a kernel up in the cache
+    //! \param  [out] binary
+    //!         Binary mapped from the cache, freed by FreeBinary
+    //! \param  [out] jitInfo
+    //!         Filled with the jitter info stored with the binary
+    //! \return CM_SUCCESS on a hit, CM_FAILURE otherwise
+    //!
+    int32_t Load(uint64_t programHash,
+                 const char *kernelName,
+                 void* &binary,
+                 uint32_t &binarySize,
+                 FINALIZER_INFO *jitInfo);
+
+    void Store(uint64_t programHash,
+               const char *kernelName,
+               const void *binary,
+               uint32_t binarySize,
+               const FINALIZER_INFO *jitInfo);
+
+    static void FreeBinary(void *binary, uint32_t binarySize);
+
+private:
+    CmJitCache();
+    ~CmJitCache() {}
+
+    CmJitCache(const CmJitCache&);
+    void operator=(const CmJitCache&);
+
+    void GetEntryPath(uint64_t key, char *path, size_t size);
+    uint64_t Evict();
+
+    bool            m_enabled;
+    uint64_t        m_maxSize;
+    uint64_t        m_size;         // size of the directory at the last scan, plus the entries stored since
+    CMRT_UMD::CSync m_evictLock;    // one scan at a time
+    char            m_dir[CM_JIT_CACHE_MAX_PATH];
+};
+
+#endif  // #ifndef MEDIADRIVER_LINUX_COMMON_CM_CMJITCACHE_H_
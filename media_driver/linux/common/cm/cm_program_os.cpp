@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      cm_program_os.cpp
+//! \brief     Contains Linux-dependent CmProgramRT member functions.
+//!
+
+#include "cm_program.h"
+#include "cm_jit_cache.h"
+
+namespace CMRT_UMD
+{
+//*-----------------------------------------------------------------------------
+//| Purpose:    Enable the JIT cache for the program if the user asked for it,
+//|             and compute the key of the program
+//*-----------------------------------------------------------------------------
+void CmProgramRT::InitJitCache(const void *cisaCode, uint32_t cisaCodeSize, const char *platform,
+                               uint32_t jitMajor, uint32_t jitMinor, int numJitFlags, const char **jitFlags)
+{
+    CmJitCache *jitCache = CmJitCache::GetInstance();
+
+    m_jitCacheEnabled = jitCache->IsEnabled();
+    if (m_jitCacheEnabled)
+    {
+        m_jitCacheHash = jitCache->HashProgram(cisaCode, cisaCodeSize, platform, jitMajor, jitMinor,
+                                               (const void *)m_fJITCompile, numJitFlags, jitFlags);
+    }
+}
+
+int32_t CmProgramRT::LoadJitBinary(const char *kernelName, void* &binary, uint32_t &binarySize, FINALIZER_INFO *jitInfo)
+{
+    return CmJitCache::GetInstance()->Load(m_jitCacheHash, kernelName, binary, binarySize, jitInfo);
+}
+
+void CmProgramRT::StoreJitBinary(const char *kernelName, const void *binary, uint32_t binarySize, const FINALIZER_INFO *jitInfo)
+{
+    CmJitCache::GetInstance()->Store(m_jitCacheHash, kernelName, binary, binarySize, jitInfo);
+}
+
+void CmProgramRT::FreeJitBinary(void *binary, uint32_t binarySize)
+{
+    CmJitCache::FreeBinary(binary, binarySize);
+}
+}  // namespace
@@ -29,6 +29,7 @@
 
 #include "cm_def.h"
 #include "cm_hal.h"
+#include "cm_bitmap.h"
 typedef enum _MOS_FORMAT MOS_FORMAT;
 
 namespace CMRT_UMD
@@ -158,6 +159,8 @@ protected:
     int32_t RemoveUserDataEntryIfNeeded(CmSurface2DRT *surface) { return 0; }
     int32_t GetSurfaceBTIInfo();
 
+    void SetSurfaceArrayElement(uint32_t index, CmSurface *surface);
+
 public:
     static const uint32_t MAX_DEVICE_FOR_SAME_SURF = 64; // mamimum number of cm device allowed for creating a cm surf2d wrapper for a mos resource
 
@@ -173,6 +176,9 @@ protected:
 
     int32_t *m_surfaceSizes;         // Size of each surface in surface array
 
+    CmBitmap m_freeSurfaceIndexes;      // Indexes not holding a surface, to find a free one in O(1)
+    CmBitmap m_releasedSurfaceIndexes;  // Surfaces released by API but not destroyed yet
+
     uint32_t m_maxBufferCount;
     uint32_t m_bufferCount;
 
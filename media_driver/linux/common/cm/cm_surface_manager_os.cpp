@@ -98,7 +98,7 @@ namespace CMRT_UMD
         return result;
     }
 
-    m_surfaceArray[ index ] = surface;
+    SetSurfaceArrayElement(index, surface);
     UpdateProfileFor2DSurface(index, width, height, format);
 
     return CM_SUCCESS;
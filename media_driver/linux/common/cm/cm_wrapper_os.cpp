@@ -206,7 +206,7 @@ int32_t CmFillMosResource( VASurfaceID        vaSurfaceID,
     CM_DDI_CHK_NULL(mediaCtx, "Null mediaCtx", CM_INVALID_UMD_CONTEXT);
 
     CM_DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "Null mediaCtx->pSurfaceHeap", CM_INVALID_UMD_CONTEXT);
-    CM_CHK_LESS((uint32_t)vaSurfaceID, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", CM_INVALID_LIBVA_SURFACE);
+    CM_CHK_LESS(DDI_MEDIA_HEAP_INDEX(vaSurfaceID), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", CM_INVALID_LIBVA_SURFACE);
 
     surface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, vaSurfaceID);
     CM_DDI_CHK_NULL(surface, "Null surface", CM_INVALID_LIBVA_SURFACE);
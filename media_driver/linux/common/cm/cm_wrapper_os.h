@@ -35,6 +35,11 @@
 #define CM_SURFACE_FORMAT_R8U  62
 #define CM_SURFACE_FORMAT_R16U 57
 
+namespace CMRT_UMD
+{
+class CmDevice;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 // Thin CMRT definition -- START
 //////////////////////////////////////////////////////////////////////////////////////
@@ -82,6 +87,13 @@ int32_t CmThinExecute(VADriverContextP vaDriverCtx,
 };
 #endif
 
+int32_t CreateCmDeviceFromVA(VADriverContextP vaDriverCtx,
+                             CMRT_UMD::CmDevice* &device,
+                             uint32_t devOption);
+
+int32_t DestroyCmDeviceFromVA(VADriverContextP vaDriverCtx,
+                              CMRT_UMD::CmDevice *device);
+
 int32_t CmFillMosResource(VASurfaceID vaSurfaceID,
                           VADriverContext *vaDriverCtx,
                           PMOS_RESOURCE osResource);
@@ -23,6 +23,8 @@ set(TMP_SOURCES_
     ${CMAKE_CURRENT_LIST_DIR}/cm_event_rt_os.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_ftrace.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_hal_os.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/cm_jit_cache.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/cm_program_os.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_surface_2d_rt_os.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_surface_manager_os.cpp
     ${CMAKE_CURRENT_LIST_DIR}/cm_task_internal_os.cpp
@@ -39,6 +41,7 @@ set(TMP_HEADERS_
     ${CMAKE_CURRENT_LIST_DIR}/cm_device_rt.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_ftrace.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_innerdef_os.h
+    ${CMAKE_CURRENT_LIST_DIR}/cm_jit_cache.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_mem_os.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_surface_2d.h
     ${CMAKE_CURRENT_LIST_DIR}/cm_surface_2d_rt.h
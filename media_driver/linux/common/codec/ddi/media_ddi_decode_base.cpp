@@ -642,6 +642,14 @@ VAStatus DdiMediaDecode::EndPicture(
         return VA_STATUS_ERROR_ALLOCATION_FAILED;
     }
 
+    // Remember the status report slot of this frame so that vaSyncSurface
+    // can find it without scanning the status buffer
+    CodechalDecode *decoder = dynamic_cast<CodechalDecode *>(m_ddiDecodeCtx->pCodecHal);
+    if (decoder && (&(m_ddiDecodeCtx->RTtbl))->pCurrentRT)
+    {
+        (&(m_ddiDecodeCtx->RTtbl))->pCurrentRT->decodeStatusIndex = decoder->GetDecodeStatusBuf()->m_currIndex;
+    }
+
     MOS_STATUS status = m_ddiDecodeCtx->pCodecHal->Execute((void *)(&m_ddiDecodeCtx->DecodeParams));
     if (status != MOS_STATUS_SUCCESS)
     {
@@ -39,6 +39,7 @@
 #include <linux/fb.h>
 
 #include "media_libva_util.h"
+#include "media_libva_copy.h"
 #include "media_libva_decoder.h"
 #include "media_libva_encoder.h"
 #ifndef ANDROID
@@ -293,7 +294,7 @@ static uint32_t DdiMedia_CreateRenderTarget(
     surfaceElement->pSurface = (DDI_MEDIA_SURFACE *)MOS_AllocAndZeroMemory(sizeof(DDI_MEDIA_SURFACE));
     if (nullptr == surfaceElement->pSurface)
     {
-        DdiMediaUtil_ReleasePMediaSurfaceFromHeap(mediaDrvCtx->pSurfaceHeap, surfaceElement->uiVaSurfaceID);
+        DdiMediaUtil_ReleaseHeapElement(mediaDrvCtx->pSurfaceHeap, surfaceElement->uiVaSurfaceID);
         DdiMediaUtil_UnLockMutex(&mediaDrvCtx->SurfaceMutex);
         return VA_INVALID_ID;
     }
@@ -315,6 +316,7 @@ static uint32_t DdiMedia_CreateRenderTarget(
         return VA_INVALID_ID;
     }
 
+    mediaDrvCtx->pSurfaceBoMap->emplace(surfaceElement->pSurface->bo, surfaceElement->pSurface);
     mediaDrvCtx->uiNumSurfaces++;
     uint32_t surfaceID = surfaceElement->uiVaSurfaceID;
     DdiMediaUtil_UnLockMutex(&mediaDrvCtx->SurfaceMutex);
@@ -705,15 +707,10 @@ static void DdiMedia_FreeSurfaceHeapElements(PDDI_MEDIA_CONTEXT mediaCtx)
     if (nullptr == surfaceHeap)
         return;
 
-    PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapBase = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)surfaceHeap->pHeapBase;
-    if (nullptr == mediaSurfaceHeapBase)
-        return;
-
-    int32_t surfaceNums = mediaCtx->uiNumSurfaces;
-    for (int32_t elementId = 0; elementId < surfaceNums; elementId++)
+    for (uint32_t elementId = 0; elementId < surfaceHeap->uiAllocatedHeapElements; elementId++)
     {
-        PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapElmt = &mediaSurfaceHeapBase[elementId];
-        if (nullptr == mediaSurfaceHeapElmt->pSurface)
+        PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapElmt = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(surfaceHeap, elementId);
+        if (nullptr == mediaSurfaceHeapElmt || nullptr == mediaSurfaceHeapElmt->pSurface)
             continue;
 
         DdiMediaUtil_FreeSurface(mediaSurfaceHeapElmt->pSurface);
@@ -740,15 +737,10 @@ static void DdiMedia_FreeBufferHeapElements(VADriverContextP    ctx)
     if (nullptr == bufferHeap)
         return;
 
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapBase = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)bufferHeap->pHeapBase;
-    if (nullptr == mediaBufferHeapBase)
-        return;
-
-    int32_t bufNums = mediaCtx->uiNumBufs;
-    for (int32_t elementId = 0; elementId < bufNums; ++elementId)
+    for (uint32_t elementId = 0; elementId < bufferHeap->uiAllocatedHeapElements; ++elementId)
     {
-        PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapElmt = &mediaBufferHeapBase[elementId];
-        if (nullptr == mediaBufferHeapElmt->pBuffer)
+        PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapElmt = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(bufferHeap, elementId);
+        if (nullptr == mediaBufferHeapElmt || nullptr == mediaBufferHeapElmt->pBuffer)
             continue;
         DdiMedia_DestroyBuffer(ctx,mediaBufferHeapElmt->uiVaBufferID);
     }
@@ -771,15 +763,10 @@ static void DdiMedia_FreeImageHeapElements(VADriverContextP    ctx)
     if (nullptr == imageHeap)
         return;
 
-    PDDI_MEDIA_IMAGE_HEAP_ELEMENT mediaImageHeapBase = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)imageHeap->pHeapBase;
-    if (nullptr == mediaImageHeapBase)
-        return;
-
-    int32_t imageNums = mediaCtx->uiNumImages;
-    for (int32_t elementId = 0; elementId < imageNums; ++elementId)
+    for (uint32_t elementId = 0; elementId < imageHeap->uiAllocatedHeapElements; ++elementId)
     {
-        PDDI_MEDIA_IMAGE_HEAP_ELEMENT mediaImageHeapElmt = &mediaImageHeapBase[elementId];
-        if (nullptr == mediaImageHeapElmt->pImage)
+        PDDI_MEDIA_IMAGE_HEAP_ELEMENT mediaImageHeapElmt = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(imageHeap, elementId);
+        if (nullptr == mediaImageHeapElmt || nullptr == mediaImageHeapElmt->pImage)
             continue;
         DdiMedia_DestroyImage(ctx,mediaImageHeapElmt->uiVaImageID);
     }
@@ -793,16 +780,12 @@ static void DdiMedia_FreeImageHeapElements(VADriverContextP    ctx)
 //! [out] none
 //! \returns
 /////////////////////////////////////////////////////////////////////////////
-static void DdiMedia_FreeContextHeap(VADriverContextP ctx, PDDI_MEDIA_HEAP contextHeap,int32_t vaContextOffset, int32_t ctxNums)
+static void DdiMedia_FreeContextHeap(VADriverContextP ctx, PDDI_MEDIA_HEAP contextHeap,int32_t vaContextOffset)
 {
-    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT mediaContextHeapBase = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)contextHeap->pHeapBase;
-    if (nullptr == mediaContextHeapBase)
-        return;
-
-    for (int32_t elementId = 0; elementId < ctxNums; ++elementId)
+    for (uint32_t elementId = 0; elementId < contextHeap->uiAllocatedHeapElements; ++elementId)
     {
-        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT mediaContextHeapElmt = &mediaContextHeapBase[elementId];
-        if (nullptr == mediaContextHeapElmt->pVaContext)
+        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT mediaContextHeapElmt = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(contextHeap, elementId);
+        if (nullptr == mediaContextHeapElmt || nullptr == mediaContextHeapElmt->pVaContext)
             continue;
         VAContextID vaCtxID = (VAContextID)(mediaContextHeapElmt->uiVaContextID + vaContextOffset);
         DdiMedia_DestroyContext(ctx,vaCtxID);
@@ -825,27 +808,23 @@ static void DdiMedia_FreeContextHeapElements(VADriverContextP    ctx)
 
     //Free EncoderContext
     PDDI_MEDIA_HEAP encoderContextHeap = mediaCtx->pEncoderCtxHeap;
-    int32_t encCtxNums        = mediaCtx->uiNumEncoders;
     if (nullptr != encoderContextHeap)
-        DdiMedia_FreeContextHeap(ctx,encoderContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_ENCODER,encCtxNums);
+        DdiMedia_FreeContextHeap(ctx,encoderContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_ENCODER);
 
     //Free DecoderContext
     PDDI_MEDIA_HEAP decoderContextHeap = mediaCtx->pDecoderCtxHeap;
-    int32_t decCtxNums        = mediaCtx->uiNumDecoders;
     if (nullptr != decoderContextHeap)
-        DdiMedia_FreeContextHeap(ctx,decoderContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_DECODER,decCtxNums);
+        DdiMedia_FreeContextHeap(ctx,decoderContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_DECODER);
 
     //Free VpContext
     PDDI_MEDIA_HEAP vpContextHeap      = mediaCtx->pVpCtxHeap;
-    int32_t vpctxNums         = mediaCtx->uiNumVPs;
     if (nullptr != vpContextHeap)
-        DdiMedia_FreeContextHeap(ctx,vpContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_VP,vpctxNums);
+        DdiMedia_FreeContextHeap(ctx,vpContextHeap,DDI_MEDIA_VACONTEXTID_OFFSET_VP);
 
     //Free MfeContext
     PDDI_MEDIA_HEAP mfeContextHeap     = mediaCtx->pMfeCtxHeap;
-    int32_t mfeCtxNums        = mediaCtx->uiNumMfes;
     if (nullptr != mfeContextHeap)
-        DdiMedia_FreeContextHeap(ctx, mfeContextHeap, DDI_MEDIA_VACONTEXTID_OFFSET_MFE, mfeCtxNums);
+        DdiMedia_FreeContextHeap(ctx, mfeContextHeap, DDI_MEDIA_VACONTEXTID_OFFSET_MFE);
 
     // Free media memory decompression data structure
     if (mediaCtx->pMediaMemDecompState)
@@ -870,10 +849,16 @@ static void DdiMedia_FreeContextCMElements(VADriverContextP ctx)
     if (nullptr == mediaCtx)
         return;
 
-    int32_t cmnums = mediaCtx->uiNumCMs;
-    for (int32_t elementId = 0; elementId < cmnums; elementId++)
+    PDDI_MEDIA_HEAP cmContextHeap = mediaCtx->pCmCtxHeap;
+    if (nullptr == cmContextHeap)
+        return;
+
+    for (uint32_t elementId = 0; elementId < cmContextHeap->uiAllocatedHeapElements; elementId++)
     {
-        VAContextID vaCtxID = elementId + DDI_MEDIA_VACONTEXTID_OFFSET_CM;
+        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT cmContextHeapElmt = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(cmContextHeap, elementId);
+        if (nullptr == cmContextHeapElmt || nullptr == cmContextHeapElmt->pVaContext)
+            continue;
+        VAContextID vaCtxID = cmContextHeapElmt->uiVaContextID + DDI_MEDIA_VACONTEXTID_OFFSET_CM;
         DdiDestroyContextCM(ctx,vaCtxID);
     }
 }
@@ -892,12 +877,9 @@ static void DdiMedia_FreeContextCMElements(VADriverContextP ctx)
 VAImage* DdiMedia_GetVAImageFromVAImageID (PDDI_MEDIA_CONTEXT mediaCtx, VAImageID imageID)
 {
     uint32_t i       = (uint32_t)imageID;
-    DDI_CHK_LESS(i, mediaCtx->pImageHeap->uiAllocatedHeapElements, "invalid image id", nullptr);
-    DdiMediaUtil_LockMutex(&mediaCtx->ImageMutex);
-    PDDI_MEDIA_IMAGE_HEAP_ELEMENT imageElement = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)mediaCtx->pImageHeap->pHeapBase;
-    imageElement    += i;
+    PDDI_MEDIA_IMAGE_HEAP_ELEMENT imageElement = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaCtx->pImageHeap, i);
+    DDI_CHK_NULL(imageElement, "invalid image id", nullptr);
     VAImage *vaImage = imageElement->pImage;
-    DdiMediaUtil_UnLockMutex(&mediaCtx->ImageMutex);
 
     return vaImage;
 }
@@ -916,12 +898,9 @@ VAImage* DdiMedia_GetVAImageFromVAImageID (PDDI_MEDIA_CONTEXT mediaCtx, VAImageI
 void* DdiMedia_GetCtxFromVABufferID (PDDI_MEDIA_CONTEXT mediaCtx, VABufferID bufferID)
 {
     uint32_t i      = (uint32_t)bufferID;
-    DDI_CHK_LESS(i, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "invalid buffer id", nullptr);
-    DdiMediaUtil_LockMutex(&mediaCtx->BufferMutex);
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)mediaCtx->pBufferHeap->pHeapBase;
-    bufHeapElement += i;
+    PDDI_MEDIA_BUFFER_HEAP_ELEMENT bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaCtx->pBufferHeap, i);
+    DDI_CHK_NULL(bufHeapElement, "invalid buffer id", nullptr);
     void *temp      = bufHeapElement->pCtx;
-    DdiMediaUtil_UnLockMutex(&mediaCtx->BufferMutex);
 
     return temp;
 }
@@ -940,12 +919,9 @@ void* DdiMedia_GetCtxFromVABufferID (PDDI_MEDIA_CONTEXT mediaCtx, VABufferID buf
 uint32_t DdiMedia_GetCtxTypeFromVABufferID (PDDI_MEDIA_CONTEXT mediaCtx, VABufferID bufferID)
 {
     uint32_t i       = (uint32_t)bufferID;
-    DDI_CHK_LESS(i, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "invalid buffer id", DDI_MEDIA_CONTEXT_TYPE_NONE);
-    DdiMediaUtil_LockMutex(&mediaCtx->BufferMutex);
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)mediaCtx->pBufferHeap->pHeapBase;
-    bufHeapElement  += i;
+    PDDI_MEDIA_BUFFER_HEAP_ELEMENT bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaCtx->pBufferHeap, i);
+    DDI_CHK_NULL(bufHeapElement, "invalid buffer id", DDI_MEDIA_CONTEXT_TYPE_NONE);
     uint32_t ctxType = bufHeapElement->uiCtxType;
-    DdiMediaUtil_UnLockMutex(&mediaCtx->BufferMutex);
 
     return ctxType;
 
@@ -1058,6 +1034,7 @@ void FreeForMediaContext(PDDI_MEDIA_CONTEXT mediaCtx)
         mediaCtx->SkuTable.reset();
         mediaCtx->WaTable.reset();
         MOS_FreeMemory(mediaCtx->pSurfaceHeap);
+        MOS_Delete(mediaCtx->pSurfaceBoMap);
         MOS_FreeMemory(mediaCtx->pBufferHeap);
         MOS_FreeMemory(mediaCtx->pImageHeap);
         MOS_FreeMemory(mediaCtx->pDecoderCtxHeap);
@@ -1158,6 +1135,13 @@ VAStatus DdiMedia__Initialize (
     }
     mediaCtx->pSurfaceHeap->uiHeapElementSize      = sizeof(DDI_MEDIA_SURFACE_HEAP_ELEMENT);
 
+    mediaCtx->pSurfaceBoMap                        = MOS_New(DDI_MEDIA_SURFACE_BO_MAP);
+    if (nullptr == mediaCtx->pSurfaceBoMap)
+    {
+        FreeForMediaContext(mediaCtx);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
     mediaCtx->pBufferHeap                          = (DDI_MEDIA_HEAP *)MOS_AllocAndZeroMemory(sizeof(DDI_MEDIA_HEAP));
     if (nullptr == mediaCtx->pBufferHeap)
     {
@@ -1232,6 +1216,25 @@ VAStatus DdiMedia__Initialize (
     }
     mos_bufmgr_gem_enable_reuse(mediaCtx->pDrmBufMgr);
 
+    MOS_USER_FEATURE_VALUE_DATA userFeatureData;
+    MOS_ZeroMemory(&userFeatureData, sizeof(userFeatureData));
+    MOS_UserFeature_ReadValue_ID(
+        nullptr,
+        __MEDIA_USER_FEATURE_VALUE_BO_CACHE_LIMIT_ID,
+        &userFeatureData);
+    mos_bufmgr_gem_set_cache_limit(mediaCtx->pDrmBufMgr, (uint64_t)userFeatureData.u32Data * 1024 * 1024);
+
+    MOS_ZeroMemory(&userFeatureData, sizeof(userFeatureData));
+    MOS_UserFeature_ReadValue_ID(
+        nullptr,
+        __MEDIA_USER_FEATURE_VALUE_ENABLE_SOFTPIN_ID,
+        &userFeatureData);
+    if (userFeatureData.i32Data &&
+        !mos_bufmgr_gem_enable_softpin(mediaCtx->pDrmBufMgr))
+    {
+        DDI_NORMALMESSAGE("DDI: softpin is not supported by the kernel, using relocations");
+    }
+
     //Latency reducation:replace HWGetDeviceID to get device using ioctl from drm.
     mediaCtx->iDeviceId = mos_bufmgr_gem_get_devid(mediaCtx->pDrmBufMgr);
 
@@ -1288,6 +1291,9 @@ VAStatus DdiMedia__Initialize (
     DdiMediaUtil_InitMutex(&mediaCtx->VpMutex);
     DdiMediaUtil_InitMutex(&mediaCtx->CmMutex);
     DdiMediaUtil_InitMutex(&mediaCtx->MfeMutex);
+
+    // Images are copied on the CPU if the GPU copy engine cannot be allocated
+    DdiMediaCopy_InitGpuCopy(mediaCtx);
 #ifndef ANDROID
     DdiMediaUtil_InitMutex(&mediaCtx->PutSurfaceRenderMutex);
     DdiMediaUtil_InitMutex(&mediaCtx->PutSurfaceSwapBufferMutex);
@@ -1429,6 +1435,9 @@ static VAStatus DdiMedia_Terminate (
 
     DdiMediaUtil_LockMutex(&GlobalMutex);
 
+    // finish the image copies before their CM device and GPU context go away
+    DdiMediaCopy_ReleaseGpuCopy(ctx);
+
     if (mediaCtx->modularizedGpuCtxEnabled)
     {
         mediaCtx->m_gpuContextMgr->CleanUp();
@@ -1473,32 +1482,53 @@ static VAStatus DdiMedia_Terminate (
 
     mediaCtx->SkuTable.reset();
     mediaCtx->WaTable.reset();
+
+    // report buffer object reuse cache and validation list statistics
+    MOS_USER_FEATURE_VALUE_WRITE_DATA userFeatureWriteData[6];
+    MOS_ZeroMemory(userFeatureWriteData, sizeof(userFeatureWriteData));
+    userFeatureWriteData[0].ValueID = __MEDIA_USER_FEATURE_VALUE_BO_CACHE_HITS_ID;
+    userFeatureWriteData[1].ValueID = __MEDIA_USER_FEATURE_VALUE_BO_CACHE_MISSES_ID;
+    userFeatureWriteData[2].ValueID = __MEDIA_USER_FEATURE_VALUE_BO_CACHE_EVICTIONS_ID;
+    userFeatureWriteData[3].ValueID = __MEDIA_USER_FEATURE_VALUE_EXEC_COUNT_ID;
+    userFeatureWriteData[4].ValueID = __MEDIA_USER_FEATURE_VALUE_EXEC_UNCHANGED_LISTS_ID;
+    userFeatureWriteData[5].ValueID = __MEDIA_USER_FEATURE_VALUE_EXEC_REUSED_BOS_ID;
+    mos_bufmgr_gem_get_cache_stats(mediaCtx->pDrmBufMgr,
+                                   &userFeatureWriteData[0].Value.u64Data,
+                                   &userFeatureWriteData[1].Value.u64Data,
+                                   &userFeatureWriteData[2].Value.u64Data);
+    mos_bufmgr_gem_get_exec_stats(mediaCtx->pDrmBufMgr,
+                                  &userFeatureWriteData[3].Value.u64Data,
+                                  &userFeatureWriteData[4].Value.u64Data,
+                                  &userFeatureWriteData[5].Value.u64Data);
+    MOS_UserFeature_WriteValues_ID(nullptr, userFeatureWriteData, 6);
+
     // destroy libdrm buffer manager
     mos_bufmgr_destroy(mediaCtx->pDrmBufMgr);
 
     // destroy heaps
-    MOS_FreeMemory(mediaCtx->pSurfaceHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pSurfaceHeap);
     MOS_FreeMemory(mediaCtx->pSurfaceHeap);
+    MOS_Delete(mediaCtx->pSurfaceBoMap);
 
-    MOS_FreeMemory(mediaCtx->pBufferHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pBufferHeap);
     MOS_FreeMemory(mediaCtx->pBufferHeap);
 
-    MOS_FreeMemory(mediaCtx->pImageHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pImageHeap);
     MOS_FreeMemory(mediaCtx->pImageHeap);
 
-    MOS_FreeMemory(mediaCtx->pDecoderCtxHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pDecoderCtxHeap);
     MOS_FreeMemory(mediaCtx->pDecoderCtxHeap);
 
-    MOS_FreeMemory(mediaCtx->pEncoderCtxHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pEncoderCtxHeap);
     MOS_FreeMemory(mediaCtx->pEncoderCtxHeap);
 
-    MOS_FreeMemory(mediaCtx->pVpCtxHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pVpCtxHeap);
     MOS_FreeMemory(mediaCtx->pVpCtxHeap);
 
-    MOS_FreeMemory(mediaCtx->pCmCtxHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pCmCtxHeap);
     MOS_FreeMemory(mediaCtx->pCmCtxHeap);
 
-    MOS_FreeMemory(mediaCtx->pMfeCtxHeap->pHeapBase);
+    DdiMediaUtil_DestroyHeapChunks(mediaCtx->pMfeCtxHeap);
     MOS_FreeMemory(mediaCtx->pMfeCtxHeap);
 
     // Destroy memory allocated to store Media System Info
@@ -1792,7 +1822,7 @@ static VAStatus DdiMedia_DestroySurfaces (
     PDDI_MEDIA_SURFACE surface = nullptr;
     for(int32_t i = 0; i < num_surfaces; i++)
     {
-        DDI_CHK_LESS((uint32_t)surfaces[i], mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
+        DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surfaces[i]), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
         surface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surfaces[i]);
         DDI_CHK_NULL(surface, "nullptr surface", VA_STATUS_ERROR_INVALID_SURFACE);
         if(surface->pCurrentFrameSemaphore)
@@ -1805,11 +1835,12 @@ static VAStatus DdiMedia_DestroySurfaces (
             DdiMediaUtil_WaitSemaphore(surface->pReferenceFrameSemaphore);
             DdiMediaUtil_PostSemaphore(surface->pReferenceFrameSemaphore);
         }
+        DdiMediaCopy_WaitSurface(mediaCtx, surface);
     }
 
     for(int32_t i = 0; i < num_surfaces; i++)
     {
-        DDI_CHK_LESS((uint32_t)surfaces[i], mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
+        DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surfaces[i]), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
         surface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surfaces[i]);
         DDI_CHK_NULL(surface, "nullptr surface", VA_STATUS_ERROR_INVALID_SURFACE);
         if(surface->pCurrentFrameSemaphore)
@@ -1826,6 +1857,18 @@ static VAStatus DdiMedia_DestroySurfaces (
 
         DdiMediaUtil_UnRegisterRTSurfaces(ctx, surface);
 
+        DdiMediaUtil_LockMutex(&mediaCtx->SurfaceMutex);
+        auto range = mediaCtx->pSurfaceBoMap->equal_range(surface->bo);
+        for (auto it = range.first; it != range.second; it++)
+        {
+            if (it->second == surface)
+            {
+                mediaCtx->pSurfaceBoMap->erase(it);
+                break;
+            }
+        }
+        DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
+
         DdiMediaUtil_FreeSurface(surface);
         MOS_FreeMemory(surface);
         DdiMediaUtil_LockMutex(&mediaCtx->SurfaceMutex);
@@ -2298,7 +2341,7 @@ static VAStatus DdiMedia_CreateContext (
         for(int32_t i = 0; i < num_render_targets; i++)
         {
             uint32_t surfaceId = (uint32_t)render_targets[i];
-            DDI_CHK_LESS(surfaceId, mediaDrvCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid Surface", VA_STATUS_ERROR_INVALID_SURFACE);
+            DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surfaceId), mediaDrvCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid Surface", VA_STATUS_ERROR_INVALID_SURFACE);
         }
     }
 
@@ -2420,7 +2463,7 @@ static VAStatus DdiMedia_BufferSetNumElements (
     DDI_CHK_NULL(mediaCtx,              "nullptr mediaCtx",              VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_CHK_NULL(mediaCtx->pBufferHeap, "nullptr mediaCtx->pBufferHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)buf_id, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buf_id), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
 
     DDI_MEDIA_BUFFER *buf       = DdiMedia_GetBufferFromVABufferID(mediaCtx, buf_id);
     DDI_CHK_NULL(buf, "Invalid buffer.", VA_STATUS_ERROR_INVALID_BUFFER);
@@ -2477,7 +2520,7 @@ VAStatus DdiMedia_MapBufferInternal (
     DDI_CHK_NULL(mediaCtx,              "nullptr mediaCtx",              VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_CHK_NULL(mediaCtx->pBufferHeap, "nullptr mediaCtx->pBufferHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)buf_id, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid bufferId", VA_STATUS_ERROR_INVALID_CONTEXT);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buf_id), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid bufferId", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_MEDIA_BUFFER   *buf     = DdiMedia_GetBufferFromVABufferID(mediaCtx, buf_id);
     DDI_CHK_NULL(buf, "nullptr buf", VA_STATUS_ERROR_INVALID_BUFFER);
@@ -2707,6 +2750,11 @@ VAStatus DdiMedia_MapBufferInternal (
             break;
 
         case VAImageBufferType:
+            // vaGetImage/vaPutImage may still copy from or to the image on the GPU
+            DdiMediaCopy_WaitBuffer(mediaCtx, buf);
+            *pbuf = (void *)(buf->pData + buf->uiOffset);
+            break;
+
         default:
             *pbuf = (void *)(buf->pData + buf->uiOffset);
             break;
@@ -2742,7 +2790,7 @@ VAStatus DdiMedia_UnmapBuffer (
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_CHK_NULL( mediaCtx->pBufferHeap, "nullptr  mediaCtx->pBufferHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)buf_id, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buf_id), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
 
     DDI_MEDIA_BUFFER   *buf     = DdiMedia_GetBufferFromVABufferID(mediaCtx,  buf_id);
     DDI_CHK_NULL(buf, "nullptr buf", VA_STATUS_ERROR_INVALID_BUFFER);
@@ -2847,7 +2895,7 @@ VAStatus DdiMedia_DestroyBuffer (
     DDI_CHK_NULL(mediaCtx,              "nullptr mediaCtx",              VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_CHK_NULL(mediaCtx->pBufferHeap, "nullptr mediaCtx->pBufferHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)buffer_id, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid bufferId", VA_STATUS_ERROR_INVALID_CONTEXT);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buffer_id), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid bufferId", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_MEDIA_BUFFER   *buf     = DdiMedia_GetBufferFromVABufferID(mediaCtx,  buffer_id);
     DDI_CHK_NULL(buf, "nullptr buf", VA_STATUS_ERROR_INVALID_BUFFER);
@@ -2897,6 +2945,7 @@ VAStatus DdiMedia_DestroyBuffer (
         case VAPictureParameterBufferType:
             break;
         case VAImageBufferType:
+            DdiMediaCopy_WaitBuffer(mediaCtx, buf);
             MOS_FreeMemory(buf->pData);
             break;
         case VAProcPipelineParameterBufferType:
@@ -3029,7 +3078,7 @@ static VAStatus DdiMedia_BeginPicture (
 
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)render_target, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "render_target", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(render_target), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "render_target", VA_STATUS_ERROR_INVALID_SURFACE);
 
     uint32_t ctxType = DDI_MEDIA_CONTEXT_TYPE_NONE;
     void     *ctxPtr = DdiMedia_GetContextFromContextID(ctx, context, &ctxType);
@@ -3085,7 +3134,7 @@ static VAStatus DdiMedia_RenderPicture (
 
     for(int32_t i = 0; i < num_buffers; i++)
     {
-       DDI_CHK_LESS((uint32_t)buffers[i], mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid Buffer", VA_STATUS_ERROR_INVALID_BUFFER);
+       DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buffers[i]), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid Buffer", VA_STATUS_ERROR_INVALID_BUFFER);
     }
 
     uint32_t ctxType = DDI_MEDIA_CONTEXT_TYPE_NONE;
@@ -3140,42 +3189,53 @@ static VAStatus DdiMedia_EndPicture (
     }
 }
 
-/*
- * This function blocks until all pending operations on the render target
- * have been completed.  Upon return it is safe to use the render target for a
- * different picture.
- */
-static VAStatus DdiMedia_SyncSurface (
-    VADriverContextP    ctx,
-    VASurfaceID         render_target
-)
+//!
+//! \brief  Check whether a decode status buffer slot reports on a surface bo
+//!
+//! \param  [in] decoder
+//!         Pointer to the decoder
+//! \param  [in] decodeStatusBuf
+//!         Pointer to the decoder's status buffer
+//! \param  [in] index
+//!         Slot in the status buffer
+//! \param  [in] bo
+//!         Surface bo
+//!
+//! \return bool
+//!     true if the slot holds the report for bo
+//!
+static bool DdiMedia_IsDecodeStatusForSurface(
+    CodechalDecode             *decoder,
+    CodechalDecodeStatusBuffer *decodeStatusBuf,
+    uint32_t                    index,
+    MOS_LINUX_BO               *bo)
 {
-    DDI_FUNCTION_ENTER();
-
-    DDI_CHK_NULL(ctx,    "nullptr ctx",    VA_STATUS_ERROR_INVALID_CONTEXT);
-
-    PDDI_MEDIA_CONTEXT mediaCtx = DdiMedia_GetMediaContext(ctx);
-    DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-
-    DDI_CHK_LESS((uint32_t)render_target, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid render_target", VA_STATUS_ERROR_INVALID_SURFACE);
-
-    DDI_MEDIA_SURFACE  *surface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, render_target);
-    DDI_CHK_NULL(surface,    "nullptr surface",      VA_STATUS_ERROR_INVALID_CONTEXT);
-    if (surface->pCurrentFrameSemaphore)
-    {
-        DdiMediaUtil_WaitSemaphore(surface->pCurrentFrameSemaphore);
-        DdiMediaUtil_PostSemaphore(surface->pCurrentFrameSemaphore);
-    }
-
-    // check the bo here?
-    // zero is a expected return value
-    uint32_t timeout_NS = 100000000;
-    while (0 != mos_gem_bo_wait(surface->bo, timeout_NS))
-    {
-        // Just loop while gem_bo_wait times-out.
-    }
+    CodechalDecodeStatusReport *report = &decodeStatusBuf->m_decodeStatus[index].m_decodeStatusReport;
+    return (report->m_currDecodedPicRes.bo == bo) ||
+           (decoder->GetStandard() == CODECHAL_VC1 && report->m_deblockedPicResOlp.bo == bo);
+}
 
+//!
+//! \brief  Collect the status reports completed up to a surface and return its status
+//! \details Called once the surface bo is idle. All reports up to the one of the
+//!          surface are moved into their surfaces under a single SurfaceMutex hold.
+//!
+//! \param  [in] mediaCtx
+//!         Pointer to media context
+//! \param  [in] surface
+//!         Pointer to the surface
+//! \param  [in] surfaceId
+//!         VA surface ID of the surface
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if the surface was processed without error
+//!
+static VAStatus DdiMedia_StatusCheck (
+    PDDI_MEDIA_CONTEXT  mediaCtx,
+    DDI_MEDIA_SURFACE  *surface,
+    VASurfaceID         surfaceId
+)
+{
     int32_t i = 0;
     PDDI_DECODE_CONTEXT decCtx = (PDDI_DECODE_CONTEXT)surface->pDecCtx;
     if (decCtx && surface->curCtxType == DDI_MEDIA_CONTEXT_TYPE_DECODER)
@@ -3195,13 +3255,19 @@ static VAStatus DdiMedia_SyncSurface (
                 DDI_CHK_CONDITION((uNumAvailableReport == 0),
                     "No report available at all", VA_STATUS_ERROR_OPERATION_FAILED);
 
-                for (i = 0; i < uNumAvailableReport; i++)
+                // Go straight to the slot recorded at EndPicture, and only scan
+                // the ring if it has been reused for another surface since.
+                i = (surface->decodeStatusIndex - decodeStatusBuf->m_firstIndex) & (CODECHAL_DECODE_STATUS_NUM - 1);
+                if (i >= uNumAvailableReport ||
+                    !DdiMedia_IsDecodeStatusForSurface(decoder, decodeStatusBuf, surface->decodeStatusIndex, surface->bo))
                 {
-                    int32_t index = (decodeStatusBuf->m_firstIndex + i) & (CODECHAL_DECODE_STATUS_NUM - 1);
-                    if ((decodeStatusBuf->m_decodeStatus[index].m_decodeStatusReport.m_currDecodedPicRes.bo == surface->bo) ||
-                        (decoder->GetStandard() == CODECHAL_VC1 && decodeStatusBuf->m_decodeStatus[index].m_decodeStatusReport.m_deblockedPicResOlp.bo == surface->bo))
+                    for (i = 0; i < uNumAvailableReport; i++)
                     {
-                        break;
+                        int32_t index = (decodeStatusBuf->m_firstIndex + i) & (CODECHAL_DECODE_STATUS_NUM - 1);
+                        if (DdiMedia_IsDecodeStatusForSurface(decoder, decodeStatusBuf, index, surface->bo))
+                        {
+                            break;
+                        }
                     }
                 }
 
@@ -3210,12 +3276,18 @@ static VAStatus DdiMedia_SyncSurface (
 
                 uint32_t uNumCompletedReport = i+1;
 
+                DdiMediaUtil_LockMutex(&mediaCtx->SurfaceMutex);
                 for (i = 0; i < uNumCompletedReport; i++)
                 {
                     CodechalDecodeStatusReport tempNewReport;
                     MOS_ZeroMemory(&tempNewReport, sizeof(CodechalDecodeStatusReport));
                     MOS_STATUS eStatus = decoder->GetStatusReport(&tempNewReport, 1);
-                    DDI_CHK_CONDITION(MOS_STATUS_SUCCESS != eStatus, "Get status report fail", VA_STATUS_ERROR_OPERATION_FAILED);
+                    if (MOS_STATUS_SUCCESS != eStatus)
+                    {
+                        DDI_ASSERTMESSAGE("Get status report fail");
+                        DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
+                        return VA_STATUS_ERROR_OPERATION_FAILED;
+                    }
 
                     MOS_LINUX_BO *bo = tempNewReport.m_currDecodedPicRes.bo;
 
@@ -3226,37 +3298,30 @@ static VAStatus DdiMedia_SyncSurface (
 
                     if ((tempNewReport.m_codecStatus == CODECHAL_STATUS_SUCCESSFUL) || (tempNewReport.m_codecStatus == CODECHAL_STATUS_ERROR) || (tempNewReport.m_codecStatus == CODECHAL_STATUS_INCOMPLETE))
                     {
-                        DdiMediaUtil_LockMutex(&mediaCtx->SurfaceMutex);
-                        PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapElmt = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)mediaCtx->pSurfaceHeap->pHeapBase;
-
-                        int32_t j = 0;
-                        for (j = 0; j < mediaCtx->pSurfaceHeap->uiAllocatedHeapElements; j++, mediaSurfaceHeapElmt++)
+                        auto range = mediaCtx->pSurfaceBoMap->equal_range(bo);
+                        if (range.first == range.second)
                         {
-                            if (mediaSurfaceHeapElmt != nullptr &&
-                                    mediaSurfaceHeapElmt->pSurface != nullptr &&
-                                    bo == mediaSurfaceHeapElmt->pSurface->bo)
-                            {
-                                mediaSurfaceHeapElmt->pSurface->curStatusReport.decode.status = (uint32_t)tempNewReport.m_codecStatus;
-                                mediaSurfaceHeapElmt->pSurface->curStatusReport.decode.errMbNum = (uint32_t)tempNewReport.m_numMbsAffected;
-                                mediaSurfaceHeapElmt->pSurface->curStatusReport.decode.crcValue = (decoder->GetStandard() == CODECHAL_AVC)?(uint32_t)tempNewReport.m_frameCrc:0;
-                                mediaSurfaceHeapElmt->pSurface->curStatusReportQueryState = DDI_MEDIA_STATUS_REPORT_QUREY_STATE_COMPLETED;
-                                break;
-                            }
+                            DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
+                            return VA_STATUS_ERROR_OPERATION_FAILED;
                         }
 
-                        if (j == mediaCtx->pSurfaceHeap->uiAllocatedHeapElements)
+                        for (auto it = range.first; it != range.second; it++)
                         {
-                            DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
-                            return VA_STATUS_ERROR_OPERATION_FAILED;
+                            PDDI_MEDIA_SURFACE reportSurface = it->second;
+                            reportSurface->curStatusReport.decode.status = (uint32_t)tempNewReport.m_codecStatus;
+                            reportSurface->curStatusReport.decode.errMbNum = (uint32_t)tempNewReport.m_numMbsAffected;
+                            reportSurface->curStatusReport.decode.crcValue = (decoder->GetStandard() == CODECHAL_AVC)?(uint32_t)tempNewReport.m_frameCrc:0;
+                            reportSurface->curStatusReportQueryState = DDI_MEDIA_STATUS_REPORT_QUREY_STATE_COMPLETED;
                         }
-                        DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
                     }
                     else
                     {
                         // return failed if queried INCOMPLETE or UNAVAILABLE report.
+                        DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
                         return VA_STATUS_ERROR_OPERATION_FAILED;
                     }
                 }
+                DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
             }
 
             // check the report ptr of current surface.
@@ -3311,7 +3376,7 @@ static VAStatus DdiMedia_SyncSurface (
                 tempSurface->curStatusReport.vpp.status = (uint32_t)tempVpReport.dwStatus;
                 tempSurface->curStatusReportQueryState  = DDI_MEDIA_STATUS_REPORT_QUREY_STATE_COMPLETED;
 
-                if(tempVpReport.StatusFeedBackID == render_target)
+                if(tempVpReport.StatusFeedBackID == surfaceId)
                 {
                     break;
                 }
@@ -3342,6 +3407,100 @@ static VAStatus DdiMedia_SyncSurface (
     return VA_STATUS_SUCCESS;
 }
 
+
+//!
+//! \brief  Wait for the render target and collect its status
+//!
+//! \param  [in] ctx
+//!         Pointer to VA driver context
+//! \param  [in] surfaceId
+//!         VA surface ID
+//! \param  [in] timeoutNs
+//!         Time to wait for the GPU in ns, UINT64_MAX (VA_TIMEOUT_INFINITE) waits until it is idle
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, VA_STATUS_ERROR_TIMEDOUT if the surface is still in use
+//!
+static VAStatus DdiMedia_SyncSurfaceWithTimeout (
+    VADriverContextP    ctx,
+    VASurfaceID         surfaceId,
+    uint64_t            timeoutNs
+)
+{
+    DDI_CHK_NULL(ctx,    "nullptr ctx",    VA_STATUS_ERROR_INVALID_CONTEXT);
+
+    PDDI_MEDIA_CONTEXT mediaCtx = DdiMedia_GetMediaContext(ctx);
+    DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
+    DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
+
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surfaceId), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaceId", VA_STATUS_ERROR_INVALID_SURFACE);
+
+    DDI_MEDIA_SURFACE  *surface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surfaceId);
+    DDI_CHK_NULL(surface,    "nullptr surface",      VA_STATUS_ERROR_INVALID_CONTEXT);
+    if (surface->pCurrentFrameSemaphore)
+    {
+        DdiMediaUtil_WaitSemaphore(surface->pCurrentFrameSemaphore);
+        DdiMediaUtil_PostSemaphore(surface->pCurrentFrameSemaphore);
+    }
+
+    if (timeoutNs == UINT64_MAX)
+    {
+        // zero is a expected return value
+        uint32_t timeout_NS = 100000000;
+        while (0 != mos_gem_bo_wait(surface->bo, timeout_NS))
+        {
+            // Just loop while gem_bo_wait times-out.
+        }
+    }
+    else
+    {
+        // The kernel takes a signed timeout, a negative one would wait forever
+        int64_t timeout = (timeoutNs > (uint64_t)INT64_MAX) ? INT64_MAX : (int64_t)timeoutNs;
+        if (0 != mos_gem_bo_wait(surface->bo, timeout))
+        {
+            DDI_NORMALMESSAGE("vaSyncSurface2: surface is still in use by the GPU");
+            return VA_STATUS_ERROR_TIMEDOUT;
+        }
+    }
+
+    // an image copied in by vaPutImage is written once the bo is idle, release its copy task
+    DdiMediaCopy_WaitSurface(mediaCtx, surface);
+
+    return DdiMedia_StatusCheck(mediaCtx, surface, surfaceId);
+}
+
+/*
+ * This function blocks until all pending operations on the render target
+ * have been completed.  Upon return it is safe to use the render target for a
+ * different picture.
+ */
+static VAStatus DdiMedia_SyncSurface (
+    VADriverContextP    ctx,
+    VASurfaceID         render_target
+)
+{
+    DDI_FUNCTION_ENTER();
+
+    return DdiMedia_SyncSurfaceWithTimeout(ctx, render_target, UINT64_MAX);
+}
+
+#if VA_CHECK_VERSION(1, 9, 0)
+/*
+ * Like vaSyncSurface, but gives up with VA_STATUS_ERROR_TIMEDOUT if the
+ * render target is still in use by the GPU after timeout_ns.
+ */
+static VAStatus DdiMedia_SyncSurface2 (
+    VADriverContextP    ctx,
+    VASurfaceID         surface_id,
+    uint64_t            timeout_ns
+)
+{
+    DDI_FUNCTION_ENTER();
+
+    return DdiMedia_SyncSurfaceWithTimeout(ctx, surface_id, timeout_ns);
+}
+#endif
+
 /*
  * Find out any pending ops on the render target
  */
@@ -3360,7 +3519,7 @@ static VAStatus DdiMedia_QuerySurfaceStatus (
     DDI_CHK_NULL(mediaCtx,                  "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap,    "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    DDI_CHK_LESS((uint32_t)render_target, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid render_target", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(render_target), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid render_target", VA_STATUS_ERROR_INVALID_SURFACE);
     DDI_MEDIA_SURFACE *surface   = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, render_target);
     DDI_CHK_NULL(surface,    "nullptr surface",    VA_STATUS_ERROR_INVALID_SURFACE);
 
@@ -3541,12 +3700,13 @@ static VAStatus DdiMedia_PutSurface(
     DDI_CHK_NULL(mediaDrvCtx,               "nullptr mediaDrvCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaDrvCtx->pSurfaceHeap, "nullptr mediaDrvCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
 
-    DDI_CHK_LESS((uint32_t)surface, mediaDrvCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaDrvCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
 
-    if (nullptr != mediaDrvCtx->pVpCtxHeap->pHeapBase)
+    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vpCtxHeapElmt = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(mediaDrvCtx->pVpCtxHeap, 0);
+    if (nullptr != vpCtxHeapElmt)
     {
         uint32_t ctxType = DDI_MEDIA_CONTEXT_TYPE_NONE;
-        vpCtx = DdiMedia_GetContextFromContextID(ctx, (VAContextID)(0 + DDI_MEDIA_VACONTEXTID_OFFSET_VP), &ctxType);
+        vpCtx = DdiMedia_GetContextFromContextID(ctx, (VAContextID)(vpCtxHeapElmt->uiVaContextID + DDI_MEDIA_VACONTEXTID_OFFSET_VP), &ctxType);
     }
 
 #ifndef ANDROID
@@ -3844,7 +4004,7 @@ VAStatus DdiMedia_DeriveImage (
     DDI_CHK_NULL(mediaCtx, "nullptr mediaCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
 
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
 
     DDI_MEDIA_SURFACE *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surface);
     DDI_CHK_NULL(mediaSurface, "nullptr mediaSurface", VA_STATUS_ERROR_INVALID_SURFACE);
@@ -4080,7 +4240,7 @@ VAStatus DdiMedia_DestroyImage (
 
     DDI_CHK_NULL(mediaCtx,             "nullptr Media",                        VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pImageHeap, "nullptr mediaCtx->pImageHeap",        VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)image, mediaCtx->pImageHeap->uiAllocatedHeapElements, "Invalid image", VA_STATUS_ERROR_INVALID_IMAGE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(image), mediaCtx->pImageHeap->uiAllocatedHeapElements, "Invalid image", VA_STATUS_ERROR_INVALID_IMAGE);
 
     VAImage *vaImage = DdiMedia_GetVAImageFromVAImageID(mediaCtx, image);
     if (vaImage == nullptr)
@@ -4153,11 +4313,6 @@ VAStatus DdiMedia_GetImage(
     VAImageID        image
 )
 {
-    DDI_UNUSED(x);
-    DDI_UNUSED(y);
-    DDI_UNUSED(width);
-    DDI_UNUSED(height);
-
     DDI_FUNCTION_ENTER();
 
     DDI_CHK_NULL(ctx,                     "nullptr ctx.",                    VA_STATUS_ERROR_INVALID_CONTEXT);
@@ -4165,9 +4320,9 @@ VAStatus DdiMedia_GetImage(
     PDDI_MEDIA_CONTEXT mediaCtx       = DdiMedia_GetMediaContext(ctx);
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx.",              VA_STATUS_ERROR_INVALID_PARAMETER);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap",   VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
     DDI_CHK_NULL(mediaCtx->pImageHeap,   "nullptr mediaCtx->pImageHeap",     VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)image,   mediaCtx->pImageHeap->uiAllocatedHeapElements,   "Invalid image",   VA_STATUS_ERROR_INVALID_IMAGE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(image),   mediaCtx->pImageHeap->uiAllocatedHeapElements,   "Invalid image",   VA_STATUS_ERROR_INVALID_IMAGE);
 
     DDI_MEDIA_SURFACE *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surface);
     DDI_CHK_NULL(mediaSurface,     "nullptr mediaSurface.",      VA_STATUS_ERROR_INVALID_PARAMETER);
@@ -4190,34 +4345,52 @@ VAStatus DdiMedia_GetImage(
         return VA_STATUS_ERROR_UNIMPLEMENTED;
     }
 
-    //Lock Surface
-    void *surfData = DdiMediaUtil_LockSurface(mediaSurface, (MOS_LOCKFLAG_READONLY | MOS_LOCKFLAG_WRITEONLY));
-    if (nullptr == surfData)
+    //a whole frame is read back by the GPU copy kernel without waiting,
+    //mapping the image buffer waits for it
+    if (x == 0 && y == 0 && width == vaimg->width && height == vaimg->height &&
+        DdiMediaCopy_SurfaceToImageGpu(ctx, mediaSurface, vaimg, buf) == VA_STATUS_SUCCESS)
     {
-        return VA_STATUS_ERROR_SURFACE_BUSY;
+        return VA_STATUS_SUCCESS;
     }
 
     void *imageData = nullptr;
     VAStatus status = DdiMedia_MapBuffer(ctx, vaimg->buf, &imageData);
     if (status != VA_STATUS_SUCCESS)
     {
-        DdiMediaUtil_UnlockSurface(mediaSurface);
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
-    //copy data from surface to image
-    //this is temp solution, will copy by difference size and difference format in further
-    MOS_STATUS eStatus = MOS_SecureMemcpy(imageData, vaimg->data_size, surfData, vaimg->data_size);
-    DDI_CHK_CONDITION((eStatus != MOS_STATUS_SUCCESS), "DDI:Failed to copy surface to image buffer data!", VA_STATUS_ERROR_OPERATION_FAILED);
-
-    status = DdiMedia_UnmapBuffer(ctx, vaimg->buf);
-    if (status != VA_STATUS_SUCCESS)
+    //copy the region from surface to image, de-tiling on the CPU
+    status = DdiMediaCopy_SurfaceToImage(mediaSurface, vaimg, (uint8_t *)imageData, x, y, width, height);
+    if (status == VA_STATUS_ERROR_UNIMPLEMENTED)
     {
+        //Lock Surface
+        void *surfData = DdiMediaUtil_LockSurface(mediaSurface, (MOS_LOCKFLAG_READONLY | MOS_LOCKFLAG_WRITEONLY));
+        if (nullptr == surfData)
+        {
+            DdiMedia_UnmapBuffer(ctx, vaimg->buf);
+            return VA_STATUS_ERROR_SURFACE_BUSY;
+        }
+
+        //copy the region through the linear view of the surface
+        status = DdiMediaCopy_LockedSurfaceToImage(mediaSurface, (uint8_t *)surfData, vaimg, (uint8_t *)imageData, x, y, width, height);
+        if (status == VA_STATUS_ERROR_UNIMPLEMENTED &&
+            x == 0 && y == 0 && width == vaimg->width && height == vaimg->height)
+        {
+            //copy data from surface to image
+            //this is temp solution, will copy by difference size and difference format in further
+            MOS_STATUS eStatus = MOS_SecureMemcpy(imageData, vaimg->data_size, surfData, vaimg->data_size);
+            status = (eStatus == MOS_STATUS_SUCCESS) ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_OPERATION_FAILED;
+        }
         DdiMediaUtil_UnlockSurface(mediaSurface);
+    }
+
+    if (DdiMedia_UnmapBuffer(ctx, vaimg->buf) != VA_STATUS_SUCCESS)
+    {
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
-    DdiMediaUtil_UnlockSurface(mediaSurface);
+    DDI_CHK_CONDITION((status != VA_STATUS_SUCCESS), "DDI:Failed to copy surface to image buffer data!", status);
 
     return VA_STATUS_SUCCESS;
 
@@ -4267,15 +4440,6 @@ VAStatus DdiMedia_PutImage(
     uint32_t         dest_height
 )
 {
-    DDI_UNUSED(src_x);
-    DDI_UNUSED(src_y);
-    DDI_UNUSED(src_width);
-    DDI_UNUSED(src_height);
-    DDI_UNUSED(dest_x);
-    DDI_UNUSED(dest_y);
-    DDI_UNUSED(dest_width);
-    DDI_UNUSED(dest_height);
-
     DDI_FUNCTION_ENTER();
 
     DDI_CHK_NULL(ctx,                     "nullptr ctx.",                    VA_STATUS_ERROR_INVALID_CONTEXT);
@@ -4283,9 +4447,9 @@ VAStatus DdiMedia_PutImage(
     PDDI_MEDIA_CONTEXT mediaCtx     = DdiMedia_GetMediaContext(ctx);
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx.",              VA_STATUS_ERROR_INVALID_PARAMETER);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap",   VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
     DDI_CHK_NULL(mediaCtx->pImageHeap,   "nullptr mediaCtx->pImageHeap",     VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)image, mediaCtx->pImageHeap->uiAllocatedHeapElements,     "Invalid image",   VA_STATUS_ERROR_INVALID_IMAGE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(image), mediaCtx->pImageHeap->uiAllocatedHeapElements,     "Invalid image",   VA_STATUS_ERROR_INVALID_IMAGE);
 
     DDI_MEDIA_SURFACE *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surface);
     DDI_CHK_NULL(mediaSurface, "nullptr mediaSurface.", VA_STATUS_ERROR_INVALID_PARAMETER);
@@ -4309,34 +4473,61 @@ VAStatus DdiMedia_PutImage(
 
     DDI_CHK_NULL(mediaSurface->bo, "Invalid buffer.", VA_STATUS_ERROR_INVALID_PARAMETER);
 
-    //Lock Surface
-    void *surfData = DdiMediaUtil_LockSurface(mediaSurface, (MOS_LOCKFLAG_READONLY | MOS_LOCKFLAG_WRITEONLY));
-    if (nullptr == surfData)
+    //a whole frame is written by the GPU copy kernel without waiting,
+    //vaSyncSurface and mapping the image buffer wait for it
+    if (src_x == 0 && src_y == 0 && dest_x == 0 && dest_y == 0 &&
+        src_width == vaimg->width && src_height == vaimg->height &&
+        dest_width == vaimg->width && dest_height == vaimg->height &&
+        DdiMediaCopy_ImageToSurfaceGpu(ctx, mediaSurface, vaimg, buf) == VA_STATUS_SUCCESS)
     {
-        return VA_STATUS_ERROR_SURFACE_BUSY;
+        return VA_STATUS_SUCCESS;
     }
 
     void *imageData = nullptr;
     VAStatus status = DdiMedia_MapBuffer(ctx, vaimg->buf, &imageData);
     if (status != VA_STATUS_SUCCESS)
     {
-        DdiMediaUtil_UnlockSurface(mediaSurface);
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
-    //copy data from image to surferce
-    //this is temp solution, will copy by difference size and difference format in further
-    MOS_STATUS eStatus = MOS_SecureMemcpy(surfData, vaimg->data_size, imageData, vaimg->data_size);
-    DDI_CHK_CONDITION((eStatus != MOS_STATUS_SUCCESS), "DDI:Failed to copy image to surface buffer data!", VA_STATUS_ERROR_OPERATION_FAILED);
-
-    status = DdiMedia_UnmapBuffer(ctx, vaimg->buf);
-    if (status != VA_STATUS_SUCCESS)
+    //copy the region from image to surface, tiling on the CPU. There is no
+    //scaling, a region that differs in size is cropped to the smaller one.
+    status = DdiMediaCopy_ImageToSurface(mediaSurface, vaimg, (uint8_t *)imageData,
+        src_x, src_y, dest_x, dest_y,
+        MOS_MIN(src_width, dest_width), MOS_MIN(src_height, dest_height));
+    if (status == VA_STATUS_ERROR_UNIMPLEMENTED)
     {
+        //Lock Surface
+        void *surfData = DdiMediaUtil_LockSurface(mediaSurface, (MOS_LOCKFLAG_READONLY | MOS_LOCKFLAG_WRITEONLY));
+        if (nullptr == surfData)
+        {
+            DdiMedia_UnmapBuffer(ctx, vaimg->buf);
+            return VA_STATUS_ERROR_SURFACE_BUSY;
+        }
+
+        //copy the region through the linear view of the surface
+        status = DdiMediaCopy_ImageToLockedSurface(mediaSurface, (uint8_t *)surfData, vaimg, (uint8_t *)imageData,
+            src_x, src_y, dest_x, dest_y,
+            MOS_MIN(src_width, dest_width), MOS_MIN(src_height, dest_height));
+        if (status == VA_STATUS_ERROR_UNIMPLEMENTED &&
+            src_x == 0 && src_y == 0 && dest_x == 0 && dest_y == 0 &&
+            src_width == vaimg->width && src_height == vaimg->height &&
+            dest_width == vaimg->width && dest_height == vaimg->height)
+        {
+            //copy data from image to surferce
+            //this is temp solution, will copy by difference size and difference format in further
+            MOS_STATUS eStatus = MOS_SecureMemcpy(surfData, vaimg->data_size, imageData, vaimg->data_size);
+            status = (eStatus == MOS_STATUS_SUCCESS) ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_OPERATION_FAILED;
+        }
         DdiMediaUtil_UnlockSurface(mediaSurface);
+    }
+
+    if (DdiMedia_UnmapBuffer(ctx, vaimg->buf) != VA_STATUS_SUCCESS)
+    {
         return VA_STATUS_ERROR_UNKNOWN;
     }
 
-    DdiMediaUtil_UnlockSurface(mediaSurface);
+    DDI_CHK_CONDITION((status != VA_STATUS_SUCCESS), "DDI:Failed to copy image to surface buffer data!", status);
 
     return VA_STATUS_SUCCESS;
 
@@ -4779,7 +4970,7 @@ VAStatus DdiMedia_BufferInfo (
         return VA_STATUS_ERROR_INVALID_CONTEXT;
 
     DDI_CHK_NULL(mediaCtx->pBufferHeap, "nullptr mediaCtx->pBufferHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)buf_id, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(buf_id), mediaCtx->pBufferHeap->uiAllocatedHeapElements, "Invalid buf_id", VA_STATUS_ERROR_INVALID_BUFFER);
 
     DDI_MEDIA_BUFFER *buf  = DdiMedia_GetBufferFromVABufferID(mediaCtx, buf_id);
     if (nullptr == buf)
@@ -4852,7 +5043,7 @@ VAStatus DdiMedia_LockSurface (
     PDDI_MEDIA_CONTEXT mediaCtx          = DdiMedia_GetMediaContext(ctx);
     DDI_CHK_NULL(mediaCtx,               "nullptr Media",                   VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
 
     DDI_MEDIA_SURFACE *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surface);
     if (nullptr == mediaSurface)
@@ -4923,7 +5114,7 @@ VAStatus DdiMedia_UnlockSurface (
     PDDI_MEDIA_CONTEXT mediaCtx = DdiMedia_GetMediaContext(ctx);
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",                 VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap",   VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surface", VA_STATUS_ERROR_INVALID_SURFACE);
 
     DDI_MEDIA_SURFACE *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, surface);
     DDI_CHK_NULL(mediaSurface, "nullptr mediaSurface", VA_STATUS_ERROR_INVALID_SURFACE);
@@ -5337,6 +5528,9 @@ VAStatus __vaDriverInit(VADriverContextP ctx )
     pVTable->vaRenderPicture                 = DdiMedia_RenderPicture;
     pVTable->vaEndPicture                    = DdiMedia_EndPicture;
     pVTable->vaSyncSurface                   = DdiMedia_SyncSurface;
+#if VA_CHECK_VERSION(1, 9, 0)
+    pVTable->vaSyncSurface2                  = DdiMedia_SyncSurface2;
+#endif
     pVTable->vaQuerySurfaceStatus            = DdiMedia_QuerySurfaceStatus;
     pVTable->vaQuerySurfaceError             = DdiMedia_QuerySurfaceError;
     pVTable->vaQuerySurfaceAttributes        = DdiMedia_QuerySurfaceAttributes;
@@ -5439,7 +5633,7 @@ MEDIAAPI_EXPORT VAStatus DdiMedia_ExtGetSurfaceHandle(
     PDDI_MEDIA_CONTEXT mediaCtx = DdiMedia_GetMediaContext(ctx);
     DDI_CHK_NULL(mediaCtx,               "nullptr mediaCtx",               VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "nullptr mediaCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_CONTEXT);
-    DDI_CHK_LESS((uint32_t)(*surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX((*surface)), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaces", VA_STATUS_ERROR_INVALID_SURFACE);
 
     DDI_MEDIA_SURFACE  *mediaSurface = DdiMedia_GetSurfaceFromVASurfaceID(mediaCtx, *surface);
     if (mediaSurface)
@@ -27,23 +27,17 @@
 #include "media_libva_util.h"
 #include "mos_solo_generic.h"
 
-static void* DdiMedia_GetVaContextFromHeap(PDDI_MEDIA_HEAP  mediaHeap, uint32_t index, PMEDIA_MUTEX_T mutex)
+static void* DdiMedia_GetVaContextFromHeap(PDDI_MEDIA_HEAP  mediaHeap, uint32_t index)
 {
     PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT  vaCtxHeapElmt;
-    void                              *context;
 
-    DdiMediaUtil_LockMutex(mutex);
-    if(nullptr == mediaHeap || index >= mediaHeap->uiAllocatedHeapElements)
+    vaCtxHeapElmt  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaHeap, index);
+    if (nullptr == vaCtxHeapElmt)
     {
-        DdiMediaUtil_UnLockMutex(mutex);
         return nullptr;
     }
-    vaCtxHeapElmt  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)mediaHeap->pHeapBase;
-    vaCtxHeapElmt += index;
-    context        = vaCtxHeapElmt->pVaContext;
-    DdiMediaUtil_UnLockMutex(mutex);
 
-    return context;
+    return vaCtxHeapElmt->pVaContext;
 }
 
 void DdiMedia_MediaSurfaceToMosResource(DDI_MEDIA_SURFACE *mediaSurface, MOS_RESOURCE  *mosResource)
@@ -218,33 +212,33 @@ void* DdiMedia_GetContextFromContextID (VADriverContextP ctx, VAContextID vaCtxI
     {
         DDI_VERBOSEMESSAGE("Cenc context detected: 0x%x", vaCtxID);
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_CENC_DECODER;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pDecoderCtxHeap, index, &mediaCtx->DecoderMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pDecoderCtxHeap, index);
     }
     else if ((vaCtxID&DDI_MEDIA_MASK_VACONTEXT_TYPE) == DDI_MEDIA_VACONTEXTID_OFFSET_DECODER)
     {
         DDI_VERBOSEMESSAGE("Decode context detected: 0x%x", vaCtxID);
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_DECODER;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pDecoderCtxHeap, index, &mediaCtx->DecoderMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pDecoderCtxHeap, index);
     }
     else if ((vaCtxID&DDI_MEDIA_MASK_VACONTEXT_TYPE) == DDI_MEDIA_VACONTEXTID_OFFSET_ENCODER)
     {
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_ENCODER;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pEncoderCtxHeap, index, &mediaCtx->EncoderMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pEncoderCtxHeap, index);
     }
     else if ((vaCtxID & DDI_MEDIA_MASK_VACONTEXT_TYPE) == DDI_MEDIA_VACONTEXTID_OFFSET_VP)
     {
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_VP;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pVpCtxHeap, index, &mediaCtx->VpMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pVpCtxHeap, index);
     }
     else if ((vaCtxID & DDI_MEDIA_MASK_VACONTEXT_TYPE) == DDI_MEDIA_VACONTEXTID_OFFSET_CM)
     {
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_CM;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pCmCtxHeap, index, &mediaCtx->CmMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pCmCtxHeap, index);
     }
     else if ((vaCtxID & DDI_MEDIA_MASK_VACONTEXT_TYPE) == DDI_MEDIA_VACONTEXTID_OFFSET_MFE)
     {
         *ctxType = DDI_MEDIA_CONTEXT_TYPE_MFE;
-        return DdiMedia_GetVaContextFromHeap(mediaCtx->pMfeCtxHeap, index, &mediaCtx->MfeMutex);
+        return DdiMedia_GetVaContextFromHeap(mediaCtx->pMfeCtxHeap, index);
     }
     else
     {
@@ -262,12 +256,9 @@ DDI_MEDIA_SURFACE* DdiMedia_GetSurfaceFromVASurfaceID (PDDI_MEDIA_CONTEXT mediaC
     PDDI_MEDIA_SURFACE               surface;
 
     i                = (uint32_t)surfaceID;
-    DDI_CHK_LESS(i, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "invalid surface id", nullptr);
-    DdiMediaUtil_LockMutex(&mediaCtx->SurfaceMutex);
-    surfaceElement  = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)mediaCtx->pSurfaceHeap->pHeapBase;
-    surfaceElement += i;
+    surfaceElement  = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaCtx->pSurfaceHeap, i);
+    DDI_CHK_NULL(surfaceElement, "invalid surface id", nullptr);
     surface         = surfaceElement->pSurface;
-    DdiMediaUtil_UnLockMutex(&mediaCtx->SurfaceMutex);
 
     return surface;
 }
@@ -279,12 +270,9 @@ DDI_MEDIA_BUFFER* DdiMedia_GetBufferFromVABufferID (PDDI_MEDIA_CONTEXT mediaCtx,
     PDDI_MEDIA_BUFFER              buf;
 
     i                = (uint32_t)bufferID;
-    DDI_CHK_LESS(i, mediaCtx->pBufferHeap->uiAllocatedHeapElements, "invalid buffer id", nullptr);
-    DdiMediaUtil_LockMutex(&mediaCtx->BufferMutex);
-    bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)mediaCtx->pBufferHeap->pHeapBase;
-    bufHeapElement += i;
+    bufHeapElement  = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(mediaCtx->pBufferHeap, i);
+    DDI_CHK_NULL(bufHeapElement, "invalid buffer id", nullptr);
     buf             = bufHeapElement->pBuffer;
-    DdiMediaUtil_UnLockMutex(&mediaCtx->BufferMutex);
 
     return buf;
 }
@@ -29,6 +29,7 @@
 #define __MEDIA_LIBVA_COMMON_H__
 
 #include <pthread.h>
+#include <unordered_map>
 
 #include "xf86drm.h"
 #include "drm.h"
@@ -84,7 +85,15 @@ static int32_t atrace_switch            = 0;
 #define DDI_MEDIA_MAX_INSTANCE_NUMBER          0x0FFFFFFF
 
 // heap
-#define DDI_MEDIA_HEAP_INCREMENTAL_SIZE      8
+// Elements live in chunks that never move, so looking an ID up needs no lock.
+// An ID is the element index plus a generation bumped on every release, which
+// stays below the context type bits of DDI_MEDIA_MASK_VACONTEXT_TYPE.
+#define DDI_MEDIA_HEAP_INCREMENTAL_SIZE      256
+#define DDI_MEDIA_HEAP_MAX_CHUNKS            1024
+#define DDI_MEDIA_HEAP_INDEX_MASK            0x00FFFFFF
+#define DDI_MEDIA_HEAP_GENERATION_SHIFT      24
+#define DDI_MEDIA_HEAP_GENERATION_MASK       0x0F000000
+#define DDI_MEDIA_HEAP_INDEX(id)             ((uint32_t)(id) & DDI_MEDIA_HEAP_INDEX_MASK)
 
 #define DDI_MEDIA_VACONTEXTID_OFFSET_DECODER       0x10000000
 #define DDI_MEDIA_VACONTEXTID_OFFSET_ENCODER       0x20000000
@@ -258,6 +267,7 @@ typedef struct _DDI_MEDIA_SURFACE
     uint32_t                            curCtxType;                // indicate current surface is using in which context type.
     DDI_MEDIA_STATUS_REPORT_QUERY_STATE curStatusReportQueryState; // indicate status report is queried or not.
     DDI_MEDIA_SURFACE_STATUS_REPORT     curStatusReport;           // union for both decode and vpp status.
+    uint32_t                            decodeStatusIndex;         // decode status buffer slot expected to hold the report of the last decode into this surface.
 
     PDDI_MEDIA_CONTEXT      pMediaCtx; // Media driver Context
     PMEDIA_SEM_T            pCurrentFrameSemaphore;   // to sync render target for hybrid decoding multi-threading mode
@@ -293,42 +303,58 @@ typedef struct _DDI_MEDIA_BUFFER
     PDDI_MEDIA_CONTEXT     pMediaCtx; // Media driver Context
 } DDI_MEDIA_BUFFER, *PDDI_MEDIA_BUFFER;
 
+//!
+//! \brief  Leading fields shared by all heap elements
+//!
+typedef struct _DDI_MEDIA_HEAP_ELEMENT
+{
+    uint32_t                                uiVaID;         // index and generation
+    uint32_t                                uiNextFree;     // index + 1 of the next free element, 0 ends the list
+}DDI_MEDIA_HEAP_ELEMENT, *PDDI_MEDIA_HEAP_ELEMENT;
+
 typedef struct _DDI_MEDIA_SURFACE_HEAP_ELEMENT
 {
-    PDDI_MEDIA_SURFACE                      pSurface;
     uint32_t                                uiVaSurfaceID;
-    struct _DDI_MEDIA_SURFACE_HEAP_ELEMENT *pNextFree;
+    uint32_t                                uiNextFree;
+    PDDI_MEDIA_SURFACE                      pSurface;
 }DDI_MEDIA_SURFACE_HEAP_ELEMENT, *PDDI_MEDIA_SURFACE_HEAP_ELEMENT;
 
+//!
+//! \brief  Surfaces by their bo, several surfaces may import the same bo
+//!
+typedef std::unordered_multimap<MOS_LINUX_BO *, PDDI_MEDIA_SURFACE> DDI_MEDIA_SURFACE_BO_MAP;
+
+typedef struct _DDI_MEDIA_COPY_ENGINE DDI_MEDIA_COPY_ENGINE;
+
 typedef struct _DDI_MEDIA_BUFFER_HEAP_ELEMENT
 {
+    uint32_t                                uiVaBufferID;
+    uint32_t                                uiNextFree;
     PDDI_MEDIA_BUFFER                       pBuffer;
     void                                   *pCtx;
     uint32_t                                uiCtxType;
-    uint32_t                                uiVaBufferID;
-    struct _DDI_MEDIA_BUFFER_HEAP_ELEMENT  *pNextFree;
 }DDI_MEDIA_BUFFER_HEAP_ELEMENT, *PDDI_MEDIA_BUFFER_HEAP_ELEMENT;
 
 typedef struct _DDI_MEDIA_IMAGE_HEAP_ELEMENT
 {
-    VAImage                                *pImage;
     uint32_t                                uiVaImageID;
-    struct _DDI_MEDIA_IMAGE_HEAP_ELEMENT   *pNextFree;
+    uint32_t                                uiNextFree;
+    VAImage                                *pImage;
 }DDI_MEDIA_IMAGE_HEAP_ELEMENT, *PDDI_MEDIA_IMAGE_HEAP_ELEMENT;
 
 typedef struct _DDI_MEDIA_VACONTEXT_HEAP_ELEMENT
 {
-    void                                       *pVaContext;
     uint32_t                                    uiVaContextID;
-    struct _DDI_MEDIA_VACONTEXT_HEAP_ELEMENT   *pNextFree;
+    uint32_t                                    uiNextFree;
+    void                                       *pVaContext;
 }DDI_MEDIA_VACONTEXT_HEAP_ELEMENT, *PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT;
 
 typedef struct _DDI_MEDIA_HEAP
 {
-    void               *pHeapBase;
+    void               *pHeapBase[DDI_MEDIA_HEAP_MAX_CHUNKS];  // chunks of DDI_MEDIA_HEAP_INCREMENTAL_SIZE elements
     uint32_t            uiHeapElementSize;
     uint32_t            uiAllocatedHeapElements;
-    void               *pFirstFreeHeapElement;
+    uint64_t            uiFirstFreeHeapElement;  // index + 1 of the first free element, and an ABA tag in the upper half
 }DDI_MEDIA_HEAP, *PDDI_MEDIA_HEAP;
 
 #ifndef ANDROID
@@ -364,6 +390,7 @@ struct DDI_MEDIA_CONTEXT
 
     PDDI_MEDIA_HEAP     pSurfaceHeap;
     uint32_t            uiNumSurfaces;
+    DDI_MEDIA_SURFACE_BO_MAP *pSurfaceBoMap;    // protected by SurfaceMutex
 
     PDDI_MEDIA_HEAP     pBufferHeap;
     uint32_t            uiNumBufs;
@@ -371,6 +398,9 @@ struct DDI_MEDIA_CONTEXT
     PDDI_MEDIA_HEAP     pImageHeap;
     uint32_t            uiNumImages;
 
+    // GPU copies of vaGetImage/vaPutImage in flight
+    DDI_MEDIA_COPY_ENGINE *pCopyEngine;
+
     PDDI_MEDIA_HEAP     pDecoderCtxHeap;
     uint32_t            uiNumDecoders;
 
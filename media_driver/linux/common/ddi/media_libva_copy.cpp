@@ -0,0 +1,465 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      media_libva_copy.cpp
+//! \brief     libva(and its extension) surface/image copy on the CPU
+//!
+#include <smmintrin.h>
+
+#include "media_libva_copy.h"
+#include "media_libva_util.h"
+#include "mos_utilities.h"
+
+//! Planes above this size are split into row bands copied by several threads
+#define DDI_MEDIA_COPY_THREAD_MIN_BYTES     (2 * 1024 * 1024)
+#define DDI_MEDIA_COPY_MAX_THREADS          4
+
+//!
+//! \brief  Rows of one plane to copy between a surface mapping and linear memory
+//!
+struct DdiMediaCopyJob
+{
+    uint8_t  *surfBase;     //!< CPU mapping of the surface bo
+    uint32_t  surfPitch;
+    uint32_t  tiling;       //!< I915_TILING_NONE, X or Y
+    uint32_t  surfX;        //!< First byte of the rows in the surface
+    uint32_t  surfY;        //!< First row in the surface, counted from the start of the bo
+    uint8_t  *linear;       //!< First byte of the first row in linear memory
+    uint32_t  linearPitch;
+    uint32_t  rowBytes;
+    uint32_t  rows;
+    bool      toLinear;     //!< Copy from the surface to linear memory
+};
+
+//!
+//! \brief  Copy one surface row segment between a tiled mapping and linear memory
+//! \details Uses the decomposition of Mos_SwizzleOffset: a Y tile is handled as
+//!          8 columns of 16B x 32 rows, an X tile as one column of 512B x 8 rows,
+//!          so a tile row consists of spans contiguous in memory.
+//!
+static void DdiMediaCopy_TiledRow(
+    uint8_t  *tiled,
+    uint32_t  pitch,
+    uint32_t  tiling,
+    uint32_t  x,
+    uint32_t  y,
+    uint8_t  *linear,
+    uint32_t  bytes,
+    bool      toLinear)
+{
+    const uint32_t spanShift = (tiling == I915_TILING_Y) ? 4 : 9;
+    const uint32_t lineShift = (tiling == I915_TILING_Y) ? 5 : 3;
+    const uint32_t spanBytes = 1 << spanShift;
+
+    uint8_t *line = tiled +
+        ((((size_t)(y >> lineShift) * (pitch >> spanShift)) << (lineShift + spanShift)) +
+         ((y & ((1 << lineShift) - 1)) << spanShift));
+
+    while (bytes)
+    {
+        uint32_t within = x & (spanBytes - 1);
+        uint32_t count  = MOS_MIN(bytes, spanBytes - within);
+        uint8_t *span   = line + ((size_t)(x >> spanShift) << (lineShift + spanShift)) + within;
+
+        if (count == sizeof(__m128i) && ((uintptr_t)span & (sizeof(__m128i) - 1)) == 0)
+        {
+            // A whole Y tile span is 16B aligned. Streaming loads avoid
+            // polluting the cache and are fast on WC mappings as well.
+            if (toLinear)
+            {
+                _mm_storeu_si128((__m128i *)linear, _mm_stream_load_si128((__m128i *)span));
+            }
+            else
+            {
+                _mm_store_si128((__m128i *)span, _mm_loadu_si128((__m128i *)linear));
+            }
+        }
+        else if (count == sizeof(__m128i))
+        {
+            // 16 bytes in the middle of an X tile span, at any alignment
+            if (toLinear)
+            {
+                _mm_storeu_si128((__m128i *)linear, _mm_loadu_si128((__m128i *)span));
+            }
+            else
+            {
+                _mm_storeu_si128((__m128i *)span, _mm_loadu_si128((__m128i *)linear));
+            }
+        }
+        else if (toLinear)
+        {
+            MOS_SecureMemcpy(linear, count, span, count);
+        }
+        else
+        {
+            MOS_SecureMemcpy(span, count, linear, count);
+        }
+
+        x      += count;
+        linear += count;
+        bytes  -= count;
+    }
+}
+
+static void DdiMediaCopy_Rows(DdiMediaCopyJob *job)
+{
+    uint8_t *linear = job->linear;
+
+    for (uint32_t row = 0; row < job->rows; row++, linear += job->linearPitch)
+    {
+        uint32_t y = job->surfY + row;
+
+        if (job->tiling == I915_TILING_NONE)
+        {
+            uint8_t *surf = job->surfBase + (size_t)y * job->surfPitch + job->surfX;
+            if (job->toLinear)
+            {
+                MOS_SecureMemcpy(linear, job->rowBytes, surf, job->rowBytes);
+            }
+            else
+            {
+                MOS_SecureMemcpy(surf, job->rowBytes, linear, job->rowBytes);
+            }
+        }
+        else
+        {
+            DdiMediaCopy_TiledRow(job->surfBase, job->surfPitch, job->tiling,
+                job->surfX, y, linear, job->rowBytes, job->toLinear);
+        }
+    }
+}
+
+static void *DdiMediaCopy_RowsThread(void *data)
+{
+    DdiMediaCopyJob *job = (DdiMediaCopyJob *)data;
+    DdiMediaCopy_Rows(job);
+    return nullptr;
+}
+
+//!
+//! \brief  Copy the rows of a job, splitting large ones into bands copied in parallel
+//!
+static void DdiMediaCopy_RunJob(DdiMediaCopyJob *job)
+{
+    uint32_t threads = 1;
+    if ((uint64_t)job->rowBytes * job->rows >= DDI_MEDIA_COPY_THREAD_MIN_BYTES)
+    {
+        threads = MOS_MIN(MOS_GetLogicalCoreNumber(), DDI_MEDIA_COPY_MAX_THREADS);
+    }
+
+    // Bands start on a tile row so that no tile is written by two threads
+    uint32_t bandRows = MOS_ALIGN_CEIL((job->rows + threads - 1) / MOS_MAX(threads, 1), 32);
+    if (threads <= 1 || bandRows >= job->rows)
+    {
+        DdiMediaCopy_Rows(job);
+        return;
+    }
+
+    DdiMediaCopyJob  bands[DDI_MEDIA_COPY_MAX_THREADS];
+    MOS_THREADHANDLE handles[DDI_MEDIA_COPY_MAX_THREADS] = {};
+    uint32_t         numBands = 0;
+
+    for (uint32_t row = 0; row < job->rows && numBands < threads; row += bandRows, numBands++)
+    {
+        bands[numBands]         = *job;
+        bands[numBands].surfY   = job->surfY + row;
+        bands[numBands].linear  = job->linear + (size_t)row * job->linearPitch;
+        bands[numBands].rows    = MOS_MIN(bandRows, job->rows - row);
+    }
+
+    for (uint32_t i = 1; i < numBands; i++)
+    {
+        handles[i] = MOS_CreateThread((void *)DdiMediaCopy_RowsThread, &bands[i]);
+        if (0 == handles[i])
+        {
+            DdiMediaCopy_Rows(&bands[i]);
+        }
+    }
+
+    DdiMediaCopy_Rows(&bands[0]);
+
+    for (uint32_t i = 1; i < numBands; i++)
+    {
+        if (handles[i])
+        {
+            MOS_WaitThread(handles[i]);
+        }
+    }
+}
+
+//!
+//! \brief  Describe the planes of the surface formats handled here
+//!
+//! \param  [in] format
+//!         Surface format
+//! \param  [out] bytesPerPixel
+//!         Bytes per pixel of the first plane. The interleaved chroma plane
+//!         of 4:2:0 formats has as many bytes per row as the first one.
+//! \param  [out] numPlanes
+//!         Number of planes, 2 for 4:2:0 formats
+//! \param  [out] alignment
+//!         Alignment of the region in pixels
+//!
+//! \return bool
+//!     true if the format is handled
+//!
+static bool DdiMediaCopy_GetFormatInfo(
+    DDI_MEDIA_FORMAT  format,
+    uint32_t         *bytesPerPixel,
+    uint32_t         *numPlanes,
+    uint32_t         *alignment)
+{
+    *numPlanes = 1;
+    *alignment = 1;
+
+    switch (format)
+    {
+        case Media_Format_NV12:
+            *bytesPerPixel = 1;
+            *numPlanes     = 2;
+            *alignment     = 2;
+            break;
+        case Media_Format_P010:
+            *bytesPerPixel = 2;
+            *numPlanes     = 2;
+            *alignment     = 2;
+            break;
+        case Media_Format_YUY2:
+            *bytesPerPixel = 2;
+            *alignment     = 2;
+            break;
+        case Media_Format_400P:
+            *bytesPerPixel = 1;
+            break;
+        case Media_Format_A8R8G8B8:
+        case Media_Format_X8R8G8B8:
+        case Media_Format_A8B8G8R8:
+        case Media_Format_X8B8G8R8:
+        case Media_Format_R10G10B10A2:
+        case Media_Format_B10G10R10A2:
+            *bytesPerPixel = 4;
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+//!
+//! \brief  Copy a region between a surface and an image
+//! \details The surface is mapped with CPU caching unless lockedData, the
+//!          linear view of a surface locked by the caller, is given.
+//!
+static VAStatus DdiMediaCopy_SurfaceImage(
+    DDI_MEDIA_SURFACE *surface,
+    uint8_t           *lockedData,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            surfX,
+    int32_t            surfY,
+    int32_t            imageX,
+    int32_t            imageY,
+    uint32_t           width,
+    uint32_t           height,
+    bool               toImage)
+{
+    DDI_CHK_NULL(surface,           "nullptr surface",    VA_STATUS_ERROR_INVALID_PARAMETER);
+    DDI_CHK_NULL(surface->bo,       "nullptr surface->bo", VA_STATUS_ERROR_INVALID_PARAMETER);
+    DDI_CHK_NULL(image,             "nullptr image",      VA_STATUS_ERROR_INVALID_PARAMETER);
+    DDI_CHK_NULL(imageData,         "nullptr imageData",  VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    uint32_t bytesPerPixel, numPlanes, alignment;
+    if (!DdiMediaCopy_GetFormatInfo(surface->format, &bytesPerPixel, &numPlanes, &alignment))
+    {
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    uint32_t tiling  = I915_TILING_NONE;
+    uint32_t swizzle = I915_BIT_6_SWIZZLE_NONE;
+    if (lockedData == nullptr)
+    {
+        // Another user holds a mapping of the surface, which may be a GTT one
+        if (surface->bMapped || surface->iRefCount)
+        {
+            return VA_STATUS_ERROR_UNIMPLEMENTED;
+        }
+
+        if (mos_bo_get_tiling(surface->bo, &tiling, &swizzle) != 0 ||
+            swizzle != I915_BIT_6_SWIZZLE_NONE)
+        {
+            return VA_STATUS_ERROR_UNIMPLEMENTED;
+        }
+    }
+
+    uint32_t pitch = (uint32_t)surface->iPitch;
+    if ((tiling == I915_TILING_Y && (pitch % 128)) ||
+        (tiling == I915_TILING_X && (pitch % 512)) ||
+        (tiling != I915_TILING_NONE && tiling != I915_TILING_X && tiling != I915_TILING_Y))
+    {
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    if (lockedData == nullptr && surface->pGmmResourceInfo)
+    {
+        GMM_RESOURCE_FLAG gmmFlags = surface->pGmmResourceInfo->GetResFlags();
+        if (gmmFlags.Info.TiledYf || gmmFlags.Info.TiledYs)
+        {
+            return VA_STATUS_ERROR_UNIMPLEMENTED;
+        }
+    }
+
+    DDI_CHK_CONDITION((surfX < 0 || surfY < 0 || imageX < 0 || imageY < 0),
+        "Invalid region", VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    // Chroma subsampling requires the region to start on an even pixel
+    surfX  &= ~(alignment - 1);
+    surfY  &= ~(alignment - 1);
+    imageX &= ~(alignment - 1);
+    imageY &= ~(alignment - 1);
+    width   = MOS_ALIGN_CEIL(width, alignment);
+    height  = MOS_ALIGN_CEIL(height, alignment);
+
+    width  = MOS_MIN(width,  (uint32_t)MOS_MAX(0, MOS_MIN(surface->iWidth - surfX, (int32_t)image->width - imageX)));
+    height = MOS_MIN(height, (uint32_t)MOS_MAX(0, MOS_MIN(surface->iRealHeight - surfY, (int32_t)image->height - imageY)));
+    if (width == 0 || height == 0)
+    {
+        return VA_STATUS_SUCCESS;
+    }
+
+    // Build the jobs and check them against both allocations before mapping
+    DdiMediaCopyJob jobs[2];
+    uint32_t        tileRows = (tiling == I915_TILING_Y) ? 32 : ((tiling == I915_TILING_X) ? 8 : 1);
+    for (uint32_t plane = 0; plane < numPlanes; plane++)
+    {
+        uint32_t shift      = plane ? 1 : 0;
+        uint32_t firstRow   = plane ? (uint32_t)surface->iHeight : 0;
+        uint32_t rows       = height >> shift;
+        uint32_t rowBytes   = width * bytesPerPixel;
+        uint32_t imageRow   = imageY >> shift;
+        uint64_t imageEnd   = image->offsets[plane] +
+                              (uint64_t)(imageRow + rows - 1) * image->pitches[plane] +
+                              imageX * bytesPerPixel + rowBytes;
+        uint64_t surfaceEnd = (uint64_t)MOS_ALIGN_CEIL(firstRow + (surfY >> shift) + rows, tileRows) * pitch;
+
+        if (imageEnd > image->data_size || surfaceEnd > surface->bo->size ||
+            image->pitches[plane] < rowBytes)
+        {
+            return VA_STATUS_ERROR_UNIMPLEMENTED;
+        }
+
+        jobs[plane].surfPitch   = pitch;
+        jobs[plane].tiling      = tiling;
+        jobs[plane].surfX       = surfX * bytesPerPixel;
+        jobs[plane].surfY       = firstRow + (surfY >> shift);
+        jobs[plane].linear      = imageData + image->offsets[plane] +
+                                  (size_t)imageRow * image->pitches[plane] + imageX * bytesPerPixel;
+        jobs[plane].linearPitch = image->pitches[plane];
+        jobs[plane].rowBytes    = rowBytes;
+        jobs[plane].rows        = rows;
+        jobs[plane].toLinear    = toImage;
+    }
+
+    if (lockedData)
+    {
+        for (uint32_t plane = 0; plane < numPlanes; plane++)
+        {
+            jobs[plane].surfBase = lockedData;
+            DdiMediaCopy_RunJob(&jobs[plane]);
+        }
+        return VA_STATUS_SUCCESS;
+    }
+
+    // A CPU mapping gives the raw tiles, which is what makes reading fast
+    if (mos_bo_map(surface->bo, !toImage) != 0 || nullptr == surface->bo->virt)
+    {
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    for (uint32_t plane = 0; plane < numPlanes; plane++)
+    {
+        jobs[plane].surfBase = (uint8_t *)surface->bo->virt;
+        DdiMediaCopy_RunJob(&jobs[plane]);
+    }
+
+    mos_bo_unmap(surface->bo);
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus DdiMediaCopy_SurfaceToImage(
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            x,
+    int32_t            y,
+    uint32_t           width,
+    uint32_t           height)
+{
+    return DdiMediaCopy_SurfaceImage(surface, nullptr, image, imageData, x, y, 0, 0, width, height, true);
+}
+
+VAStatus DdiMediaCopy_ImageToSurface(
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            srcX,
+    int32_t            srcY,
+    int32_t            destX,
+    int32_t            destY,
+    uint32_t           width,
+    uint32_t           height)
+{
+    return DdiMediaCopy_SurfaceImage(surface, nullptr, image, imageData, destX, destY, srcX, srcY, width, height, false);
+}
+
+VAStatus DdiMediaCopy_LockedSurfaceToImage(
+    DDI_MEDIA_SURFACE *surface,
+    uint8_t           *surfData,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            x,
+    int32_t            y,
+    uint32_t           width,
+    uint32_t           height)
+{
+    DDI_CHK_NULL(surfData, "nullptr surfData", VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    return DdiMediaCopy_SurfaceImage(surface, surfData, image, imageData, x, y, 0, 0, width, height, true);
+}
+
+VAStatus DdiMediaCopy_ImageToLockedSurface(
+    DDI_MEDIA_SURFACE *surface,
+    uint8_t           *surfData,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            srcX,
+    int32_t            srcY,
+    int32_t            destX,
+    int32_t            destY,
+    uint32_t           width,
+    uint32_t           height)
+{
+    DDI_CHK_NULL(surfData, "nullptr surfData", VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    return DdiMediaCopy_SurfaceImage(surface, surfData, image, imageData, destX, destY, srcX, srcY, width, height, false);
+}
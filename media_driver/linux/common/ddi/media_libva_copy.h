@@ -0,0 +1,269 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      media_libva_copy.h
+//! \brief     libva(and its extension) surface/image copy head file
+//!
+#ifndef __MEDIA_LIBVA_COPY_H__
+#define __MEDIA_LIBVA_COPY_H__
+
+#include "media_libva_common.h"
+
+//!
+//! \brief  Copy a region of a surface into a VA image on the CPU
+//! \details The surface bo is mapped with CPU caching and X/Y tiles are
+//!          de-tiled in software, instead of reading through a GTT map.
+//!
+//! \param  [in] surface
+//!         Source surface, must not be locked
+//! \param  [in] image
+//!         Destination image
+//! \param  [out] imageData
+//!         Mapped data of the image buffer
+//! \param  [in] x
+//!         X offset of the region in the surface
+//! \param  [in] y
+//!         Y offset of the region in the surface
+//! \param  [in] width
+//!         Width of the region
+//! \param  [in] height
+//!         Height of the region
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, VA_STATUS_ERROR_UNIMPLEMENTED if the
+//!     surface format or layout is not handled and the caller has to copy
+//!     through a surface lock, else fail reason
+//!
+VAStatus DdiMediaCopy_SurfaceToImage(
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            x,
+    int32_t            y,
+    uint32_t           width,
+    uint32_t           height);
+
+//!
+//! \brief  Copy a region of a VA image into a surface on the CPU
+//!
+//! \param  [in] surface
+//!         Destination surface, must not be locked
+//! \param  [in] image
+//!         Source image
+//! \param  [in] imageData
+//!         Mapped data of the image buffer
+//! \param  [in] srcX
+//!         X offset of the region in the image
+//! \param  [in] srcY
+//!         Y offset of the region in the image
+//! \param  [in] destX
+//!         X offset of the region in the surface
+//! \param  [in] destY
+//!         Y offset of the region in the surface
+//! \param  [in] width
+//!         Width of the region
+//! \param  [in] height
+//!         Height of the region
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, VA_STATUS_ERROR_UNIMPLEMENTED if the
+//!     surface format or layout is not handled and the caller has to copy
+//!     through a surface lock, else fail reason
+//!
+VAStatus DdiMediaCopy_ImageToSurface(
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            srcX,
+    int32_t            srcY,
+    int32_t            destX,
+    int32_t            destY,
+    uint32_t           width,
+    uint32_t           height);
+
+//!
+//! \brief  Copy a region of a surface locked by the caller into a VA image
+//! \details Fallback of DdiMediaCopy_SurfaceToImage, the surface is read
+//!          through the linear view returned by DdiMediaUtil_LockSurface.
+//!
+//! \param  [in] surface
+//!         Source surface
+//! \param  [in] surfData
+//!         Linear view of the locked surface
+//! \param  [in] image
+//!         Destination image
+//! \param  [out] imageData
+//!         Mapped data of the image buffer
+//! \param  [in] x
+//!         X offset of the region in the surface
+//! \param  [in] y
+//!         Y offset of the region in the surface
+//! \param  [in] width
+//!         Width of the region
+//! \param  [in] height
+//!         Height of the region
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, VA_STATUS_ERROR_UNIMPLEMENTED if the
+//!     surface format is not handled, else fail reason
+//!
+VAStatus DdiMediaCopy_LockedSurfaceToImage(
+    DDI_MEDIA_SURFACE *surface,
+    uint8_t           *surfData,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            x,
+    int32_t            y,
+    uint32_t           width,
+    uint32_t           height);
+
+//!
+//! \brief  Copy a region of a VA image into a surface locked by the caller
+//!
+//! \param  [in] surface
+//!         Destination surface
+//! \param  [in] surfData
+//!         Linear view of the locked surface
+//! \param  [in] image
+//!         Source image
+//! \param  [in] imageData
+//!         Mapped data of the image buffer
+//! \param  [in] srcX
+//!         X offset of the region in the image
+//! \param  [in] srcY
+//!         Y offset of the region in the image
+//! \param  [in] destX
+//!         X offset of the region in the surface
+//! \param  [in] destY
+//!         Y offset of the region in the surface
+//! \param  [in] width
+//!         Width of the region
+//! \param  [in] height
+//!         Height of the region
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, VA_STATUS_ERROR_UNIMPLEMENTED if the
+//!     surface format is not handled, else fail reason
+//!
+VAStatus DdiMediaCopy_ImageToLockedSurface(
+    DDI_MEDIA_SURFACE *surface,
+    uint8_t           *surfData,
+    VAImage           *image,
+    uint8_t           *imageData,
+    int32_t            srcX,
+    int32_t            srcY,
+    int32_t            destX,
+    int32_t            destY,
+    uint32_t           width,
+    uint32_t           height);
+
+//!
+//! \brief  Enqueue a copy of a whole surface into a VA image on the GPU
+//! \details The copy runs the CM GPU copy kernel on the image buffer memory
+//!          and returns without waiting. Mapping or destroying the image
+//!          buffer waits for it through DdiMediaCopy_WaitBuffer.
+//!
+//! \param  [in] ctx
+//!         Pointer to VA driver context
+//! \param  [in] surface
+//!         Source surface
+//! \param  [in] image
+//!         Destination image, must be as wide as the surface
+//! \param  [in] imageBuf
+//!         Buffer of the image
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if the copy is enqueued, VA_STATUS_ERROR_UNIMPLEMENTED
+//!     if the image is small or its layout is not handled by the copy kernels
+//!     and the caller has to copy on the CPU, else fail reason
+//!
+VAStatus DdiMediaCopy_SurfaceToImageGpu(
+    VADriverContextP   ctx,
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *imageBuf);
+
+//!
+//! \brief  Enqueue a copy of a whole VA image into a surface on the GPU
+//! \details vaSyncSurface on the surface and mapping or destroying the image
+//!          buffer wait for the copy.
+//!
+//! \param  [in] ctx
+//!         Pointer to VA driver context
+//! \param  [in] surface
+//!         Destination surface
+//! \param  [in] image
+//!         Source image, must be as wide as the surface
+//! \param  [in] imageBuf
+//!         Buffer of the image
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if the copy is enqueued, VA_STATUS_ERROR_UNIMPLEMENTED
+//!     if the caller has to copy on the CPU, else fail reason
+//!
+VAStatus DdiMediaCopy_ImageToSurfaceGpu(
+    VADriverContextP   ctx,
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *imageBuf);
+
+//!
+//! \brief  Wait for the GPU copies reading or writing a surface
+//!
+//! \param  [in] mediaCtx
+//!         Pointer to ddi media context
+//! \param  [in] surface
+//!         Media surface
+//!
+void DdiMediaCopy_WaitSurface(PDDI_MEDIA_CONTEXT mediaCtx, DDI_MEDIA_SURFACE *surface);
+
+//!
+//! \brief  Wait for the GPU copies reading or writing a buffer
+//!
+//! \param  [in] mediaCtx
+//!         Pointer to ddi media context
+//! \param  [in] buffer
+//!         Media buffer
+//!
+void DdiMediaCopy_WaitBuffer(PDDI_MEDIA_CONTEXT mediaCtx, DDI_MEDIA_BUFFER *buffer);
+
+//!
+//! \brief  Allocate the GPU copy engine of a media context
+//! \details The CM device behind it is only created on the first GPU copy.
+//!
+//! \param  [in] mediaCtx
+//!         Pointer to ddi media context
+//!
+//! \return VAStatus
+//!     VA_STATUS_SUCCESS if success, else fail reason
+//!
+VAStatus DdiMediaCopy_InitGpuCopy(PDDI_MEDIA_CONTEXT mediaCtx);
+
+//!
+//! \brief  Wait for all GPU copies and destroy the GPU copy engine
+//!
+//! \param  [in] ctx
+//!         Pointer to VA driver context
+//!
+void DdiMediaCopy_ReleaseGpuCopy(VADriverContextP ctx);
+
+#endif //__MEDIA_LIBVA_COPY_H__
@@ -0,0 +1,361 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file      media_libva_copy_gpu.cpp
+//! \brief     libva(and its extension) surface/image copy through the CM GPU copy kernels
+//!
+#include "media_libva_copy.h"
+#include "media_libva_util.h"
+#include "cm_rt_umd.h"
+#include "cm_wrapper_os.h"
+
+//! Images below this size are cheaper to copy on the CPU than to submit
+#define DDI_MEDIA_COPY_GPU_MIN_BYTES        (2 * 1024 * 1024)
+//! Copies in flight before the oldest one is waited for
+#define DDI_MEDIA_COPY_GPU_MAX_PENDING      16
+
+//!
+//! \brief  A GPU copy in flight and the objects it keeps busy
+//!
+typedef struct _DDI_MEDIA_COPY_TASK
+{
+    CmEvent           *event;
+    CmSurface2D       *cmSurface;
+    DDI_MEDIA_SURFACE *surface;
+    DDI_MEDIA_BUFFER  *buffer;
+} DDI_MEDIA_COPY_TASK;
+
+struct _DDI_MEDIA_COPY_ENGINE
+{
+    MEDIA_MUTEX_T       mutex;          //!< Protects everything below
+    CmDevice           *device;         //!< Created on the first GPU copy
+    CmQueue            *queue;
+    bool                unavailable;    //!< Device creation failed, stay on the CPU
+    uint32_t            numTasks;
+    DDI_MEDIA_COPY_TASK tasks[DDI_MEDIA_COPY_GPU_MAX_PENDING];  //!< In submission order
+};
+
+//!
+//! \brief  Wait for task i, release its CM objects and drop it from the list
+//!
+static void DdiMediaCopy_RetireTask(DDI_MEDIA_COPY_ENGINE *engine, uint32_t i)
+{
+    DDI_MEDIA_COPY_TASK *task = &engine->tasks[i];
+
+    if (task->event)
+    {
+        task->event->WaitForTaskFinished();
+        engine->queue->DestroyEvent(task->event);
+    }
+    if (task->cmSurface)
+    {
+        engine->device->DestroySurface(task->cmSurface);
+    }
+
+    engine->numTasks--;
+    for (; i < engine->numTasks; i++)
+    {
+        engine->tasks[i] = engine->tasks[i + 1];
+    }
+}
+
+//!
+//! \brief  Retire the copies touching surface or buffer, and the ones already finished
+//! \details The queue executes in order, so waiting for the last matching copy
+//!          would be enough, but every copy still holds a CM surface to release.
+//!
+static void DdiMediaCopy_RetireTasks(
+    DDI_MEDIA_COPY_ENGINE *engine,
+    DDI_MEDIA_SURFACE     *surface,
+    DDI_MEDIA_BUFFER      *buffer)
+{
+    uint32_t i = 0;
+    while (i < engine->numTasks)
+    {
+        DDI_MEDIA_COPY_TASK *task = &engine->tasks[i];
+        CM_STATUS status = CM_STATUS_QUEUED;
+        if ((surface && task->surface == surface) ||
+            (buffer && task->buffer == buffer) ||
+            (task->event && task->event->GetStatus(status) == CM_SUCCESS && status == CM_STATUS_FINISHED))
+        {
+            DdiMediaCopy_RetireTask(engine, i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+//!
+//! \brief  Create the CM device and queue used for copies
+//!
+static bool DdiMediaCopy_InitDevice(VADriverContextP ctx, DDI_MEDIA_COPY_ENGINE *engine)
+{
+    if (engine->device)
+    {
+        return true;
+    }
+    if (engine->unavailable)
+    {
+        return false;
+    }
+
+    if (CreateCmDeviceFromVA(ctx, engine->device, CM_DEVICE_CREATE_OPTION_DEFAULT) != CM_SUCCESS)
+    {
+        engine->device = nullptr;
+    }
+    else if (engine->device->CreateQueue(engine->queue) != CM_SUCCESS)
+    {
+        DestroyCmDeviceFromVA(ctx, engine->device);
+        engine->device = nullptr;
+    }
+
+    if (engine->device == nullptr)
+    {
+        DDI_NORMALMESSAGE("GPU copy is not available, images are copied on the CPU.");
+        engine->unavailable = true;
+        return false;
+    }
+    return true;
+}
+
+//!
+//! \brief  Check that a whole image matches the layout the CM copy kernels read or write
+//! \details The kernels copy every row of the surface, with the chroma plane of
+//!          NV12/P010 placed right after heightStride luma rows.
+//!
+static bool DdiMediaCopy_IsGpuCopyable(
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *buffer,
+    uint32_t          *heightStride)
+{
+    if (buffer->format != Media_Format_CPU || buffer->pData == nullptr ||
+        ((uintptr_t)buffer->pData & 0xf) ||
+        image->data_size < DDI_MEDIA_COPY_GPU_MIN_BYTES ||
+        image->width != (uint32_t)surface->iWidth ||
+        image->height > (uint32_t)surface->iHeight ||
+        image->offsets[0] != 0 ||
+        image->pitches[0] == 0 || (image->pitches[0] & 0xf))
+    {
+        return false;
+    }
+
+    uint32_t pitch = image->pitches[0];
+    uint32_t rows  = 0;
+    uint32_t size  = 0;
+    switch (surface->format)
+    {
+        case Media_Format_NV12:
+        case Media_Format_P010:
+            if (image->num_planes != 2 || image->pitches[1] != pitch || (image->offsets[1] % pitch))
+            {
+                return false;
+            }
+            *heightStride = image->offsets[1] / pitch;
+            rows          = MOS_MIN(*heightStride, (uint32_t)surface->iHeight);
+            size          = pitch * *heightStride + pitch * rows / 2;
+            break;
+        case Media_Format_YUY2:
+        case Media_Format_A8R8G8B8:
+        case Media_Format_X8R8G8B8:
+        case Media_Format_A8B8G8R8:
+        case Media_Format_X8B8G8R8:
+            if (image->num_planes != 1)
+            {
+                return false;
+            }
+            *heightStride = image->height;
+            size          = pitch * image->height;
+            break;
+        default:
+            return false;
+    }
+
+    return *heightStride >= image->height && size <= image->data_size;
+}
+
+//!
+//! \brief  Enqueue a copy of a whole image between a surface and the image buffer
+//!
+static VAStatus DdiMediaCopy_EnqueueGpu(
+    VADriverContextP   ctx,
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *buffer,
+    bool               toImage)
+{
+    DDI_CHK_NULL(ctx,     "nullptr ctx",     VA_STATUS_ERROR_INVALID_CONTEXT);
+    DDI_CHK_NULL(surface, "nullptr surface", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_NULL(image,   "nullptr image",   VA_STATUS_ERROR_INVALID_IMAGE);
+    DDI_CHK_NULL(buffer,  "nullptr buffer",  VA_STATUS_ERROR_INVALID_BUFFER);
+
+    PDDI_MEDIA_CONTEXT mediaCtx = DdiMedia_GetMediaContext(ctx);
+    DDI_CHK_NULL(mediaCtx, "nullptr mediaCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
+
+    DDI_MEDIA_COPY_ENGINE *engine = mediaCtx->pCopyEngine;
+    uint32_t heightStride = 0;
+    if (engine == nullptr || surface->bo == nullptr ||
+        !DdiMediaCopy_IsGpuCopyable(surface, image, buffer, &heightStride))
+    {
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    DdiMediaUtil_LockMutex(&engine->mutex);
+
+    if (!DdiMediaCopy_InitDevice(ctx, engine))
+    {
+        DdiMediaUtil_UnLockMutex(&engine->mutex);
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    // A surface or buffer has at most one copy in flight, so its CM surface is never created twice
+    DdiMediaCopy_RetireTasks(engine, surface, buffer);
+    if (engine->numTasks == DDI_MEDIA_COPY_GPU_MAX_PENDING)
+    {
+        DdiMediaCopy_RetireTask(engine, 0);
+    }
+
+    MOS_RESOURCE resource;
+    MOS_ZeroMemory(&resource, sizeof(resource));
+    DdiMedia_MediaSurfaceToMosResource(surface, &resource);
+
+    CmSurface2D *cmSurface = nullptr;
+    if (engine->device->CreateSurface2D(&resource, cmSurface) != CM_SUCCESS || cmSurface == nullptr)
+    {
+        DdiMediaUtil_UnLockMutex(&engine->mutex);
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    CmEvent *event  = nullptr;
+    int32_t  result = CM_SUCCESS;
+    if (toImage)
+    {
+        result = engine->queue->EnqueueCopyGPUToCPUFullStride(cmSurface,
+            buffer->pData, image->pitches[0], heightStride, CM_FASTCOPY_OPTION_NONBLOCKING, event);
+    }
+    else
+    {
+        result = engine->queue->EnqueueCopyCPUToGPUFullStride(cmSurface,
+            buffer->pData, image->pitches[0], heightStride, CM_FASTCOPY_OPTION_NONBLOCKING, event);
+    }
+
+    if (result != CM_SUCCESS)
+    {
+        engine->device->DestroySurface(cmSurface);
+        DdiMediaUtil_UnLockMutex(&engine->mutex);
+        DDI_VERBOSEMESSAGE("GPU copy failed with %d, copying on the CPU.", result);
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    DDI_MEDIA_COPY_TASK *task = &engine->tasks[engine->numTasks++];
+    task->event     = event;
+    task->cmSurface = cmSurface;
+    task->surface   = surface;
+    task->buffer    = buffer;
+
+    DdiMediaUtil_UnLockMutex(&engine->mutex);
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus DdiMediaCopy_SurfaceToImageGpu(
+    VADriverContextP   ctx,
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *imageBuf)
+{
+    return DdiMediaCopy_EnqueueGpu(ctx, surface, image, imageBuf, true);
+}
+
+VAStatus DdiMediaCopy_ImageToSurfaceGpu(
+    VADriverContextP   ctx,
+    DDI_MEDIA_SURFACE *surface,
+    VAImage           *image,
+    DDI_MEDIA_BUFFER  *imageBuf)
+{
+    return DdiMediaCopy_EnqueueGpu(ctx, surface, image, imageBuf, false);
+}
+
+void DdiMediaCopy_WaitSurface(PDDI_MEDIA_CONTEXT mediaCtx, DDI_MEDIA_SURFACE *surface)
+{
+    DDI_MEDIA_COPY_ENGINE *engine = mediaCtx ? mediaCtx->pCopyEngine : nullptr;
+    if (engine == nullptr || surface == nullptr)
+    {
+        return;
+    }
+
+    DdiMediaUtil_LockMutex(&engine->mutex);
+    DdiMediaCopy_RetireTasks(engine, surface, nullptr);
+    DdiMediaUtil_UnLockMutex(&engine->mutex);
+}
+
+void DdiMediaCopy_WaitBuffer(PDDI_MEDIA_CONTEXT mediaCtx, DDI_MEDIA_BUFFER *buffer)
+{
+    DDI_MEDIA_COPY_ENGINE *engine = mediaCtx ? mediaCtx->pCopyEngine : nullptr;
+    if (engine == nullptr || buffer == nullptr)
+    {
+        return;
+    }
+
+    DdiMediaUtil_LockMutex(&engine->mutex);
+    DdiMediaCopy_RetireTasks(engine, nullptr, buffer);
+    DdiMediaUtil_UnLockMutex(&engine->mutex);
+}
+
+VAStatus DdiMediaCopy_InitGpuCopy(PDDI_MEDIA_CONTEXT mediaCtx)
+{
+    DDI_CHK_NULL(mediaCtx, "nullptr mediaCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
+
+    DDI_MEDIA_COPY_ENGINE *engine = (DDI_MEDIA_COPY_ENGINE *)MOS_AllocAndZeroMemory(sizeof(DDI_MEDIA_COPY_ENGINE));
+    DDI_CHK_NULL(engine, "Failed to allocate the copy engine", VA_STATUS_ERROR_ALLOCATION_FAILED);
+
+    DdiMediaUtil_InitMutex(&engine->mutex);
+    mediaCtx->pCopyEngine = engine;
+    return VA_STATUS_SUCCESS;
+}
+
+void DdiMediaCopy_ReleaseGpuCopy(VADriverContextP ctx)
+{
+    PDDI_MEDIA_CONTEXT mediaCtx = ctx ? DdiMedia_GetMediaContext(ctx) : nullptr;
+    DDI_MEDIA_COPY_ENGINE *engine = mediaCtx ? mediaCtx->pCopyEngine : nullptr;
+    if (engine == nullptr)
+    {
+        return;
+    }
+
+    DdiMediaUtil_LockMutex(&engine->mutex);
+    while (engine->numTasks)
+    {
+        DdiMediaCopy_RetireTask(engine, 0);
+    }
+    if (engine->device)
+    {
+        // The queue is destroyed with the device
+        DestroyCmDeviceFromVA(ctx, engine->device);
+    }
+    DdiMediaUtil_UnLockMutex(&engine->mutex);
+
+    DdiMediaUtil_DestroyMutex(&engine->mutex);
+    MOS_FreeMemory(engine);
+    mediaCtx->pCopyEngine = nullptr;
+}
@@ -365,6 +365,7 @@ VAStatus DdiCodec_PutSurfaceLinuxHW(
 
     uint32_t                ctxType;
     PDDI_VP_CONTEXT         vpCtx;
+    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vpCtxHeapElmt;
     struct dri_drawable*    dri_drawable;
     union dri_buffer*       buffer;
 
@@ -374,7 +375,7 @@ VAStatus DdiCodec_PutSurfaceLinuxHW(
     DDI_CHK_NULL(mediaCtx, "Null mediaCtx", VA_STATUS_ERROR_INVALID_CONTEXT);
     DDI_CHK_NULL(mediaCtx->dri_output, "Null mediaDrvCtx->dri_output", VA_STATUS_ERROR_INVALID_PARAMETER);
     DDI_CHK_NULL(mediaCtx->pSurfaceHeap, "Null mediaDrvCtx->pSurfaceHeap", VA_STATUS_ERROR_INVALID_PARAMETER);
-    DDI_CHK_LESS((uint32_t)surface, mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaceId", VA_STATUS_ERROR_INVALID_SURFACE);
+    DDI_CHK_LESS(DDI_MEDIA_HEAP_INDEX(surface), mediaCtx->pSurfaceHeap->uiAllocatedHeapElements, "Invalid surfaceId", VA_STATUS_ERROR_INVALID_SURFACE);
 
     struct dri_vtable * const dri_vtable = &mediaCtx->dri_output->vtable;
     dri_drawable = dri_vtable->get_drawable(ctx, (Drawable)draw);
@@ -388,9 +389,10 @@ VAStatus DdiCodec_PutSurfaceLinuxHW(
     pitch = bufferObject->iPitch;
 
     vpCtx         = nullptr;
-    if (nullptr != mediaCtx->pVpCtxHeap->pHeapBase)
+    vpCtxHeapElmt = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(mediaCtx->pVpCtxHeap, 0);
+    if (nullptr != vpCtxHeapElmt)
     {
-        vpCtx = (PDDI_VP_CONTEXT)DdiMedia_GetContextFromContextID(ctx, (VAContextID)(0 + DDI_MEDIA_VACONTEXTID_OFFSET_VP), &ctxType);
+        vpCtx = (PDDI_VP_CONTEXT)DdiMedia_GetContextFromContextID(ctx, (VAContextID)(vpCtxHeapElmt->uiVaContextID + DDI_MEDIA_VACONTEXTID_OFFSET_VP), &ctxType);
         DDI_CHK_NULL(vpCtx, "Null vpCtx", VA_STATUS_ERROR_INVALID_PARAMETER);
         vpHal = vpCtx->pVpHal;
         DDI_CHK_NULL(vpHal, "Null vpHal", VA_STATUS_ERROR_INVALID_PARAMETER);
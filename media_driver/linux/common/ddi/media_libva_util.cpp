@@ -1194,181 +1194,215 @@ void DdiMediaUtil_PostSemaphore(PMEDIA_SEM_T  sem)
 }
 
 // heap related
-PDDI_MEDIA_SURFACE_HEAP_ELEMENT DdiMediaUtil_AllocPMediaSurfaceFromHeap(PDDI_MEDIA_HEAP surfaceHeap)
+// The free list head keeps index + 1 of the first free element in its lower
+// half and a tag bumped on every update in its upper half against ABA.
+#define DDI_MEDIA_HEAP_FREE_INDEX_MASK      0xFFFFFFFFull
+#define DDI_MEDIA_HEAP_FREE_TAG_INCREMENT   0x100000000ull
+
+static inline PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_HeapElementAt(PDDI_MEDIA_HEAP heap, uint32_t index)
 {
-    PDDI_MEDIA_SURFACE_HEAP_ELEMENT  mediaSurfaceHeapElmt;
+    uint8_t *chunk = (uint8_t *)__atomic_load_n(&heap->pHeapBase[index / DDI_MEDIA_HEAP_INCREMENTAL_SIZE], __ATOMIC_ACQUIRE);
+    return (PDDI_MEDIA_HEAP_ELEMENT)(chunk + (index % DDI_MEDIA_HEAP_INCREMENTAL_SIZE) * heap->uiHeapElementSize);
+}
 
-    if (nullptr == surfaceHeap->pFirstFreeHeapElement)
+static PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_PopFreeHeapElement(PDDI_MEDIA_HEAP heap)
+{
+    uint64_t head = __atomic_load_n(&heap->uiFirstFreeHeapElement, __ATOMIC_ACQUIRE);
+    while (head & DDI_MEDIA_HEAP_FREE_INDEX_MASK)
     {
-        void *newHeapBase = MOS_ReallocMemory(surfaceHeap->pHeapBase, (surfaceHeap->uiAllocatedHeapElements + DDI_MEDIA_HEAP_INCREMENTAL_SIZE) * sizeof(DDI_MEDIA_SURFACE_HEAP_ELEMENT));
-
-        if (nullptr == newHeapBase)
+        // chunks are never freed before the heap, so a stale head is still safe to read
+        PDDI_MEDIA_HEAP_ELEMENT heapElmt = DdiMediaUtil_HeapElementAt(heap, (uint32_t)(head & DDI_MEDIA_HEAP_FREE_INDEX_MASK) - 1);
+        uint64_t next = ((head & ~DDI_MEDIA_HEAP_FREE_INDEX_MASK) + DDI_MEDIA_HEAP_FREE_TAG_INCREMENT) |
+                        __atomic_load_n(&heapElmt->uiNextFree, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&heap->uiFirstFreeHeapElement, &head, next, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
         {
-            DDI_ASSERTMESSAGE("DDI: realloc failed.");
-            return nullptr;
+            return heapElmt;
         }
-        surfaceHeap->pHeapBase                    = newHeapBase;
-        PDDI_MEDIA_SURFACE_HEAP_ELEMENT surfaceHeapBase  = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)surfaceHeap->pHeapBase;
-        surfaceHeap->pFirstFreeHeapElement        = (void*)(&surfaceHeapBase[surfaceHeap->uiAllocatedHeapElements]);
-        for (int32_t i = 0; i < (DDI_MEDIA_HEAP_INCREMENTAL_SIZE); i++)
+    }
+    return nullptr;
+}
+
+static void DdiMediaUtil_PushFreeHeapElements(PDDI_MEDIA_HEAP heap, uint32_t firstIndex, PDDI_MEDIA_HEAP_ELEMENT lastElmt)
+{
+    uint64_t head = __atomic_load_n(&heap->uiFirstFreeHeapElement, __ATOMIC_RELAXED);
+    uint64_t next;
+    do
+    {
+        __atomic_store_n(&lastElmt->uiNextFree, (uint32_t)(head & DDI_MEDIA_HEAP_FREE_INDEX_MASK), __ATOMIC_RELAXED);
+        next = ((head & ~DDI_MEDIA_HEAP_FREE_INDEX_MASK) + DDI_MEDIA_HEAP_FREE_TAG_INCREMENT) | (firstIndex + 1);
+    } while (!__atomic_compare_exchange_n(&heap->uiFirstFreeHeapElement, &head, next, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static bool DdiMediaUtil_GrowHeap(PDDI_MEDIA_HEAP heap)
+{
+    uint32_t allocated  = __atomic_load_n(&heap->uiAllocatedHeapElements, __ATOMIC_ACQUIRE);
+    uint32_t chunkIndex = allocated / DDI_MEDIA_HEAP_INCREMENTAL_SIZE;
+    if (chunkIndex >= DDI_MEDIA_HEAP_MAX_CHUNKS)
+    {
+        DDI_ASSERTMESSAGE("DDI: heap is full.");
+        return false;
+    }
+
+    uint8_t *chunk = (uint8_t *)MOS_AllocAndZeroMemory(DDI_MEDIA_HEAP_INCREMENTAL_SIZE * heap->uiHeapElementSize);
+    if (nullptr == chunk)
+    {
+        DDI_ASSERTMESSAGE("DDI: alloc failed.");
+        return false;
+    }
+
+    PDDI_MEDIA_HEAP_ELEMENT heapElmt = nullptr;
+    for (uint32_t i = 0; i < DDI_MEDIA_HEAP_INCREMENTAL_SIZE; i++)
+    {
+        heapElmt             = (PDDI_MEDIA_HEAP_ELEMENT)(chunk + i * heap->uiHeapElementSize);
+        heapElmt->uiVaID     = allocated + i;
+        heapElmt->uiNextFree = (i == (DDI_MEDIA_HEAP_INCREMENTAL_SIZE - 1)) ? 0 : allocated + i + 2;
+    }
+
+    void *expected = nullptr;
+    if (!__atomic_compare_exchange_n(&heap->pHeapBase[chunkIndex], &expected, (void *)chunk, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        // another thread grew the heap first, its elements show up on the free list
+        MOS_FreeMemory(chunk);
+        return true;
+    }
+
+    __atomic_store_n(&heap->uiAllocatedHeapElements, allocated + DDI_MEDIA_HEAP_INCREMENTAL_SIZE, __ATOMIC_RELEASE);
+    DdiMediaUtil_PushFreeHeapElements(heap, allocated, heapElmt);
+    return true;
+}
+
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_AllocHeapElement(PDDI_MEDIA_HEAP heap)
+{
+    DDI_CHK_NULL(heap, "nullptr heap", nullptr);
+
+    PDDI_MEDIA_HEAP_ELEMENT heapElmt;
+    while (nullptr == (heapElmt = DdiMediaUtil_PopFreeHeapElement(heap)))
+    {
+        if (!DdiMediaUtil_GrowHeap(heap))
         {
-            mediaSurfaceHeapElmt                  = &surfaceHeapBase[surfaceHeap->uiAllocatedHeapElements + i];
-            mediaSurfaceHeapElmt->pNextFree       = (i == (DDI_MEDIA_HEAP_INCREMENTAL_SIZE - 1))? nullptr : &surfaceHeapBase[surfaceHeap->uiAllocatedHeapElements + i + 1];
-            mediaSurfaceHeapElmt->uiVaSurfaceID   = surfaceHeap->uiAllocatedHeapElements + i;
+            return nullptr;
         }
-        surfaceHeap->uiAllocatedHeapElements     += DDI_MEDIA_HEAP_INCREMENTAL_SIZE;
+    }
+    return heapElmt;
+}
+
+bool DdiMediaUtil_ReleaseHeapElement(PDDI_MEDIA_HEAP heap, uint32_t vaID)
+{
+    PDDI_MEDIA_HEAP_ELEMENT heapElmt = DdiMediaUtil_GetHeapElement(heap, vaID);
+    DDI_CHK_NULL(heapElmt, "invalid heap element id", false);
+
+    // a new generation makes the released id stale for lookups
+    uint32_t index    = DDI_MEDIA_HEAP_INDEX(vaID);
+    uint32_t expected = vaID;
+    uint32_t nextID   = ((vaID + (1 << DDI_MEDIA_HEAP_GENERATION_SHIFT)) & DDI_MEDIA_HEAP_GENERATION_MASK) | index;
+    if (!__atomic_compare_exchange_n(&heapElmt->uiVaID, &expected, nextID, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        DDI_ASSERTMESSAGE("DDI: heap element is already released.");
+        return false;
+    }
+
+    DdiMediaUtil_PushFreeHeapElements(heap, index, heapElmt);
+    return true;
+}
+
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_GetHeapElement(PDDI_MEDIA_HEAP heap, uint32_t vaID)
+{
+    if (nullptr == heap || (vaID & ~(DDI_MEDIA_HEAP_INDEX_MASK | DDI_MEDIA_HEAP_GENERATION_MASK)))
+    {
+        return nullptr;
     }
 
-    mediaSurfaceHeapElmt                          = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)surfaceHeap->pFirstFreeHeapElement;
-    surfaceHeap->pFirstFreeHeapElement            = mediaSurfaceHeapElmt->pNextFree;
+    PDDI_MEDIA_HEAP_ELEMENT heapElmt = DdiMediaUtil_GetHeapElementByIndex(heap, DDI_MEDIA_HEAP_INDEX(vaID));
+    if (nullptr == heapElmt || __atomic_load_n(&heapElmt->uiVaID, __ATOMIC_ACQUIRE) != vaID)
+    {
+        return nullptr;
+    }
+    return heapElmt;
+}
 
-    return mediaSurfaceHeapElmt;
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_GetHeapElementByIndex(PDDI_MEDIA_HEAP heap, uint32_t index)
+{
+    if (nullptr == heap || index >= __atomic_load_n(&heap->uiAllocatedHeapElements, __ATOMIC_ACQUIRE))
+    {
+        return nullptr;
+    }
+    return DdiMediaUtil_HeapElementAt(heap, index);
+}
+
+void DdiMediaUtil_DestroyHeapChunks(PDDI_MEDIA_HEAP heap)
+{
+    DDI_CHK_NULL(heap, "nullptr heap", );
+
+    for (uint32_t i = 0; i < DDI_MEDIA_HEAP_MAX_CHUNKS && heap->pHeapBase[i]; i++)
+    {
+        MOS_FreeMemory(heap->pHeapBase[i]);
+        heap->pHeapBase[i] = nullptr;
+    }
+    heap->uiAllocatedHeapElements = 0;
+    heap->uiFirstFreeHeapElement  = 0;
+}
+
+PDDI_MEDIA_SURFACE_HEAP_ELEMENT DdiMediaUtil_AllocPMediaSurfaceFromHeap(PDDI_MEDIA_HEAP surfaceHeap)
+{
+    return (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)DdiMediaUtil_AllocHeapElement(surfaceHeap);
 }
 
 
 void DdiMediaUtil_ReleasePMediaSurfaceFromHeap(PDDI_MEDIA_HEAP surfaceHeap, uint32_t vaSurfaceID)
 {
-    DDI_CHK_LESS(vaSurfaceID, surfaceHeap->uiAllocatedHeapElements, "invalid surface id", );
-    PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapBase                   = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)surfaceHeap->pHeapBase;
-    PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapElmt                   = &mediaSurfaceHeapBase[vaSurfaceID];
+    PDDI_MEDIA_SURFACE_HEAP_ELEMENT mediaSurfaceHeapElmt = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(surfaceHeap, vaSurfaceID);
+    DDI_CHK_NULL(mediaSurfaceHeapElmt, "invalid surface id", );
     DDI_CHK_NULL(mediaSurfaceHeapElmt->pSurface, "surface is already released", );
-    void *firstFree                         = surfaceHeap->pFirstFreeHeapElement;
-    surfaceHeap->pFirstFreeHeapElement     = (void*)mediaSurfaceHeapElmt;
-    mediaSurfaceHeapElmt->pNextFree        = (PDDI_MEDIA_SURFACE_HEAP_ELEMENT)firstFree;
     mediaSurfaceHeapElmt->pSurface         = nullptr;
+    DdiMediaUtil_ReleaseHeapElement(surfaceHeap, vaSurfaceID);
 }
 
 
 PDDI_MEDIA_BUFFER_HEAP_ELEMENT DdiMediaUtil_AllocPMediaBufferFromHeap(PDDI_MEDIA_HEAP bufferHeap)
 {
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT  mediaBufferHeapElmt;
-    if (nullptr == bufferHeap->pFirstFreeHeapElement)
-    {
-        void *newHeapBase = MOS_ReallocMemory(bufferHeap->pHeapBase, (bufferHeap->uiAllocatedHeapElements + DDI_MEDIA_HEAP_INCREMENTAL_SIZE) * sizeof(DDI_MEDIA_BUFFER_HEAP_ELEMENT));
-        if (nullptr == newHeapBase)
-        {
-            DDI_ASSERTMESSAGE("DDI: realloc failed.");
-            return nullptr;
-        }
-        bufferHeap->pHeapBase                                 = newHeapBase;
-        PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapBase    = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)bufferHeap->pHeapBase;
-        bufferHeap->pFirstFreeHeapElement     = (void*)(&mediaBufferHeapBase[bufferHeap->uiAllocatedHeapElements]);
-        for (int32_t i = 0; i < (DDI_MEDIA_HEAP_INCREMENTAL_SIZE); i++)
-        {
-            mediaBufferHeapElmt               = &mediaBufferHeapBase[bufferHeap->uiAllocatedHeapElements + i];
-            mediaBufferHeapElmt->pNextFree    = (i == (DDI_MEDIA_HEAP_INCREMENTAL_SIZE - 1))? nullptr : &mediaBufferHeapBase[bufferHeap->uiAllocatedHeapElements + i + 1];
-            mediaBufferHeapElmt->uiVaBufferID = bufferHeap->uiAllocatedHeapElements + i;
-        }
-        bufferHeap->uiAllocatedHeapElements  += DDI_MEDIA_HEAP_INCREMENTAL_SIZE;
-    }
-
-    mediaBufferHeapElmt                       = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)bufferHeap->pFirstFreeHeapElement;
-    bufferHeap->pFirstFreeHeapElement         = mediaBufferHeapElmt->pNextFree;
-    return mediaBufferHeapElmt;
+    return (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_AllocHeapElement(bufferHeap);
 }
 
 
 void DdiMediaUtil_ReleasePMediaBufferFromHeap(PDDI_MEDIA_HEAP bufferHeap, uint32_t vaBufferID)
 {
-    DDI_CHK_LESS(vaBufferID, bufferHeap->uiAllocatedHeapElements, "invalid buffer id", );
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapBase                    = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)bufferHeap->pHeapBase;
-    PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapElmt                    = &mediaBufferHeapBase[vaBufferID];
+    PDDI_MEDIA_BUFFER_HEAP_ELEMENT mediaBufferHeapElmt = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(bufferHeap, vaBufferID);
+    DDI_CHK_NULL(mediaBufferHeapElmt, "invalid buffer id", );
     DDI_CHK_NULL(mediaBufferHeapElmt->pBuffer, "buffer is already released", );
-    void *firstFree                        = bufferHeap->pFirstFreeHeapElement;
-    bufferHeap->pFirstFreeHeapElement      = (void*)mediaBufferHeapElmt;
-    mediaBufferHeapElmt->pNextFree         = (PDDI_MEDIA_BUFFER_HEAP_ELEMENT)firstFree;
     mediaBufferHeapElmt->pBuffer           = nullptr;
+    DdiMediaUtil_ReleaseHeapElement(bufferHeap, vaBufferID);
 }
 
 PDDI_MEDIA_IMAGE_HEAP_ELEMENT DdiMediaUtil_AllocPVAImageFromHeap(PDDI_MEDIA_HEAP imageHeap)
 {
-    PDDI_MEDIA_IMAGE_HEAP_ELEMENT   vaimageHeapElmt;
-
-    if (nullptr == imageHeap->pFirstFreeHeapElement)
-    {
-        void *newHeapBase = MOS_ReallocMemory(imageHeap->pHeapBase, (imageHeap->uiAllocatedHeapElements + DDI_MEDIA_HEAP_INCREMENTAL_SIZE) * sizeof(DDI_MEDIA_IMAGE_HEAP_ELEMENT));
-
-        if (nullptr == newHeapBase)
-        {
-            DDI_ASSERTMESSAGE("DDI: realloc failed.");
-            return nullptr;
-        }
-        imageHeap->pHeapBase                           = newHeapBase;
-        PDDI_MEDIA_IMAGE_HEAP_ELEMENT vaimageHeapBase  = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)imageHeap->pHeapBase;
-        imageHeap->pFirstFreeHeapElement               = (void*)(&vaimageHeapBase[imageHeap->uiAllocatedHeapElements]);
-        for (int32_t i = 0; i < (DDI_MEDIA_HEAP_INCREMENTAL_SIZE); i++)
-        {
-            vaimageHeapElmt                   = &vaimageHeapBase[imageHeap->uiAllocatedHeapElements + i];
-            vaimageHeapElmt->pNextFree        = (i == (DDI_MEDIA_HEAP_INCREMENTAL_SIZE - 1))? nullptr : &vaimageHeapBase[imageHeap->uiAllocatedHeapElements + i + 1];
-            vaimageHeapElmt->uiVaImageID      = imageHeap->uiAllocatedHeapElements + i;
-        }
-        imageHeap->uiAllocatedHeapElements   += DDI_MEDIA_HEAP_INCREMENTAL_SIZE;
-
-    }
-
-    vaimageHeapElmt                           = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)imageHeap->pFirstFreeHeapElement;
-    imageHeap->pFirstFreeHeapElement          = vaimageHeapElmt->pNextFree;
-    return vaimageHeapElmt;
+    return (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)DdiMediaUtil_AllocHeapElement(imageHeap);
 }
 
 
 void DdiMediaUtil_ReleasePVAImageFromHeap(PDDI_MEDIA_HEAP imageHeap, uint32_t vaImageID)
 {
-    PDDI_MEDIA_IMAGE_HEAP_ELEMENT    vaImageHeapBase;
     PDDI_MEDIA_IMAGE_HEAP_ELEMENT    vaImageHeapElmt;
-    void                            *firstFree;
 
-    DDI_CHK_LESS(vaImageID, imageHeap->uiAllocatedHeapElements, "invalid image id", );
-    vaImageHeapBase                    = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)imageHeap->pHeapBase;
-    vaImageHeapElmt                    = &vaImageHeapBase[vaImageID];
+    vaImageHeapElmt                    = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(imageHeap, vaImageID);
+    DDI_CHK_NULL(vaImageHeapElmt, "invalid image id", );
     DDI_CHK_NULL(vaImageHeapElmt->pImage, "image is already released", );
-    firstFree                          = imageHeap->pFirstFreeHeapElement;
-    imageHeap->pFirstFreeHeapElement   = (void*)vaImageHeapElmt;
-    vaImageHeapElmt->pNextFree         = (PDDI_MEDIA_IMAGE_HEAP_ELEMENT)firstFree;
     vaImageHeapElmt->pImage            = nullptr;
+    DdiMediaUtil_ReleaseHeapElement(imageHeap, vaImageID);
 }
 
 PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT DdiMediaUtil_AllocPVAContextFromHeap(PDDI_MEDIA_HEAP vaContextHeap)
 {
-    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT   vacontextHeapElmt;
-    if (nullptr == vaContextHeap->pFirstFreeHeapElement)
-    {
-        void *newHeapBase = MOS_ReallocMemory(vaContextHeap->pHeapBase, (vaContextHeap->uiAllocatedHeapElements + DDI_MEDIA_HEAP_INCREMENTAL_SIZE) * sizeof(DDI_MEDIA_VACONTEXT_HEAP_ELEMENT));
-
-        if (nullptr == newHeapBase)
-        {
-            DDI_ASSERTMESSAGE("DDI: realloc failed.");
-            return nullptr;
-        }
-        vaContextHeap->pHeapBase                            = newHeapBase;
-        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vacontextHeapBase = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)vaContextHeap->pHeapBase;
-        vaContextHeap->pFirstFreeHeapElement        = (void*)(&(vacontextHeapBase[vaContextHeap->uiAllocatedHeapElements]));
-        for (int32_t i = 0; i < (DDI_MEDIA_HEAP_INCREMENTAL_SIZE); i++)
-        {
-            vacontextHeapElmt                       = &vacontextHeapBase[vaContextHeap->uiAllocatedHeapElements + i];
-            vacontextHeapElmt->pNextFree            = (i == (DDI_MEDIA_HEAP_INCREMENTAL_SIZE - 1))? nullptr : &vacontextHeapBase[vaContextHeap->uiAllocatedHeapElements + i + 1];
-            vacontextHeapElmt->uiVaContextID        = vaContextHeap->uiAllocatedHeapElements + i;
-            vacontextHeapElmt->pVaContext           = nullptr;
-        }
-        vaContextHeap->uiAllocatedHeapElements     += DDI_MEDIA_HEAP_INCREMENTAL_SIZE;
-    }
-
-    vacontextHeapElmt                               = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)vaContextHeap->pFirstFreeHeapElement;
-    vaContextHeap->pFirstFreeHeapElement            = vacontextHeapElmt->pNextFree;
-    return vacontextHeapElmt;
+    return (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_AllocHeapElement(vaContextHeap);
 }
 
 
 void DdiMediaUtil_ReleasePVAContextFromHeap(PDDI_MEDIA_HEAP vaContextHeap, uint32_t vaContextID)
 {
-    DDI_CHK_LESS(vaContextID, vaContextHeap->uiAllocatedHeapElements, "invalid context id", );
-    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vaContextHeapBase = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)vaContextHeap->pHeapBase;
-    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vaContextHeapElmt = &vaContextHeapBase[vaContextID];
+    PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT vaContextHeapElmt = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElement(vaContextHeap, vaContextID);
+    DDI_CHK_NULL(vaContextHeapElmt, "invalid context id", );
     DDI_CHK_NULL(vaContextHeapElmt->pVaContext, "context is already released", );
-    void *firstFree                        = vaContextHeap->pFirstFreeHeapElement;
-    vaContextHeap->pFirstFreeHeapElement   = (void*)vaContextHeapElmt;
-    vaContextHeapElmt->pNextFree           = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)firstFree;
     vaContextHeapElmt->pVaContext          = nullptr;
+    DdiMediaUtil_ReleaseHeapElement(vaContextHeap, vaContextID);
 }
 
 void DdiMediaUtil_UnRefBufObjInMediaBuffer(PDDI_MEDIA_BUFFER buf)
@@ -1421,15 +1455,15 @@ VAStatus DdiMediaUtil_UnRegisterRTSurfaces(
     //Look through all decode contexts to unregister the surface in each decode context's RTtable.
     if (mediaCtx->pDecoderCtxHeap != nullptr)
     {
-        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT decVACtxHeapBase;
+        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT decVACtxHeapElmt;
 
         DdiMediaUtil_LockMutex(&mediaCtx->DecoderMutex);
-        decVACtxHeapBase  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)mediaCtx->pDecoderCtxHeap->pHeapBase;
-        for (int32_t j = 0; j < mediaCtx->pDecoderCtxHeap->uiAllocatedHeapElements; j++)
+        for (uint32_t j = 0; j < mediaCtx->pDecoderCtxHeap->uiAllocatedHeapElements; j++)
         {
-            if (decVACtxHeapBase[j].pVaContext != nullptr)
+            decVACtxHeapElmt  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(mediaCtx->pDecoderCtxHeap, j);
+            if (decVACtxHeapElmt != nullptr && decVACtxHeapElmt->pVaContext != nullptr)
             {
-                PDDI_DECODE_CONTEXT  decCtx = (PDDI_DECODE_CONTEXT)decVACtxHeapBase[j].pVaContext;
+                PDDI_DECODE_CONTEXT  decCtx = (PDDI_DECODE_CONTEXT)decVACtxHeapElmt->pVaContext;
                 if (decCtx && decCtx->m_ddiDecode)
                 {
                     //not check the return value since the surface may not be registered in the context. pay attention to LOGW.
@@ -1441,15 +1475,15 @@ VAStatus DdiMediaUtil_UnRegisterRTSurfaces(
     }
     if (mediaCtx->pEncoderCtxHeap != nullptr)
     {
-        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT pEncVACtxHeapBase;
+        PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT pEncVACtxHeapElmt;
 
         DdiMediaUtil_LockMutex(&mediaCtx->EncoderMutex);
-        pEncVACtxHeapBase  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)mediaCtx->pEncoderCtxHeap->pHeapBase;
-        for (int32_t j = 0; j < mediaCtx->pEncoderCtxHeap->uiAllocatedHeapElements; j++)
+        for (uint32_t j = 0; j < mediaCtx->pEncoderCtxHeap->uiAllocatedHeapElements; j++)
         {
-            if (pEncVACtxHeapBase[j].pVaContext != nullptr)
+            pEncVACtxHeapElmt  = (PDDI_MEDIA_VACONTEXT_HEAP_ELEMENT)DdiMediaUtil_GetHeapElementByIndex(mediaCtx->pEncoderCtxHeap, j);
+            if (pEncVACtxHeapElmt != nullptr && pEncVACtxHeapElmt->pVaContext != nullptr)
             {
-                PDDI_ENCODE_CONTEXT  pEncCtx = (PDDI_ENCODE_CONTEXT)pEncVACtxHeapBase[j].pVaContext;
+                PDDI_ENCODE_CONTEXT  pEncCtx = (PDDI_ENCODE_CONTEXT)pEncVACtxHeapElmt->pVaContext;
                 if (pEncCtx && pEncCtx->m_encode)
                 {
                     //not check the return value since the surface may not be registered in the context. pay attention to LOGW.
@@ -219,6 +219,68 @@ VAStatus DdiMediaUtil_FillPositionToRect(RECT *rect, int16_t offset_x, int16_t o
 //!
 bool     DdiMediaUtil_IsExternalSurface(PDDI_MEDIA_SURFACE surface);
 
+//!
+//! \brief  Allocate an element from heap
+//! \details Lock free. The heap grows by one chunk when it has no free
+//!          element, and chunks stay in place until the heap is destroyed.
+//!
+//! \param  [in] heap
+//!         Pointer to ddi media heap
+//!
+//! \return PDDI_MEDIA_HEAP_ELEMENT
+//!     Pointer to the heap element, its uiVaID is the id to hand out
+//!
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_AllocHeapElement(PDDI_MEDIA_HEAP heap);
+
+//!
+//! \brief  Release an element to heap
+//! \details Lock free. The generation in the id is bumped, so the released
+//!          id no longer resolves to the element.
+//!
+//! \param  [in] heap
+//!         Pointer to ddi media heap
+//! \param  [in] vaID
+//!         Id of the heap element
+//!
+//! \return bool
+//!     true if success, false if the id is invalid or already released
+//!
+bool     DdiMediaUtil_ReleaseHeapElement(PDDI_MEDIA_HEAP heap, uint32_t vaID);
+
+//!
+//! \brief  Look up a heap element by id without locking
+//!
+//! \param  [in] heap
+//!         Pointer to ddi media heap
+//! \param  [in] vaID
+//!         Id of the heap element
+//!
+//! \return PDDI_MEDIA_HEAP_ELEMENT
+//!     Pointer to the heap element, nullptr if the id is out of range or stale
+//!
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_GetHeapElement(PDDI_MEDIA_HEAP heap, uint32_t vaID);
+
+//!
+//! \brief  Get a heap element by index, whether it is in use or not
+//!
+//! \param  [in] heap
+//!         Pointer to ddi media heap
+//! \param  [in] index
+//!         Index of the heap element
+//!
+//! \return PDDI_MEDIA_HEAP_ELEMENT
+//!     Pointer to the heap element, nullptr if index is out of range
+//!
+PDDI_MEDIA_HEAP_ELEMENT DdiMediaUtil_GetHeapElementByIndex(PDDI_MEDIA_HEAP heap, uint32_t index);
+
+//!
+//! \brief  Free all chunks of heap
+//!
+//! \param  [in] heap
+//!         Pointer to ddi media heap
+//!
+void     DdiMediaUtil_DestroyHeapChunks(PDDI_MEDIA_HEAP heap);
+
 //!
 //! \brief  Allocate pmedia surface from heap
 //! 
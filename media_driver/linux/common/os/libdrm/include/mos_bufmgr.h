@@ -251,6 +251,23 @@ struct mos_linux_bo *mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
                         const char *name,
                         unsigned int handle);
 void mos_bufmgr_gem_enable_reuse(struct mos_bufmgr *bufmgr);
+void mos_bufmgr_gem_set_cache_limit(struct mos_bufmgr *bufmgr, uint64_t limit);
+void mos_bufmgr_gem_get_cache_stats(struct mos_bufmgr *bufmgr,
+                      uint64_t *hits,
+                      uint64_t *misses,
+                      uint64_t *evictions);
+int mos_bufmgr_gem_enable_softpin(struct mos_bufmgr *bufmgr);
+int mos_gem_bo_is_softpin(struct mos_linux_bo *bo);
+void mos_bufmgr_gem_get_exec_stats(struct mos_bufmgr *bufmgr,
+                     uint64_t *execs,
+                     uint64_t *unchanged,
+                     uint64_t *reused_bos);
+typedef void (*mos_deferred_flush_func)(void *data);
+void mos_bufmgr_gem_set_deferred_flush(struct mos_bufmgr *bufmgr,
+                       mos_deferred_flush_func func,
+                       void *data);
+void mos_bufmgr_gem_clear_deferred_flush(struct mos_bufmgr *bufmgr, void *data);
+void mos_gem_bo_mark_deferred(struct mos_linux_bo *bo, int deferred);
 void mos_bufmgr_gem_enable_fenced_relocs(struct mos_bufmgr *bufmgr);
 void mos_bufmgr_gem_set_vma_cache_size(struct mos_bufmgr *bufmgr,
                          int limit);
@@ -51,6 +51,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <stdbool.h>
+#include <unordered_map>
+#include <vector>
 #ifdef ANDROID
 #include <sync/sync.h>
 #endif
@@ -107,9 +109,35 @@
  */
 #define lower_32_bits(n) ((__u32)(n))
 
+/** Number of exact-size buckets learned for allocations above the rounded buckets */
+#define MOS_GEM_EXACT_BUCKETS 16
+
 struct mos_gem_bo_bucket {
     drmMMListHead head;
     unsigned long size;
+    /** Protects head, so allocations of different sizes don't contend */
+    pthread_mutex_t lock;
+};
+
+#define MOS_GEM_RELOC_POOL_SIZE 32
+
+/** Granularity and base of the GPU virtual addresses handed out in softpin mode */
+#define MOS_GEM_VA_ALIGNMENT    (64 * 1024)
+#define MOS_GEM_VA_BASE         (1ull << 20)
+#define MOS_GEM_VA_4GB          (1ull << 32)
+
+/** Softpin address ranges, below 4GB and above it for 48 bit capable bos */
+#define MOS_GEM_VA_RANGE_LOW    0
+#define MOS_GEM_VA_RANGE_HIGH   1
+#define MOS_GEM_VA_RANGE_COUNT  2
+
+struct mos_reloc_target;
+
+/** A validation list entry of the previous submission on a context */
+struct mos_gem_exec_entry {
+    struct mos_linux_bo *bo;
+    uint32_t release_count;
+    uint64_t offset;
 };
 
 struct mos_bufmgr_gem {
@@ -121,7 +149,12 @@ struct mos_bufmgr_gem {
 
     int max_relocs;
 
+    /** Protects the validation list and execbuffer submission */
     pthread_mutex_t lock;
+    /** Protects the named tables and the final unreference of a bo against lookups */
+    pthread_mutex_t named_lock;
+    /** Protects the vma cache and the per-bo mappings */
+    pthread_mutex_t vma_lock;
 
     struct drm_i915_gem_exec_object *exec_objects;
     struct drm_i915_gem_exec_object2 *exec2_objects;
@@ -129,14 +162,69 @@ struct mos_bufmgr_gem {
     int exec_size;
     int exec_count;
 
-    /** Array of lists of cached gem objects of power-of-two sizes */
-    struct mos_gem_bo_bucket cache_bucket[14 * 4];
+    /**
+     * Last validation list submitted per context. Bos found again at the
+     * same slot with the same offset already have their per-context
+     * offset recorded, and skip the contextOffsetMap update.
+     */
+    std::unordered_map<struct mos_linux_context *, std::vector<struct mos_gem_exec_entry>> *exec_lists;
+    uint64_t exec_lists_total;
+    uint64_t exec_lists_unchanged;
+    uint64_t exec_bos_reused;
+
+    /**
+     * Softpin mode: every bo is pinned at a GPU virtual address assigned
+     * here when it is created, so batches need no relocations. Addresses
+     * come from the range below 4GB, or from the one above for bos that
+     * opted in to 48 bit addresses. Sizes are rounded up to buckets, and
+     * released ranges are kept per range and bucket and handed out again
+     * before va_next grows.
+     */
+    bool softpin;
+    uint64_t va_next[MOS_GEM_VA_RANGE_COUNT];
+    uint64_t va_end[MOS_GEM_VA_RANGE_COUNT];
+    std::unordered_map<uint64_t, std::vector<uint64_t>> *va_free;
+    pthread_mutex_t va_lock;
+
+    /** Released relocation arrays of max_relocs entries, reused by mos_setup_reloc_list() */
+    std::vector<std::pair<struct drm_i915_gem_relocation_entry *, struct mos_reloc_target *>> *reloc_pool;
+    pthread_mutex_t reloc_pool_lock;
+
+    /**
+     * Array of lists of cached gem objects of power-of-two sizes, followed
+     * by exact-size buckets added on demand for sizes above cache_max_size
+     */
+    struct mos_gem_bo_bucket cache_bucket[14 * 4 + MOS_GEM_EXACT_BUCKETS];
     int num_buckets;
+    /** Last time the buckets were swept by mos_gem_cleanup_bo_cache */
     time_t time;
+    int num_round_buckets;
+    unsigned long cache_max_size;
+    /** Serializes adding exact-size buckets */
+    pthread_mutex_t bucket_lock;
+
+    /**
+     * Callback submitting the batches a client has queued instead of
+     * executing them, see mos_bufmgr_gem_set_deferred_flush()
+     */
+    mos_deferred_flush_func deferred_flush;
+    void *deferred_data;
+    /** Protects deferred_flush and deferred_data */
+    pthread_mutex_t deferred_lock;
+
+    /** Bytes held by the reuse cache, and the limit enforced by eviction (0 = unlimited) */
+    uint64_t cache_bytes;
+    uint64_t cache_limit;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t cache_evictions;
 
     drmMMListHead managers;
 
-    drmMMListHead named;
+    /** flink name -> bo, for bos imported by name or flinked by us */
+    std::unordered_map<uint32_t, struct mos_bo_gem *> *name_table;
+    /** gem handle -> bo, for every bo shared through flink or prime */
+    std::unordered_map<uint32_t, struct mos_bo_gem *> *handle_table;
     drmMMListHead vma_cache;
     int vma_count, vma_open, vma_max;
 
@@ -152,6 +240,9 @@ struct mos_bufmgr_gem {
     unsigned int no_exec : 1;
     unsigned int has_vebox : 1;
     unsigned int has_ext_mmap : 1;
+    unsigned int has_softpin : 1;
+    unsigned int has_full_ppgtt : 1;
+    unsigned int has_full_48b_ppgtt : 1;
     bool fenced_relocs;
 
     struct {
@@ -167,6 +258,7 @@ struct mos_bufmgr_gem {
 } mos_bufmgr_gem;
 
 #define DRM_INTEL_RELOC_FENCE (1<<0)
+#define DRM_INTEL_RELOC_WRITE (1<<1)
 
 struct mos_reloc_target {
     struct mos_linux_bo *bo;
@@ -182,11 +274,8 @@ struct mos_bo_gem {
 
     /**
      * Kenel-assigned global name for this object
-         *
-         * List contains both flink named and prime fd'd objects
      */
     unsigned int global_name;
-    drmMMListHead name_list;
 
     /**
      * Index of the buffer within the validation list while preparing a
@@ -212,7 +301,7 @@ struct mos_bo_gem {
     /** Number of entries in relocs */
     int reloc_count;
     /** Array of BOs that are referenced by this buffer and will be softpinned */
-    struct mos_linux_bo **softpin_target;
+    struct mos_reloc_target *softpin_target;
     /** Number softpinned BOs that are referenced by this buffer */
     int softpin_target_count;
     /** Maximum amount of softpinned BOs that are referenced by this buffer */
@@ -267,6 +356,18 @@ struct mos_bo_gem {
      */
     bool idle;
 
+    /**
+     * Number of times this bo was released to the reuse cache or freed, so
+     * that a validation list entry is not mistaken for its next owner's
+     */
+    uint32_t release_count;
+
+    /**
+     * Number of batches queued through the deferred flush hook, but not
+     * yet executed, that reference this buffer.
+     */
+    atomic_t deferred_refs;
+
     /**
      * Boolean of whether this buffer was allocated with userptr
      */
@@ -286,6 +387,12 @@ struct mos_bo_gem {
      */
     bool is_softpin;
 
+    /**
+     * Size of the range from the softpin address allocator backing
+     * offset64, 0 if the bo was not pinned by the bufmgr
+     */
+    uint64_t va_size;
+
     /**
      * Size in bytes of this buffer and its relocation descendents.
      *
@@ -331,7 +438,7 @@ mos_gem_bo_set_tiling_internal(struct mos_linux_bo *bo,
                      uint32_t tiling_mode,
                      uint32_t stride);
 
-static void mos_gem_bo_unreference_locked_timed(struct mos_linux_bo *bo,
+static bool mos_gem_bo_unreference_timed(struct mos_linux_bo *bo,
                               time_t time);
 
 static void mos_gem_bo_unreference(struct mos_linux_bo *bo);
@@ -385,21 +492,72 @@ mos_gem_bo_tile_pitch(struct mos_bufmgr_gem *bufmgr_gem,
     return ROUND_UP_TO(pitch, tile_width);
 }
 
+static void
+add_bucket(struct mos_bufmgr_gem *bufmgr_gem, unsigned long size);
+
 static struct mos_gem_bo_bucket *
-mos_gem_bo_bucket_for_size(struct mos_bufmgr_gem *bufmgr_gem,
+mos_gem_bo_exact_bucket(struct mos_bufmgr_gem *bufmgr_gem,
                  unsigned long size)
 {
+    int i, num_buckets;
+
+    num_buckets = __atomic_load_n(&bufmgr_gem->num_buckets, __ATOMIC_ACQUIRE);
+    for (i = bufmgr_gem->num_round_buckets; i < num_buckets; i++) {
+        if (bufmgr_gem->cache_bucket[i].size == size)
+            return &bufmgr_gem->cache_bucket[i];
+    }
+
+    return nullptr;
+}
+
+/**
+ * Returns the bucket for the given size. Sizes up to cache_max_size are
+ * rounded up to the next bucket; larger sizes (4K/8K tiled surfaces) only
+ * match an exact-size bucket, which is learned on allocation if @learn is
+ * set and there is a free slot.
+ */
+static struct mos_gem_bo_bucket *
+mos_gem_bo_bucket_for_size(struct mos_bufmgr_gem *bufmgr_gem,
+                 unsigned long size,
+                 bool learn = false)
+{
+    struct mos_gem_bo_bucket *bucket;
     int i;
 
-    for (i = 0; i < bufmgr_gem->num_buckets; i++) {
-        struct mos_gem_bo_bucket *bucket =
-            &bufmgr_gem->cache_bucket[i];
-        if (bucket->size >= size) {
-            return bucket;
+    if (size <= bufmgr_gem->cache_max_size) {
+        for (i = 0; i < bufmgr_gem->num_round_buckets; i++) {
+            bucket = &bufmgr_gem->cache_bucket[i];
+            if (bucket->size >= size) {
+                return bucket;
+            }
         }
+        return nullptr;
     }
 
-    return nullptr;
+    size = ROUND_UP_TO(size, getpagesize());
+    bucket = mos_gem_bo_exact_bucket(bufmgr_gem, size);
+    if (bucket != nullptr || !learn)
+        return bucket;
+
+    pthread_mutex_lock(&bufmgr_gem->bucket_lock);
+    bucket = mos_gem_bo_exact_bucket(bufmgr_gem, size);
+    if (bucket == nullptr &&
+        bufmgr_gem->num_buckets < (int)ARRAY_SIZE(bufmgr_gem->cache_bucket)) {
+        add_bucket(bufmgr_gem, size);
+        bucket = &bufmgr_gem->cache_bucket[bufmgr_gem->num_buckets - 1];
+    }
+    pthread_mutex_unlock(&bufmgr_gem->bucket_lock);
+
+    return bucket;
+}
+
+/* Called with the bucket lock held */
+static void
+mos_gem_bo_cache_remove(struct mos_bufmgr_gem *bufmgr_gem,
+                    struct mos_bo_gem *bo_gem)
+{
+    DRMLISTDEL(&bo_gem->head);
+    __sync_fetch_and_sub(&bufmgr_gem->cache_bytes, bo_gem->bo.size);
 }
 
 static void
@@ -439,7 +597,7 @@ mos_gem_dump_validation_list(struct mos_bufmgr_gem *bufmgr_gem)
         }
 
         for (j = 0; j < bo_gem->softpin_target_count; j++) {
-            struct mos_linux_bo *target_bo = bo_gem->softpin_target[j];
+            struct mos_linux_bo *target_bo = bo_gem->softpin_target[j].bo;
             struct mos_bo_gem *target_gem =
                 (struct mos_bo_gem *) target_bo;
             MOS_DBG("%2d: %d %s(%s) -> "
@@ -524,7 +682,7 @@ mos_add_validate_buffer(struct mos_linux_bo *bo)
 }
 
 static void
-mos_add_validate_buffer2(struct mos_linux_bo *bo, int need_fence)
+mos_add_validate_buffer2(struct mos_linux_bo *bo, int need_fence, int need_write)
 {
     struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *)bo->bufmgr;
     struct mos_bo_gem *bo_gem = (struct mos_bo_gem *)bo;
@@ -543,6 +701,8 @@ mos_add_validate_buffer2(struct mos_linux_bo *bo, int need_fence)
         flags |= EXEC_OBJECT_SUPPORTS_48B_ADDRESS;
     if (bo_gem->is_softpin)
         flags |= EXEC_OBJECT_PINNED;
+    if (need_write)
+        flags |= EXEC_OBJECT_WRITE;
 
     if (bo_gem->validate_index != -1) {
         bufmgr_gem->exec2_objects[bo_gem->validate_index].flags |= flags;
@@ -638,6 +798,18 @@ mos_setup_reloc_list(struct mos_linux_bo *bo)
     if (bo->size / 4 < max_relocs)
         max_relocs = bo->size / 4;
 
+    if (max_relocs == (unsigned int)bufmgr_gem->max_relocs) {
+        pthread_mutex_lock(&bufmgr_gem->reloc_pool_lock);
+        if (!bufmgr_gem->reloc_pool->empty()) {
+            bo_gem->relocs = bufmgr_gem->reloc_pool->back().first;
+            bo_gem->reloc_target_info = bufmgr_gem->reloc_pool->back().second;
+            bufmgr_gem->reloc_pool->pop_back();
+            pthread_mutex_unlock(&bufmgr_gem->reloc_pool_lock);
+            return 0;
+        }
+        pthread_mutex_unlock(&bufmgr_gem->reloc_pool_lock);
+    }
+
     bo_gem->relocs = (struct drm_i915_gem_relocation_entry *)malloc(max_relocs *
                 sizeof(struct drm_i915_gem_relocation_entry));
     bo_gem->reloc_target_info = (struct mos_reloc_target *)malloc(max_relocs *
@@ -657,6 +829,189 @@ mos_setup_reloc_list(struct mos_linux_bo *bo)
     return 0;
 }
 
+/* Releases the relocation arrays, keeping full-size ones for the next bo */
+static void
+mos_gem_bo_release_reloc_list(struct mos_linux_bo *bo)
+{
+    struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
+    bool pooled = false;
+
+    if (bo_gem->relocs && bo_gem->reloc_target_info &&
+        bo->size / 4 >= (unsigned long)bufmgr_gem->max_relocs) {
+        pthread_mutex_lock(&bufmgr_gem->reloc_pool_lock);
+        if (bufmgr_gem->reloc_pool->size() < MOS_GEM_RELOC_POOL_SIZE) {
+            bufmgr_gem->reloc_pool->push_back(
+                std::make_pair(bo_gem->relocs, bo_gem->reloc_target_info));
+            pooled = true;
+        }
+        pthread_mutex_unlock(&bufmgr_gem->reloc_pool_lock);
+    }
+
+    if (!pooled) {
+        free(bo_gem->reloc_target_info);
+        free(bo_gem->relocs);
+    }
+    bo_gem->reloc_target_info = nullptr;
+    bo_gem->relocs = nullptr;
+}
+
+/*
+ * Rounds size up to one of four buckets per power of two, as the bo cache
+ * does, so that released ranges fit later bos of similar sizes.
+ */
+static uint64_t
+mos_gem_va_bucket_size(uint64_t size)
+{
+    uint64_t pow2 = MOS_GEM_VA_ALIGNMENT;
+    int i;
+
+    if (size <= MOS_GEM_VA_ALIGNMENT)
+        return MOS_GEM_VA_ALIGNMENT;
+
+    while (pow2 * 2 <= size)
+        pow2 *= 2;
+
+    for (i = 0; i < 4; i++) {
+        if (pow2 + pow2 * i / 4 >= size)
+            break;
+    }
+
+    return ALIGN(pow2 + pow2 * i / 4, MOS_GEM_VA_ALIGNMENT);
+}
+
+/* Key of the free list of a range and bucket size, which is 64KB aligned */
+#define MOS_GEM_VA_FREE_KEY(range, size)    ((size) | (range))
+
+static int
+mos_gem_va_range(uint64_t offset)
+{
+    return offset >= MOS_GEM_VA_4GB ? MOS_GEM_VA_RANGE_HIGH : MOS_GEM_VA_RANGE_LOW;
+}
+
+/*
+ * Returns a GPU virtual address range of size bytes in the given range,
+ * size being a bucket size, or 0 if the range is exhausted
+ */
+static uint64_t
+mos_gem_va_alloc(struct mos_bufmgr_gem *bufmgr_gem, int range, uint64_t size, uint64_t alignment)
+{
+    uint64_t offset = 0;
+
+    pthread_mutex_lock(&bufmgr_gem->va_lock);
+    auto free_list = bufmgr_gem->va_free->find(MOS_GEM_VA_FREE_KEY(range, size));
+    if (free_list != bufmgr_gem->va_free->end()) {
+        for (auto it = free_list->second.begin(); it != free_list->second.end(); it++) {
+            if ((*it & (alignment - 1)) == 0) {
+                offset = *it;
+                *it = free_list->second.back();
+                free_list->second.pop_back();
+                break;
+            }
+        }
+    }
+    if (offset == 0) {
+        uint64_t start = ALIGN(bufmgr_gem->va_next[range], alignment);
+        if (start + size <= bufmgr_gem->va_end[range]) {
+            offset = start;
+            bufmgr_gem->va_next[range] = start + size;
+        }
+    }
+    pthread_mutex_unlock(&bufmgr_gem->va_lock);
+
+    return offset;
+}
+
+static void
+mos_gem_va_free(struct mos_bufmgr_gem *bufmgr_gem, uint64_t offset, uint64_t size)
+{
+    pthread_mutex_lock(&bufmgr_gem->va_lock);
+    (*bufmgr_gem->va_free)[MOS_GEM_VA_FREE_KEY(mos_gem_va_range(offset), size)].push_back(offset);
+    pthread_mutex_unlock(&bufmgr_gem->va_lock);
+}
+
+/**
+ * Pins bo at an address of its own in softpin mode, below 4GB unless the
+ * bo opted in to 48 bit addresses. A bo coming back from the reuse cache
+ * keeps its range unless it does not meet alignment or lies above 4GB
+ * while the bo now needs a 32 bit address. A bo left unpinned because
+ * the address space is exhausted is relocated by the kernel as before.
+ */
+static void
+mos_gem_bo_assign_va(struct mos_bufmgr_gem *bufmgr_gem,
+               struct mos_bo_gem *bo_gem,
+               unsigned int alignment)
+{
+    uint64_t va_alignment = MOS_GEM_VA_ALIGNMENT;
+
+    if (alignment > va_alignment)
+        va_alignment = alignment;
+
+    if (bo_gem->va_size &&
+        ((bo_gem->bo.offset64 & (va_alignment - 1)) ||
+         (!bo_gem->use_48b_address_range &&
+          mos_gem_va_range(bo_gem->bo.offset64) == MOS_GEM_VA_RANGE_HIGH))) {
+        mos_gem_va_free(bufmgr_gem, bo_gem->bo.offset64, bo_gem->va_size);
+        bo_gem->va_size = 0;
+        bo_gem->is_softpin = false;
+    }
+
+    if (bo_gem->va_size == 0) {
+        uint64_t size = mos_gem_va_bucket_size(bo_gem->bo.size);
+        uint64_t offset = 0;
+
+        if (bo_gem->use_48b_address_range)
+            offset = mos_gem_va_alloc(bufmgr_gem, MOS_GEM_VA_RANGE_HIGH, size, va_alignment);
+        if (offset == 0)
+            offset = mos_gem_va_alloc(bufmgr_gem, MOS_GEM_VA_RANGE_LOW, size, va_alignment);
+        if (offset == 0)
+            return;
+
+        bo_gem->va_size = size;
+        bo_gem->is_softpin = true;
+        bo_gem->bo.offset64 = offset;
+        bo_gem->bo.offset = offset;
+    }
+}
+
+/**
+ * Submits the batches a client queued through mos_bufmgr_gem_set_deferred_flush().
+ * Called before anything that executes or waits on the GPU, so that a queued
+ * batch is never overtaken and a CPU access never misses its rendering.
+ */
+static void
+mos_gem_flush_deferred(struct mos_bufmgr_gem *bufmgr_gem)
+{
+    mos_deferred_flush_func func;
+    void *data;
+
+    if (__atomic_load_n(&bufmgr_gem->deferred_flush, __ATOMIC_ACQUIRE) == nullptr)
+        return;
+
+    pthread_mutex_lock(&bufmgr_gem->deferred_lock);
+    func = bufmgr_gem->deferred_flush;
+    data = bufmgr_gem->deferred_data;
+    bufmgr_gem->deferred_flush = nullptr;
+    bufmgr_gem->deferred_data = nullptr;
+    pthread_mutex_unlock(&bufmgr_gem->deferred_lock);
+
+    if (func)
+        func(data);
+}
+
+/**
+ * Submits the queued batches before the CPU maps, waits on or polls bo, if
+ * any of them reference it.
+ */
+static inline void
+mos_gem_bo_flush_deferred(struct mos_linux_bo *bo)
+{
+    struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
+
+    if (atomic_read(&bo_gem->deferred_refs))
+        mos_gem_flush_deferred((struct mos_bufmgr_gem *) bo->bufmgr);
+}
+
 static int
 mos_gem_bo_busy(struct mos_linux_bo *bo)
 {
@@ -681,6 +1036,17 @@ mos_gem_bo_busy(struct mos_linux_bo *bo)
     return (ret == 0 && busy.busy);
 }
 
+/*
+ * bo_busy entry point. Internal callers probing the reuse cache use
+ * mos_gem_bo_busy() directly, as they run under a bucket lock.
+ */
+static int
+mos_gem_bo_busy_deferred(struct mos_linux_bo *bo)
+{
+    mos_gem_bo_flush_deferred(bo);
+    return mos_gem_bo_busy(bo);
+}
+
 static int
 mos_gem_bo_madvise_internal(struct mos_bufmgr_gem *bufmgr_gem,
                  struct mos_bo_gem *bo_gem, int state)
@@ -719,7 +1085,7 @@ mos_gem_bo_cache_purge_bucket(struct mos_bufmgr_gem *bufmgr_gem,
             (bufmgr_gem, bo_gem, I915_MADV_DONTNEED))
             break;
 
-        DRMLISTDEL(&bo_gem->head);
+        mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
         mos_gem_bo_free(&bo_gem->bo);
     }
 }
@@ -728,26 +1094,24 @@ mos_gem_bo_cache_purge_bucket(struct mos_bufmgr_gem *bufmgr_gem,
 static void
 mos_gem_empty_bo_cache(struct mos_bufmgr_gem *bufmgr_gem)
 {
-    pthread_mutex_lock(&bufmgr_gem->lock);
-
     int i;
 
     for (i = 0; i < bufmgr_gem->num_buckets; i++) {
         struct mos_gem_bo_bucket *bucket =
             &bufmgr_gem->cache_bucket[i];
 
+        pthread_mutex_lock(&bucket->lock);
         while (!DRMLISTEMPTY(&bucket->head)) {
             struct mos_bo_gem *bo_gem;
 
             bo_gem = DRMLISTENTRY(struct mos_bo_gem,
                           bucket->head.next, head);
 
-            DRMLISTDEL(&bo_gem->head);
+            mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
             mos_gem_bo_free(&bo_gem->bo);
         }
+        pthread_mutex_unlock(&bucket->lock);
     }
-
-    pthread_mutex_unlock(&bufmgr_gem->lock);
 }
 #endif
 
@@ -774,7 +1138,8 @@ mos_gem_bo_alloc_internal(struct mos_bufmgr *bufmgr,
         for_render = true;
 
     /* Round the allocated size up to a power of two number of pages. */
-    bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, size);
+    bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, size,
+                                        bufmgr_gem->bo_reuse);
 
     /* If we don't have caching at this size, don't actually round the
      * allocation up.
@@ -787,7 +1152,8 @@ mos_gem_bo_alloc_internal(struct mos_bufmgr *bufmgr,
         bo_size = bucket->size;
     }
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    if (bucket != nullptr)
+        pthread_mutex_lock(&bucket->lock);
     /* Get a buffer out of the cache if available */
 retry:
     alloc_from_cache = false;
@@ -799,7 +1165,7 @@ retry:
              */
             bo_gem = DRMLISTENTRY(struct mos_bo_gem,
                           bucket->head.prev, head);
-            DRMLISTDEL(&bo_gem->head);
+            mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
             alloc_from_cache = true;
             bo_gem->bo.align = alignment;
         } else {
@@ -815,7 +1181,7 @@ retry:
                           bucket->head.next, head);
             if (!mos_gem_bo_busy(&bo_gem->bo)) {
                 alloc_from_cache = true;
-                DRMLISTDEL(&bo_gem->head);
+                mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
             }
         }
 
@@ -836,7 +1202,12 @@ retry:
             }
         }
     }
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    if (bucket != nullptr)
+        pthread_mutex_unlock(&bucket->lock);
+
+    if (bufmgr_gem->bo_reuse)
+        __sync_fetch_and_add(alloc_from_cache ? &bufmgr_gem->cache_hits :
+                             &bufmgr_gem->cache_misses, 1);
 
     if (!alloc_from_cache) {
         struct drm_i915_gem_create create;
@@ -868,7 +1239,6 @@ retry:
 
         /* drm_intel_gem_bo_free calls DRMLISTDEL() for an uninitialized
            list (vma_list), so better set the list head here */
-        DRMINITLISTHEAD(&bo_gem->name_list);
         DRMINITLISTHEAD(&bo_gem->vma_list);
         if (mos_gem_bo_set_tiling_internal(&bo_gem->bo,
                              tiling_mode,
@@ -886,6 +1256,8 @@ retry:
     bo_gem->has_error = false;
     bo_gem->reusable = true;
     bo_gem->use_48b_address_range = false;
+    if (bufmgr_gem->softpin)
+        mos_gem_bo_assign_va(bufmgr_gem, bo_gem, alignment);
 
     mos_bo_gem_set_in_aperture_size(bufmgr_gem, bo_gem, alignment);
 
@@ -925,12 +1297,12 @@ mos_gem_bo_alloc_internal(struct mos_bufmgr *bufmgr,
         bucket = nullptr;
     } else {
         /* Round the allocated size up to a power of two number of pages. */
-        bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, size);
+        bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, size,
+                                            bufmgr_gem->bo_reuse);
     }
 
-    bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, size);
-
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    if (bucket != nullptr)
+        pthread_mutex_lock(&bucket->lock);
     /* Get a buffer out of the cache if available */
 retry:
     alloc_from_cache = false;
@@ -946,7 +1318,7 @@ retry:
                     entry, head);
 
                 if (bo_gem->bo.size >= size) {
-                    DRMLISTDEL(&bo_gem->head);
+                    mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
                     alloc_from_cache = true;
                     break;
                 }
@@ -966,7 +1338,7 @@ retry:
 
                 if ((bo_gem->bo.size >= size) &&
                 !mos_gem_bo_busy(&bo_gem->bo)) {
-                    DRMLISTDEL(&bo_gem->head);
+                    mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
                     alloc_from_cache = true;
                     break;
                 }
@@ -998,7 +1370,12 @@ retry:
     if (alloc_from_cache && (flags & BO_ALLOC_FLUSH))
         mos_gem_bo_start_gtt_access(&bo_gem->bo, 0);
 
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    if (bucket != nullptr)
+        pthread_mutex_unlock(&bucket->lock);
+
+    if (bufmgr_gem->bo_reuse)
+        __sync_fetch_and_add(alloc_from_cache ? &bufmgr_gem->cache_hits :
+                             &bufmgr_gem->cache_misses, 1);
 
     if (!alloc_from_cache) {
         struct drm_i915_gem_create create;
@@ -1067,7 +1444,6 @@ retry:
 
         /* drm_intel_gem_bo_free calls DRMLISTDEL() for an uninitialized
            list (vma_list), so better set the list head here */
-        DRMINITLISTHEAD(&bo_gem->name_list);
         DRMINITLISTHEAD(&bo_gem->vma_list);
         if (mos_gem_bo_set_tiling_internal(&bo_gem->bo,
                              tiling_mode,
@@ -1256,7 +1632,6 @@ mos_gem_bo_alloc_userptr(struct mos_bufmgr *bufmgr,
     bo_gem->swizzle_mode = I915_BIT_6_SWIZZLE_NONE;
     bo_gem->stride       = 0;
 
-    DRMINITLISTHEAD(&bo_gem->name_list);
     DRMINITLISTHEAD(&bo_gem->vma_list);
 
     bo_gem->name = name;
@@ -1267,6 +1642,8 @@ mos_gem_bo_alloc_userptr(struct mos_bufmgr *bufmgr,
     bo_gem->has_error = false;
     bo_gem->reusable = false;
     bo_gem->use_48b_address_range = false;
+    if (bufmgr_gem->softpin)
+        mos_gem_bo_assign_va(bufmgr_gem, bo_gem, 0);
 
 #ifdef ANDROID
     mos_bo_gem_set_in_aperture_size(bufmgr_gem, bo_gem);
@@ -1420,6 +1797,31 @@ mos_bo_gem_create_from_prime_fd(struct mos_bufmgr *bufmgr,
 }
 #endif
 
+/* Called with named_lock held */
+static struct mos_bo_gem *
+mos_gem_bo_find_named(std::unordered_map<uint32_t, struct mos_bo_gem *> *table,
+                      uint32_t key)
+{
+    auto it = table->find(key);
+    return it != table->end() ? it->second : nullptr;
+}
+
+/* Called with named_lock held */
+static void
+mos_gem_bo_remove_named(struct mos_bufmgr_gem *bufmgr_gem,
+                        struct mos_bo_gem *bo_gem)
+{
+    auto it = bufmgr_gem->handle_table->find(bo_gem->gem_handle);
+    if (it != bufmgr_gem->handle_table->end() && it->second == bo_gem)
+        bufmgr_gem->handle_table->erase(it);
+
+    if (bo_gem->global_name) {
+        it = bufmgr_gem->name_table->find(bo_gem->global_name);
+        if (it != bufmgr_gem->name_table->end() && it->second == bo_gem)
+            bufmgr_gem->name_table->erase(it);
+    }
+}
+
 /**
  * Returns a drm_intel_bo wrapping the given buffer object handle.
  *
@@ -1436,24 +1838,16 @@ mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
     int ret;
     struct drm_gem_open open_arg;
     struct drm_i915_gem_get_tiling get_tiling;
-    drmMMListHead *list;
 
-    /* At the moment most applications only have a few named bo.
-     * For instance, in a DRI client only the render buffers passed
-     * between X and the client are named. And since X returns the
-     * alternating names for the front/back buffer a linear search
-     * provides a sufficiently fast match.
+    /* Zero-copy pipelines may import thousands of shared surfaces,
+     * so named and prime bos are kept in hash tables rather than a list.
      */
-    pthread_mutex_lock(&bufmgr_gem->lock);
-    for (list = bufmgr_gem->named.next;
-         list != &bufmgr_gem->named;
-         list = list->next) {
-        bo_gem = DRMLISTENTRY(struct mos_bo_gem, list, name_list);
-        if (bo_gem->global_name == handle) {
-            mos_gem_bo_reference(&bo_gem->bo);
-            pthread_mutex_unlock(&bufmgr_gem->lock);
-            return &bo_gem->bo;
-        }
+    pthread_mutex_lock(&bufmgr_gem->named_lock);
+    bo_gem = mos_gem_bo_find_named(bufmgr_gem->name_table, handle);
+    if (bo_gem) {
+        mos_gem_bo_reference(&bo_gem->bo);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
+        return &bo_gem->bo;
     }
 
     memclear(open_arg);
@@ -1464,27 +1858,22 @@ mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
     if (ret != 0) {
         MOS_DBG("Couldn't reference %s handle 0x%08x: %s\n",
             name, handle, strerror(errno));
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
         return nullptr;
     }
-        /* Now see if someone has used a prime handle to get this
-         * object from the kernel before by looking through the list
-         * again for a matching gem_handle
-         */
-    for (list = bufmgr_gem->named.next;
-         list != &bufmgr_gem->named;
-         list = list->next) {
-        bo_gem = DRMLISTENTRY(struct mos_bo_gem, list, name_list);
-        if (bo_gem->gem_handle == open_arg.handle) {
-            mos_gem_bo_reference(&bo_gem->bo);
-            pthread_mutex_unlock(&bufmgr_gem->lock);
-            return &bo_gem->bo;
-        }
+    /* Now see if someone has used a prime handle to get this
+     * object from the kernel before by looking for a matching gem_handle
+     */
+    bo_gem = mos_gem_bo_find_named(bufmgr_gem->handle_table, open_arg.handle);
+    if (bo_gem) {
+        mos_gem_bo_reference(&bo_gem->bo);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
+        return &bo_gem->bo;
     }
 
     bo_gem = (struct mos_bo_gem *)calloc(1, sizeof(*bo_gem));
     if (!bo_gem) {
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
         return nullptr;
     }
 
@@ -1505,6 +1894,9 @@ mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
     bo_gem->global_name = handle;
     bo_gem->reusable = false;
     bo_gem->use_48b_address_range = false;
+    if (bufmgr_gem->softpin)
+        mos_gem_bo_assign_va(bufmgr_gem, bo_gem, 0);
+    DRMINITLISTHEAD(&bo_gem->vma_list);
 
     memclear(get_tiling);
     get_tiling.handle = bo_gem->gem_handle;
@@ -1512,8 +1904,9 @@ mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
                DRM_IOCTL_I915_GEM_GET_TILING,
                &get_tiling);
     if (ret != 0) {
+        /* The final unreference takes named_lock itself */
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
         mos_gem_bo_unreference(&bo_gem->bo);
-        pthread_mutex_unlock(&bufmgr_gem->lock);
         return nullptr;
     }
     bo_gem->tiling_mode = get_tiling.tiling_mode;
@@ -1525,9 +1918,9 @@ mos_bo_gem_create_from_name(struct mos_bufmgr *bufmgr,
     mos_bo_gem_set_in_aperture_size(bufmgr_gem, bo_gem, 0);
 #endif
 
-    DRMINITLISTHEAD(&bo_gem->vma_list);
-    DRMLISTADDTAIL(&bo_gem->name_list, &bufmgr_gem->named);
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    (*bufmgr_gem->name_table)[bo_gem->global_name] = bo_gem;
+    (*bufmgr_gem->handle_table)[bo_gem->gem_handle] = bo_gem;
+    pthread_mutex_unlock(&bufmgr_gem->named_lock);
     MOS_DBG("bo_create_from_handle: %d (%s)\n", handle, bo_gem->name);
 
     return &bo_gem->bo;
@@ -1541,6 +1934,7 @@ mos_gem_bo_free(struct mos_linux_bo *bo)
     struct drm_gem_close close;
     int ret;
 
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
     DRMLISTDEL(&bo_gem->vma_list);
     if (bo_gem->mem_virtual) {
         VG(VALGRIND_FREELIKE_BLOCK(bo_gem->mem_virtual, 0));
@@ -1560,6 +1954,7 @@ mos_gem_bo_free(struct mos_linux_bo *bo)
 #endif
         bufmgr_gem->vma_count--;
     }
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
 
     /* Close this object */
     memclear(close);
@@ -1569,6 +1964,8 @@ mos_gem_bo_free(struct mos_linux_bo *bo)
         MOS_DBG("DRM_IOCTL_GEM_CLOSE %d failed (%s): %s\n",
             bo_gem->gem_handle, bo_gem->name, strerror(errno));
     }
+    if (bo_gem->va_size)
+        mos_gem_va_free(bufmgr_gem, bo_gem->bo.offset64, bo_gem->va_size);
 #ifdef ANDROID
     free(bo_gem->aub_annotations);
 #endif
@@ -1598,13 +1995,15 @@ mos_gem_cleanup_bo_cache(struct mos_bufmgr_gem *bufmgr_gem, time_t time)
 {
     int i;
 
-    if (bufmgr_gem->time == time)
+    /* Sweep at most once per second, and by one thread only */
+    if (__atomic_exchange_n(&bufmgr_gem->time, time, __ATOMIC_RELAXED) == time)
         return;
 
     for (i = 0; i < bufmgr_gem->num_buckets; i++) {
         struct mos_gem_bo_bucket *bucket =
             &bufmgr_gem->cache_bucket[i];
 
+        pthread_mutex_lock(&bucket->lock);
         while (!DRMLISTEMPTY(&bucket->head)) {
             struct mos_bo_gem *bo_gem;
 
@@ -1613,13 +2012,63 @@ mos_gem_cleanup_bo_cache(struct mos_bufmgr_gem *bufmgr_gem, time_t time)
             if (time - bo_gem->free_time <= 1)
                 break;
 
-            DRMLISTDEL(&bo_gem->head);
+            mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
 
             mos_gem_bo_free(&bo_gem->bo);
         }
+        pthread_mutex_unlock(&bucket->lock);
     }
+}
+
+/**
+ * Frees the least recently released cached buffers until the cache is
+ * back under cache_limit. Each bucket is kept in release order, so the
+ * oldest buffer overall is at the head of one of the buckets.
+ */
+static void
+mos_gem_evict_bo_cache(struct mos_bufmgr_gem *bufmgr_gem)
+{
+    while (bufmgr_gem->cache_bytes > bufmgr_gem->cache_limit) {
+        struct mos_gem_bo_bucket *oldest = nullptr;
+        struct mos_bo_gem *bo_gem = nullptr;
+        time_t oldest_time = 0;
+        int i, num_buckets;
+
+        num_buckets = __atomic_load_n(&bufmgr_gem->num_buckets, __ATOMIC_ACQUIRE);
+        for (i = 0; i < num_buckets; i++) {
+            struct mos_gem_bo_bucket *bucket =
+                &bufmgr_gem->cache_bucket[i];
+
+            pthread_mutex_lock(&bucket->lock);
+            if (!DRMLISTEMPTY(&bucket->head)) {
+                bo_gem = DRMLISTENTRY(struct mos_bo_gem,
+                              bucket->head.next, head);
+                if (oldest == nullptr || bo_gem->free_time < oldest_time) {
+                    oldest = bucket;
+                    oldest_time = bo_gem->free_time;
+                }
+            }
+            pthread_mutex_unlock(&bucket->lock);
+        }
 
-    bufmgr_gem->time = time;
+        if (oldest == nullptr)
+            break;
+
+        /* The bucket may have been drained meanwhile, then just rescan */
+        bo_gem = nullptr;
+        pthread_mutex_lock(&oldest->lock);
+        if (!DRMLISTEMPTY(&oldest->head)) {
+            bo_gem = DRMLISTENTRY(struct mos_bo_gem,
+                          oldest->head.next, head);
+            mos_gem_bo_cache_remove(bufmgr_gem, bo_gem);
+        }
+        pthread_mutex_unlock(&oldest->lock);
+
+        if (bo_gem) {
+            mos_gem_bo_free(&bo_gem->bo);
+            __sync_fetch_and_add(&bufmgr_gem->cache_evictions, 1);
+        }
+    }
 }
 
 static void mos_gem_bo_purge_vma_cache(struct mos_bufmgr_gem *bufmgr_gem)
@@ -1670,6 +2119,7 @@ static void mos_gem_bo_purge_vma_cache(struct mos_bufmgr_gem *bufmgr_gem)
     }
 }
 
+/* Called with vma_lock held */
 static void mos_gem_bo_close_vma(struct mos_bufmgr_gem *bufmgr_gem,
                      struct mos_bo_gem *bo_gem)
 {
@@ -1684,6 +2134,7 @@ static void mos_gem_bo_close_vma(struct mos_bufmgr_gem *bufmgr_gem,
     mos_gem_bo_purge_vma_cache(bufmgr_gem);
 }
 
+/* Called with vma_lock held */
 static void mos_gem_bo_open_vma(struct mos_bufmgr_gem *bufmgr_gem,
                       struct mos_bo_gem *bo_gem)
 {
@@ -1709,13 +2160,13 @@ mos_gem_bo_unreference_final(struct mos_linux_bo *bo, time_t time)
     /* Unreference all the target buffers */
     for (i = 0; i < bo_gem->reloc_count; i++) {
         if (bo_gem->reloc_target_info[i].bo != bo) {
-            mos_gem_bo_unreference_locked_timed(bo_gem->
+            mos_gem_bo_unreference_timed(bo_gem->
                                   reloc_target_info[i].bo,
                                   time);
         }
     }
     for (i = 0; i < bo_gem->softpin_target_count; i++)
-        mos_gem_bo_unreference_locked_timed(bo_gem->softpin_target[i],
+        mos_gem_bo_unreference_timed(bo_gem->softpin_target[i].bo,
                                   time);
     bo_gem->reloc_count = 0;
     bo_gem->used_as_reloc_target = false;
@@ -1728,14 +2179,8 @@ mos_gem_bo_unreference_final(struct mos_linux_bo *bo, time_t time)
 #endif
 
     /* release memory associated with this object */
-    if (bo_gem->reloc_target_info) {
-        free(bo_gem->reloc_target_info);
-        bo_gem->reloc_target_info = nullptr;
-    }
-    if (bo_gem->relocs) {
-        free(bo_gem->relocs);
-        bo_gem->relocs = nullptr;
-    }
+    mos_gem_bo_release_reloc_list(bo);
+    bo_gem->release_count++;
     if (bo_gem->softpin_target) {
         free(bo_gem->softpin_target);
         bo_gem->softpin_target = nullptr;
@@ -1745,13 +2190,13 @@ mos_gem_bo_unreference_final(struct mos_linux_bo *bo, time_t time)
     /* Clear any left-over mappings */
     if (bo_gem->map_count) {
         MOS_DBG("bo freed with non-zero map-count %d\n", bo_gem->map_count);
+        pthread_mutex_lock(&bufmgr_gem->vma_lock);
         bo_gem->map_count = 0;
         mos_gem_bo_close_vma(bufmgr_gem, bo_gem);
+        pthread_mutex_unlock(&bufmgr_gem->vma_lock);
         mos_gem_bo_mark_mmaps_incoherent(bo);
     }
 
-    DRMLISTDEL(&bo_gem->name_list);
-
     bucket = mos_gem_bo_bucket_for_size(bufmgr_gem, bo->size);
     /* Put the buffer into our internal cache for reuse if we can. */
     if (bufmgr_gem->bo_reuse && bo_gem->reusable && bucket != nullptr &&
@@ -1762,20 +2207,46 @@ mos_gem_bo_unreference_final(struct mos_linux_bo *bo, time_t time)
         bo_gem->name = nullptr;
         bo_gem->validate_index = -1;
 
+        pthread_mutex_lock(&bucket->lock);
         DRMLISTADDTAIL(&bo_gem->head, &bucket->head);
+        pthread_mutex_unlock(&bucket->lock);
+
+        if (__sync_add_and_fetch(&bufmgr_gem->cache_bytes, bo->size) >
+            bufmgr_gem->cache_limit && bufmgr_gem->cache_limit)
+            mos_gem_evict_bo_cache(bufmgr_gem);
     } else {
         mos_gem_bo_free(bo);
     }
 }
 
-static void mos_gem_bo_unreference_locked_timed(struct mos_linux_bo *bo,
+/**
+ * Drops a reference. The last reference is only dropped under named_lock,
+ * so that a concurrent flink/prime lookup can't revive a bo being freed,
+ * and the bo is removed from the named tables before it is released.
+ * Returns true if the bo was released.
+ */
+static bool mos_gem_bo_unreference_timed(struct mos_linux_bo *bo,
                               time_t time)
 {
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
     struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
 
     assert(atomic_read(&bo_gem->refcount) > 0);
-    if (atomic_dec_and_test(&bo_gem->refcount))
-        mos_gem_bo_unreference_final(bo, time);
+
+    /* Lock-free fast path while other references remain */
+    if (!atomic_add_unless(&bo_gem->refcount, -1, 1))
+        return false;
+
+    pthread_mutex_lock(&bufmgr_gem->named_lock);
+    if (!atomic_dec_and_test(&bo_gem->refcount)) {
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
+        return false;
+    }
+    mos_gem_bo_remove_named(bufmgr_gem, bo_gem);
+    pthread_mutex_unlock(&bufmgr_gem->named_lock);
+
+    mos_gem_bo_unreference_final(bo, time);
+    return true;
 }
 
 static void mos_gem_bo_unreference(struct mos_linux_bo *bo)
@@ -1791,14 +2262,8 @@ static void mos_gem_bo_unreference(struct mos_linux_bo *bo)
 
         clock_gettime(CLOCK_MONOTONIC, &time);
 
-        pthread_mutex_lock(&bufmgr_gem->lock);
-
-        if (atomic_dec_and_test(&bo_gem->refcount)) {
-            mos_gem_bo_unreference_final(bo, time.tv_sec);
+        if (mos_gem_bo_unreference_timed(bo, time.tv_sec))
             mos_gem_cleanup_bo_cache(bufmgr_gem, time.tv_sec);
-        }
-
-        pthread_mutex_unlock(&bufmgr_gem->lock);
     }
 }
 
@@ -1868,11 +2333,13 @@ mos_gem_bo_map_wc(struct mos_linux_bo *bo) {
     struct drm_i915_gem_set_domain set_domain;
     int ret;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    mos_gem_bo_flush_deferred(bo);
+
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     ret = map_wc(bo);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
     if (ret) {
-        pthread_mutex_unlock(&bufmgr_gem->lock);
         return ret;
     }
 
@@ -1898,7 +2365,6 @@ mos_gem_bo_map_wc(struct mos_linux_bo *bo) {
     }
     mos_gem_bo_mark_mmaps_incoherent(bo);
     VG(VALGRIND_MAKE_MEM_DEFINED(bo_gem->mem_wc_virtual, bo->size));
-    pthread_mutex_unlock(&bufmgr_gem->lock);
 
     return 0;
 }
@@ -1911,7 +2377,7 @@ mos_gem_bo_map_wc_unsynchronized(struct mos_linux_bo *bo) {
 #endif
     int ret;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     ret = map_wc(bo);
     if (ret == 0) {
@@ -1919,7 +2385,7 @@ mos_gem_bo_map_wc_unsynchronized(struct mos_linux_bo *bo) {
         VG(VALGRIND_MAKE_MEM_DEFINED(bo_gem->mem_wc_virtual, bo->size));
     }
 
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
 
     return ret;
 }
@@ -1931,6 +2397,8 @@ drm_export int mos_gem_bo_map(struct mos_linux_bo *bo, int write_enable)
     struct drm_i915_gem_set_domain set_domain;
     int ret;
 
+    mos_gem_bo_flush_deferred(bo);
+
     if (bo_gem->is_userptr) {
         /* Return the same user ptr */
 #ifdef __cplusplus
@@ -1941,7 +2409,7 @@ drm_export int mos_gem_bo_map(struct mos_linux_bo *bo, int write_enable)
         return 0;
     }
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     if (bo_gem->map_count++ == 0)
         mos_gem_bo_open_vma(bufmgr_gem, bo_gem);
@@ -1965,7 +2433,7 @@ drm_export int mos_gem_bo_map(struct mos_linux_bo *bo, int write_enable)
                 bo_gem->name, strerror(errno));
             if (--bo_gem->map_count == 0)
                 mos_gem_bo_close_vma(bufmgr_gem, bo_gem);
-            pthread_mutex_unlock(&bufmgr_gem->lock);
+            pthread_mutex_unlock(&bufmgr_gem->vma_lock);
             return ret;
         }
         VG(VALGRIND_MALLOCLIKE_BLOCK(mmap_arg.addr_ptr, mmap_arg.size, 0, 1));
@@ -1979,6 +2447,14 @@ drm_export int mos_gem_bo_map(struct mos_linux_bo *bo, int write_enable)
     bo->virtual = bo_gem->mem_virtual;
 #endif
 
+    if (write_enable)
+        bo_gem->mapped_cpu_write = true;
+
+    /* The domain change doesn't touch the vma cache, so don't hold
+     * the lock across the ioctl.
+     */
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
+
     memclear(set_domain);
     set_domain.handle = bo_gem->gem_handle;
     set_domain.read_domains = I915_GEM_DOMAIN_CPU;
@@ -1995,12 +2471,8 @@ drm_export int mos_gem_bo_map(struct mos_linux_bo *bo, int write_enable)
             strerror(errno));
     }
 
-    if (write_enable)
-        bo_gem->mapped_cpu_write = true;
-
     mos_gem_bo_mark_mmaps_incoherent(bo);
     VG(VALGRIND_MAKE_MEM_DEFINED(bo_gem->mem_virtual, bo->size));
-    pthread_mutex_unlock(&bufmgr_gem->lock);
 
     return 0;
 }
@@ -2079,11 +2551,13 @@ mos_gem_bo_map_gtt(struct mos_linux_bo *bo)
     struct drm_i915_gem_set_domain set_domain;
     int ret;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    mos_gem_bo_flush_deferred(bo);
+
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     ret = map_gtt(bo);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
     if (ret) {
-        pthread_mutex_unlock(&bufmgr_gem->lock);
         return ret;
     }
 
@@ -2111,7 +2585,6 @@ mos_gem_bo_map_gtt(struct mos_linux_bo *bo)
 
     mos_gem_bo_mark_mmaps_incoherent(bo);
     VG(VALGRIND_MAKE_MEM_DEFINED(bo_gem->gtt_virtual, bo->size));
-    pthread_mutex_unlock(&bufmgr_gem->lock);
 
     return 0;
 }
@@ -2149,7 +2622,7 @@ mos_gem_bo_map_unsynchronized(struct mos_linux_bo *bo)
     if (!bufmgr_gem->has_llc)
         return mos_gem_bo_map_gtt(bo);
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     ret = map_gtt(bo);
     if (ret == 0) {
@@ -2157,7 +2630,7 @@ mos_gem_bo_map_unsynchronized(struct mos_linux_bo *bo)
         VG(VALGRIND_MAKE_MEM_DEFINED(bo_gem->gtt_virtual, bo->size));
     }
 
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
 
     return ret;
 }
@@ -2176,11 +2649,11 @@ drm_export int mos_gem_bo_unmap(struct mos_linux_bo *bo)
 
     bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
 
     if (bo_gem->map_count <= 0) {
         MOS_DBG("attempted to unmap an unmapped bo\n");
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        pthread_mutex_unlock(&bufmgr_gem->vma_lock);
         /* Preserve the old behaviour of just treating this as a
          * no-op rather than reporting the error.
          */
@@ -2218,7 +2691,7 @@ drm_export int mos_gem_bo_unmap(struct mos_linux_bo *bo)
         bo->virtual = nullptr;
 #endif
     }
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
 
     return ret;
 }
@@ -2325,6 +2798,7 @@ mos_gem_bo_get_subdata(struct mos_linux_bo *bo, unsigned long offset,
 static void
 mos_gem_bo_wait_rendering(struct mos_linux_bo *bo)
 {
+    mos_gem_bo_flush_deferred(bo);
     mos_gem_bo_start_gtt_access(bo, 1);
 }
 
@@ -2364,6 +2838,8 @@ mos_gem_bo_wait(struct mos_linux_bo *bo, int64_t timeout_ns)
     struct drm_i915_gem_wait wait;
     int ret;
 
+    mos_gem_bo_flush_deferred(bo);
+
     if (!bufmgr_gem->has_wait_timeout) {
         MOS_DBG("%s:%d: Timed wait is not supported. Falling back to "
             "infinite wait\n", __FILE__, __LINE__);
@@ -2432,6 +2908,9 @@ mos_bufmgr_gem_destroy(struct mos_bufmgr *bufmgr)
 #endif
 
     pthread_mutex_destroy(&bufmgr_gem->lock);
+    pthread_mutex_destroy(&bufmgr_gem->named_lock);
+    delete bufmgr_gem->name_table;
+    delete bufmgr_gem->handle_table;
 
 #ifndef ANDROID
     /* Free any cached buffer objects we were going to reuse */
@@ -2461,6 +2940,23 @@ mos_bufmgr_gem_destroy(struct mos_bufmgr *bufmgr)
                 "i915 kernel driver may not be sane!\n", errno);
     }
 #endif
+
+    for (i = 0; i < bufmgr_gem->num_buckets; i++)
+        pthread_mutex_destroy(&bufmgr_gem->cache_bucket[i].lock);
+    pthread_mutex_destroy(&bufmgr_gem->bucket_lock);
+    pthread_mutex_destroy(&bufmgr_gem->deferred_lock);
+    pthread_mutex_destroy(&bufmgr_gem->vma_lock);
+
+    for (auto &arrays : *bufmgr_gem->reloc_pool) {
+        free(arrays.second);
+        free(arrays.first);
+    }
+    delete bufmgr_gem->reloc_pool;
+    pthread_mutex_destroy(&bufmgr_gem->reloc_pool_lock);
+    delete bufmgr_gem->exec_lists;
+    delete bufmgr_gem->va_free;
+    pthread_mutex_destroy(&bufmgr_gem->va_lock);
+
     free(bufmgr);
 }
 
@@ -2628,12 +3124,19 @@ do_bo_emit_reloc2(struct mos_linux_bo *bo, uint32_t offset,
 static void
 mos_gem_bo_use_48b_address_range(struct mos_linux_bo *bo, uint32_t enable)
 {
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
     struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
     bo_gem->use_48b_address_range = enable;
+
+    /* A bo pinned above 4GB moves below it when it loses the opt-in, which
+     * is only safe before its address is written into any batch */
+    if (bufmgr_gem->softpin && bo_gem->va_size)
+        mos_gem_bo_assign_va(bufmgr_gem, bo_gem, bo->align);
 }
 
 static int
-mos_gem_bo_add_softpin_target(struct mos_linux_bo *bo, struct mos_linux_bo *target_bo)
+mos_gem_bo_add_softpin_target(struct mos_linux_bo *bo, struct mos_linux_bo *target_bo,
+                              uint32_t write_domain)
 {
     struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
     struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
@@ -2656,14 +3159,18 @@ mos_gem_bo_add_softpin_target(struct mos_linux_bo *bo, struct mos_linux_bo *targ
         if (new_size == 0)
             new_size = bufmgr_gem->max_relocs;
 
-        bo_gem->softpin_target = (struct mos_linux_bo **)realloc(bo_gem->softpin_target, new_size *
-                sizeof(struct mos_linux_bo *));
+        bo_gem->softpin_target = (struct mos_reloc_target *)realloc(bo_gem->softpin_target, new_size *
+                sizeof(struct mos_reloc_target));
         if (!bo_gem->softpin_target)
             return -ENOMEM;
 
         bo_gem->softpin_target_size = new_size;
     }
-    bo_gem->softpin_target[bo_gem->softpin_target_count] = target_bo;
+    /* Without relocations the kernel only learns about writes from
+     * EXEC_OBJECT_WRITE, which orders later readers on other engines */
+    bo_gem->softpin_target[bo_gem->softpin_target_count].bo = target_bo;
+    bo_gem->softpin_target[bo_gem->softpin_target_count].flags =
+        write_domain ? DRM_INTEL_RELOC_WRITE : 0;
     mos_gem_bo_reference(target_bo);
     bo_gem->softpin_target_count++;
 
@@ -2693,7 +3200,7 @@ mos_gem_bo_emit_reloc(struct mos_linux_bo *bo, uint32_t offset,
     struct mos_bo_gem *target_bo_gem = (struct mos_bo_gem *)target_bo;
 
     if (target_bo_gem->is_softpin)
-        return mos_gem_bo_add_softpin_target(bo, target_bo);
+        return mos_gem_bo_add_softpin_target(bo, target_bo, write_domain);
     else
         return do_bo_emit_reloc(bo, offset, target_bo, target_offset,
                     read_domains, write_domain,
@@ -2708,8 +3215,15 @@ mos_gem_bo_emit_reloc2(struct mos_linux_bo *bo, uint32_t offset,
                 uint64_t presumed_offset)
 {
     struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *)bo->bufmgr;
+    struct mos_bo_gem *target_bo_gem = (struct mos_bo_gem *)target_bo;
 
-    return do_bo_emit_reloc2(bo, offset, target_bo, target_offset,
+    /* A pinned batch is validated anyway, and already knows its own address */
+    if (target_bo_gem->is_softpin && target_bo == bo)
+        return 0;
+    else if (target_bo_gem->is_softpin)
+        return mos_gem_bo_add_softpin_target(bo, target_bo, write_domain);
+    else
+        return do_bo_emit_reloc2(bo, offset, target_bo, target_offset,
                     read_domains, write_domain,
                     !bufmgr_gem->fenced_relocs,
                     presumed_offset);
@@ -2768,15 +3282,15 @@ mos_gem_bo_clear_relocs(struct mos_linux_bo *bo, int start)
         struct mos_bo_gem *target_bo_gem = (struct mos_bo_gem *) bo_gem->reloc_target_info[i].bo;
         if (&target_bo_gem->bo != bo) {
             bo_gem->reloc_tree_fences -= target_bo_gem->reloc_tree_fences;
-            mos_gem_bo_unreference_locked_timed(&target_bo_gem->bo,
+            mos_gem_bo_unreference_timed(&target_bo_gem->bo,
                                   time.tv_sec);
         }
     }
     bo_gem->reloc_count = start;
 
     for (i = 0; i < bo_gem->softpin_target_count; i++) {
-        struct mos_bo_gem *target_bo_gem = (struct mos_bo_gem *) bo_gem->softpin_target[i];
-        mos_gem_bo_unreference_locked_timed(&target_bo_gem->bo, time.tv_sec);
+        struct mos_bo_gem *target_bo_gem = (struct mos_bo_gem *) bo_gem->softpin_target[i].bo;
+        mos_gem_bo_unreference_timed(&target_bo_gem->bo, time.tv_sec);
     }
     bo_gem->softpin_target_count = 0;
 
@@ -2839,18 +3353,19 @@ mos_gem_bo_process_reloc2(struct mos_linux_bo *bo)
                   DRM_INTEL_RELOC_FENCE);
 
         /* Add the target to the validate list */
-        mos_add_validate_buffer2(target_bo, need_fence);
+        mos_add_validate_buffer2(target_bo, need_fence, false);
     }
 
     for (i = 0; i < bo_gem->softpin_target_count; i++) {
-        struct mos_linux_bo *target_bo = bo_gem->softpin_target[i];
+        struct mos_linux_bo *target_bo = bo_gem->softpin_target[i].bo;
 
         if (target_bo == bo)
             continue;
 
         mos_gem_bo_mark_mmaps_incoherent(bo);
         mos_gem_bo_process_reloc2(target_bo);
-        mos_add_validate_buffer2(target_bo, false);
+        mos_add_validate_buffer2(target_bo, false,
+            bo_gem->softpin_target[i].flags & DRM_INTEL_RELOC_WRITE);
     }
 }
 
@@ -2882,6 +3397,15 @@ mos_update_buffer_offsets2 (struct mos_bufmgr_gem *bufmgr_gem, mos_linux_context
 {
     int i;
 
+#ifndef ANDROID
+    auto &last_list = (*bufmgr_gem->exec_lists)[ctx];
+    bool unchanged = (int)last_list.size() == bufmgr_gem->exec_count;
+
+    /* New slots are zeroed and never match */
+    last_list.resize(bufmgr_gem->exec_count);
+    bufmgr_gem->exec_lists_total++;
+#endif
+
     for (i = 0; i < bufmgr_gem->exec_count; i++) {
         struct mos_linux_bo *bo = bufmgr_gem->exec_bos[i];
         struct mos_bo_gem *bo_gem = (struct mos_bo_gem *)bo;
@@ -2903,23 +3427,43 @@ mos_update_buffer_offsets2 (struct mos_bufmgr_gem *bufmgr_gem, mos_linux_context
         }
 
 #ifndef ANDROID
-        if (cmd_bo != bo) {
-            auto item_ctx = ctx->pOsContext->contextOffsetList.begin();
-            for (; item_ctx != ctx->pOsContext->contextOffsetList.end(); item_ctx++) {
-                if (item_ctx->intel_context == ctx && item_ctx->target_bo == bo) {
-                    item_ctx->offset64 = bo->offset64;
+        auto &entry = last_list[i];
+        if (entry.bo == bo &&
+            entry.release_count == bo_gem->release_count &&
+            entry.offset == bo->offset64) {
+            bufmgr_gem->exec_bos_reused++;
+            continue;
+        }
+        unchanged = false;
+        entry.bo = bo;
+        entry.release_count = bo_gem->release_count;
+        entry.offset = bo->offset64;
+
+        /* A pinned bo has the same address in every context */
+        if (cmd_bo != bo && !bo_gem->is_softpin) {
+            auto &offsetMap = ctx->pOsContext->contextOffsetMap;
+            auto range = offsetMap.equal_range(bo);
+            auto item_ctx = range.first;
+            for (; item_ctx != range.second; item_ctx++) {
+                if (item_ctx->second.intel_context == ctx) {
+                    item_ctx->second.offset64 = bo->offset64;
                     break;
                 }
             }
-            if ( item_ctx == ctx->pOsContext->contextOffsetList.end()) {
+            if (item_ctx == range.second) {
                 struct MOS_CONTEXT_OFFSET newContext = {ctx,
                                     bo,
                                     bo->offset64};
-                ctx->pOsContext->contextOffsetList.push_back(newContext);
+                offsetMap.emplace(bo, newContext);
             }
         }
 #endif
     }
+
+#ifndef ANDROID
+    if (unchanged)
+        bufmgr_gem->exec_lists_unchanged++;
+#endif
 }
 
 #ifdef ANDROID
@@ -3233,6 +3777,8 @@ mos_gem_bo_exec(struct mos_linux_bo *bo, int used,
     if (to_bo_gem(bo)->has_error)
         return -ENOMEM;
 
+    mos_gem_flush_deferred(bufmgr_gem);
+
     pthread_mutex_lock(&bufmgr_gem->lock);
     /* Update indices and set up the validate list. */
     mos_gem_bo_process_reloc(bo);
@@ -3375,6 +3921,8 @@ do_exec2(struct mos_linux_bo *bo, int used, struct mos_linux_context *ctx,
     if (to_bo_gem(bo)->has_error)
         return -ENOMEM;
 
+    mos_gem_flush_deferred(bufmgr_gem);
+
     switch (flags & 0x7) {
     default:
         return -EINVAL;
@@ -3402,7 +3950,7 @@ do_exec2(struct mos_linux_bo *bo, int used, struct mos_linux_context *ctx,
     /* Add the batch buffer to the validation list.  There are no relocations
      * pointing to it.
      */
-    mos_add_validate_buffer2(bo, 0);
+    mos_add_validate_buffer2(bo, 0, 0);
 
     memclear(execbuf);
     execbuf.buffers_ptr = (uintptr_t)bufmgr_gem->exec2_objects;
@@ -3420,6 +3968,16 @@ do_exec2(struct mos_linux_bo *bo, int used, struct mos_linux_context *ctx,
         i915_execbuffer2_set_context_id(execbuf, ctx->ctx_id);
     execbuf.rsvd2 = 0;
 
+    /* With every target pinned the kernel has nothing to relocate */
+    if (bufmgr_gem->softpin) {
+        for (i = 0; i < bufmgr_gem->exec_count; i++) {
+            if (bufmgr_gem->exec2_objects[i].relocation_count)
+                break;
+        }
+        if (i == bufmgr_gem->exec_count)
+            execbuf.flags |= I915_EXEC_NO_RELOC;
+    }
+
     if (bufmgr_gem->no_exec)
         goto skip_execution;
 
@@ -3491,6 +4049,8 @@ do_exec2(struct mos_linux_bo *bo, int used, struct mos_linux_context *ctx,
     int ret = 0;
     int i;
 
+    mos_gem_flush_deferred(bufmgr_gem);
+
     switch (flags & 0x7) {
     default:
         return -EINVAL;
@@ -3526,7 +4086,7 @@ do_exec2(struct mos_linux_bo *bo, int used, struct mos_linux_context *ctx,
     /* Add the batch buffer to the validation list.  There are no relocations
      * pointing to it.
      */
-    mos_add_validate_buffer2(bo, 0);
+    mos_add_validate_buffer2(bo, 0, 0);
 
     memclear(execbuf);
     execbuf.buffers_ptr = (uintptr_t)bufmgr_gem->exec2_objects;
@@ -3983,13 +4543,12 @@ mos_bo_gem_create_from_prime(struct mos_bufmgr *bufmgr, int prime_fd, int size)
     uint32_t handle;
     struct mos_bo_gem *bo_gem;
     struct drm_i915_gem_get_tiling get_tiling;
-    drmMMListHead *list;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->named_lock);
     ret = drmPrimeFDToHandle(bufmgr_gem->fd, prime_fd, &handle);
     if (ret) {
         MOS_DBG("create_from_prime: failed to obtain handle from fd: %s\n", strerror(errno));
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
         return nullptr;
     }
 
@@ -3998,20 +4557,16 @@ mos_bo_gem_create_from_prime(struct mos_bufmgr *bufmgr, int prime_fd, int size)
      * for named buffers, we must not create two bo's pointing at the same
      * kernel object
      */
-    for (list = bufmgr_gem->named.next;
-         list != &bufmgr_gem->named;
-         list = list->next) {
-        bo_gem = DRMLISTENTRY(struct mos_bo_gem, list, name_list);
-        if (bo_gem->gem_handle == handle) {
-            mos_gem_bo_reference(&bo_gem->bo);
-            pthread_mutex_unlock(&bufmgr_gem->lock);
-            return &bo_gem->bo;
-        }
+    bo_gem = mos_gem_bo_find_named(bufmgr_gem->handle_table, handle);
+    if (bo_gem) {
+        mos_gem_bo_reference(&bo_gem->bo);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
+        return &bo_gem->bo;
     }
 
     bo_gem = (struct mos_bo_gem *)calloc(1, sizeof(*bo_gem));
     if (!bo_gem) {
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
         return nullptr;
     }
     /* Determine size of bo.  The fd-to-handle ioctl really should
@@ -4039,10 +4594,12 @@ mos_bo_gem_create_from_prime(struct mos_bufmgr *bufmgr, int prime_fd, int size)
     bo_gem->has_error = false;
     bo_gem->reusable = false;
     bo_gem->use_48b_address_range = false;
+    if (bufmgr_gem->softpin)
+        mos_gem_bo_assign_va(bufmgr_gem, bo_gem, 0);
 
     DRMINITLISTHEAD(&bo_gem->vma_list);
-    DRMLISTADDTAIL(&bo_gem->name_list, &bufmgr_gem->named);
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    (*bufmgr_gem->handle_table)[bo_gem->gem_handle] = bo_gem;
+    pthread_mutex_unlock(&bufmgr_gem->named_lock);
 
     memclear(get_tiling);
     get_tiling.handle = bo_gem->gem_handle;
@@ -4071,10 +4628,9 @@ mos_bo_gem_export_to_prime(struct mos_linux_bo *bo, int *prime_fd)
     struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bo->bufmgr;
     struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
 
-    pthread_mutex_lock(&bufmgr_gem->lock);
-        if (DRMLISTEMPTY(&bo_gem->name_list))
-                DRMLISTADDTAIL(&bo_gem->name_list, &bufmgr_gem->named);
-    pthread_mutex_unlock(&bufmgr_gem->lock);
+    pthread_mutex_lock(&bufmgr_gem->named_lock);
+    (*bufmgr_gem->handle_table)[bo_gem->gem_handle] = bo_gem;
+    pthread_mutex_unlock(&bufmgr_gem->named_lock);
 
     if (drmPrimeHandleToFD(bufmgr_gem->fd, bo_gem->gem_handle,
                    DRM_CLOEXEC, prime_fd) != 0)
@@ -4098,20 +4654,20 @@ mos_gem_bo_flink(struct mos_linux_bo *bo, uint32_t * name)
         memclear(flink);
         flink.handle = bo_gem->gem_handle;
 
-        pthread_mutex_lock(&bufmgr_gem->lock);
+        pthread_mutex_lock(&bufmgr_gem->named_lock);
 
         ret = drmIoctl(bufmgr_gem->fd, DRM_IOCTL_GEM_FLINK, &flink);
         if (ret != 0) {
-            pthread_mutex_unlock(&bufmgr_gem->lock);
+            pthread_mutex_unlock(&bufmgr_gem->named_lock);
             return -errno;
         }
 
         bo_gem->global_name = flink.name;
         bo_gem->reusable = false;
 
-                if (DRMLISTEMPTY(&bo_gem->name_list))
-                        DRMLISTADDTAIL(&bo_gem->name_list, &bufmgr_gem->named);
-        pthread_mutex_unlock(&bufmgr_gem->lock);
+        (*bufmgr_gem->name_table)[bo_gem->global_name] = bo_gem;
+        (*bufmgr_gem->handle_table)[bo_gem->gem_handle] = bo_gem;
+        pthread_mutex_unlock(&bufmgr_gem->named_lock);
     }
 
     *name = bo_gem->global_name;
@@ -4159,6 +4715,152 @@ mos_bufmgr_gem_enable_reuse(struct mos_bufmgr *bufmgr)
     bufmgr_gem->bo_reuse = true;
 }
 
+/**
+ * Bounds the bytes held by the buffer object reuse cache. Once exceeded,
+ * the least recently released buffers are freed. 0 means unlimited.
+ */
+void
+mos_bufmgr_gem_set_cache_limit(struct mos_bufmgr *bufmgr, uint64_t limit)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    bufmgr_gem->cache_limit = limit;
+    if (limit && bufmgr_gem->cache_bytes > limit)
+        mos_gem_evict_bo_cache(bufmgr_gem);
+}
+
+/**
+ * Returns the reuse cache hit, miss and eviction counts since init.
+ */
+void
+mos_bufmgr_gem_get_cache_stats(struct mos_bufmgr *bufmgr,
+                     uint64_t *hits,
+                     uint64_t *misses,
+                     uint64_t *evictions)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    *hits = bufmgr_gem->cache_hits;
+    *misses = bufmgr_gem->cache_misses;
+    *evictions = bufmgr_gem->cache_evictions;
+}
+
+/**
+ * Enables softpin mode: bos created from now on are pinned at a GPU virtual
+ * address handed out by the bufmgr, and execbuffers whose targets are all
+ * pinned carry no relocations. Needs kernel softpin and full PPGTT support,
+ * and must be called before the first bo is allocated.
+ *
+ * Returns 1 if softpin mode is enabled.
+ */
+int
+mos_bufmgr_gem_enable_softpin(struct mos_bufmgr *bufmgr)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    if (!bufmgr_gem->has_softpin || !bufmgr_gem->has_full_ppgtt)
+        return 0;
+
+    bufmgr_gem->va_next[MOS_GEM_VA_RANGE_LOW] = MOS_GEM_VA_BASE;
+    bufmgr_gem->va_end[MOS_GEM_VA_RANGE_LOW] = MOS_GEM_VA_4GB;
+    /* Stay in the lower half of the 48 bit space to keep addresses canonical */
+    bufmgr_gem->va_next[MOS_GEM_VA_RANGE_HIGH] = MOS_GEM_VA_4GB;
+    bufmgr_gem->va_end[MOS_GEM_VA_RANGE_HIGH] = bufmgr_gem->has_full_48b_ppgtt ? (1ull << 47) : MOS_GEM_VA_4GB;
+    bufmgr_gem->softpin = true;
+    return 1;
+}
+
+/**
+ * Returns whether bo is pinned at its offset, so that the address can be
+ * written into commands without a relocation.
+ */
+int
+mos_gem_bo_is_softpin(struct mos_linux_bo *bo)
+{
+    return ((struct mos_bo_gem *) bo)->is_softpin;
+}
+
+/**
+ * Returns the number of context execbuffers, how many of them submitted
+ * the same validation list as the previous one on their context, and how
+ * many bos skipped their per-context offset bookkeeping as a result.
+ */
+void
+mos_bufmgr_gem_get_exec_stats(struct mos_bufmgr *bufmgr,
+                    uint64_t *execs,
+                    uint64_t *unchanged,
+                    uint64_t *reused_bos)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    pthread_mutex_lock(&bufmgr_gem->lock);
+    *execs = bufmgr_gem->exec_lists_total;
+    *unchanged = bufmgr_gem->exec_lists_unchanged;
+    *reused_bos = bufmgr_gem->exec_bos_reused;
+    pthread_mutex_unlock(&bufmgr_gem->lock);
+}
+
+/**
+ * Registers func to submit the batches the caller has queued rather than
+ * executed. It is called once, outside of any bufmgr lock, before the next
+ * execbuffer on this bufmgr or the next map, wait or busy query on a bo
+ * marked with mos_gem_bo_mark_deferred(). A hook registered by another
+ * client is flushed first, as only one can be pending.
+ */
+void
+mos_bufmgr_gem_set_deferred_flush(struct mos_bufmgr *bufmgr,
+                       mos_deferred_flush_func func,
+                       void *data)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    for (;;) {
+        pthread_mutex_lock(&bufmgr_gem->deferred_lock);
+        if (bufmgr_gem->deferred_flush == nullptr ||
+            bufmgr_gem->deferred_data == data) {
+            bufmgr_gem->deferred_data = data;
+            __atomic_store_n(&bufmgr_gem->deferred_flush, func, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&bufmgr_gem->deferred_lock);
+            return;
+        }
+        pthread_mutex_unlock(&bufmgr_gem->deferred_lock);
+
+        mos_gem_flush_deferred(bufmgr_gem);
+    }
+}
+
+/**
+ * Drops the pending hook if it belongs to data, without calling it. Used by
+ * the owner before it submits its queued batches itself.
+ */
+void
+mos_bufmgr_gem_clear_deferred_flush(struct mos_bufmgr *bufmgr, void *data)
+{
+    struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *) bufmgr;
+
+    pthread_mutex_lock(&bufmgr_gem->deferred_lock);
+    if (bufmgr_gem->deferred_data == data) {
+        bufmgr_gem->deferred_flush = nullptr;
+        bufmgr_gem->deferred_data = nullptr;
+    }
+    pthread_mutex_unlock(&bufmgr_gem->deferred_lock);
+}
+
+/**
+ * Tracks whether bo is referenced by a batch queued behind the deferred
+ * flush hook. Maps, waits and busy queries on a marked bo flush the hook.
+ */
+void
+mos_gem_bo_mark_deferred(struct mos_linux_bo *bo, int deferred)
+{
+    struct mos_bo_gem *bo_gem = (struct mos_bo_gem *) bo;
+
+    if (deferred)
+        atomic_inc(&bo_gem->deferred_refs);
+    else
+        atomic_dec(&bo_gem->deferred_refs, 1);
+}
+
 /**
  * Enable use of fenced reloc type.
  *
@@ -4384,9 +5086,9 @@ _mos_gem_bo_references(struct mos_linux_bo *bo, struct mos_linux_bo *target_bo)
     }
 
     for (i = 0; i< bo_gem->softpin_target_count; i++) {
-        if (bo_gem->softpin_target[i] == target_bo)
+        if (bo_gem->softpin_target[i].bo == target_bo)
             return 1;
-        if (_mos_gem_bo_references(bo_gem->softpin_target[i], target_bo))
+        if (_mos_gem_bo_references(bo_gem->softpin_target[i].bo, target_bo))
             return 1;
     }
 
@@ -4407,15 +5109,17 @@ mos_gem_bo_references(struct mos_linux_bo *bo, struct mos_linux_bo *target_bo)
 }
 
 static void
-add_bucket(struct mos_bufmgr_gem *bufmgr_gem, int size)
+add_bucket(struct mos_bufmgr_gem *bufmgr_gem, unsigned long size)
 {
     unsigned int i = bufmgr_gem->num_buckets;
 
     assert(i < ARRAY_SIZE(bufmgr_gem->cache_bucket));
 
     DRMINITLISTHEAD(&bufmgr_gem->cache_bucket[i].head);
+    pthread_mutex_init(&bufmgr_gem->cache_bucket[i].lock, nullptr);
     bufmgr_gem->cache_bucket[i].size = size;
-    bufmgr_gem->num_buckets++;
+    /* Publish the bucket to lock-free lookups only once it is set up */
+    __atomic_store_n(&bufmgr_gem->num_buckets, i + 1, __ATOMIC_RELEASE);
 }
 
 static void
@@ -4443,6 +5147,11 @@ init_cache_buckets(struct mos_bufmgr_gem *bufmgr_gem)
         add_bucket(bufmgr_gem, size + size * 2 / 4);
         add_bucket(bufmgr_gem, size + size * 3 / 4);
     }
+
+    /* Anything larger is cached in exact-size buckets learned on use */
+    bufmgr_gem->num_round_buckets = bufmgr_gem->num_buckets;
+    bufmgr_gem->cache_max_size =
+        bufmgr_gem->cache_bucket[bufmgr_gem->num_buckets - 1].size;
 }
 
 void
@@ -4450,9 +5159,11 @@ mos_bufmgr_gem_set_vma_cache_size(struct mos_bufmgr *bufmgr, int limit)
 {
     struct mos_bufmgr_gem *bufmgr_gem = (struct mos_bufmgr_gem *)bufmgr;
 
+    pthread_mutex_lock(&bufmgr_gem->vma_lock);
     bufmgr_gem->vma_max = limit;
 
     mos_gem_bo_purge_vma_cache(bufmgr_gem);
+    pthread_mutex_unlock(&bufmgr_gem->vma_lock);
 }
 
 /**
@@ -4628,6 +5339,10 @@ mos_gem_context_destroy(struct mos_linux_context *ctx)
     destroy.ctx_id = ctx->ctx_id;
     ret = drmIoctl(bufmgr_gem->fd, DRM_IOCTL_I915_GEM_CONTEXT_DESTROY,
                &destroy);
+
+    pthread_mutex_lock(&bufmgr_gem->lock);
+    bufmgr_gem->exec_lists->erase(ctx);
+    pthread_mutex_unlock(&bufmgr_gem->lock);
     if (ret != 0)
         fprintf(stderr, "DRM_IOCTL_I915_GEM_CONTEXT_DESTROY failed: %s\n",
             strerror(errno));
@@ -4967,7 +5682,13 @@ mos_bufmgr_gem_init(int fd, int batch_size)
     bufmgr_gem->fd = fd;
     atomic_set(&bufmgr_gem->refcount, 1);
 
-    if (pthread_mutex_init(&bufmgr_gem->lock, nullptr) != 0) {
+    if (pthread_mutex_init(&bufmgr_gem->lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->named_lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->bucket_lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->deferred_lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->reloc_pool_lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->va_lock, nullptr) != 0 ||
+        pthread_mutex_init(&bufmgr_gem->vma_lock, nullptr) != 0) {
         free(bufmgr_gem);
         bufmgr_gem = nullptr;
         goto exit;
@@ -5033,13 +5754,17 @@ mos_bufmgr_gem_init(int fd, int batch_size)
 
     gp.param = I915_PARAM_HAS_EXEC_SOFTPIN;
     ret = drmIoctl(bufmgr_gem->fd, DRM_IOCTL_I915_GETPARAM, &gp);
-    if (ret == 0 && *gp.value > 0)
+    if (ret == 0 && *gp.value > 0) {
         bufmgr_gem->bufmgr.bo_set_softpin_offset = mos_gem_bo_set_softpin_offset;
+        bufmgr_gem->has_softpin = true;
+    }
 
     gp.param = I915_PARAM_HAS_ALIASING_PPGTT;
     ret = drmIoctl(bufmgr_gem->fd, DRM_IOCTL_I915_GETPARAM, &gp);
     if (ret == 0 && *gp.value == 3)
         bufmgr_gem->bufmgr.bo_use_48b_address_range = mos_gem_bo_use_48b_address_range;
+    bufmgr_gem->has_full_ppgtt = (ret == 0 && *gp.value >= 2);
+    bufmgr_gem->has_full_48b_ppgtt = (ret == 0 && *gp.value == 3);
 
     /* Let's go with one relocation per every 2 dwords (but round down a bit
      * since a power of two will mean an extra page allocation for the reloc
@@ -5098,7 +5823,7 @@ mos_bufmgr_gem_init(int fd, int batch_size)
         bufmgr_gem->bufmgr.bo_mrb_exec = mos_gem_bo_mrb_exec2;
     } else
         bufmgr_gem->bufmgr.bo_exec = mos_gem_bo_exec;
-    bufmgr_gem->bufmgr.bo_busy = mos_gem_bo_busy;
+    bufmgr_gem->bufmgr.bo_busy = mos_gem_bo_busy_deferred;
     bufmgr_gem->bufmgr.bo_madvise = mos_gem_bo_madvise;
     bufmgr_gem->bufmgr.destroy = mos_bufmgr_gem_unref;
     bufmgr_gem->bufmgr.debug = 0;
@@ -5110,7 +5835,11 @@ mos_bufmgr_gem_init(int fd, int batch_size)
         mos_gem_get_pipe_from_crtc_id;
     bufmgr_gem->bufmgr.bo_references = mos_gem_bo_references;
 
-    DRMINITLISTHEAD(&bufmgr_gem->named);
+    bufmgr_gem->name_table = new std::unordered_map<uint32_t, struct mos_bo_gem *>;
+    bufmgr_gem->handle_table = new std::unordered_map<uint32_t, struct mos_bo_gem *>;
+    bufmgr_gem->exec_lists = new std::unordered_map<struct mos_linux_context *, std::vector<struct mos_gem_exec_entry>>;
+    bufmgr_gem->reloc_pool = new std::vector<std::pair<struct drm_i915_gem_relocation_entry *, struct mos_reloc_target *>>;
+    bufmgr_gem->va_free = new std::unordered_map<uint64_t, std::vector<uint64_t>>;
     init_cache_buckets(bufmgr_gem);
 
     DRMINITLISTHEAD(&bufmgr_gem->vma_cache);
@@ -32,6 +32,8 @@
 #include "mos_cmdbufmgr.h"
 
 #define MI_BATCHBUFFER_END 0x05000000
+#define MI_NOOP 0x00000000
+#define MI_BATCHBUFFER_START_PPGTT_64 ((0x31 << 23) | (1 << 8) | 1)
 static pthread_mutex_t command_dump_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 GpuContextSpecific::GpuContextSpecific(
@@ -97,6 +99,23 @@ MOS_STATUS GpuContextSpecific::Init(OsContext *osContext)
 
     m_GPUStatusTag = 1;
 
+#ifndef ANDROID
+    MOS_USER_FEATURE_VALUE_DATA userFeatureData;
+    MOS_ZeroMemory(&userFeatureData, sizeof(userFeatureData));
+    MOS_UserFeature_ReadValue_ID(
+        nullptr,
+        __MEDIA_USER_FEATURE_VALUE_ENABLE_DEFERRED_SUBMISSION_ID,
+        &userFeatureData);
+    // The chaining MI_BATCHBUFFER_START is the gen8+ 3 dword encoding
+    if ((userFeatureData.i32Data || MosUltDeferredSubmission) &&
+        GFX_GET_CURRENT_RENDERCORE(osContext->GetPlatformInfo()) >= IGFX_GEN8_CORE)
+    {
+        m_deferredMutex = MOS_CreateMutex();
+        MOS_OS_CHK_NULL_RETURN(m_deferredMutex);
+        m_deferredSubmission = true;
+    }
+#endif
+
     return MOS_STATUS_SUCCESS;
 }
 
@@ -104,6 +123,20 @@ void GpuContextSpecific::Clear()
 {
     MOS_OS_FUNCTION_ENTER;
 
+    if (m_deferredMutex)
+    {
+        MOS_LockMutex(m_deferredMutex);
+        FlushDeferredBatches();
+        MOS_UnlockMutex(m_deferredMutex);
+        if (m_deferredBufmgr)
+        {
+            mos_bufmgr_gem_clear_deferred_flush(m_deferredBufmgr, this);
+        }
+        MOS_DestroyMutex(m_deferredMutex);
+        m_deferredMutex      = nullptr;
+        m_deferredSubmission = false;
+    }
+
     // hanlde the status buf bundled w/ the specified gpucontext
     if (m_statusBufferResource)
     {
@@ -141,14 +174,24 @@ MOS_STATUS GpuContextSpecific::RegisterResource(
 
     MOS_OS_CHK_NULL_RETURN(m_attachedResources);
 
-    PMOS_RESOURCE registeredResources = m_attachedResources;
-    uint32_t      allocationIndex     = 0;
+    // The slot cached in the resource is valid only if it still holds the same bo in the
+    // current submission, otherwise fall back to the per-submission bo index
+    uint32_t allocationIndex = (uint32_t)osResource->iAllocationIndex[m_gpuContext];
 
-    for ( allocationIndex = 0; allocationIndex < m_resCount; allocationIndex++, registeredResources++)
+    if (allocationIndex >= m_resCount || osResource->bo != m_attachedResources[allocationIndex].bo)
     {
-        if (osResource->bo == registeredResources->bo)
+        auto item = m_resIndexMap.find(osResource->bo);
+        if (item != m_resIndexMap.end())
         {
-            break;
+            allocationIndex = item->second;
+        }
+        else
+        {
+            allocationIndex = m_resCount;
+            if (allocationIndex < m_maxNumAllocations)
+            {
+                m_resIndexMap[osResource->bo] = allocationIndex;
+            }
         }
     }
 
@@ -464,15 +507,16 @@ MOS_STATUS GpuContextSpecific::SubmitCommandBuffer(
             resource));
 
 #ifndef ANDROID
+        // A pinned bo has the same address in every context
         uint64_t boOffset = alloc_bo->offset64;
-        if (alloc_bo != cmd_bo)
+        if (alloc_bo != cmd_bo && !mos_gem_bo_is_softpin(alloc_bo))
         {
-            auto item_ctx = osContext->contextOffsetList.begin();
-            for (; item_ctx != osContext->contextOffsetList.end(); item_ctx++)
+            auto range = osContext->contextOffsetMap.equal_range(alloc_bo);
+            for (auto item_ctx = range.first; item_ctx != range.second; item_ctx++)
             {
-                if (item_ctx->intel_context == osContext->intel_context && item_ctx->target_bo == alloc_bo)
+                if (item_ctx->second.intel_context == osContext->intel_context)
                 {
-                    boOffset = item_ctx->offset64;
+                    boOffset = item_ctx->second.offset64;
                     break;
                 }
             }
@@ -524,6 +568,7 @@ MOS_STATUS GpuContextSpecific::SubmitCommandBuffer(
     }
 
     //Add Batch buffer End Command
+    uint32_t batchBufferEndOffset = cmdBuffer->iOffset;
     uint32_t batchBufferEndCmd = MI_BATCHBUFFER_END;
     if (MOS_FAILED(Mos_AddCommand(
             cmdBuffer,
@@ -534,9 +579,15 @@ MOS_STATUS GpuContextSpecific::SubmitCommandBuffer(
         return MOS_STATUS_UNKNOWN;
     }
 
-    // Now, we can unmap the video command buffer, since we don't need CPU access anymore.
+    // A deferred batch needs room to turn its BB_END into a 3 dword BB_START
+    bool deferSubmission = m_deferredSubmission;
+    if (deferSubmission)
+    {
+        uint32_t noopCmd[2] = {MI_NOOP, MI_NOOP};
+        deferSubmission = (Mos_AddCommand(cmdBuffer, noopCmd, sizeof(noopCmd)) == MOS_STATUS_SUCCESS);
+    }
+
     MOS_OS_CHK_NULL_RETURN(cmdBuffer->OsResource.pGfxResource);
-    cmdBuffer->OsResource.pGfxResource->Unlock(m_osContext);
 
     int32_t perfData;
     if (osContext->pPerfData != nullptr)
@@ -656,8 +707,27 @@ MOS_STATUS GpuContextSpecific::SubmitCommandBuffer(
 
 #endif  //(_DEBUG || _RELEASE_INTERNAL)
 
-    if (gpuNode != I915_EXEC_RENDER &&
-        osInterface->osCpInterface->IsTearDownHappen())
+    bool tearDownHappen = gpuNode != I915_EXEC_RENDER &&
+        osInterface->osCpInterface->IsTearDownHappen();
+
+    // Only plain submissions are chained, the kernel takes DR4 and cliprects per execbuffer
+    deferSubmission = deferSubmission && !tearDownHappen && !nullRendering &&
+        DR4 == 0 && num_cliprects == 0;
+
+    if (!deferSubmission)
+    {
+        // Now, we can unmap the video command buffer, since we don't need CPU access anymore.
+        cmdBuffer->OsResource.pGfxResource->Unlock(m_osContext);
+
+        if (m_deferredMutex)
+        {
+            MOS_LockMutex(m_deferredMutex);
+            FlushDeferredBatches();
+            MOS_UnlockMutex(m_deferredMutex);
+        }
+    }
+
+    if (tearDownHappen)
     {
         // skip PAK command when CP tear down happen to avoid of GPU hang
         // conditonal batch buffer start PoC is in progress
@@ -686,13 +756,21 @@ MOS_STATUS GpuContextSpecific::SubmitCommandBuffer(
                 execFlag);
         }
 #else
-        ret = mos_gem_bo_context_exec2(cmd_bo,
-            m_commandBufferSize,
-            osContext->intel_context,
-            cliprects,
-            num_cliprects,
-            DR4,
-            execFlag);
+        if (deferSubmission)
+        {
+            // Queueing may submit the chain, its failure is this submission's
+            MOS_OS_CHK_STATUS_RETURN(QueueDeferredBatch(cmdBuffer, batchBufferEndOffset, execFlag, osContext->intel_context));
+        }
+        else
+        {
+            ret = mos_gem_bo_context_exec2(cmd_bo,
+                m_commandBufferSize,
+                osContext->intel_context,
+                cliprects,
+                num_cliprects,
+                DR4,
+                execFlag);
+        }
 #endif
 
         if (ret != 0)
@@ -729,8 +807,12 @@ if (osInterface->bDumpCommandBuffer)
     }
 #endif  //(_DEBUG || _RELEASE_INTERNAL)
 
-    //clear command buffer relocations to fix memory leak issue
-    mos_gem_bo_clear_relocs(cmd_bo, 0);
+    //clear command buffer relocations to fix memory leak issue, a deferred
+    //batch keeps them until the chain is submitted
+    if (!deferSubmission)
+    {
+        mos_gem_bo_clear_relocs(cmd_bo, 0);
+    }
 
     // Reset resource allocation
     m_numAllocations = 0;
@@ -738,12 +820,160 @@ if (osInterface->bDumpCommandBuffer)
     m_currentNumPatchLocations = 0;
     MOS_ZeroMemory(m_patchLocationList, sizeof(PATCHLOCATIONLIST) * m_maxNumAllocations);
     m_resCount = 0;
+    m_resIndexMap.clear();
 
     MOS_ZeroMemory(m_writeModeList, sizeof(bool) * m_maxNumAllocations);
 finish:
     return eStatus;
 }
 
+MOS_STATUS GpuContextSpecific::QueueDeferredBatch(
+    PMOS_COMMAND_BUFFER  cmdBuffer,
+    uint32_t             endOffset,
+    uint32_t             execFlag,
+    MOS_LINUX_CONTEXT   *intelContext)
+{
+    MOS_OS_FUNCTION_ENTER;
+
+    MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
+    auto       cmd_bo  = cmdBuffer->OsResource.bo;
+
+    MOS_LockMutex(m_deferredMutex);
+
+    for (;;)
+    {
+        // Batches for another ring or kernel context can not share the execbuffer
+        if (!m_deferredBatches.empty() &&
+            (m_deferredExecFlag != execFlag || m_deferredIntelContext != intelContext))
+        {
+            FlushDeferredBatches();
+        }
+
+        // The hook must be in place before the batch and its marked bos are
+        // visible, or a wait on one of them would not submit the chain.
+        // Registering may flush another client's hook, so do it without
+        // holding the mutex; a hook called meanwhile submits whatever is queued.
+        if (!m_deferredHookArmed)
+        {
+            m_deferredHookArmed = true;
+            m_deferredBufmgr    = cmd_bo->bufmgr;
+            MOS_UnlockMutex(m_deferredMutex);
+            mos_bufmgr_gem_set_deferred_flush(cmd_bo->bufmgr, FlushDeferredCallback, this);
+            MOS_LockMutex(m_deferredMutex);
+            continue;
+        }
+
+        if (m_deferredBatches.empty())
+        {
+            break;
+        }
+
+        auto &tail = m_deferredBatches.back();
+        auto  cmd  = (uint32_t *)((uint8_t *)tail.bo->virt + tail.endOffset);
+
+        cmd[0] = MI_BATCHBUFFER_START_PPGTT_64;
+        cmd[1] = (uint32_t)cmd_bo->offset64;
+        cmd[2] = (uint32_t)(cmd_bo->offset64 >> 32);
+
+        if (mos_bo_emit_reloc2(
+                tail.bo,
+                tail.endOffset + sizeof(uint32_t),
+                cmd_bo,
+                0,
+                I915_GEM_DOMAIN_COMMAND,
+                0,
+                cmd_bo->offset64) != 0)
+        {
+            // Leave the tail ending the chain and start a new one
+            cmd[0] = MI_BATCHBUFFER_END;
+            FlushDeferredBatches();
+            continue;
+        }
+        break;
+    }
+
+    DeferredBatch batch;
+    batch.bo        = cmd_bo;
+    batch.resource  = cmdBuffer->OsResource.pGfxResource;
+    batch.endOffset = endOffset;
+    for (uint32_t i = 0; i < m_numAllocations; i++)
+    {
+        auto resource = (PMOS_RESOURCE)m_allocationList[i].hAllocation;
+        if (resource && resource->bo)
+        {
+            // Held until the execbuffer, the resource may be freed meanwhile
+            mos_bo_reference(resource->bo);
+            mos_gem_bo_mark_deferred(resource->bo, true);
+            batch.refs.push_back(resource->bo);
+        }
+    }
+    m_deferredBatches.push_back(batch);
+    m_deferredExecFlag     = execFlag;
+    m_deferredIntelContext = intelContext;
+
+    if (m_deferredBatches.size() >= m_maxDeferredBatches)
+    {
+        eStatus = FlushDeferredBatches();
+    }
+
+    MOS_UnlockMutex(m_deferredMutex);
+
+    return eStatus;
+}
+
+MOS_STATUS GpuContextSpecific::FlushDeferredBatches()
+{
+    MOS_OS_FUNCTION_ENTER;
+
+    if (m_deferredBatches.empty())
+    {
+        return MOS_STATUS_SUCCESS;
+    }
+
+    // Drop the hook first, the execbuffer would otherwise call back into this context
+    mos_bufmgr_gem_clear_deferred_flush(m_deferredBufmgr, this);
+    m_deferredHookArmed = false;
+
+    MOS_STATUS eStatus = MOS_STATUS_SUCCESS;
+    int32_t    ret     = mos_gem_bo_context_exec2(m_deferredBatches.front().bo,
+        m_commandBufferSize,
+        m_deferredIntelContext,
+        nullptr,
+        0,
+        0,
+        m_deferredExecFlag);
+    if (ret != 0)
+    {
+        MOS_OS_ASSERTMESSAGE("Deferred command buffer submission failed!");
+        eStatus = MOS_STATUS_UNKNOWN;
+    }
+
+    for (auto &batch : m_deferredBatches)
+    {
+        for (auto bo : batch.refs)
+        {
+            mos_gem_bo_mark_deferred(bo, false);
+            mos_bo_unreference(bo);
+        }
+        batch.resource->Unlock(m_osContext);
+        mos_gem_bo_clear_relocs(batch.bo, 0);
+    }
+    m_deferredBatches.clear();
+
+    return eStatus;
+}
+
+void GpuContextSpecific::FlushDeferredCallback(void *data)
+{
+    auto gpuContext = static_cast<GpuContextSpecific *>(data);
+
+    MOS_LockMutex(gpuContext->m_deferredMutex);
+    // The buffer manager dropped the hook before calling it
+    gpuContext->m_deferredHookArmed = false;
+    gpuContext->FlushDeferredBatches();
+    MOS_UnlockMutex(gpuContext->m_deferredMutex);
+}
+
 void GpuContextSpecific::IncrementGpuStatusTag()
 {
     m_GPUStatusTag = m_GPUStatusTag % UINT_MAX + 1;
@@ -762,6 +992,7 @@ void GpuContextSpecific::ResetGpuContextStatus()
 
     MOS_ZeroMemory(m_attachedResources, sizeof(MOS_RESOURCE) * ALLOCATIONLIST_SIZE);
     m_resCount = 0;
+    m_resIndexMap.clear();
 
     MOS_ZeroMemory(m_writeModeList, sizeof(bool) * ALLOCATIONLIST_SIZE);
 
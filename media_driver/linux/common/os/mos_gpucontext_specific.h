@@ -175,6 +175,64 @@ public:
     MOS_STATUS AllocateGPUStatusBuf();
 
 private:
+    //!
+    //! \brief    Queue a patched command buffer behind the previous deferred one
+    //! \details  The previous batch's end is overwritten with a batch buffer start
+    //!           to cmdBuffer, so that one execbuffer runs the whole chain
+    //! \param    [in] cmdBuffer
+    //!           Command buffer, with batch buffer end and padding at endOffset
+    //! \param    [in] endOffset
+    //!           Offset of the batch buffer end
+    //! \param    [in] execFlag
+    //!           Ring the batch is submitted to
+    //! \param    [in] intelContext
+    //!           Kernel context the batch is submitted on
+    //! \return   MOS_STATUS
+    //!           Return MOS_STATUS_SUCCESS if successful, otherwise failed
+    //!
+    MOS_STATUS QueueDeferredBatch(
+        PMOS_COMMAND_BUFFER  cmdBuffer,
+        uint32_t             endOffset,
+        uint32_t             execFlag,
+        MOS_LINUX_CONTEXT   *intelContext);
+
+    //!
+    //! \brief    Submit the chained command buffers, called with m_deferredMutex held
+    //! \return   MOS_STATUS
+    //!           Return MOS_STATUS_SUCCESS if successful, otherwise failed
+    //!
+    MOS_STATUS FlushDeferredBatches();
+
+    //!
+    //! \brief    Deferred flush hook registered with the buffer manager
+    //! \param    [in] data
+    //!           Gpu context whose chain is submitted
+    //!
+    static void FlushDeferredCallback(void *data);
+
+    //! \brief    Maximum number of command buffers chained into one execbuffer
+    static const uint32_t m_maxDeferredBatches = 8;
+
+    //! \brief    Command buffer queued for deferred submission
+    struct DeferredBatch
+    {
+        MOS_LINUX_BO               *bo;         //!< Command buffer bo
+        GraphicsResource           *resource;   //!< Command buffer resource, locked until submitted
+        uint32_t                    endOffset;  //!< Offset of the batch buffer end
+        std::vector<MOS_LINUX_BO *> refs;       //!< Registered bos, referenced and marked deferred until submitted
+    };
+
+    //! \brief    Chain command buffers instead of submitting each one
+    bool m_deferredSubmission = false;
+
+    //! \brief    Queued command buffers, in submission order
+    std::vector<DeferredBatch> m_deferredBatches;
+    uint32_t           m_deferredExecFlag     = 0;        //!< Ring of the queued batches
+    MOS_LINUX_CONTEXT *m_deferredIntelContext = nullptr;  //!< Kernel context of the queued batches
+    MOS_BUFMGR        *m_deferredBufmgr       = nullptr;  //!< Buffer manager the hook is registered with
+    bool               m_deferredHookArmed    = false;    //!< Hook registered or being called, under m_deferredMutex
+    PMOS_MUTEX         m_deferredMutex        = nullptr;  //!< Protects the queued batches
+
     //! \brief    internal command buffer pool per gpu context
     std::vector<CommandBuffer *> m_cmdBufPool;
 
@@ -205,6 +263,7 @@ private:
     uint32_t      m_resCount = 0;  //!< number of resources registered
     PMOS_RESOURCE m_attachedResources = nullptr;  //!< Pointer to resources list
     bool         *m_writeModeList     = nullptr;  //!< Write mode
+    std::unordered_map<MOS_LINUX_BO *, uint32_t> m_resIndexMap;  //!< bo to allocation index of current submission
 
     //! \brief    GPU Status tag
     uint32_t m_GPUStatusTag;
@@ -979,10 +979,9 @@ void Linux_Destroy(
     }
 
 #ifndef ANDROID
-    if (pOsContext->contextOffsetList.size())
+    if (pOsContext->contextOffsetMap.size())
     {
-         pOsContext->contextOffsetList.clear();
-         pOsContext->contextOffsetList.shrink_to_fit();
+         pOsContext->contextOffsetMap.clear();
     }
 #endif
 
@@ -993,7 +992,7 @@ void Linux_Destroy(
 
     GmmDeleteClientContext(pOsContext->pGmmClientContext);
 
-    MOS_FreeMemAndSetNull(pOsContext);
+    MOS_Delete(pOsContext);
 }
 
 //!
@@ -1503,6 +1502,7 @@ void Mos_Specific_ResetOsStates(
     pOsGpuContext->uiCurrentNumPatchLocations = 0;
     MOS_ZeroMemory(pOsGpuContext->pPatchLocationList, sizeof(PATCHLOCATIONLIST) * pOsGpuContext->uiMaxPatchLocationsize);
     pOsGpuContext->uiResCount = 0;
+    pOsGpuContext->resIndexMap.clear();
 
     MOS_ZeroMemory(pOsGpuContext->pResources, sizeof(MOS_RESOURCE) * pOsGpuContext->uiMaxNumAllocations);
     MOS_ZeroMemory(pOsGpuContext->pbWriteMode, sizeof(int32_t) * pOsGpuContext->uiMaxNumAllocations);
@@ -2064,17 +2064,8 @@ void Mos_Specific_FreeResource(
         mos_bo_unreference((MOS_LINUX_BO *)(pOsResource->bo));
 
 #ifndef ANDROID
-        if ( pOsInterface->pOsContext != nullptr && pOsInterface->pOsContext->contextOffsetList.size()) {
-          MOS_CONTEXT *pOsCtx = pOsInterface->pOsContext;
-          auto item_ctx = pOsCtx->contextOffsetList.begin();
-
-          for (;item_ctx != pOsCtx->contextOffsetList.end();)
-          {
-             if (item_ctx->target_bo == pOsResource->bo)
-                item_ctx = pOsCtx->contextOffsetList.erase(item_ctx);
-             else
-                item_ctx++;
-          }
+        if ( pOsInterface->pOsContext != nullptr && pOsInterface->pOsContext->contextOffsetMap.size()) {
+          pOsInterface->pOsContext->contextOffsetMap.erase((MOS_LINUX_BO *)(pOsResource->bo));
         }
 #endif
         pOsResource->bo = nullptr;
@@ -2541,11 +2532,24 @@ MOS_STATUS Mos_Specific_RegisterResource (
         MOS_OS_ASSERTMESSAGE("pResouce is NULL.");
         return MOS_STATUS_SUCCESS;
     }
-    for (uiAllocation = 0;
-         uiAllocation < pOsGpuContext->uiResCount;
-         uiAllocation++, pResources++)
+    // The slot cached in the resource is valid only if it still holds the same bo in the
+    // current submission, otherwise fall back to the per-submission bo index
+    uiAllocation = (uint32_t)pOsResource->iAllocationIndex[pOsInterface->CurrentGpuContextOrdinal];
+    if (uiAllocation >= pOsGpuContext->uiResCount || pOsResource->bo != pResources[uiAllocation].bo)
     {
-        if (pOsResource->bo == pResources->bo) break;
+        auto item = pOsGpuContext->resIndexMap.find(pOsResource->bo);
+        if (item != pOsGpuContext->resIndexMap.end())
+        {
+            uiAllocation = item->second;
+        }
+        else
+        {
+            uiAllocation = pOsGpuContext->uiResCount;
+            if (uiAllocation < pOsGpuContext->uiMaxNumAllocations)
+            {
+                pOsGpuContext->resIndexMap[pOsResource->bo] = uiAllocation;
+            }
+        }
     }
     // Allocation list to be updated
     if (uiAllocation < pOsGpuContext->uiMaxNumAllocations)
@@ -2600,8 +2604,8 @@ MOS_STATUS Mos_Specific_VerifyCommandBufferSize(
         return (gpuContext->VerifyCommandBufferSize(dwRequestedSize));
     }
 
-    PMOS_OS_CONTEXT    pOsContext;
-    MOS_OS_GPU_CONTEXT OsGpuContext;
+    PMOS_OS_CONTEXT     pOsContext;
+    PMOS_OS_GPU_CONTEXT pOsGpuContext;
 
     //---------------------------------------
     MOS_UNUSED(dwFlags);
@@ -2610,9 +2614,9 @@ MOS_STATUS Mos_Specific_VerifyCommandBufferSize(
     //---------------------------------------
 
     pOsContext      = pOsInterface->pOsContext;
-    OsGpuContext    = pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
+    pOsGpuContext   = &pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
 
-    if (OsGpuContext.uiCommandBufferSize < dwRequestedSize)
+    if (pOsGpuContext->uiCommandBufferSize < dwRequestedSize)
     {
         return MOS_STATUS_UNKNOWN;
     }
@@ -2785,17 +2789,17 @@ MOS_STATUS Mos_Specific_GetIndirectState(
         return (gpuContext->GetIndirectState(puOffset, puSize));
     }
 
-    PMOS_CONTEXT       pOsContext;
-    MOS_OS_GPU_CONTEXT OsGpuContext;
+    PMOS_CONTEXT        pOsContext;
+    PMOS_OS_GPU_CONTEXT pOsGpuContext;
 
     pOsContext = pOsInterface->pOsContext;
     if (pOsContext)
     {
-        OsGpuContext = pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
+        pOsGpuContext = &pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
 
         if (puOffset)
         {
-            *puOffset = OsGpuContext.uiCommandBufferSize - pOsContext->uIndirectStateSize;
+            *puOffset = pOsGpuContext->uiCommandBufferSize - pOsContext->uIndirectStateSize;
         }
 
         if (puSize)
@@ -2846,7 +2850,7 @@ MOS_STATUS Mos_Specific_GetIndirectStatePointer(
     uint8_t             **pIndirectState)
 {
     PMOS_OS_CONTEXT     pOsContext;
-    MOS_OS_GPU_CONTEXT  OsGpuContext;
+    PMOS_OS_GPU_CONTEXT pOsGpuContext;
     MOS_STATUS          eStatus;
 
     MOS_OS_FUNCTION_ENTER;
@@ -2868,13 +2872,13 @@ MOS_STATUS Mos_Specific_GetIndirectStatePointer(
 
     if (pOsContext)
     {
-        OsGpuContext = pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
+        pOsGpuContext = &pOsContext->OsGpuContext[pOsInterface->CurrentGpuContextOrdinal];
 
-        if (OsGpuContext.pCB && OsGpuContext.pCB->pCmdBase)
+        if (pOsGpuContext->pCB && pOsGpuContext->pCB->pCmdBase)
         {
             *pIndirectState =
-                (uint8_t*)OsGpuContext.pCB->pCmdBase   +
-                OsGpuContext.uiCommandBufferSize    -
+                (uint8_t*)pOsGpuContext->pCB->pCmdBase   +
+                pOsGpuContext->uiCommandBufferSize    -
                 pOsContext->uIndirectStateSize;
 
             eStatus = MOS_STATUS_SUCCESS;
@@ -3200,14 +3204,14 @@ MOS_STATUS Mos_Specific_SubmitCommandBuffer(
 
 #ifndef ANDROID
         boOffset = alloc_bo->offset64;
-        if (alloc_bo != cmd_bo)
+        if (alloc_bo != cmd_bo && !mos_gem_bo_is_softpin(alloc_bo))
         {
-          auto item_ctx = pOsContext->contextOffsetList.begin();
-          for (; item_ctx != pOsContext->contextOffsetList.end(); item_ctx++)
+          auto range = pOsContext->contextOffsetMap.equal_range(alloc_bo);
+          for (auto item_ctx = range.first; item_ctx != range.second; item_ctx++)
           {
-             if (item_ctx->intel_context == pOsContext->intel_context && item_ctx->target_bo == alloc_bo)
+             if (item_ctx->second.intel_context == pOsContext->intel_context)
              {
-               boOffset = item_ctx->offset64;
+               boOffset = item_ctx->second.offset64;
                break;
              }
           }
@@ -3465,6 +3469,7 @@ MOS_STATUS Mos_Specific_SubmitCommandBuffer(
     pOsGpuContext->uiCurrentNumPatchLocations = 0;
     MOS_ZeroMemory(pOsGpuContext->pPatchLocationList, sizeof(PATCHLOCATIONLIST) * pOsGpuContext->uiMaxPatchLocationsize);
     pOsGpuContext->uiResCount = 0;
+    pOsGpuContext->resIndexMap.clear();
 
     MOS_ZeroMemory(pOsGpuContext->pbWriteMode, sizeof(int32_t) * pOsGpuContext->uiMaxNumAllocations);
 finish:
@@ -3528,7 +3533,12 @@ uint64_t Mos_Specific_GetResourceGfxAddress(
     PMOS_RESOURCE    pResource)
 {
     MOS_UNUSED(pOsInterface);
-    MOS_UNUSED(pResource);
+
+    // Only a softpinned bo has an address before it is submitted
+    if (pResource && pResource->bo && mos_gem_bo_is_softpin(pResource->bo))
+    {
+        return pResource->bo->offset64;
+    }
     return 0;
 }
 
@@ -5617,7 +5627,8 @@ MOS_STATUS Mos_Specific_InitInterface(
     pOsInterface->modularizedGpuCtxEnabled    = true;
 
     // Create Linux OS Context
-    pOsContext = (PMOS_OS_CONTEXT)MOS_AllocAndZeroMemory(sizeof(MOS_OS_CONTEXT));
+    // Use MOS_New so that the STL members of the OS context are constructed
+    pOsContext = MOS_New(MOS_OS_CONTEXT);
     if (pOsContext == nullptr)
     {
         MOS_OS_ASSERTMESSAGE("Unable to allocate memory.");
@@ -5888,7 +5899,7 @@ MOS_STATUS Mos_Specific_InitInterface(
 finish:
     if( MOS_STATUS_SUCCESS != eStatus && nullptr != pOsContext )
     {
-        MOS_FreeMemAndSetNull(pOsContext);
+        MOS_Delete(pOsContext);
     }
     return eStatus;
 }
@@ -41,6 +41,7 @@
 #include "xf86drm.h"
 
 #include <vector>
+#include <unordered_map>
 
 typedef unsigned int MOS_OS_FORMAT;
 
@@ -432,6 +433,7 @@ typedef struct _CODECHAL_OS_GPU_CONTEXT
     int32_t                     iResIndex[CODECHAL_MAX_REGS];  //!< Resource indices
     PMOS_RESOURCE                pResources;                   //!< Pointer to resources list
     int32_t                     *pbWriteMode;                  //!< Write mode
+    std::unordered_map<MOS_LINUX_BO *, uint32_t> resIndexMap;  //!< bo to allocation index of current submission
 
     // GPU Status
     uint32_t                    uiGPUStatusTag;
@@ -522,7 +524,9 @@ struct _MOS_OS_CONTEXT
     PMOS_RESOURCE   pGPUStatusBuffer;
 
 #ifndef ANDROID
-    std::vector< struct MOS_CONTEXT_OFFSET> contextOffsetList;
+    // Last known GPU offsets per (context, bo), keyed by target bo so that patching and
+    // bo release do not need to walk every bo the process has ever submitted
+    std::unordered_multimap<MOS_LINUX_BO *, struct MOS_CONTEXT_OFFSET> contextOffsetMap;
 #endif
 
     // Media memory decompression function
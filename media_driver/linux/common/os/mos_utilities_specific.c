@@ -33,9 +33,12 @@
 #include <errno.h>     // strerror(errno)
 #include <time.h>      // get_clocktime
 #include <sys/stat.h>  // fstat
+#include <sys/file.h>  // flock
+#include <sys/syscall.h> // SYS_gettid
 #include <dlfcn.h>     // dlopen, dlsym, dlclose
 #include <sys/types.h>
 #include <unistd.h>
+#include <sched.h>     // sched_yield
 #if _MEDIA_RESERVED
 #include "codechal_util_user_interface_ext.h"
 #endif // _MEDIA_RESERVED
@@ -67,6 +70,9 @@ extern int32_t MosMemAllocCounterNoUserFeatureGfx;
 const char * const MosTracePath = "/sys/kernel/debug/tracing/trace_marker";
 static int32_t MosTraceFd = -1;
 
+#define MOS_TRACE_RING_SIZE             4096    // records per thread, 256KB
+#define MOS_TRACE_FLUSH_INTERVAL_MS     10
+
 //!
 //! \brief for int64_t/uint64_t format print warning
 //!
@@ -598,6 +604,34 @@ static MOS_STATUS _UserFeature_Add(MOS_PUF_KEYLIST *pKeyList, MOS_UF_KEY *NewKey
     return MOS_STATUS_SUCCESS;
 }
 
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_CopyValueData
+| Purpose   : Copy type and data of a value into a newly allocated buffer.
+| Arguments : pValue            [out] Value to set, its buffer is not freed.
+|             pNewValue         [in] Value content.
+| Returns   : MOS_STATUS_SUCCESS      Operation success.
+|             MOS_STATUS_NO_SPACE     no space left for allocate
+\---------------------------------------------------------------------------*/
+static MOS_STATUS _UserFeature_CopyValueData(MOS_UF_VALUE *pValue, const MOS_UF_VALUE *pNewValue)
+{
+    pValue->ulValueLen  = pNewValue->ulValueLen;
+    pValue->ulValueType = pNewValue->ulValueType;
+    pValue->ulValueBuf  = MOS_AllocMemory(pNewValue->ulValueLen);
+    if(pValue->ulValueBuf == nullptr)
+    {
+        return MOS_STATUS_NO_SPACE;
+    }
+
+    MOS_ZeroMemory(pValue->ulValueBuf, pNewValue->ulValueLen);
+
+    MOS_SecureMemcpy(pValue->ulValueBuf,
+                     pNewValue->ulValueLen,
+                     pNewValue->ulValueBuf,
+                     pNewValue->ulValueLen);
+
+    return MOS_STATUS_SUCCESS;
+}
+
 /*----------------------------------------------------------------------------
 | Name      : _UserFeature_Set
 | Purpose   : This function set a key to the key list.
@@ -649,65 +683,13 @@ static MOS_STATUS _UserFeature_Set(MOS_PUF_KEYLIST *pKeyList, MOS_UF_KEY NewKey)
         Key->ulValueNum ++;
     }
 
-    Key->pValueArray[iPos].ulValueLen  = NewKey.pValueArray[0].ulValueLen;
-    Key->pValueArray[iPos].ulValueType = NewKey.pValueArray[0].ulValueType;
-    Key->pValueArray[iPos].ulValueBuf  = MOS_AllocMemory(NewKey.pValueArray[0].ulValueLen);
-    if(Key->pValueArray[iPos].ulValueBuf == nullptr)
-    {
-        return MOS_STATUS_NO_SPACE;
-    }
-
-    MOS_ZeroMemory(Key->pValueArray[iPos].ulValueBuf, NewKey.pValueArray[0].ulValueLen);
-
-    MOS_SecureMemcpy(Key->pValueArray[iPos].ulValueBuf,
-                     NewKey.pValueArray[0].ulValueLen,
-                     NewKey.pValueArray[0].ulValueBuf,
-                     NewKey.pValueArray[0].ulValueLen);
-
-    return MOS_STATUS_SUCCESS;
-}
-
-/*----------------------------------------------------------------------------
-| Name      : _UserFeature_Query
-| Purpose   : This function query a key's value and return matched key node
-|             content just with matched value content.
-| Arguments : pKeyList      [in] Key linked list.
-|             NewKey        [in] New key content with matched value.
-| Returns   : MOS_STATUS_SUCCESS         Operation success.
-|             MOS_STATUS_UNKNOWN         Can't find key or value in User Feature File.
-| Comments  :
-\---------------------------------------------------------------------------*/
-static MOS_STATUS _UserFeature_Query(MOS_PUF_KEYLIST pKeyList, MOS_UF_KEY *NewKey)
-{
-    int32_t       iPos;
-    MOS_UF_VALUE  *pValueArray;
-    MOS_UF_KEY    *Key;
-
-    iPos         = -1;
-    pValueArray  = nullptr;
-
-    // can't find key in user feature
-    if ( (Key = _UserFeature_FindKey(pKeyList, NewKey->pcKeyName)) == nullptr )
-    {
-        return MOS_STATUS_UNKNOWN;
-    }
-
-    // can't find Value in the key
-    if ( (iPos = _UserFeature_FindValue(*Key, NewKey->pValueArray[0].pcValueName)) == NOT_FOUND)
+    else
     {
-        return MOS_STATUS_UNKNOWN;
+        // the key list is kept across calls, free the replaced value
+        MOS_FreeMemory(Key->pValueArray[iPos].ulValueBuf);
     }
 
-    //get key content from user feature
-    MOS_SecureMemcpy(NewKey->pValueArray[0].ulValueBuf,
-                     Key->pValueArray[iPos].ulValueLen,
-                     Key->pValueArray[iPos].ulValueBuf,
-                     Key->pValueArray[iPos].ulValueLen);
-
-    NewKey->pValueArray[0].ulValueLen    =  Key->pValueArray[iPos].ulValueLen;
-    NewKey->pValueArray[0].ulValueType   =  Key->pValueArray[iPos].ulValueType;
-
-    return MOS_STATUS_SUCCESS;
+    return _UserFeature_CopyValueData(&Key->pValueArray[iPos], &NewKey.pValueArray[0]);
 }
 
 static MOS_STATUS _UserFeature_ReadNextTokenFromFile(FILE *pFile, const char *szFormat, char  *szToken)
@@ -782,6 +764,8 @@ static MOS_STATUS _UserFeature_DumpFile(const char * const szFileName, MOS_PUF_K
         MOS_FreeMemory(CurKey);
         return MOS_STATUS_USER_FEATURE_KEY_READ_FAILED;
     }
+    // wait for a writer in another process to finish, released by fclose
+    flock(fileno(File), LOCK_SH);
     while (feof(File) != EOF)
     {
         MOS_ZeroMemory(szTmp, MAX_USERFEATURE_LINE_LENGTH*sizeof(char ));
@@ -987,18 +971,34 @@ static MOS_STATUS _UserFeature_DumpFile(const char * const szFileName, MOS_PUF_K
 |             pKeyList               [in] Reserved, any LPDWORD type value.
 | Returns   : MOS_STATUS_SUCCESS                        Operation success.
 |             MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED  File can't be written.
-| Comments  :
+| Comments  : The file is rewritten in place under an exclusive lock, so
+|             readers never parse a partial file. It is not replaced by a
+|             renamed copy since the change notification semaphore is keyed
+|             by the file inode (ftok).
 \---------------------------------------------------------------------------*/
 static MOS_STATUS _UserFeature_DumpDataToFile(char  *szFileName, MOS_PUF_KEYLIST pKeyList)
 {
     int32_t           iResult;
+    int32_t           fd;
     PFILE             File;
     MOS_PUF_KEYLIST   pKeyTmp;
     int32_t           j;
 
-    File = fopen(szFileName, "w+");
+    fd = open(szFileName, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    if (fd < 0)
+    {
+        return MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED;
+    }
+    // truncate only once readers in other processes are done
+    if (flock(fd, LOCK_EX) != 0 || ftruncate(fd, 0) != 0)
+    {
+        close(fd);
+        return MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED;
+    }
+    File = fdopen(fd, "w");
     if ( !File )
     {
+        close(fd);
         return MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED;
     }
 
@@ -1072,6 +1072,396 @@ static void _UserFeature_FreeKeyList(MOS_PUF_KEYLIST pKeyList)
     return;
 }
 
+//!
+//! \brief Entry of the user feature store index, a key when iValue is NOT_FOUND,
+//!        else a value of the key
+//!
+typedef struct _MOS_UF_INDEX_ENTRY
+{
+    MOS_UF_KEY      *pKey;
+    int32_t         iValue;
+    uint32_t        uiHash;
+} MOS_UF_INDEX_ENTRY;
+
+//!
+//! \brief Process-wide copy of the user feature file. It is parsed once and
+//!        parsed again only when the file changes, values set by the process
+//!        are kept in pPendingList and written back together at the end of
+//!        each MOS_UserFeature_WriteValues call, see MOS_UserFeatureFlush.
+//!
+typedef struct _MOS_UF_STORE
+{
+    MOS_PUF_KEYLIST     pKeyList;           // parsed user feature file, with the pending values applied
+    MOS_PUF_KEYLIST     pPendingList;       // values set since the last write back
+    MOS_UF_INDEX_ENTRY  *pIndex;            // open addressing hash of key and value names
+    uint32_t            uiIndexSize;        // power of 2
+    int32_t             bLoaded;
+    struct timespec     FileTime;           // modification time of the parsed file
+    off_t               FileSize;
+    ino_t               FileIno;
+} MOS_UF_STORE;
+
+#define MOS_UF_INDEX_MIN_SIZE           256
+
+static MOS_UF_STORE gUfStore;
+static MOS_MUTEX    gUfStoreMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_Hash
+| Purpose   : FNV-1a hash of a key name, followed by a value name if given.
+\---------------------------------------------------------------------------*/
+static uint32_t _UserFeature_Hash(const char *pcKeyName, const char *pcValueName)
+{
+    uint32_t uiHash = 2166136261u;
+
+    for (; *pcKeyName; pcKeyName++)
+    {
+        uiHash = (uiHash ^ (uint8_t)*pcKeyName) * 16777619u;
+    }
+    if (pcValueName != nullptr)
+    {
+        // separator, so that "ab"+"c" and "a"+"bc" differ
+        uiHash = (uiHash ^ 0xff) * 16777619u;
+        for (; *pcValueName; pcValueName++)
+        {
+            uiHash = (uiHash ^ (uint8_t)*pcValueName) * 16777619u;
+        }
+    }
+    return uiHash;
+}
+
+static void _UserFeature_IndexInsert(MOS_UF_KEY *pKey, int32_t iValue)
+{
+    uint32_t uiHash;
+    uint32_t uiMask;
+    uint32_t i;
+
+    uiHash = _UserFeature_Hash(pKey->pcKeyName,
+                 (iValue == NOT_FOUND) ? nullptr : pKey->pValueArray[iValue].pcValueName);
+    uiMask = gUfStore.uiIndexSize - 1;
+
+    for (i = uiHash & uiMask; gUfStore.pIndex[i].pKey != nullptr; i = (i + 1) & uiMask);
+
+    gUfStore.pIndex[i].pKey   = pKey;
+    gUfStore.pIndex[i].iValue = iValue;
+    gUfStore.pIndex[i].uiHash = uiHash;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_BuildIndex
+| Purpose   : Index every key and value of the store by name. Lookups fall back
+|             to a list walk if the index can't be allocated.
+\---------------------------------------------------------------------------*/
+static void _UserFeature_BuildIndex()
+{
+    MOS_PUF_KEYLIST     pKeyTmp;
+    uint32_t            uiCount;
+    uint32_t            uiSize;
+    uint32_t            i;
+
+    MOS_FreeMemory(gUfStore.pIndex);
+    gUfStore.pIndex      = nullptr;
+    gUfStore.uiIndexSize = 0;
+
+    uiCount = 0;
+    for (pKeyTmp = gUfStore.pKeyList; pKeyTmp; pKeyTmp = pKeyTmp->pNext)
+    {
+        uiCount += 1 + pKeyTmp->pElem->ulValueNum;
+    }
+
+    // keep the load factor at 1/2 or below
+    for (uiSize = MOS_UF_INDEX_MIN_SIZE; uiSize < uiCount * 2; uiSize <<= 1);
+
+    gUfStore.pIndex = (MOS_UF_INDEX_ENTRY*)MOS_AllocAndZeroMemory(uiSize * sizeof(MOS_UF_INDEX_ENTRY));
+    if (gUfStore.pIndex == nullptr)
+    {
+        return;
+    }
+    gUfStore.uiIndexSize = uiSize;
+
+    for (pKeyTmp = gUfStore.pKeyList; pKeyTmp; pKeyTmp = pKeyTmp->pNext)
+    {
+        _UserFeature_IndexInsert(pKeyTmp->pElem, NOT_FOUND);
+        for (i = 0; i < pKeyTmp->pElem->ulValueNum; i++)
+        {
+            _UserFeature_IndexInsert(pKeyTmp->pElem, (int32_t)i);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_StoreFindKey
+| Purpose   : Find a key of the store by name.
+| Returns   : Matched key, nullptr if not found.
+\---------------------------------------------------------------------------*/
+static MOS_UF_KEY* _UserFeature_StoreFindKey(const char *pcKeyName)
+{
+    uint32_t    uiHash;
+    uint32_t    uiMask;
+    uint32_t    i;
+
+    if (gUfStore.pIndex == nullptr)
+    {
+        return _UserFeature_FindKey(gUfStore.pKeyList, (char *)pcKeyName);
+    }
+
+    uiHash = _UserFeature_Hash(pcKeyName, nullptr);
+    uiMask = gUfStore.uiIndexSize - 1;
+    for (i = uiHash & uiMask; gUfStore.pIndex[i].pKey != nullptr; i = (i + 1) & uiMask)
+    {
+        MOS_UF_INDEX_ENTRY *pEntry = &gUfStore.pIndex[i];
+        if (pEntry->uiHash == uiHash && pEntry->iValue == NOT_FOUND &&
+            strcmp(pEntry->pKey->pcKeyName, pcKeyName) == 0)
+        {
+            return pEntry->pKey;
+        }
+    }
+    return nullptr;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_StoreFindValue
+| Purpose   : Find a value of a key of the store by name.
+| Returns   : Position of the value in the values array of the key, NOT_FOUND
+|             if it can't be found.
+\---------------------------------------------------------------------------*/
+static int32_t _UserFeature_StoreFindValue(MOS_UF_KEY *pKey, const char *pcValueName)
+{
+    uint32_t    uiHash;
+    uint32_t    uiMask;
+    uint32_t    i;
+
+    if (gUfStore.pIndex == nullptr)
+    {
+        return _UserFeature_FindValue(*pKey, (char *)pcValueName);
+    }
+
+    uiHash = _UserFeature_Hash(pKey->pcKeyName, pcValueName);
+    uiMask = gUfStore.uiIndexSize - 1;
+    for (i = uiHash & uiMask; gUfStore.pIndex[i].pKey != nullptr; i = (i + 1) & uiMask)
+    {
+        MOS_UF_INDEX_ENTRY *pEntry = &gUfStore.pIndex[i];
+        if (pEntry->uiHash == uiHash && pEntry->pKey == pKey && pEntry->iValue != NOT_FOUND &&
+            strcmp(pKey->pValueArray[pEntry->iValue].pcValueName, pcValueName) == 0)
+        {
+            return pEntry->iValue;
+        }
+    }
+    return NOT_FOUND;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_LoadStore
+| Purpose   : Make the store match the user feature file. The file is parsed
+|             only at the first call and when its time, size or inode change,
+|             the values still pending write back are applied again on the
+|             new content.
+| Returns   : MOS_STATUS_SUCCESS                        Operation success.
+|             MOS_STATUS_USER_FEATURE_KEY_READ_FAILED   User Feature File can't be open as read.
+|             Else the errors of _UserFeature_DumpFile.
+| Comments  : gUfStoreMutex must be held.
+\---------------------------------------------------------------------------*/
+static MOS_STATUS _UserFeature_LoadStore()
+{
+    struct stat         FileStat;
+    MOS_PUF_KEYLIST     pKeyList;
+    MOS_PUF_KEYLIST     pKeyTmp;
+    MOS_STATUS          eStatus;
+
+    if (stat(USER_FEATURE_FILE, &FileStat) != 0)
+    {
+        return MOS_STATUS_USER_FEATURE_KEY_READ_FAILED;
+    }
+
+    if (gUfStore.bLoaded &&
+        FileStat.st_mtim.tv_sec  == gUfStore.FileTime.tv_sec  &&
+        FileStat.st_mtim.tv_nsec == gUfStore.FileTime.tv_nsec &&
+        FileStat.st_size         == gUfStore.FileSize         &&
+        FileStat.st_ino          == gUfStore.FileIno)
+    {
+        return MOS_STATUS_SUCCESS;
+    }
+
+    pKeyList = nullptr;
+    if ((eStatus = _UserFeature_DumpFile(USER_FEATURE_FILE, &pKeyList)) != MOS_STATUS_SUCCESS)
+    {
+        _UserFeature_FreeKeyList(pKeyList);
+        return eStatus;
+    }
+
+    for (pKeyTmp = gUfStore.pPendingList; pKeyTmp; pKeyTmp = pKeyTmp->pNext)
+    {
+        MOS_UF_KEY  PendingKey = *pKeyTmp->pElem;
+        uint32_t    i;
+
+        // _UserFeature_Set takes one value at a time
+        PendingKey.ulValueNum = 1;
+        for (i = 0; i < pKeyTmp->pElem->ulValueNum; i++)
+        {
+            PendingKey.pValueArray = &pKeyTmp->pElem->pValueArray[i];
+            _UserFeature_Set(&pKeyList, PendingKey);
+        }
+    }
+
+    _UserFeature_FreeKeyList(gUfStore.pKeyList);
+    gUfStore.pKeyList = pKeyList;
+    _UserFeature_BuildIndex();
+
+    gUfStore.FileTime = FileStat.st_mtim;
+    gUfStore.FileSize = FileStat.st_size;
+    gUfStore.FileIno  = FileStat.st_ino;
+    gUfStore.bLoaded  = true;
+
+    return MOS_STATUS_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_FlushStore
+| Purpose   : Write the pending values back to the user feature file.
+| Returns   : MOS_STATUS_SUCCESS                        Operation success.
+|             MOS_STATUS_USER_FEATURE_KEY_WRITE_FAILED  File can't be written.
+| Comments  : gUfStoreMutex must be held.
+\---------------------------------------------------------------------------*/
+static MOS_STATUS _UserFeature_FlushStore()
+{
+    struct stat     FileStat;
+    MOS_STATUS      eStatus;
+
+    if (gUfStore.pPendingList == nullptr)
+    {
+        return MOS_STATUS_SUCCESS;
+    }
+
+    // Pick up the values other processes wrote since the file was parsed
+    if ((eStatus = _UserFeature_LoadStore()) != MOS_STATUS_SUCCESS)
+    {
+        return eStatus;
+    }
+
+    eStatus = _UserFeature_DumpDataToFile((char *)USER_FEATURE_FILE, gUfStore.pKeyList);
+    if (eStatus == MOS_STATUS_SUCCESS && stat(USER_FEATURE_FILE, &FileStat) == 0)
+    {
+        // The file now matches the store, no need to parse it again
+        gUfStore.FileTime = FileStat.st_mtim;
+        gUfStore.FileSize = FileStat.st_size;
+        gUfStore.FileIno  = FileStat.st_ino;
+    }
+
+    _UserFeature_FreeKeyList(gUfStore.pPendingList);
+    gUfStore.pPendingList = nullptr;
+
+    return eStatus;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_AcquireStore
+| Purpose   : Lock the store and refresh it from the user feature file.
+| Returns   : Status of _UserFeature_LoadStore. The store is locked in any
+|             case and must be released with _UserFeature_ReleaseStore.
+\---------------------------------------------------------------------------*/
+static MOS_STATUS _UserFeature_AcquireStore()
+{
+    MOS_LockMutex(&gUfStoreMutex);
+
+    return _UserFeature_LoadStore();
+}
+
+static void _UserFeature_ReleaseStore()
+{
+    MOS_UnlockMutex(&gUfStoreMutex);
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_CloseStore
+| Purpose   : Write back the pending values and free the store. It is loaded
+|             again by the next access.
+\---------------------------------------------------------------------------*/
+static void _UserFeature_CloseStore()
+{
+    MOS_LockMutex(&gUfStoreMutex);
+
+    _UserFeature_FlushStore();
+    _UserFeature_FreeKeyList(gUfStore.pPendingList);
+    _UserFeature_FreeKeyList(gUfStore.pKeyList);
+    MOS_FreeMemory(gUfStore.pIndex);
+    MOS_ZeroMemory(&gUfStore, sizeof(gUfStore));
+
+    MOS_UnlockMutex(&gUfStoreMutex);
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_CountAllocs
+| Purpose   : Count the allocations held by a key list, as done by
+|             _UserFeature_FreeKeyList.
+\---------------------------------------------------------------------------*/
+static int32_t _UserFeature_CountAllocs(MOS_PUF_KEYLIST pKeyList)
+{
+    MOS_PUF_KEYLIST     pKeyTmp;
+    int32_t             iCount = 0;
+    uint32_t            i;
+
+    for (pKeyTmp = pKeyList; pKeyTmp; pKeyTmp = pKeyTmp->pNext)
+    {
+        for (i = 0; i < pKeyTmp->pElem->ulValueNum; i++)
+        {
+            iCount += (pKeyTmp->pElem->pValueArray[i].ulValueBuf != nullptr);
+        }
+        iCount += (pKeyTmp->pElem->pValueArray != nullptr) + 2;
+    }
+    return iCount;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_StoreAllocs
+| Purpose   : Number of allocations held by the store, which are not leaks as
+|             the store is freed at close.
+\---------------------------------------------------------------------------*/
+static int32_t _UserFeature_StoreAllocs()
+{
+    int32_t iCount;
+
+    MOS_LockMutex(&gUfStoreMutex);
+    iCount  = _UserFeature_CountAllocs(gUfStore.pKeyList);
+    iCount += _UserFeature_CountAllocs(gUfStore.pPendingList);
+    iCount += (gUfStore.pIndex != nullptr);
+    MOS_UnlockMutex(&gUfStoreMutex);
+
+    return iCount;
+}
+
+/*----------------------------------------------------------------------------
+| Name      : _UserFeature_AddPending
+| Purpose   : Keep a copy of a value set in the store until it is written back.
+| Returns   : MOS_STATUS_SUCCESS            Operation success.
+|             MOS_STATUS_NO_SPACE           no space left for allocate
+\---------------------------------------------------------------------------*/
+static MOS_STATUS _UserFeature_AddPending(MOS_UF_KEY *NewKey)
+{
+    MOS_UF_KEY      *Key;
+    MOS_STATUS      eStatus;
+
+    // A value set again while pending is simply updated
+    if ((Key = _UserFeature_FindKey(gUfStore.pPendingList, NewKey->pcKeyName)) != nullptr)
+    {
+        return _UserFeature_Set(&gUfStore.pPendingList, *NewKey);
+    }
+
+    Key = (MOS_UF_KEY*)MOS_AllocAndZeroMemory(sizeof(MOS_UF_KEY));
+    if (Key == nullptr)
+    {
+        return MOS_STATUS_NO_SPACE;
+    }
+    MOS_SecureStrcpy(Key->pcKeyName, MAX_USERFEATURE_LINE_LENGTH, NewKey->pcKeyName);
+
+    if ((eStatus = _UserFeature_Add(&gUfStore.pPendingList, Key)) != MOS_STATUS_SUCCESS)
+    {
+        MOS_FreeMemory(Key);
+        return eStatus;
+    }
+
+    return _UserFeature_Set(&gUfStore.pPendingList, *NewKey);
+}
+
 /*----------------------------------------------------------------------------
 | Name      : _UserFeature_SetValue
 | Purpose   : Modify or add a value of the specified user feature key.
@@ -1106,10 +1496,10 @@ static MOS_STATUS _UserFeature_SetValue(
     MOS_UF_KEY          NewKey;
     MOS_UF_VALUE        NewValue;
     MOS_STATUS          eStatus;
-    MOS_PUF_KEYLIST     pKeyList;
+    MOS_UF_KEY          *Key;
+    int32_t             iPos;
 
     eStatus   = MOS_STATUS_UNKNOWN;
-    pKeyList   = nullptr;
 
     if ( (strKey== nullptr) || (pcValueName == nullptr) )
     {
@@ -1134,17 +1524,38 @@ static MOS_STATUS _UserFeature_SetValue(
     NewKey.pValueArray = &NewValue;
     NewKey.ulValueNum = 1;
 
-    if ( (eStatus = _UserFeature_DumpFile(USER_FEATURE_FILE, &pKeyList)) != MOS_STATUS_SUCCESS )
+    if ( (eStatus = _UserFeature_AcquireStore()) != MOS_STATUS_SUCCESS )
     {
+        _UserFeature_ReleaseStore();
         return eStatus;
     }
 
-    if ( ( eStatus = _UserFeature_Set(&pKeyList, NewKey)) == MOS_STATUS_SUCCESS )
+    if ( (Key = _UserFeature_StoreFindKey(strKey)) == nullptr )
+    {
+        // can't find key in File
+        eStatus = MOS_STATUS_UNKNOWN;
+    }
+    else if ( (iPos = _UserFeature_StoreFindValue(Key, NewValue.pcValueName)) == NOT_FOUND )
+    {
+        // new value, the values array of the key is reallocated
+        if ( (eStatus = _UserFeature_Set(&gUfStore.pKeyList, NewKey)) == MOS_STATUS_SUCCESS )
+        {
+            _UserFeature_BuildIndex();
+        }
+    }
+    else
+    {
+        MOS_FreeMemory(Key->pValueArray[iPos].ulValueBuf);
+        eStatus = _UserFeature_CopyValueData(&Key->pValueArray[iPos], &NewValue);
+    }
+
+    // The file is written back once per write call, see MOS_UserFeatureFlush
+    if ( eStatus == MOS_STATUS_SUCCESS )
     {
-        eStatus = _UserFeature_DumpDataToFile((char *)USER_FEATURE_FILE, pKeyList);
+        eStatus = _UserFeature_AddPending(&NewKey);
     }
 
-    _UserFeature_FreeKeyList(pKeyList);
+    _UserFeature_ReleaseStore();
     return eStatus;
 }
 
@@ -1172,45 +1583,43 @@ static MOS_STATUS _UserFeature_QueryValue(
     void                *pData,
     int32_t             *nDataSize)
 {
-    MOS_UF_KEY          NewKey;
-    MOS_UF_VALUE        NewValue;
-    size_t              nKeyLen, nValueLen;
     MOS_STATUS          eStatus;
-    MOS_PUF_KEYLIST     pKeyList;
-    char                strTempKey[MAX_USERFEATURE_LINE_LENGTH];
-    char                strTempValueName[MAX_USERFEATURE_LINE_LENGTH];
+    MOS_UF_KEY          *Key;
+    MOS_UF_VALUE        *Value;
+    int32_t             iPos;
 
     eStatus   = MOS_STATUS_UNKNOWN;
-    pKeyList   = nullptr;
 
     if ( (strKey == nullptr) || (pcValueName == nullptr))
     {
         return MOS_STATUS_INVALID_PARAMETER;
     }
-    MOS_ZeroMemory(NewValue.pcValueName, MAX_USERFEATURE_LINE_LENGTH);
-    MOS_SecureStrcpy(NewValue.pcValueName, MAX_USERFEATURE_LINE_LENGTH, pcValueName);
-    NewValue.ulValueBuf     = pData;
-
-    MOS_ZeroMemory(NewKey.pcKeyName, MAX_USERFEATURE_LINE_LENGTH);
-    MOS_SecureStrcpy(NewKey.pcKeyName, MAX_USERFEATURE_LINE_LENGTH, strKey);
-    NewKey.pValueArray = &NewValue;
-    NewKey.ulValueNum = 1;
 
-    if ( (eStatus = _UserFeature_DumpFile(USER_FEATURE_FILE, &pKeyList)) == MOS_STATUS_SUCCESS)
+    if ( (eStatus = _UserFeature_AcquireStore()) == MOS_STATUS_SUCCESS)
     {
-        if ( (eStatus = _UserFeature_Query(pKeyList, &NewKey)) == MOS_STATUS_SUCCESS )
+        if ( (Key = _UserFeature_StoreFindKey(strKey)) == nullptr ||
+             (iPos = _UserFeature_StoreFindValue(Key, pcValueName)) == NOT_FOUND )
         {
+            // can't find key or value in user feature
+            eStatus = MOS_STATUS_UNKNOWN;
+        }
+        else
+        {
+            //get key content from user feature
+            Value = &Key->pValueArray[iPos];
+            MOS_SecureMemcpy(pData, Value->ulValueLen, Value->ulValueBuf, Value->ulValueLen);
+
             if(uiValueType != nullptr)
             {
-                *uiValueType = NewKey.pValueArray[0].ulValueType;
+                *uiValueType = Value->ulValueType;
             }
             if (nDataSize != nullptr)
             {
-                *nDataSize   = NewKey.pValueArray[0].ulValueLen;
+                *nDataSize   = Value->ulValueLen;
             }
         }
     }
-    _UserFeature_FreeKeyList(pKeyList);
+    _UserFeature_ReleaseStore();
 
     return eStatus;
 }
@@ -1227,33 +1636,20 @@ static MOS_STATUS _UserFeature_QueryValue(
 \---------------------------------------------------------------------------*/
 static MOS_STATUS _UserFeature_GetKeyIdbyName(const char  *pcKeyName, void **pUFKey)
 {
-    MOS_PUF_KEYLIST     pKeyList;
-    int32_t             iResult;
     MOS_STATUS          eStatus;
-    MOS_PUF_KEYLIST     pTempNode;
+    MOS_UF_KEY          *Key;
 
-    pKeyList   = nullptr;
-    iResult    = -1;
-
-    if ( (eStatus = _UserFeature_DumpFile(USER_FEATURE_FILE, &pKeyList)) !=
-        MOS_STATUS_SUCCESS )
+    if ( (eStatus = _UserFeature_AcquireStore()) == MOS_STATUS_SUCCESS )
     {
-        return eStatus;
-    }
+        eStatus   = MOS_STATUS_INVALID_PARAMETER;
 
-    eStatus   = MOS_STATUS_INVALID_PARAMETER;
-
-    for(pTempNode=pKeyList; pTempNode; pTempNode=pTempNode->pNext)
-    {
-        iResult = strcmp(pTempNode->pElem->pcKeyName, pcKeyName);
-        if ( iResult == 0 )
+        if ( (Key = _UserFeature_StoreFindKey(pcKeyName)) != nullptr )
         {
-            *pUFKey = pTempNode->pElem->UFKey;
+            *pUFKey = Key->UFKey;
             eStatus = MOS_STATUS_SUCCESS;
-            break;
         }
     }
-    _UserFeature_FreeKeyList(pKeyList);
+    _UserFeature_ReleaseStore();
 
     return eStatus;
 }
@@ -1270,12 +1666,9 @@ static MOS_STATUS _UserFeature_GetKeyIdbyName(const char  *pcKeyName, void **pUF
 \---------------------------------------------------------------------------*/
 static MOS_STATUS _UserFeature_GetKeyNamebyId(void  *UFKey, char  *pcKeyName)
 {
-    MOS_PUF_KEYLIST     pKeyList;
     MOS_PUF_KEYLIST     pTempNode;
     MOS_STATUS          eStatus;
 
-    pKeyList   = nullptr;
-
     switch((uintptr_t)UFKey)
     {
     case UFKEY_INTERNAL:
@@ -1287,15 +1680,16 @@ static MOS_STATUS _UserFeature_GetKeyNamebyId(void  *UFKey, char  *pcKeyName)
         eStatus = MOS_STATUS_SUCCESS;
         break;
     default:
-        if ( (eStatus = _UserFeature_DumpFile(USER_FEATURE_FILE, &pKeyList)) !=
+        if ( (eStatus = _UserFeature_AcquireStore()) !=
             MOS_STATUS_SUCCESS )
         {
+            _UserFeature_ReleaseStore();
             return eStatus;
         }
 
         eStatus   = MOS_STATUS_UNKNOWN;
 
-        for(pTempNode=pKeyList;pTempNode;pTempNode=pTempNode->pNext)
+        for(pTempNode=gUfStore.pKeyList;pTempNode;pTempNode=pTempNode->pNext)
         {
             if(pTempNode->pElem->UFKey == UFKey)
             {
@@ -1304,7 +1698,7 @@ static MOS_STATUS _UserFeature_GetKeyNamebyId(void  *UFKey, char  *pcKeyName)
                 break;
             }
         }
-        _UserFeature_FreeKeyList(pKeyList);
+        _UserFeature_ReleaseStore();
         break;
     }
 
@@ -2087,6 +2481,17 @@ MOS_STATUS MOS_UserFeatureSetValueEx_File(
     return eStatus;
 }
 
+MOS_STATUS MOS_UserFeatureFlush()
+{
+    MOS_STATUS  eStatus;
+
+    MOS_LockMutex(&gUfStoreMutex);
+    eStatus = _UserFeature_FlushStore();
+    MOS_UnlockMutex(&gUfStoreMutex);
+
+    return eStatus;
+}
+
 MOS_STATUS MOS_OS_Utilities_Init()
 {
     MOS_STATUS     eStatus = MOS_STATUS_SUCCESS;
@@ -2144,14 +2549,16 @@ MOS_STATUS MOS_OS_Utilities_Close()
     if (uiMOSUtilInitCount == 0 )
     {
         MOS_TraceEventClose();
-        MemoryCounter = MosMemAllocCounter + MosMemAllocCounterGfx;
-        MosMemAllocCounterNoUserFeature = MosMemAllocCounter;
+        // The user feature store is freed below, it is not a leak
+        MosMemAllocCounterNoUserFeature = MosMemAllocCounter - _UserFeature_StoreAllocs();
+        MemoryCounter = MosMemAllocCounterNoUserFeature + MosMemAllocCounterGfx;
         MosMemAllocCounterNoUserFeatureGfx = MosMemAllocCounterGfx;
         MOS_OS_VERBOSEMESSAGE("MemNinja leak detection end");
 
         UserFeatureWriteData.Value.i32Data    =   MemoryCounter;
         UserFeatureWriteData.ValueID          = __MEDIA_USER_FEATURE_VALUE_MEMNINJA_COUNTER_ID;
         MOS_UserFeature_WriteValues_ID(NULL, &UserFeatureWriteData, 1);
+        _UserFeature_CloseStore();
 
         eStatus = MOS_DestroyUserFeatureKeysForAllDescFields();
 #if _MEDIA_RESERVED
@@ -2775,20 +3182,308 @@ MOS_STATUS MOS_GetLocalTime(
     return eStatus;
 }
 
+//!
+//! \brief Per-thread ring of binary trace records. Only the owning thread
+//!        moves ui64Head and only the flusher thread moves ui64Tail. A ring
+//!        is freed by the thread exit destructor, or at trace close once its
+//!        thread is no longer writing into it (*pInUse is 0).
+//!
+typedef struct _MOS_TRACE_RING
+{
+    uint64_t                ui64Head;           // records written
+    uint64_t                ui64Tail;           // records flushed
+    uint64_t                ui64Dropped;        // records lost because the ring was full
+    uint32_t                dwThreadId;
+    uint32_t                *pInUse;            // MosTraceThreadInUse of the owning thread
+    struct _MOS_TRACE_RING  *pNext;
+    MOS_TRACE_RECORD        Records[MOS_TRACE_RING_SIZE];
+} MOS_TRACE_RING;
+
+static int32_t          MosTraceRingFd      = -1;       // binary trace output, -1 if the text trace_marker is used
+static bool             MosTraceRingEnabled = false;    // checked by MOS_TraceEvent, cleared first at close
+static MOS_TRACE_RING   *MosTraceRings      = nullptr;  // rings of all threads, under MosTraceRingMutex
+static uint32_t         MosTraceSession     = 1;        // bumped when close frees the rings, 0 is no session
+static bool             MosTraceFlusherStop = false;
+static MOS_THREADHANDLE MosTraceFlusher     = 0;
+static MOS_MUTEX        MosTraceRingMutex   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t    MosTraceRingKey;                // runs MOS_TraceRingThreadExit, exists while MosTraceRingFd is open
+
+static __thread MOS_TRACE_RING  *MosTraceThreadRing     = nullptr;
+static __thread uint32_t        MosTraceThreadSession   = 0;    // MosTraceSession MosTraceThreadRing belongs to
+static __thread uint32_t        MosTraceThreadInUse     = 0;    // set while the thread writes into its ring
+
+static uint64_t MOS_TraceGetTime()
+{
+    struct timespec t;
+
+    // vDSO, no syscall
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+//!
+//! \brief    Write the records of a ring not flushed yet to the trace file
+//!
+static void MOS_TraceFlushRing(MOS_TRACE_RING *pRing)
+{
+    uint64_t    ui64Head;
+    uint64_t    ui64Tail;
+    uint32_t    dwStart;
+    uint32_t    dwCount;
+    ssize_t     writeSize;
+
+    ui64Head = __atomic_load_n(&pRing->ui64Head, __ATOMIC_ACQUIRE);
+    ui64Tail = pRing->ui64Tail;
+
+    while (ui64Tail < ui64Head)
+    {
+        // one write up to the end of the ring, a second one for the wrapped part
+        dwStart = (uint32_t)(ui64Tail % MOS_TRACE_RING_SIZE);
+        dwCount = (uint32_t)MOS_MIN(ui64Head - ui64Tail, MOS_TRACE_RING_SIZE - dwStart);
+
+        writeSize = write(MosTraceRingFd, &pRing->Records[dwStart], dwCount * sizeof(MOS_TRACE_RECORD));
+        if (writeSize != (ssize_t)(dwCount * sizeof(MOS_TRACE_RECORD)))
+        {
+            // drop what can't be written rather than retrying forever
+            ui64Tail = ui64Head;
+            break;
+        }
+        ui64Tail += dwCount;
+    }
+
+    __atomic_store_n(&pRing->ui64Tail, ui64Tail, __ATOMIC_RELEASE);
+}
+
+static void MOS_TraceFlushAllRings()
+{
+    MOS_TRACE_RING *pRing;
+
+    // the lock keeps exiting threads from freeing a ring being flushed
+    MOS_LockMutex(&MosTraceRingMutex);
+    for (pRing = MosTraceRings; pRing; pRing = pRing->pNext)
+    {
+        MOS_TraceFlushRing(pRing);
+    }
+    MOS_UnlockMutex(&MosTraceRingMutex);
+}
+
+//!
+//! \brief    Thread exit destructor, flushes and frees the ring of the thread
+//!           unless a concurrent close already freed it
+//!
+static void MOS_TraceRingThreadExit(void *pData)
+{
+    MOS_TRACE_RING  *pRing = nullptr;
+    MOS_TRACE_RING  **ppLink;
+
+    MOS_LockMutex(&MosTraceRingMutex);
+    for (ppLink = &MosTraceRings; *ppLink; ppLink = &(*ppLink)->pNext)
+    {
+        // the address may have been reused by the ring of another thread
+        if (*ppLink == pData && (*ppLink)->pInUse == &MosTraceThreadInUse)
+        {
+            pRing   = *ppLink;
+            *ppLink = pRing->pNext;
+            break;
+        }
+    }
+    if (pRing != nullptr)
+    {
+        MOS_TraceFlushRing(pRing);
+    }
+    MOS_UnlockMutex(&MosTraceRingMutex);
+
+    MosTraceThreadRing = nullptr;
+    if (pRing == nullptr)
+    {
+        return;
+    }
+    if (pRing->ui64Dropped)
+    {
+        MOS_OS_NORMALMESSAGE("%" MOSu64 " trace events dropped by thread %u.", pRing->ui64Dropped, pRing->dwThreadId);
+    }
+    MOS_FreeMemory(pRing);
+}
+
+//!
+//! \brief    Background thread moving the records from the rings to the file
+//!
+static void *MOS_TraceFlusherThread(void *pData)
+{
+    MOS_UNUSED(pData);
+
+    while (!__atomic_load_n(&MosTraceFlusherStop, __ATOMIC_ACQUIRE))
+    {
+        MOS_TraceFlushAllRings();
+        usleep(MOS_TRACE_FLUSH_INTERVAL_MS * 1000);
+    }
+    MOS_TraceFlushAllRings();
+
+    return nullptr;
+}
+
+//!
+//! \brief    Get the ring of the calling thread, allocated at its first event
+//!           of each trace session
+//!
+static MOS_TRACE_RING *MOS_TraceGetThreadRing()
+{
+    MOS_TRACE_RING *pRing;
+
+    // a ring of a closed session has been freed by MOS_TraceRingClose
+    if (MosTraceThreadSession == __atomic_load_n(&MosTraceSession, __ATOMIC_ACQUIRE))
+    {
+        return MosTraceThreadRing;
+    }
+
+    pRing = (MOS_TRACE_RING *)MOS_AllocAndZeroMemory(sizeof(MOS_TRACE_RING));
+    if (pRing == nullptr)
+    {
+        return nullptr;
+    }
+    pRing->dwThreadId = (uint32_t)syscall(SYS_gettid);
+    pRing->pInUse     = &MosTraceThreadInUse;
+
+    // the key and the registry only exist while the trace file is open
+    MOS_LockMutex(&MosTraceRingMutex);
+    if (MosTraceRingFd < 0 || pthread_setspecific(MosTraceRingKey, pRing) != 0)
+    {
+        MOS_UnlockMutex(&MosTraceRingMutex);
+        MOS_FreeMemory(pRing);
+        return nullptr;
+    }
+    pRing->pNext = MosTraceRings;
+    MosTraceRings = pRing;
+    MosTraceThreadRing    = pRing;
+    MosTraceThreadSession = MosTraceSession;
+    MOS_UnlockMutex(&MosTraceRingMutex);
+
+    return pRing;
+}
+
+//!
+//! \brief    Open the binary trace file named by MOS_TRACE_FILE_ENV and start
+//!           the flusher
+//! \return   true if binary tracing is on
+//!
+static bool MOS_TraceRingInit()
+{
+    const char              *pcPath;
+    MOS_TRACE_FILE_HEADER   Header;
+    int32_t                 fd;
+
+    pcPath = getenv(MOS_TRACE_FILE_ENV);
+    if (pcPath == nullptr || pcPath[0] == '\0')
+    {
+        return false;
+    }
+
+    fd = open(pcPath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (pthread_key_create(&MosTraceRingKey, MOS_TraceRingThreadExit) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    MOS_ZeroMemory(&Header, sizeof(Header));
+    MOS_SecureMemcpy(Header.szMagic, sizeof(Header.szMagic), MOS_TRACE_FILE_MAGIC, sizeof(MOS_TRACE_FILE_MAGIC));
+    Header.dwVersion     = MOS_TRACE_FILE_VERSION;
+    Header.dwRecordSize  = sizeof(MOS_TRACE_RECORD);
+    Header.ui64StartTime = MOS_TraceGetTime();
+
+    if (write(fd, &Header, sizeof(Header)) != sizeof(Header))
+    {
+        pthread_key_delete(MosTraceRingKey);
+        close(fd);
+        return false;
+    }
+
+    MOS_LockMutex(&MosTraceRingMutex);
+    MosTraceRingFd = fd;
+    MOS_UnlockMutex(&MosTraceRingMutex);
+
+    MosTraceFlusherStop = false;
+    if ((MosTraceFlusher = MOS_CreateThread((void *)MOS_TraceFlusherThread, nullptr)) == 0)
+    {
+        MOS_LockMutex(&MosTraceRingMutex);
+        MosTraceRingFd = -1;
+        MOS_UnlockMutex(&MosTraceRingMutex);
+        pthread_key_delete(MosTraceRingKey);
+        close(fd);
+        return false;
+    }
+
+    __atomic_store_n(&MosTraceRingEnabled, true, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void MOS_TraceRingClose()
+{
+    MOS_TRACE_RING *pRing;
+
+    if (MosTraceRingFd < 0)
+    {
+        return;
+    }
+
+    // new events are ignored, a writer either sees this or has its in use
+    // flag seen below (both sides are sequentially consistent)
+    __atomic_store_n(&MosTraceRingEnabled, false, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&MosTraceFlusherStop, true, __ATOMIC_RELEASE);
+    MOS_WaitThread(MosTraceFlusher);
+    MosTraceFlusher = 0;
+
+    // the lock keeps exiting threads out, their destructors unlink under it
+    MOS_LockMutex(&MosTraceRingMutex);
+    while ((pRing = MosTraceRings) != nullptr)
+    {
+        while (__atomic_load_n(pRing->pInUse, __ATOMIC_SEQ_CST))
+        {
+            sched_yield();
+        }
+        MOS_TraceFlushRing(pRing);
+        if (pRing->ui64Dropped)
+        {
+            MOS_OS_NORMALMESSAGE("%" MOSu64 " trace events dropped by thread %u.", pRing->ui64Dropped, pRing->dwThreadId);
+        }
+        MosTraceRings = pRing->pNext;
+        MOS_FreeMemory(pRing);
+    }
+
+    // threads still holding a freed ring allocate a new one next session,
+    // and no destructor may run once the driver is unloaded
+    __atomic_store_n(&MosTraceSession, MosTraceSession + 1, __ATOMIC_RELEASE);
+    pthread_key_delete(MosTraceRingKey);
+    close(MosTraceRingFd);
+    MosTraceRingFd = -1;
+    MOS_UnlockMutex(&MosTraceRingMutex);
+}
+
 void MOS_TraceEventInit()
 {
     // close first, if already opened.
+    MOS_TraceRingClose();
     if (MosTraceFd >= 0)
     {
         close(MosTraceFd);
         MosTraceFd = -1;
     }
-    MosTraceFd = open(MosTracePath, O_WRONLY);
+
+    // binary records if an output file is given, else text to trace_marker
+    if (!MOS_TraceRingInit())
+    {
+        MosTraceFd = open(MosTracePath, O_WRONLY);
+    }
     return;
 }
 
 void MOS_TraceEventClose()
 {
+    MOS_TraceRingClose();
     if (MosTraceFd >= 0)
     {
         close(MosTraceFd);
@@ -2797,6 +3492,72 @@ void MOS_TraceEventClose()
     return;
 }
 
+//!
+//! \brief    Store a trace event into the ring of the calling thread
+//! \details  A few stores, no lock, no syscall. The event is dropped if the
+//!           flusher is behind and the ring is full.
+//!
+static void MOS_TraceEventRing(
+    uint16_t         usId,
+    uint8_t          ucType,
+    void * const     pArg1,
+    uint32_t         dwSize1,
+    void * const     pArg2,
+    uint32_t         dwSize2)
+{
+    MOS_TRACE_RING      *pRing;
+    MOS_TRACE_RECORD    *pRecord;
+    uint64_t            ui64Head;
+    uint32_t            dwCopy1;
+    uint32_t            dwCopy2;
+
+    if ((pRing = MOS_TraceGetThreadRing()) == nullptr)
+    {
+        return;
+    }
+
+    // close frees the ring once the flag is clear, recheck the session in
+    // case the ring was freed and tracing restarted since it was looked up
+    __atomic_store_n(&MosTraceThreadInUse, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&MosTraceRingEnabled, __ATOMIC_SEQ_CST) ||
+        MosTraceThreadSession != __atomic_load_n(&MosTraceSession, __ATOMIC_ACQUIRE))
+    {
+        __atomic_store_n(&MosTraceThreadInUse, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    ui64Head = pRing->ui64Head;
+    if (ui64Head - __atomic_load_n(&pRing->ui64Tail, __ATOMIC_ACQUIRE) >= MOS_TRACE_RING_SIZE)
+    {
+        pRing->ui64Dropped++;
+        __atomic_store_n(&MosTraceThreadInUse, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    pRecord = &pRing->Records[ui64Head % MOS_TRACE_RING_SIZE];
+    pRecord->ui64Time   = MOS_TraceGetTime();
+    pRecord->dwThreadId = pRing->dwThreadId;
+    pRecord->usId       = usId;
+    pRecord->ucType     = ucType;
+    pRecord->ucReserved = 0;
+
+    dwCopy1 = pArg1 ? MOS_MIN(dwSize1, MOS_TRACE_RECORD_DATA_SIZE) : 0;
+    dwCopy2 = (pArg1 && pArg2) ? MOS_MIN(dwSize2, MOS_TRACE_RECORD_DATA_SIZE - dwCopy1) : 0;
+    pRecord->usSize1 = pArg1 ? (uint16_t)MOS_MIN(dwSize1, 0xffff) : 0;
+    pRecord->usSize2 = (pArg1 && pArg2) ? (uint16_t)MOS_MIN(dwSize2, 0xffff) : 0;
+    if (dwCopy1)
+    {
+        memcpy(pRecord->ucData, pArg1, dwCopy1);
+    }
+    if (dwCopy2)
+    {
+        memcpy(pRecord->ucData + dwCopy1, pArg2, dwCopy2);
+    }
+
+    __atomic_store_n(&pRing->ui64Head, ui64Head + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&MosTraceThreadInUse, 0, __ATOMIC_RELEASE);
+}
+
 #define TRACE_EVENT_MAX_SIZE    4096
 void MOS_TraceEvent(
     uint16_t         usId,
@@ -2806,46 +3567,48 @@ void MOS_TraceEvent(
     void * const     pArg2,
     uint32_t         dwSize2)
 {
-    if (MosTraceFd >= 0)
+    if (__atomic_load_n(&MosTraceRingEnabled, __ATOMIC_ACQUIRE))
     {
-        char  *pTraceBuf = (char *)MOS_AllocAndZeroMemory(TRACE_EVENT_MAX_SIZE);
+        MOS_TraceEventRing(usId, ucType, pArg1, dwSize1, pArg2, dwSize2);
+    }
+    else if (MosTraceFd >= 0)
+    {
+        char       TraceBuf[TRACE_EVENT_MAX_SIZE];
+        char       *pTraceBuf = TraceBuf;
         uint32_t   nLen = 0;
 
-        if (pTraceBuf)
+        MOS_SecureStringPrint(pTraceBuf,
+                    TRACE_EVENT_MAX_SIZE,
+                    (TRACE_EVENT_MAX_SIZE-1),
+                    "IMTE|%d|%d", // magic number IMTE (IntelMediaTraceEvent)
+                    usId,
+                    ucType);
+        nLen = strlen(pTraceBuf);
+        if (pArg1)
         {
-            MOS_SecureStringPrint(pTraceBuf,
-                        TRACE_EVENT_MAX_SIZE,
-                        (TRACE_EVENT_MAX_SIZE-1),
-                        "IMTE|%d|%d", // magic number IMTE (IntelMediaTraceEvent)
-                        usId,
-                        ucType);
-            nLen = strlen(pTraceBuf);
-            if (pArg1)
-            {
-                // convert raw event data to string. native raw data will be supported
-                // from linux kernel 4.10, hopefully we can skip this convert in the future.
-                const static char n2c[] = "0123456789ABCDEF";
-                unsigned char *pData = (unsigned char *)pArg1;
+            // convert raw event data to string. native raw data will be supported
+            // from linux kernel 4.10, hopefully we can skip this convert in the future.
+            const static char n2c[] = "0123456789ABCDEF";
+            unsigned char *pData = (unsigned char *)pArg1;
 
-                pTraceBuf[nLen++] = '|'; // prefix splite marker.
-                while(dwSize1-- > 0 && nLen < TRACE_EVENT_MAX_SIZE-2)
+            pTraceBuf[nLen++] = '|'; // prefix splite marker.
+            while(dwSize1-- > 0 && nLen < TRACE_EVENT_MAX_SIZE-2)
+            {
+                pTraceBuf[nLen++] = n2c[(*pData) >> 4];
+                pTraceBuf[nLen++] = n2c[(*pData++) & 0xf];
+            }
+            if (pArg2)
+            {
+                pData = (unsigned char *)pArg2;
+                while(dwSize2-- > 0 && nLen < TRACE_EVENT_MAX_SIZE-2)
                 {
                     pTraceBuf[nLen++] = n2c[(*pData) >> 4];
                     pTraceBuf[nLen++] = n2c[(*pData++) & 0xf];
                 }
-                if (pArg2)
-                {
-                    pData = (unsigned char *)pArg2;
-                    while(dwSize2-- > 0 && nLen < TRACE_EVENT_MAX_SIZE-2)
-                    {
-                        pTraceBuf[nLen++] = n2c[(*pData) >> 4];
-                        pTraceBuf[nLen++] = n2c[(*pData++) & 0xf];
-                    }
-                }
             }
-            size_t writeSize = write(MosTraceFd, pTraceBuf, nLen);
-            MOS_FreeMemory(pTraceBuf);
         }
+        size_t writeSize = write(MosTraceFd, pTraceBuf, nLen);
+        MOS_UNUSED(writeSize);
     }
     return;
 }
@@ -94,6 +94,37 @@
 #define __MOS_USER_FEATURE_KEY_MESSAGE_DEFAULT_VALUE_STR     "1"
 #define __MOS_USER_FEATURE_VALUE_ADAPTIVE_TRANSFORM_DECISION_ENABLE_DEFAULT_VALUE "0"
 
+//!
+//! \brief Binary trace events, written instead of the trace_marker text when
+//!        MOS_TRACE_FILE_ENV names an output file. The file is a
+//!        MOS_TRACE_FILE_HEADER followed by MOS_TRACE_RECORDs, which
+//!        Tools/MediaDriverTools/TraceDecode prints.
+//!
+#define MOS_TRACE_FILE_ENV              "MOS_TRACE_FILE"
+#define MOS_TRACE_FILE_MAGIC            "IMTEBIN"   // IntelMediaTraceEvent, binary
+#define MOS_TRACE_FILE_VERSION          1
+#define MOS_TRACE_RECORD_DATA_SIZE      44
+
+typedef struct _MOS_TRACE_FILE_HEADER
+{
+    char        szMagic[8];
+    uint32_t    dwVersion;
+    uint32_t    dwRecordSize;
+    uint64_t    ui64StartTime;          // CLOCK_MONOTONIC time of MOS_TraceEventInit, in ns
+} MOS_TRACE_FILE_HEADER;
+
+typedef struct _MOS_TRACE_RECORD
+{
+    uint64_t    ui64Time;               // CLOCK_MONOTONIC time, in ns
+    uint32_t    dwThreadId;             // kernel thread id
+    uint16_t    usId;                   // MEDIA_EVENT
+    uint8_t     ucType;                 // MEDIA_EVENT_TYPE
+    uint8_t     ucReserved;
+    uint16_t    usSize1;                // size of arg1, only the part fitting in ucData is kept
+    uint16_t    usSize2;                // size of arg2, stored after arg1
+    uint8_t     ucData[MOS_TRACE_RECORD_DATA_SIZE];
+} MOS_TRACE_RECORD;
+
 typedef enum
 {
     LINUX_UF_FUNCTYPE_INVALID,
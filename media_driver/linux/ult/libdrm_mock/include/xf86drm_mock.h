@@ -122,6 +122,8 @@ typedef struct drmHashEntry {
 extern drm_export int semctl(int semid, int semnum, int cmd, ...);
 
 extern drm_export int mosdrmIoctl(int fd, unsigned long request, void *arg);
+// Execbuffers received so far, nothing is executed
+extern drm_export int mosdrmGetExecCount(void);
 extern int drmIoctl(int fd, unsigned long request, void *arg);
 extern void *drmGetHashTable(void);
 extern drmHashEntry *drmGetEntry(int fd);
@@ -2994,18 +2994,20 @@ mos_update_buffer_offsets2 (struct mos_bufmgr_gem *bufmgr_gem, mos_linux_context
 
 #if 0//ndef ANDROID
         if (cmd_bo != bo) {
-            auto item_ctx = ctx->pOsContext->contextOffsetList.begin();
-            for (; item_ctx != ctx->pOsContext->contextOffsetList.end(); item_ctx++) {
-                if (item_ctx->intel_context == ctx && item_ctx->target_bo == bo) {
-                    item_ctx->offset64 = bo->offset64;
+            auto &offsetMap = ctx->pOsContext->contextOffsetMap;
+            auto range = offsetMap.equal_range(bo);
+            auto item_ctx = range.first;
+            for (; item_ctx != range.second; item_ctx++) {
+                if (item_ctx->second.intel_context == ctx) {
+                    item_ctx->second.offset64 = bo->offset64;
                     break;
                 }
             }
-            if ( item_ctx == ctx->pOsContext->contextOffsetList.end()) {
+            if (item_ctx == range.second) {
                 struct MOS_CONTEXT_OFFSET newContext = {ctx,
                                     bo,
                                     bo->offset64};
-                ctx->pOsContext->contextOffsetList.push_back(newContext);
+                offsetMap.emplace(bo, newContext);
             }
         }
 #endif
@@ -0,0 +1,227 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include "gtest/gtest.h"
+#include "mos_cmdbufmgr.h"
+
+using namespace std;
+
+// Command buffers backed by nothing, only their size is tracked
+class FakeCommandBuffer : public CommandBuffer
+{
+public:
+    FakeCommandBuffer() { m_created++; m_live++; }
+
+    virtual ~FakeCommandBuffer() { m_live--; }
+
+    virtual MOS_STATUS Allocate(OsContext *osContext, uint32_t size)
+    {
+        m_size = size;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    virtual void Free() {}
+
+    virtual MOS_STATUS BindToGpuContext(GpuContext *gpuContext) { return MOS_STATUS_SUCCESS; }
+
+    virtual void UnBindToGpuContext() {}
+
+    virtual MOS_STATUS ReSize(uint32_t newSize)
+    {
+        m_size = newSize;
+        return MOS_STATUS_SUCCESS;
+    }
+
+    static atomic<int32_t> m_created;
+    static atomic<int32_t> m_live;
+};
+
+atomic<int32_t> FakeCommandBuffer::m_created(0);
+atomic<int32_t> FakeCommandBuffer::m_live(0);
+
+class CommandBuffer *CommandBuffer::CreateCmdBuf()
+{
+    return MOS_New(FakeCommandBuffer);
+}
+
+class FakeOsContext : public OsContext
+{
+public:
+    virtual MOS_STATUS Init(MOS_CONTEXT *osDriverContext) { return MOS_STATUS_SUCCESS; }
+
+    virtual void Destroy() {}
+};
+
+class CmdBufMgrTest : public testing::Test
+{
+protected:
+    static const uint32_t m_initSize = 0x1000;
+    static const int32_t  m_initNum  = 32;
+
+    virtual void SetUp()
+    {
+        FakeCommandBuffer::m_created = 0;
+        ASSERT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.Initialize(&m_osContext, m_initSize));
+        ASSERT_EQ(m_initNum, FakeCommandBuffer::m_created);
+    }
+
+    virtual void TearDown()
+    {
+        m_cmdBufMgr.CleanUp();
+        EXPECT_EQ(0, FakeCommandBuffer::m_live);
+    }
+
+    FakeOsContext m_osContext;
+    CmdBufMgr     m_cmdBufMgr;
+};
+
+const uint32_t CmdBufMgrTest::m_initSize;
+const int32_t  CmdBufMgrTest::m_initNum;
+
+TEST_F(CmdBufMgrTest, GrowsPoolInStepsWhenEmpty)
+{
+    set<CommandBuffer *> picked;
+    for (int32_t i = 0; i < m_initNum; i++)
+    {
+        auto cmdBuf = m_cmdBufMgr.PickupOneCmdBuf(m_initSize);
+        ASSERT_NE(nullptr, cmdBuf);
+        picked.insert(cmdBuf);
+    }
+    EXPECT_EQ((size_t)m_initNum, picked.size());
+    EXPECT_EQ(m_initNum, FakeCommandBuffer::m_created);
+
+    // an empty pool allocates a batch, only one buffer is handed out
+    auto cmdBuf = m_cmdBufMgr.PickupOneCmdBuf(m_initSize);
+    ASSERT_NE(nullptr, cmdBuf);
+    EXPECT_EQ(0u, picked.count(cmdBuf));
+    EXPECT_EQ(m_initNum + 8, FakeCommandBuffer::m_created);
+    picked.insert(cmdBuf);
+
+    for (auto buf : picked)
+    {
+        EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ReleaseCmdBuf(buf));
+    }
+}
+
+TEST_F(CmdBufMgrTest, PicksSmallestBufferLargeEnough)
+{
+    // the pool holds buffers, but none is large enough, only one is allocated
+    auto medium = m_cmdBufMgr.PickupOneCmdBuf(0x4000);
+    auto large  = m_cmdBufMgr.PickupOneCmdBuf(0x10000);
+    ASSERT_NE(nullptr, medium);
+    ASSERT_NE(nullptr, large);
+    EXPECT_EQ(0x4000u, medium->GetCmdBufSize());
+    EXPECT_EQ(0x10000u, large->GetCmdBufSize());
+    EXPECT_EQ(m_initNum + 2, FakeCommandBuffer::m_created);
+
+    EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ReleaseCmdBuf(large));
+    EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ReleaseCmdBuf(medium));
+
+    auto cmdBuf = m_cmdBufMgr.PickupOneCmdBuf(0x2000);
+    EXPECT_EQ(medium, cmdBuf);
+    EXPECT_EQ(large, m_cmdBufMgr.PickupOneCmdBuf(0x4001));
+    EXPECT_EQ(m_initSize, m_cmdBufMgr.PickupOneCmdBuf(m_initSize)->GetCmdBufSize());
+    EXPECT_EQ(m_initNum + 2, FakeCommandBuffer::m_created);
+}
+
+TEST_F(CmdBufMgrTest, ResizedBufferReturnsToItsNewSize)
+{
+    auto cmdBuf = m_cmdBufMgr.PickupOneCmdBuf(m_initSize);
+    ASSERT_NE(nullptr, cmdBuf);
+    EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ResizeOneCmdBuf(cmdBuf, 0x8000));
+    EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ReleaseCmdBuf(cmdBuf));
+
+    EXPECT_EQ(cmdBuf, m_cmdBufMgr.PickupOneCmdBuf(0x8000));
+    EXPECT_EQ(m_initNum, FakeCommandBuffer::m_created);
+}
+
+TEST_F(CmdBufMgrTest, ReleasesInAnyOrder)
+{
+    vector<CommandBuffer *> picked;
+    for (int32_t i = 0; i < m_initNum; i++)
+    {
+        picked.push_back(m_cmdBufMgr.PickupOneCmdBuf(m_initSize));
+    }
+
+    // every release moves the last in-use buffer into the vacated slot
+    shuffle(picked.begin(), picked.end(), mt19937(1));
+    for (auto cmdBuf : picked)
+    {
+        EXPECT_EQ(MOS_STATUS_SUCCESS, m_cmdBufMgr.ReleaseCmdBuf(cmdBuf));
+    }
+    EXPECT_EQ(m_initNum, FakeCommandBuffer::m_created);
+}
+
+TEST_F(CmdBufMgrTest, ConcurrentPickupAndRelease)
+{
+    const uint32_t threadNum = 8;
+    atomic<int32_t> failures(0);
+    vector<thread> threads;
+
+    for (uint32_t t = 0; t < threadNum; t++)
+    {
+        threads.push_back(thread([this, t, &failures]() {
+            mt19937 rng(t);
+            vector<CommandBuffer *> held;
+            for (uint32_t iter = 0; iter < 2000; iter++)
+            {
+                if (held.size() < 4 && rng() % 2)
+                {
+                    uint32_t size = m_initSize << (rng() % 4);
+                    auto cmdBuf = m_cmdBufMgr.PickupOneCmdBuf(size);
+                    if (cmdBuf == nullptr || cmdBuf->GetCmdBufSize() < size)
+                    {
+                        failures++;
+                        continue;
+                    }
+                    held.push_back(cmdBuf);
+                }
+                else if (!held.empty())
+                {
+                    uint32_t idx = rng() % held.size();
+                    if (m_cmdBufMgr.ReleaseCmdBuf(held[idx]) != MOS_STATUS_SUCCESS)
+                    {
+                        failures++;
+                    }
+                    held.erase(held.begin() + idx);
+                }
+            }
+            for (auto cmdBuf : held)
+            {
+                if (m_cmdBufMgr.ReleaseCmdBuf(cmdBuf) != MOS_STATUS_SUCCESS)
+                {
+                    failures++;
+                }
+            }
+        }));
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(0, failures);
+}
@@ -0,0 +1,246 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <random>
+#include "gtest/gtest.h"
+#include "heap_manager.h"
+
+using namespace std;
+
+// Heaps are backed by system memory instead of graphics resources
+#if MOS_MESSAGES_ENABLED
+static MOS_STATUS FakeAllocateResource(
+    PMOS_INTERFACE           osInterface,
+    PMOS_ALLOC_GFXRES_PARAMS params,
+    const char               *functionName,
+    const char               *filename,
+    int32_t                  line,
+    PMOS_RESOURCE            resource)
+#else
+static MOS_STATUS FakeAllocateResource(
+    PMOS_INTERFACE           osInterface,
+    PMOS_ALLOC_GFXRES_PARAMS params,
+    PMOS_RESOURCE            resource)
+#endif
+{
+    resource->pData = (uint8_t *)calloc(1, params->dwBytes);
+    return resource->pData ? MOS_STATUS_SUCCESS : MOS_STATUS_NO_SPACE;
+}
+
+#if MOS_MESSAGES_ENABLED
+static void FakeFreeResource(
+    PMOS_INTERFACE osInterface,
+    const char     *functionName,
+    const char     *filename,
+    int32_t        line,
+    PMOS_RESOURCE  resource)
+#else
+static void FakeFreeResource(
+    PMOS_INTERFACE osInterface,
+    PMOS_RESOURCE  resource)
+#endif
+{
+    free(resource->pData);
+    resource->pData = nullptr;
+}
+
+static void *FakeLockResource(
+    PMOS_INTERFACE   osInterface,
+    PMOS_RESOURCE    resource,
+    PMOS_LOCK_PARAMS flags)
+{
+    return resource->pData;
+}
+
+static MOS_STATUS FakeUnlockResource(
+    PMOS_INTERFACE osInterface,
+    PMOS_RESOURCE  resource)
+{
+    return MOS_STATUS_SUCCESS;
+}
+
+class MemoryBlockManagerTest : public testing::Test
+{
+protected:
+    static const uint32_t m_heapSize = 0x10000;
+
+    virtual void SetUp()
+    {
+        memset(&m_osInterface, 0, sizeof(m_osInterface));
+        m_osInterface.pfnAllocateResource = FakeAllocateResource;
+        m_osInterface.pfnFreeResource     = FakeFreeResource;
+        m_osInterface.pfnLockResource     = FakeLockResource;
+        m_osInterface.pfnUnlockResource   = FakeUnlockResource;
+
+        // the client clears blocks itself, a failed acquisition never extends the heap
+        m_heapManager.SetDefaultBehavior(HeapManager::Behavior::clientControlled);
+        ASSERT_EQ(MOS_STATUS_SUCCESS, m_heapManager.RegisterOsInterface(&m_osInterface));
+        ASSERT_EQ(MOS_STATUS_SUCCESS, m_heapManager.SetInitialHeapSize(m_heapSize));
+        ASSERT_EQ(MOS_STATUS_SUCCESS, m_heapManager.RegisterTrackerResource(&m_trackerData));
+    }
+
+    MOS_STATUS Acquire(uint32_t trackerId, vector<uint32_t> sizes, vector<MemoryBlock> &blocks, uint32_t &spaceNeeded)
+    {
+        MemoryBlockManager::AcquireParams params(trackerId, sizes);
+        blocks.resize(sizes.size());
+        return m_heapManager.AcquireSpace(params, blocks, spaceNeeded);
+    }
+
+    // Acquires and submits one block, the block is freed once m_trackerData reaches trackerId
+    MemoryBlock Submit(uint32_t trackerId, uint32_t size)
+    {
+        vector<MemoryBlock> blocks;
+        uint32_t spaceNeeded = 0;
+        EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(trackerId, {size}, blocks, spaceNeeded));
+        EXPECT_EQ(0u, spaceNeeded);
+        EXPECT_EQ(MOS_STATUS_SUCCESS, m_heapManager.SubmitBlocks(blocks));
+        return blocks[0];
+    }
+
+    // Frees every submitted block up to trackerId
+    void Complete(uint32_t trackerId, MemoryBlock block)
+    {
+        m_trackerData = trackerId;
+        EXPECT_EQ(MOS_STATUS_SUCCESS, m_heapManager.ClearSpace(block));
+    }
+
+    MOS_INTERFACE m_osInterface;
+    HeapManager   m_heapManager;
+    uint32_t      m_trackerData = 0;
+};
+
+const uint32_t MemoryBlockManagerTest::m_heapSize;
+
+TEST_F(MemoryBlockManagerTest, FitsLargestBlockOfSizeClass)
+{
+    const uint32_t pending = 0xffff;
+
+    // these sizes share a size class, keep them apart so they do not merge
+    auto large = Submit(1, 0x11c0);
+    Submit(pending, 0x400);
+    auto small = Submit(2, 0x1040);
+    Submit(pending, 0x400);
+    auto middle = Submit(3, 0x1100);
+    Submit(pending, m_heapSize - 0x11c0 - 0x1040 - 0x1100 - 0x800);
+
+    // free the largest block first so it ends up last in the size class list
+    Complete(1, large);
+    Complete(2, small);
+    Complete(3, middle);
+
+    vector<MemoryBlock> blocks;
+    uint32_t spaceNeeded = 0;
+    EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(4, {0x11c0}, blocks, spaceNeeded));
+    EXPECT_EQ(0u, spaceNeeded);
+    EXPECT_EQ(0x11c0u, blocks[0].GetSize());
+    EXPECT_EQ(m_heapSize, m_heapManager.GetTotalSize());
+
+    EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(4, {0x1100, 0x1040}, blocks, spaceNeeded));
+    EXPECT_EQ(0u, spaceNeeded);
+    EXPECT_EQ(MOS_STATUS_CLIENT_AR_NO_SPACE, Acquire(4, {0x40}, blocks, spaceNeeded));
+    EXPECT_EQ(0x40u, spaceNeeded);
+}
+
+TEST_F(MemoryBlockManagerTest, SplitsAndMergesFreeBlocks)
+{
+    auto block = Submit(1, m_heapSize - 0x2000);
+
+    vector<MemoryBlock> blocks;
+    uint32_t spaceNeeded = 0;
+    EXPECT_EQ(MOS_STATUS_CLIENT_AR_NO_SPACE, Acquire(2, {0x3000}, blocks, spaceNeeded));
+    EXPECT_EQ(0x3000u, spaceNeeded);
+
+    EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(2, {0x1000, 0x1000}, blocks, spaceNeeded));
+    EXPECT_EQ(0u, spaceNeeded);
+    EXPECT_EQ(MOS_STATUS_SUCCESS, m_heapManager.SubmitBlocks(blocks));
+
+    Complete(2, block);
+    EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(3, {m_heapSize}, blocks, spaceNeeded));
+    EXPECT_EQ(0u, spaceNeeded);
+}
+
+TEST_F(MemoryBlockManagerTest, RandomBlocksStayDisjointAndMergeBack)
+{
+    mt19937 rng(1);
+    uniform_int_distribution<uint32_t> sizeDist(1, 0x800);
+    vector<pair<uint32_t, MemoryBlock>> live;
+    uint32_t trackerId = 0;
+
+    for (uint32_t iter = 0; iter < 2000; iter++)
+    {
+        vector<MemoryBlock> blocks;
+        uint32_t spaceNeeded = 0;
+        MOS_STATUS status = Acquire(++trackerId, {sizeDist(rng), sizeDist(rng)}, blocks, spaceNeeded);
+        if (status == MOS_STATUS_SUCCESS)
+        {
+            ASSERT_EQ(0u, spaceNeeded);
+            ASSERT_EQ(MOS_STATUS_SUCCESS, m_heapManager.SubmitBlocks(blocks));
+            for (auto &block : blocks)
+            {
+                live.push_back(make_pair(trackerId, block));
+            }
+        }
+        else
+        {
+            ASSERT_EQ(MOS_STATUS_CLIENT_AR_NO_SPACE, status);
+            ASSERT_NE(0u, spaceNeeded);
+        }
+
+        // blocks in flight never overlap
+        vector<pair<uint32_t, uint32_t>> ranges;
+        for (auto &entry : live)
+        {
+            ranges.push_back(make_pair(entry.second.GetOffset(), entry.second.GetOffset() + entry.second.GetSize()));
+        }
+        sort(ranges.begin(), ranges.end());
+        for (uint32_t i = 1; i < ranges.size(); i++)
+        {
+            ASSERT_LE(ranges[i - 1].second, ranges[i].first);
+        }
+        ASSERT_TRUE(ranges.empty() || ranges.back().second <= m_heapSize);
+
+        // retire the oldest submissions now and then, in tracker order as the GPU would
+        if (!live.empty() && (rng() % 3 == 0 || status != MOS_STATUS_SUCCESS))
+        {
+            uint32_t retire = min<uint32_t>(rng() % 4 + 1, live.size());
+            uint32_t completedId = live[retire - 1].first;
+            while (retire < live.size() && live[retire].first == completedId)
+            {
+                retire++;
+            }
+            Complete(completedId, live[0].second);
+            live.erase(live.begin(), live.begin() + retire);
+        }
+    }
+
+    if (!live.empty())
+    {
+        Complete(trackerId, live[0].second);
+    }
+
+    // every freed block merged back, the whole heap is one block again
+    vector<MemoryBlock> blocks;
+    uint32_t spaceNeeded = 0;
+    EXPECT_EQ(MOS_STATUS_SUCCESS, Acquire(++trackerId, {m_heapSize}, blocks, spaceNeeded));
+    EXPECT_EQ(0u, spaceNeeded);
+    EXPECT_EQ(m_heapSize, m_heapManager.GetTotalSize());
+}
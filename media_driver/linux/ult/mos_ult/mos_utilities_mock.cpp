@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+//!
+//! \file     mos_utilities_mock.cpp
+//! \brief    Minimal MOS utilities for unit testing components outside the driver library.
+//!
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "mos_os.h"
+
+int32_t MosMemAllocCounter = 0;
+
+#if MOS_MESSAGES_ENABLED
+void *MOS_AllocAndZeroMemoryUtils(
+    size_t     size,
+    const char *functionName,
+    const char *filename,
+    int32_t    line)
+#else
+void *MOS_AllocAndZeroMemory(size_t size)
+#endif
+{
+    void *ptr = calloc(1, size);
+    if (ptr != nullptr)
+    {
+        MosMemAllocCounter++;
+    }
+    return ptr;
+}
+
+#if MOS_MESSAGES_ENABLED
+void MOS_FreeMemoryUtils(
+    void       *ptr,
+    const char *functionName,
+    const char *filename,
+    int32_t    line)
+#else
+void MOS_FreeMemory(void *ptr)
+#endif
+{
+    if (ptr != nullptr)
+    {
+        MosMemAllocCounter--;
+        free(ptr);
+    }
+}
+
+#if MOS_MESSAGES_ENABLED
+void MOS_Message(
+    MOS_MESSAGE_LEVEL level,
+    const PCCHAR      logtag,
+    MOS_COMPONENT_ID  compID,
+    uint8_t           subCompID,
+    const PCCHAR      functionName,
+    int32_t           lineNum,
+    const PCCHAR      message,
+                      ...)
+{
+    if (level != MOS_MESSAGE_LVL_CRITICAL)
+    {
+        return;
+    }
+
+    va_list args;
+    va_start(args, message);
+    fprintf(stderr, "%s: ", functionName);
+    vfprintf(stderr, message, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+#endif
+
+#if MOS_ASSERT_ENABLED
+void _MOS_Assert(
+    MOS_COMPONENT_ID compID,
+    uint8_t          subCompID)
+{
+}
+#endif
+
+MOS_STATUS MOS_SecureMemcpy(
+    void       *pDestination,
+    size_t     dstLength,
+    const void *pSource,
+    size_t     srcLength)
+{
+    if (pDestination == nullptr || pSource == nullptr)
+    {
+        return MOS_STATUS_NULL_POINTER;
+    }
+    if (dstLength < srcLength)
+    {
+        return MOS_STATUS_INVALID_PARAMETER;
+    }
+    memcpy(pDestination, pSource, srcLength);
+    return MOS_STATUS_SUCCESS;
+}
+
+int32_t MOS_SecureStringPrint(
+    char              *buffer,
+    size_t            bufSize,
+    size_t            length,
+    const char *const format,
+                      ...)
+{
+    va_list args;
+    va_start(args, format);
+    int32_t ret = vsnprintf(buffer, bufSize < length ? bufSize : length, format, args);
+    va_end(args);
+    return ret;
+}
+
+MOS_STATUS MOS_WriteFileFromPtr(
+    const char *pFilename,
+    void       *lpBuffer,
+    uint32_t   writeSize)
+{
+    return MOS_STATUS_UNIMPLEMENTED;
+}
+
+void MOS_Sleep(uint32_t mSec)
+{
+    usleep(1000 * mSec);
+}
+
+int32_t Mos_ResourceIsNull(PMOS_RESOURCE pOsResource)
+{
+    return (pOsResource->pData == nullptr);
+}
+
+PMOS_MUTEX MOS_CreateMutex()
+{
+    PMOS_MUTEX mutex = (PMOS_MUTEX)MOS_AllocAndZeroMemory(sizeof(MOS_MUTEX));
+    if (mutex != nullptr)
+    {
+        pthread_mutex_init(mutex, nullptr);
+    }
+    return mutex;
+}
+
+MOS_STATUS MOS_DestroyMutex(PMOS_MUTEX mutex)
+{
+    if (mutex != nullptr)
+    {
+        pthread_mutex_destroy(mutex);
+        MOS_FreeMemory(mutex);
+    }
+    return MOS_STATUS_SUCCESS;
+}
+
+MOS_STATUS MOS_LockMutex(PMOS_MUTEX mutex)
+{
+    return (mutex && pthread_mutex_lock(mutex) == 0) ? MOS_STATUS_SUCCESS : MOS_STATUS_UNKNOWN;
+}
+
+MOS_STATUS MOS_UnlockMutex(PMOS_MUTEX mutex)
+{
+    return (mutex && pthread_mutex_unlock(mutex) == 0) ? MOS_STATUS_SUCCESS : MOS_STATUS_UNKNOWN;
+}
@@ -19,6 +19,8 @@
 * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
 * OTHER DEALINGS IN THE SOFTWARE.
 */
+#include <chrono>
+#include <dlfcn.h>
 #include "ddi_test_decode.h"
 
 using namespace std;
@@ -37,6 +39,52 @@ TEST_F(MediaDecodeDdiTest, DecodeAVCLong)
     delete pDecData;
 }
 
+// CPU cost of building and submitting the AVC decode commands, the libdrm
+// mock does not execute the batch buffers. Not run by default, use
+// --gtest_also_run_disabled_tests --gtest_filter=*DecodeAVCLongPerf
+TEST_F(MediaDecodeDdiTest, DISABLED_DecodeAVCLongPerf)
+{
+    DecTestData *pDecData = m_decDataFactory.GetDecTestData("AVC-Long");
+    m_repeatCount = 100;
+    ExectueDecodeTest(pDecData);
+    delete pDecData;
+}
+
+// Deferred submission chains the batches of a GPU context, it must never
+// take more execbuffers than direct submission. Counted by the libdrm mock.
+TEST_F(MediaDecodeDdiTest, DecodeAVCLongDeferredSubmission)
+{
+    typedef int (*GetExecCountFunc)();
+    GetExecCountFunc getExecCount = (GetExecCountFunc)dlsym(RTLD_DEFAULT, "mosdrmGetExecCount");
+    ASSERT_NE(nullptr, getExecCount) << "libdrm_mock is not preloaded" << endl;
+
+    DecTestData *pDecData = m_decDataFactory.GetDecTestData("AVC-Long");
+
+    int execCount = getExecCount();
+    ExectueDecodeTest(pDecData);
+    int directExecs  = getExecCount() - execCount;
+    int directFrames = m_frameCount;
+
+    m_driverLoader.m_deferredSubmission = 1;
+    m_frameCount = 0;
+    execCount    = getExecCount();
+    ExectueDecodeTest(pDecData);
+    int deferredExecs  = getExecCount() - execCount;
+    int deferredFrames = m_frameCount;
+    delete pDecData;
+
+    if (directFrames == 0)
+    {
+        return;
+    }
+    EXPECT_EQ(directFrames, deferredFrames);
+    EXPECT_GT(directExecs, 0);
+    EXPECT_GT(deferredExecs, 0);
+    EXPECT_LE(deferredExecs, directExecs);
+    cout << "Execbuffers per frame: direct = " << (double)directExecs / directFrames
+        << ", deferred = " << (double)deferredExecs / deferredFrames << endl;
+}
+
 void MediaDecodeDdiTest::ExectueDecodeTest(DecTestData *pDecData)
 {
     vector<Platform_t> platforms = m_driverLoader.GetPlatforms();
@@ -80,8 +128,12 @@ void MediaDecodeDdiTest::DecodeExecute(DecTestData *pDecData, Platform_t platfor
     EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platform]
         << ", Failed function = m_driverLoader.m_ctx.vtable->vaCreateContext" << endl;
 
-    for (int i = 0; i < pDecData->m_num_frames; i++)
+    chrono::steady_clock::duration endPictureTime = chrono::steady_clock::duration::zero();
+
+    for (int n = 0; n < pDecData->m_num_frames * m_repeatCount; n++)
     {
+        int i = n % pDecData->m_num_frames;
+
         // As BeginPicture would reset some parameters, so it should be called before RenderPicture.
         ret = m_driverLoader.m_ctx.vtable->vaBeginPicture(&m_driverLoader.m_ctx, context_id, resources[0]);
         EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platform]
@@ -106,10 +158,14 @@ void MediaDecodeDdiTest::DecodeExecute(DecTestData *pDecData, Platform_t platfor
                 << ", Failed function = m_driverLoader.m_ctx.vtable->vaRenderPicture" << endl;
         }
 
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
         ret = m_driverLoader.m_ctx.vtable->vaEndPicture(&m_driverLoader.m_ctx, context_id);
+        endPictureTime += chrono::steady_clock::now() - start;
         EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platform]
             << ", Failed function = m_driverLoader.m_ctx.vtable->vaEndPicture" << endl;
 
+        m_frameCount++;
+
         do
         {
             ret = m_driverLoader.m_ctx.vtable->vaQuerySurfaceStatus(
@@ -124,6 +180,14 @@ void MediaDecodeDdiTest::DecodeExecute(DecTestData *pDecData, Platform_t platfor
         }
       }
 
+    if (m_repeatCount > 1)
+    {
+        cout << "Platform = " << g_platformName[platform] << ", vaEndPicture = "
+            << chrono::duration_cast<chrono::nanoseconds>(endPictureTime).count() /
+               (pDecData->m_num_frames * m_repeatCount) / 1000.0
+            << " us per frame" << endl;
+    }
+
     ret = m_driverLoader.m_ctx.vtable->vaDestroySurfaces(&m_driverLoader.m_ctx, &resources[0], resources.size());
     EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platform]
         << ", Failed function = m_driverLoader.m_ctx.vtable->vaDestroySurfaces" << endl;
@@ -58,6 +58,8 @@ protected:
     DriverDllLoader    m_driverLoader;
     DecTestDataFactory m_decDataFactory;
     DecodeTestConfig   m_decTestCfg;
+    int                m_repeatCount = 1;  // Times the frames are decoded, the CPU time of vaEndPicture is printed if more than 1
+    int                m_frameCount  = 0;  // Frames decoded on all platforms
 };
 
 #endif // __DDI_TEST_DECODE_H__
@@ -0,0 +1,221 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include "ddi_test_heap.h"
+
+using namespace std;
+
+const uint32_t MediaHeapDdiTest::m_heapIndexMask;
+const uint32_t MediaHeapDdiTest::m_heapGenerationShift;
+const uint32_t MediaHeapDdiTest::m_heapGenerationNum;
+const uint32_t MediaHeapDdiTest::m_heapChunkSize;
+
+VAStatus MediaHeapDdiTest::CreateSurfaces(VASurfaceID *surfaces, int num)
+{
+    return m_driverLoader.m_ctx.vtable->vaCreateSurfaces2(&m_driverLoader.m_ctx, VA_RT_FORMAT_YUV420,
+        64, 64, surfaces, num, nullptr, 0);
+}
+
+VAStatus MediaHeapDdiTest::DestroySurfaces(VASurfaceID *surfaces, int num)
+{
+    return m_driverLoader.m_ctx.vtable->vaDestroySurfaces(&m_driverLoader.m_ctx, surfaces, num);
+}
+
+VAStatus MediaHeapDdiTest::QuerySurface(VASurfaceID surface)
+{
+    VASurfaceStatus status;
+    return m_driverLoader.m_ctx.vtable->vaQuerySurfaceStatus(&m_driverLoader.m_ctx, surface, &status);
+}
+
+// A released ID must not alias the element once it is handed out again
+TEST_F(MediaHeapDdiTest, ReleasedSurfaceIdIsStale)
+{
+    vector<Platform_t> platforms = m_driverLoader.GetPlatforms();
+    for (int i = 0; i < m_driverLoader.GetPlatformNum(); i++)
+    {
+        int ret = m_driverLoader.InitDriver(platforms[i]);
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.InitDriver" << endl;
+
+        VASurfaceID released;
+        ASSERT_EQ(VA_STATUS_SUCCESS, CreateSurfaces(&released, 1));
+        EXPECT_EQ(VA_STATUS_SUCCESS, DestroySurfaces(&released, 1));
+
+        // the free list hands the element just released out first, under the next generation
+        VASurfaceID reused;
+        ASSERT_EQ(VA_STATUS_SUCCESS, CreateSurfaces(&reused, 1));
+        EXPECT_EQ(released & m_heapIndexMask, reused & m_heapIndexMask);
+        EXPECT_EQ(((released >> m_heapGenerationShift) + 1) % m_heapGenerationNum,
+            reused >> m_heapGenerationShift);
+
+        EXPECT_EQ(VA_STATUS_ERROR_INVALID_SURFACE, QuerySurface(released));
+        EXPECT_EQ(VA_STATUS_ERROR_INVALID_SURFACE, DestroySurfaces(&released, 1));
+        EXPECT_EQ(VA_STATUS_ERROR_INVALID_SURFACE, QuerySurface(released | ~(m_heapIndexMask | (0xF << m_heapGenerationShift))));
+        EXPECT_EQ(VA_STATUS_SUCCESS, QuerySurface(reused));
+        EXPECT_EQ(VA_STATUS_SUCCESS, DestroySurfaces(&reused, 1));
+
+        ret = m_driverLoader.CloseDriver();
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.CloseDriver" << endl;
+
+        MemoryLeakDetector::Detect(m_driverLoader, platforms[i]);
+    }
+}
+
+// IDs stay unique and valid while the heap grows by several chunks
+TEST_F(MediaHeapDdiTest, SurfaceIdsAcrossChunks)
+{
+    vector<Platform_t> platforms = m_driverLoader.GetPlatforms();
+    for (int i = 0; i < m_driverLoader.GetPlatformNum(); i++)
+    {
+        int ret = m_driverLoader.InitDriver(platforms[i]);
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.InitDriver" << endl;
+
+        vector<VASurfaceID> surfaces(m_heapChunkSize * 2 + 1);
+        ASSERT_EQ(VA_STATUS_SUCCESS, CreateSurfaces(&surfaces[0], surfaces.size()));
+        EXPECT_EQ(surfaces.size(), set<VASurfaceID>(surfaces.begin(), surfaces.end()).size());
+        for (auto surface : surfaces)
+        {
+            EXPECT_EQ(VA_STATUS_SUCCESS, QuerySurface(surface));
+        }
+
+        EXPECT_EQ(VA_STATUS_SUCCESS, DestroySurfaces(&surfaces[0], surfaces.size()));
+        for (auto surface : surfaces)
+        {
+            EXPECT_EQ(VA_STATUS_ERROR_INVALID_SURFACE, QuerySurface(surface));
+        }
+
+        ret = m_driverLoader.CloseDriver();
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.CloseDriver" << endl;
+
+        MemoryLeakDetector::Detect(m_driverLoader, platforms[i]);
+    }
+}
+
+// Lookups do not take the surface mutex, they race with the allocations,
+// releases and heap growth of the other threads.
+TEST_F(MediaHeapDdiTest, ConcurrentCreateDestroyAndLookup)
+{
+    const int threadNum = 8;
+
+    vector<Platform_t> platforms = m_driverLoader.GetPlatforms();
+    for (int i = 0; i < m_driverLoader.GetPlatformNum(); i++)
+    {
+        int ret = m_driverLoader.InitDriver(platforms[i]);
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.InitDriver" << endl;
+
+        atomic<uint32_t> createsStarted(0);
+        atomic<uint32_t> createsFinished(0);
+        atomic<int>      failures(0);
+        mutex            liveMutex;
+        set<VASurfaceID> live;
+
+        auto worker = [&](int seed) {
+            mt19937 rng(seed);
+            vector<VASurfaceID> held;
+            for (int iter = 0; iter < 500; iter++)
+            {
+                if (held.size() < 64 && rng() % 2)
+                {
+                    VASurfaceID surface;
+                    createsStarted++;
+                    VAStatus status = CreateSurfaces(&surface, 1);
+                    createsFinished++;
+                    if (status != VA_STATUS_SUCCESS)
+                    {
+                        failures++;
+                        continue;
+                    }
+
+                    // no live surface may share the ID
+                    lock_guard<mutex> lock(liveMutex);
+                    if (!live.insert(surface).second)
+                    {
+                        failures++;
+                    }
+                    held.push_back(surface);
+                }
+                else if (!held.empty())
+                {
+                    uint32_t    idx     = rng() % held.size();
+                    VASurfaceID surface = held[idx];
+                    held.erase(held.begin() + idx);
+                    {
+                        lock_guard<mutex> lock(liveMutex);
+                        live.erase(surface);
+                    }
+
+                    // the element can only come back under the same ID after all
+                    // generations went by, which takes that many allocations
+                    uint32_t finished = createsFinished;
+                    if (DestroySurfaces(&surface, 1) != VA_STATUS_SUCCESS)
+                    {
+                        failures++;
+                    }
+                    VAStatus status = QuerySurface(surface);
+                    if (createsStarted - finished < m_heapGenerationNum && status != VA_STATUS_ERROR_INVALID_SURFACE)
+                    {
+                        failures++;
+                    }
+                }
+
+                for (auto surface : held)
+                {
+                    if (QuerySurface(surface) != VA_STATUS_SUCCESS)
+                    {
+                        failures++;
+                    }
+                }
+            }
+
+            if (!held.empty() && DestroySurfaces(&held[0], held.size()) != VA_STATUS_SUCCESS)
+            {
+                failures++;
+            }
+        };
+
+        vector<thread> threads;
+        for (int t = 0; t < threadNum; t++)
+        {
+            threads.push_back(thread(worker, t));
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        EXPECT_EQ(0, failures) << "Platform = " << g_platformName[platforms[i]] << endl;
+
+        ret = m_driverLoader.CloseDriver();
+        EXPECT_EQ(VA_STATUS_SUCCESS, ret) << "Platform = " << g_platformName[platforms[i]]
+            << ", Failed function = m_driverLoader.CloseDriver" << endl;
+
+        MemoryLeakDetector::Detect(m_driverLoader, platforms[i]);
+    }
+}
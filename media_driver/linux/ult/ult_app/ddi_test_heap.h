@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2018, Intel Corporation
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included
+* in all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+* OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+* OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+* ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+* OTHER DEALINGS IN THE SOFTWARE.
+*/
+#ifndef __DDI_TEST_HEAP_H__
+#define __DDI_TEST_HEAP_H__
+
+#include "driver_loader.h"
+#include "gtest/gtest.h"
+#include "memory_leak_detector.h"
+
+class MediaHeapDdiTest : public testing::Test
+{
+protected:
+
+    virtual void SetUp() { }
+
+    virtual void TearDown() { }
+
+    VAStatus CreateSurfaces(VASurfaceID *surfaces, int num);
+
+    VAStatus DestroySurfaces(VASurfaceID *surfaces, int num);
+
+    VAStatus QuerySurface(VASurfaceID surface);
+
+protected:
+
+    // Layout of the object IDs handed out by the DDI heaps, see media_libva_common.h
+    static const uint32_t m_heapIndexMask       = 0x00FFFFFF;
+    static const uint32_t m_heapGenerationShift = 24;
+    static const uint32_t m_heapGenerationNum   = 16;
+    static const uint32_t m_heapChunkSize       = 256;
+
+    DriverDllLoader m_driverLoader;
+};
+
+#endif // __DDI_TEST_HEAP_H__
@@ -114,13 +114,15 @@ VAStatus DriverDllLoader::InitDriver(int platform_id)
             {
                 vaCmExtSendReqMsg         = (CmExtSendReqMsgFunc)dlsym(m_umdhandle, cm_entry_name);
                 MOS_SetUltFlag            = (MOS_SetUltFlagFunc)dlsym(m_umdhandle, "MOS_SetUltFlag");
+                MOS_SetUltDeferredSubmission = (MOS_SetUltFlagFunc)dlsym(m_umdhandle, "MOS_SetUltDeferredSubmission");
                 MOS_GetMemNinjaCounter    = (MOS_GetMemNinjaCounterFunc)dlsym(m_umdhandle, "MOS_GetMemNinjaCounter");
                 MOS_GetMemNinjaCounterGfx = (MOS_GetMemNinjaCounterFunc)dlsym(m_umdhandle, "MOS_GetMemNinjaCounterGfx");
                 break;
             }
         }
 
-        if (!init_func || !vaCmExtSendReqMsg || !MOS_SetUltFlag || !MOS_GetMemNinjaCounter || !MOS_GetMemNinjaCounterGfx)
+        if (!init_func || !vaCmExtSendReqMsg || !MOS_SetUltFlag || !MOS_SetUltDeferredSubmission ||
+            !MOS_GetMemNinjaCounter || !MOS_GetMemNinjaCounterGfx)
         {
             return VA_STATUS_ERROR_UNKNOWN;
         }
@@ -130,6 +132,8 @@ VAStatus DriverDllLoader::InitDriver(int platform_id)
         m_ctx.drm_state  = &m_drmstate;
 
         MOS_SetUltFlag(1);
+        // The driver is kept loaded, set it on every init so it doesn't leak into the next test
+        MOS_SetUltDeferredSubmission(m_deferredSubmission);
         return (*init_func)(&m_ctx);
     }
 }
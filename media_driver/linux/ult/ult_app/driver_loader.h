@@ -91,6 +91,7 @@ public:
 
     CmExtSendReqMsgFunc         vaCmExtSendReqMsg;
     MOS_SetUltFlagFunc          MOS_SetUltFlag;
+    MOS_SetUltFlagFunc          MOS_SetUltDeferredSubmission;
     MOS_GetMemNinjaCounterFunc  MOS_GetMemNinjaCounter;
     MOS_GetMemNinjaCounterFunc  MOS_GetMemNinjaCounterGfx;
 
@@ -99,6 +100,7 @@ public:
     VADriverContext             m_ctx;
     VADriverVTable              m_vtable;
     VADriverVTableVPP           m_vtable_vpp;
+    uint8_t                     m_deferredSubmission = 0;  // Chain the batches of a GPU context, applied by InitDriver
 
 private:
 